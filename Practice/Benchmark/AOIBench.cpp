@@ -0,0 +1,214 @@
+﻿// 2026 10 18 이정모 home
+//
+// AOIGrid(균일 격자 AOI) 성능 측정
+//
+// 4km x 4km map에 entity 10000개를 뿌려두고 tick(100ms)마다 모두 조금씩 움직인다.
+// 일부는 방향을 바꾸고, 아주 일부는 멀리 순간이동해서 cell이 크게 바뀌는 경우도 섞는다.
+//
+// 측정(tick 하나 기준)
+// - 모든 entity의 Move() 시간
+// - CollectDeltas()로 appear/disappear 목록을 만드는 시간과 목록 크기
+// - 모든 entity가 자기 이동을 주변에 알리기 위해 받을 대상을 모으는 시간
+//   AOIGrid::GatherNearEntities()와 모든 entity를 훑어보는 방식(지금까지의 방법)을 비교한다.
+//   모든 entity를 훑어보는 방식은 O(N^2)이라 앞쪽 몇 tick만 잰다.
+//
+// 두 방식 모두 3x3 cell 안의 entity를 대상으로 하기 때문에 대상 수는 같아야 한다.
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+
+#include "Log.h"
+#include "Connection.h"
+#include "AOIGrid.h"
+#include "IOCPServer.h"
+
+// benchmark는 NetworkLibrary만 link하기 때문에 server 객체가 필요하지만
+// Connection을 사용하지 않으니 아무 server도 알려주지 않는다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return nullptr;
+}
+
+constexpr float MAP_SIZE{ 4000.0f };
+constexpr float TICK_SEC{ 0.1f };
+
+// 모든 entity를 훑어보는 방식은 이 tick 수만큼만 잰다.
+constexpr int NAIVE_TICK_CNT{ 3 };
+
+struct MovingEntity
+{
+	float mX;
+	float mY;
+	float mDirX;
+	float mDirY;
+};
+
+double GetElapsedMsec(std::chrono::steady_clock::time_point beginTime)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count();
+}
+
+int main(int argc, char* argv[])
+{
+	const char* usage = "usage: AOIBench [entityCnt] [tickCnt] [cellSize] [speed(m/s)]";
+
+	if (argc > 1 && 0 >= atoi(argv[1]))
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	int entityCnt = argc > 1 ? atoi(argv[1]) : 10000;
+	int tickCnt = argc > 2 ? atoi(argv[2]) : 100;
+	float cellSize = argc > 3 ? static_cast<float>(atof(argv[3])) : 100.0f;
+	float speed = argc > 4 ? static_cast<float>(atof(argv[4])) : 5.0f;
+
+	AOIGrid aoiGrid;
+	if (false == aoiGrid.Create(MAP_SIZE, MAP_SIZE, cellSize, entityCnt))
+	{
+		std::cout << "AOIGrid::Create() failed" << std::endl;
+		return 1;
+	}
+
+	std::mt19937 random{ 1234 };
+	std::uniform_real_distribution<float> positionDist{ 0.0f, MAP_SIZE };
+	std::uniform_real_distribution<float> angleDist{ 0.0f, 6.2831853f };
+	std::uniform_int_distribution<int> eventDist{ 0, 999 };
+
+	std::vector<MovingEntity> entities(entityCnt);
+	for (int id = 0; id < entityCnt; ++id)
+	{
+		float angle = angleDist(random);
+		entities[id] = MovingEntity{ positionDist(random), positionDist(random), std::cos(angle), std::sin(angle) };
+
+		aoiGrid.Enter(id, entities[id].mX, entities[id].mY, true);
+	}
+
+	// Enter()로 생긴 처음 목록은 측정에서 뺀다.
+	aoiGrid.CollectDeltas();
+
+	double moveMsec{ 0.0 };
+	double deltaMsec{ 0.0 };
+	double gatherMsec{ 0.0 };
+	double naiveMsec{ 0.0 };
+	LONG64 deltaCnt{ 0 };
+	LONG64 gatherTargetCnt{ 0 };
+	LONG64 naiveTargetCnt{ 0 };
+	LONG64 naiveCompareTargetCnt{ 0 };
+
+	std::vector<AOIEntityId> nearEntities;
+	nearEntities.reserve(entityCnt);
+
+	for (int tick = 0; tick < tickCnt; ++tick)
+	{
+		// 위치 계산은 측정에서 뺀다.
+		for (MovingEntity& entity : entities)
+		{
+			int event = eventDist(random);
+			if (0 == event)
+			{
+				entity.mX = positionDist(random);
+				entity.mY = positionDist(random);
+				continue;
+			}
+
+			if (20 > event)
+			{
+				float angle = angleDist(random);
+				entity.mDirX = std::cos(angle);
+				entity.mDirY = std::sin(angle);
+			}
+
+			entity.mX += entity.mDirX * speed * TICK_SEC;
+			entity.mY += entity.mDirY * speed * TICK_SEC;
+
+			// map 끝에 닿으면 되돌아간다.
+			if (0.0f > entity.mX || MAP_SIZE < entity.mX)
+			{
+				entity.mDirX = -entity.mDirX;
+				entity.mX = std::fmin(std::fmax(entity.mX, 0.0f), MAP_SIZE);
+			}
+
+			if (0.0f > entity.mY || MAP_SIZE < entity.mY)
+			{
+				entity.mDirY = -entity.mDirY;
+				entity.mY = std::fmin(std::fmax(entity.mY, 0.0f), MAP_SIZE);
+			}
+		}
+
+		auto beginTime = std::chrono::steady_clock::now();
+		for (int id = 0; id < entityCnt; ++id)
+		{
+			aoiGrid.Move(id, entities[id].mX, entities[id].mY);
+		}
+		moveMsec += GetElapsedMsec(beginTime);
+
+		beginTime = std::chrono::steady_clock::now();
+		deltaCnt += aoiGrid.CollectDeltas().size();
+		deltaMsec += GetElapsedMsec(beginTime);
+
+		beginTime = std::chrono::steady_clock::now();
+		LONG64 tickTargetCnt{ 0 };
+		for (int id = 0; id < entityCnt; ++id)
+		{
+			tickTargetCnt += aoiGrid.GatherNearEntities(id, nearEntities);
+		}
+		gatherMsec += GetElapsedMsec(beginTime);
+		gatherTargetCnt += tickTargetCnt;
+
+		if (NAIVE_TICK_CNT > tick)
+		{
+			naiveCompareTargetCnt += tickTargetCnt;
+
+			beginTime = std::chrono::steady_clock::now();
+			for (int id = 0; id < entityCnt; ++id)
+			{
+				int column = static_cast<int>(entities[id].mX / cellSize);
+				int row = static_cast<int>(entities[id].mY / cellSize);
+
+				nearEntities.clear();
+				for (int otherId = 0; otherId < entityCnt; ++otherId)
+				{
+					int otherColumn = static_cast<int>(entities[otherId].mX / cellSize);
+					int otherRow = static_cast<int>(entities[otherId].mY / cellSize);
+
+					if (id != otherId && 1 >= std::abs(column - otherColumn) && 1 >= std::abs(row - otherRow))
+					{
+						nearEntities.push_back(otherId);
+					}
+				}
+
+				naiveTargetCnt += nearEntities.size();
+			}
+			naiveMsec += GetElapsedMsec(beginTime);
+		}
+	}
+
+	int naiveTickCnt = tickCnt < NAIVE_TICK_CNT ? tickCnt : NAIVE_TICK_CNT;
+
+	printf("entities:               %d\n", entityCnt);
+	printf("cells:                  %d (cell size %.0fm)\n", aoiGrid.GetCellCount(), cellSize);
+	printf("ticks:                  %d\n", tickCnt);
+	printf("move msec/tick:         %.3f\n", moveMsec / tickCnt);
+	printf("delta msec/tick:        %.3f\n", deltaMsec / tickCnt);
+	printf("deltas/tick:            %.1f\n", static_cast<double>(deltaCnt) / tickCnt);
+	printf("grid gather msec/tick:  %.3f\n", gatherMsec / tickCnt);
+	printf("targets/entity:         %.1f\n", static_cast<double>(gatherTargetCnt) / tickCnt / entityCnt);
+
+	if (0 < naiveTickCnt)
+	{
+		printf("naive gather msec/tick: %.3f\n", naiveMsec / naiveTickCnt);
+		printf("target count mismatch:  %lld\n", naiveTargetCnt - naiveCompareTargetCnt);
+	}
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,389 @@
+﻿// 2026 10 18 이정모 home
+//
+// IO backend(epoll, io_uring) 성능 비교
+//
+// NetworkLibrary의 Connection, IOBackend만 사용하는 echo server를 띄우고
+// fork()한 client 프로세스가 많은 연결로 패킷을 주고받는다.
+// client는 모든 연결에 패킷을 하나씩 보낸 뒤에 모든 연결에서 echo를 받는 것을 반복해서
+// server의 worker thread가 한 번 깨어날 때 여러 완료 통지를 처리하게 만든다.
+//
+// server 프로세스 기준으로 측정
+// - 초당 패킷 수
+// - 패킷 하나를 처리하는데 호출한 시스템 콜 수(IOBackend::GetSyscallCount())
+// - 패킷 하나를 처리하는데 사용한 CPU 시간(getrusage())
+// - worker thread가 한 번 깨어날 때 처리한 완료 통지 수(IOBackend::GetAverageCompletionsPerWakeup())
+//
+// 연결 수만큼 file descriptor가 필요해서 시작할 때 RLIMIT_NOFILE을 올린다.
+// hard limit보다 많이 필요하면 root로 실행하거나 ulimit -Hn을 올려야 한다.
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "Log.h"
+#include "Connection.h"
+#include "IOBackend.h"
+#include "IOCPServer.h"
+
+const char* SERVER_IP = "127.0.0.1";
+const int SERVER_PORT = 8100;
+
+constexpr int PACKET_SIZE{ 64 };
+
+std::atomic<LONG64> gRecvPacketCnt{ 0 };
+
+// server가 OnAccept()까지 마친 연결 수
+std::atomic<int> gAcceptCnt{ 0 };
+
+// 연결을 마친 client thread 수
+std::atomic<int> gConnectedThreadCnt{ 0 };
+int gClientThreadCnt{ 4 };
+
+// server가 측정 시작 값을 읽은 뒤에 client thread들이 보내기 시작한다.
+std::atomic<bool> gIsStarted{ false };
+
+// 받은 패킷을 그대로 돌려주는 server
+class EchoServer : public IOCPServer
+{
+public:
+	bool OnAccept(Connection*) override
+	{
+		gAcceptCnt.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool OnRecv(Connection* pConnection, DWORD size, char* pPacket) override
+	{
+		// echo를 보내기 전에 세야 client가 마지막 echo를 받고 끝났을 때 모두 세어져 있다.
+		gRecvPacketCnt.fetch_add(1, std::memory_order_relaxed);
+
+		// PrepareSendPacket()이 앞 4byte에 패킷 크기를 채워준다.
+		char* pSendPacket = pConnection->PrepareSendPacket(size);
+		if (nullptr == pSendPacket)
+		{
+			return false;
+		}
+
+		CopyMemory(pSendPacket + 4, pPacket + 4, size - 4);
+		pConnection->SendPost();
+
+		return true;
+	}
+
+	void OnClose(Connection*) override
+	{
+	}
+
+	bool CloseConnection(Connection* pConnection) override
+	{
+		return pConnection->CloseConnection();
+	}
+};
+
+EchoServer gEchoServer;
+
+// benchmark는 NetworkLibrary만 link하기 때문에
+// Connection이 사용하는 server 객체를 여기서 알려준다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return &gEchoServer;
+}
+
+// client thread 하나가 연결 여러 개를 맡아서 보내고 받는다.
+void ClientThread(int connectionCnt, int roundCnt)
+{
+	SOCKADDR_IN serverAddr{};
+	serverAddr.sin_family = AF_INET;
+	serverAddr.sin_port = htons(SERVER_PORT);
+	inet_pton(AF_INET, SERVER_IP, &serverAddr.sin_addr);
+
+	std::vector<SOCKET> sockets;
+	for (int i = 0; i < connectionCnt; ++i)
+	{
+		SOCKET clientSocket = socket(AF_INET, SOCK_STREAM, 0);
+		if (0 != connect(clientSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)))
+		{
+			std::cout << "connect() failed: " << errno << std::endl;
+			std::exit(1);
+		}
+
+		sockets.push_back(clientSocket);
+	}
+
+	// 모든 연결이 끝나고 server가 측정을 시작한 뒤에 동시에 시작한다.
+	gConnectedThreadCnt.fetch_add(1);
+	while (false == gIsStarted.load())
+	{
+		std::this_thread::yield();
+	}
+
+	char sendPacket[PACKET_SIZE]{};
+	int packetSize = PACKET_SIZE;
+	CopyMemory(sendPacket, &packetSize, sizeof(packetSize));
+
+	char recvPacket[PACKET_SIZE]{};
+
+	for (int round = 0; round < roundCnt; ++round)
+	{
+		for (SOCKET clientSocket : sockets)
+		{
+			send(clientSocket, sendPacket, PACKET_SIZE, MSG_NOSIGNAL);
+		}
+
+		for (SOCKET clientSocket : sockets)
+		{
+			int recvBytes{ 0 };
+			while (PACKET_SIZE > recvBytes)
+			{
+				ssize_t ret = recv(clientSocket, recvPacket + recvBytes, PACKET_SIZE - recvBytes, 0);
+				if (0 >= ret)
+				{
+					std::cout << "recv() failed: " << errno << std::endl;
+					std::exit(1);
+				}
+
+				recvBytes += static_cast<int>(ret);
+			}
+		}
+	}
+
+	for (SOCKET clientSocket : sockets)
+	{
+		close(clientSocket);
+	}
+}
+
+// 모든 연결이 끝나면 readyPipe로 server에게 알려주고
+// server가 측정 시작 값을 읽은 뒤에 startPipe로 알려주면 보내기 시작한다.
+void RunClient(int connectionCnt, int roundCnt, int readyPipe, int startPipe)
+{
+	std::vector<std::thread> clientThreads;
+	for (int i = 0; i < gClientThreadCnt; ++i)
+	{
+		int threadConnectionCnt = connectionCnt / gClientThreadCnt + (i < connectionCnt % gClientThreadCnt ? 1 : 0);
+		clientThreads.emplace_back(ClientThread, threadConnectionCnt, roundCnt);
+	}
+
+	while (gClientThreadCnt > gConnectedThreadCnt.load())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	char ready{ 1 };
+	write(readyPipe, &ready, sizeof(ready));
+
+	char start{ 0 };
+	read(startPipe, &start, sizeof(start));
+	gIsStarted.store(true);
+
+	for (std::thread& clientThread : clientThreads)
+	{
+		clientThread.join();
+	}
+}
+
+double GetCPUTime()
+{
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+		usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+}
+
+// server와 client 프로세스가 각각 연결 수만큼 socket을 연다.
+// soft limit을 필요한 만큼 올리고, hard limit보다 많이 필요하면 hard limit도 올려본다.
+bool RaiseFileLimit(int connectionCnt)
+{
+	// listen socket, epoll, io_uring, pipe 등
+	constexpr rlim_t EXTRA_FILE_CNT{ 64 };
+
+	rlim_t needFileCnt = static_cast<rlim_t>(connectionCnt) + EXTRA_FILE_CNT;
+
+	rlimit fileLimit{};
+	getrlimit(RLIMIT_NOFILE, &fileLimit);
+
+	if (needFileCnt <= fileLimit.rlim_cur)
+	{
+		return true;
+	}
+
+	fileLimit.rlim_cur = needFileCnt;
+	if (needFileCnt > fileLimit.rlim_max)
+	{
+		fileLimit.rlim_max = needFileCnt;
+	}
+
+	if (0 != setrlimit(RLIMIT_NOFILE, &fileLimit))
+	{
+		getrlimit(RLIMIT_NOFILE, &fileLimit);
+
+		std::cout << "setrlimit(RLIMIT_NOFILE, " << needFileCnt << ") failed: " << errno
+			<< ", hard limit: " << fileLimit.rlim_max << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: IOBackendBench [epoll|uring] [connectionCnt] [roundCnt] [workerThreadCnt] [completionBatchSize]" << std::endl;
+		return 0;
+	}
+
+	eIOBackendType backendType{};
+	if (0 == strcmp(argv[1], "epoll"))
+	{
+		backendType = eIOBackendType::BACKEND_EPOLL;
+	}
+	else if (0 == strcmp(argv[1], "uring"))
+	{
+		backendType = eIOBackendType::BACKEND_IO_URING;
+	}
+	else
+	{
+		std::cout << "usage: IOBackendBench [epoll|uring] [connectionCnt] [roundCnt] [workerThreadCnt] [completionBatchSize]" << std::endl;
+		return 0;
+	}
+
+	// 연결이 많을 때 완료 통지가 몰려오는 상황을 보기 위해 기본 20000개로 측정한다.
+	int connectionCnt = argc > 2 ? atoi(argv[2]) : 20000;
+	int roundCnt = argc > 3 ? atoi(argv[3]) : 100;
+	int workerThreadCnt = argc > 4 ? atoi(argv[4]) : 4;
+	int completionBatchSize = argc > 5 ? atoi(argv[5]) : DEFAULT_COMPLETION_BATCH;
+
+	// fork()한 client 프로세스도 같은 limit을 물려받는다.
+	if (false == RaiseFileLimit(connectionCnt))
+	{
+		return 1;
+	}
+
+	// client 프로세스를 먼저 만들어야 server의 CPU 시간에 client가 섞이지 않는다.
+	int readyPipe[2]{};
+	int startPipe[2]{};
+	pipe(readyPipe);
+	pipe(startPipe);
+
+	pid_t clientPid = fork();
+	if (0 == clientPid)
+	{
+		close(readyPipe[0]);
+		close(startPipe[1]);
+
+		// server가 listen할 때까지 기다린다.
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		RunClient(connectionCnt, roundCnt, readyPipe[1], startPipe[0]);
+
+		return 0;
+	}
+
+	close(readyPipe[1]);
+	close(startPipe[0]);
+
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	int reuseAddr{ 1 };
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
+
+	SOCKADDR_IN serverAddr{};
+	serverAddr.sin_family = AF_INET;
+	serverAddr.sin_port = htons(SERVER_PORT);
+	inet_pton(AF_INET, SERVER_IP, &serverAddr.sin_addr);
+
+	if (0 != bind(listenSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)) ||
+		0 != listen(listenSocket, SOMAXCONN))
+	{
+		std::cout << "bind(), listen() failed: " << errno << std::endl;
+		return 1;
+	}
+
+	IOBackend* pIOBackend = IOBackend::CreateIOBackend(backendType);
+	if (nullptr == pIOBackend ||
+		false == pIOBackend->Create(connectionCnt) ||
+		false == pIOBackend->BindListenSocket(listenSocket) ||
+		false == pIOBackend->CreateWorkerThread(workerThreadCnt, completionBatchSize))
+	{
+		std::cout << "IOBackend create failed" << std::endl;
+		return 1;
+	}
+
+	Connection* pConnections = new Connection[connectionCnt];
+	for (int i = 0; i < connectionCnt; ++i)
+	{
+		InitConfig initConfig{};
+		initConfig.mIndex = i;
+		initConfig.mListenSocket = listenSocket;
+		initConfig.mIOBackend = pIOBackend;
+		initConfig.mRecvBufCnt = 4;
+		initConfig.mSendBufCnt = 4;
+		initConfig.mRecvBufSize = 1024;
+		initConfig.mSendBufSize = 1024;
+
+		pConnections[i].CreateConnection(initConfig);
+	}
+
+	char ready{ 0 };
+	read(readyPipe[0], &ready, sizeof(ready));
+
+	// client의 connect()가 끝나도 server는 아직 accept 완료 통지를 처리하고 있을 수 있다.
+	while (connectionCnt > gAcceptCnt.load())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// 시작 값을 먼저 읽고 client를 출발시켜야 처음 보낸 패킷도 측정 구간에 들어간다.
+	LONG64 beginSyscallCnt = pIOBackend->GetSyscallCount();
+	LONG64 beginPacketCnt = gRecvPacketCnt.load();
+	LONG64 beginWakeupCnt = pIOBackend->GetWakeupCount();
+	LONG64 beginCompletionCnt = pIOBackend->GetCompletionCount();
+	double beginCPUTime = GetCPUTime();
+	auto beginTime = std::chrono::steady_clock::now();
+
+	char start{ 1 };
+	write(startPipe[1], &start, sizeof(start));
+
+	waitpid(clientPid, nullptr, 0);
+
+	auto endTime = std::chrono::steady_clock::now();
+	double cpuTime = GetCPUTime() - beginCPUTime;
+	LONG64 syscallCnt = pIOBackend->GetSyscallCount() - beginSyscallCnt;
+	LONG64 packetCnt = gRecvPacketCnt.load() - beginPacketCnt;
+	LONG64 wakeupCnt = pIOBackend->GetWakeupCount() - beginWakeupCnt;
+	LONG64 completionCnt = pIOBackend->GetCompletionCount() - beginCompletionCnt;
+
+	double elapsedTime = std::chrono::duration<double>(endTime - beginTime).count();
+
+	std::cout << "backend:          " << argv[1] << std::endl;
+	std::cout << "connections:      " << connectionCnt << std::endl;
+	std::cout << "batch size:       " << completionBatchSize << std::endl;
+	std::cout << "packets:          " << packetCnt << std::endl;
+	std::cout << "packets/sec:      " << static_cast<LONG64>(packetCnt / elapsedTime) << std::endl;
+	std::cout << "syscalls/packet:  " << static_cast<double>(syscallCnt) / packetCnt << std::endl;
+	std::cout << "cpu usec/packet:  " << cpuTime * 1000000.0 / packetCnt << std::endl;
+	std::cout << "completions/wake: " << static_cast<double>(completionCnt) / wakeupCnt << std::endl;
+
+	pIOBackend->DestroyWorkerThread();
+
+	// 측정 구간 밖에서 처리한 패킷이 있다면 패킷당 값들을 backend끼리 비교할 수 없다.
+	LONG64 expectedPacketCnt = static_cast<LONG64>(connectionCnt) * roundCnt;
+	if (expectedPacketCnt != packetCnt)
+	{
+		std::cout << "packet count mismatch: expected " << expectedPacketCnt << ", measured " << packetCnt << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+#endif
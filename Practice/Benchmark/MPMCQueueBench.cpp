@@ -0,0 +1,265 @@
+﻿// 2026 10 18 이정모 home
+//
+// Monitor로 보호하는 Queue<T>와 lock 없는 MPMCQueue<T>의 경합 성능 비교
+//
+// thread마다 값을 넣고 꺼내기를 번갈아 하는데 자기가 넣은 값이 아니라도 꺼낸다.
+// (worker thread와 Strand::Post()가 ready queue에 넣고 꺼내는 것, 여러 thread가 LOG()로 넣는 것을 흉내)
+// - monitor: Push()는 Queue<T> 안의 lock으로, Front()와 Pop()은 바깥 lock을 한 번 더 잡고 꺼낸다.
+//   (EpollBackend::PopReady()가 하던 방식)
+// - mpmc: TryPush(), TryPop()으로 하나씩 넣고 꺼낸다.
+// - mpmc batch: PushBatch(), PopBatch()로 BATCH_CNT개씩 넣고 꺼낸다.
+//
+// 측정
+// - thread 수(1 ~ maxThreadCnt, 2배씩)마다 값 하나를 넣고 꺼내는데 걸린 시간과 전체 처리량
+// - checksum(넣은 값의 합과 꺼낸 값의 합이 같아야 한다.)
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include "Log.h"
+#include "Queue.h"
+#include "MPMCQueue.h"
+#include "IOCPServer.h"
+
+// benchmark는 NetworkLibrary만 link하기 때문에 server 객체가 필요하지만
+// Connection을 사용하지 않으니 아무 server도 알려주지 않는다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return nullptr;
+}
+
+constexpr int QUEUE_SIZE{ 4096 };
+constexpr int BATCH_CNT{ 16 };
+
+enum class eQueueMode
+{
+	MONITOR,
+	MPMC,
+	MPMC_BATCH,
+};
+
+const char* GetModeName(eQueueMode mode)
+{
+	switch (mode)
+	{
+	case eQueueMode::MONITOR:
+		return "monitor";
+	case eQueueMode::MPMC:
+		return "mpmc";
+	case eQueueMode::MPMC_BATCH:
+		return "mpmc batch";
+	}
+
+	return "";
+}
+
+Queue<LONG64>* gMonitorQueue{ nullptr };
+Monitor gMonitorPopSyncObject;
+MPMCQueue<LONG64>* gMPMCQueue{ nullptr };
+
+// 모든 thread가 만들어진 뒤에 동시에 시작한다.
+std::atomic<int> gReadyThreadCnt{ 0 };
+std::atomic<bool> gIsStarted{ false };
+
+bool PushValue(eQueueMode mode, LONG64 value)
+{
+	if (eQueueMode::MONITOR == mode)
+	{
+		return gMonitorQueue->Push(value);
+	}
+
+	return gMPMCQueue->TryPush(value);
+}
+
+bool PopValue(eQueueMode mode, LONG64* pValue)
+{
+	if (eQueueMode::MONITOR == mode)
+	{
+		Monitor::Owner lock{ gMonitorPopSyncObject };
+
+		if (gMonitorQueue->IsEmpty())
+		{
+			return false;
+		}
+
+		*pValue = gMonitorQueue->Front();
+		gMonitorQueue->Pop();
+		return true;
+	}
+
+	return gMPMCQueue->TryPop(pValue);
+}
+
+// 자기 몫을 모두 넣고 그만큼 꺼낼 때까지 BATCH_CNT개씩 넣고 꺼내기를 반복한다.
+// 다른 thread가 넣은 값도 꺼내지만 자기 몫보다 많이 꺼내지 않기 때문에
+// 전체로 보면 넣은 개수와 꺼낸 개수가 같아서 모든 thread가 끝난다.
+void BenchThread(eQueueMode mode, LONG64 beginValue, LONG64 valueCnt, unsigned long long* pChecksum)
+{
+	gReadyThreadCnt.fetch_add(1);
+	while (false == gIsStarted.load())
+	{
+		std::this_thread::yield();
+	}
+
+	LONG64 pushCnt{ 0 };
+	LONG64 popCnt{ 0 };
+	unsigned long long checksum{ 0 };
+	LONG64 values[BATCH_CNT]{};
+
+	while (valueCnt > pushCnt || valueCnt > popCnt)
+	{
+		int batchPushCnt = static_cast<int>(valueCnt - pushCnt < BATCH_CNT ? valueCnt - pushCnt : BATCH_CNT);
+		int batchPopCnt = static_cast<int>(valueCnt - popCnt < BATCH_CNT ? valueCnt - popCnt : BATCH_CNT);
+		LONG64 prevCnt = pushCnt + popCnt;
+
+		if (eQueueMode::MPMC_BATCH == mode)
+		{
+			for (int i = 0; i < batchPushCnt; ++i)
+			{
+				values[i] = beginValue + pushCnt + i;
+			}
+
+			pushCnt += gMPMCQueue->PushBatch(std::span<const LONG64>{ values, static_cast<size_t>(batchPushCnt) });
+
+			batchPopCnt = gMPMCQueue->PopBatch(std::span<LONG64>{ values, static_cast<size_t>(batchPopCnt) });
+			for (int i = 0; i < batchPopCnt; ++i)
+			{
+				checksum += values[i];
+			}
+
+			popCnt += batchPopCnt;
+		}
+		else
+		{
+			for (int i = 0; i < batchPushCnt; ++i)
+			{
+				if (false == PushValue(mode, beginValue + pushCnt))
+				{
+					break;
+				}
+
+				++pushCnt;
+			}
+
+			for (int i = 0; i < batchPopCnt; ++i)
+			{
+				LONG64 value{ 0 };
+				if (false == PopValue(mode, &value))
+				{
+					break;
+				}
+
+				checksum += value;
+				++popCnt;
+			}
+		}
+
+		// core보다 thread가 많으면 위치만 차지하고 쉬게 된 thread가 값을 채울 수 있도록 양보한다.
+		if (prevCnt == pushCnt + popCnt)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	*pChecksum = checksum;
+}
+
+// 값 하나를 넣고 꺼내는 시간(모든 thread를 합친 처리량 기준)
+double RunThreads(eQueueMode mode, int threadCnt, LONG64 valueCnt, bool* pIsChecksumOk)
+{
+	gMonitorQueue = new Queue<LONG64>{ QUEUE_SIZE };
+	gMPMCQueue = new MPMCQueue<LONG64>{ QUEUE_SIZE };
+	gReadyThreadCnt.store(0);
+	gIsStarted.store(false);
+
+	std::vector<std::thread> threads;
+	std::vector<unsigned long long> checksums(threadCnt, 0);
+
+	LONG64 threadValueCnt = valueCnt / threadCnt;
+	for (int i = 0; i < threadCnt; ++i)
+	{
+		threads.emplace_back(BenchThread, mode, 1 + i * threadValueCnt, threadValueCnt, &checksums[i]);
+	}
+
+	while (threadCnt > gReadyThreadCnt.load())
+	{
+		std::this_thread::yield();
+	}
+
+	auto beginTime = std::chrono::steady_clock::now();
+	gIsStarted.store(true);
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+
+	// 1부터 threadCnt * threadValueCnt까지의 합
+	unsigned long long totalValueCnt = static_cast<unsigned long long>(threadCnt * threadValueCnt);
+	unsigned long long expectedChecksum = totalValueCnt * (totalValueCnt + 1) / 2;
+
+	unsigned long long checksum{ 0 };
+	for (unsigned long long threadChecksum : checksums)
+	{
+		checksum += threadChecksum;
+	}
+
+	*pIsChecksumOk = expectedChecksum == checksum;
+
+	delete gMonitorQueue;
+	gMonitorQueue = nullptr;
+	delete gMPMCQueue;
+	gMPMCQueue = nullptr;
+
+	return std::chrono::duration<double, std::nano>(endTime - beginTime).count() / totalValueCnt;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && 0 == strcmp(argv[1], "-h"))
+	{
+		std::cout << "usage: MPMCQueueBench [valueCnt] [maxThreadCnt]" << std::endl;
+		return 0;
+	}
+
+	LONG64 valueCnt = argc > 1 ? atoll(argv[1]) : 10000000;
+	int maxThreadCnt = argc > 2 ? atoi(argv[2]) : 32;
+	if (1 > maxThreadCnt)
+	{
+		maxThreadCnt = 1;
+	}
+
+	std::cout << "values:         " << valueCnt << std::endl;
+	std::cout << "queue size:     " << QUEUE_SIZE << std::endl;
+	std::cout << "batch size:     " << BATCH_CNT << std::endl;
+	std::cout << "hardware cores: " << std::thread::hardware_concurrency() << std::endl;
+	std::cout << std::endl;
+
+	printf("%-12s %-8s %12s %12s %10s\n", "mode", "threads", "ns/value", "Mvalues/sec", "checksum");
+
+	for (int threadCnt = 1; threadCnt <= maxThreadCnt; threadCnt *= 2)
+	{
+		for (eQueueMode mode : { eQueueMode::MONITOR, eQueueMode::MPMC, eQueueMode::MPMC_BATCH })
+		{
+			bool isChecksumOk{ false };
+			double nsPerValue = RunThreads(mode, threadCnt, valueCnt, &isChecksumOk);
+
+			printf("%-12s %-8d %12.1f %12.2f %10s\n", GetModeName(mode), threadCnt,
+				nsPerValue, 1000.0 / nsPerValue, isChecksumOk ? "ok" : "MISMATCH");
+		}
+	}
+
+	return 0;
+}
+
+#endif
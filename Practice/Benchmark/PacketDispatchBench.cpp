@@ -0,0 +1,283 @@
+﻿// 2026 10 18 이정모 home
+//
+// 패킷 dispatch 방식 비교
+//
+// 같은 패킷 묶음을 세 가지 방식으로 handler에게 넘기는 시간을 잰다.
+// - PacketDispatcher: compile time에 만든 jump table을 한 번 간접 호출
+// - switch: 패킷 번호로 분기하는 switch 문을 직접 작성
+// - unordered_map: 패킷 번호를 key로 std::function handler를 찾아서 호출
+//
+// 세 방식 모두 크기 검사를 하고 같은 handler를 호출한다.
+// 패킷 번호가 무작위(random)일 때와 하나로 같을(same) 때를 나눠서 볼 수 있다.
+// 번호가 같으면 분기 예측이 항상 맞기 때문에 간접 호출 비용 차이가 줄어든다.
+//
+// 측정
+// - 패킷 하나를 dispatch하는 데 걸린 시간(nsec)
+// - checksum(세 방식이 같은 handler를 같은 순서로 호출했는지 확인, 모두 같아야 한다.)
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include "Log.h"
+#include "Connection.h"
+#include "PacketDispatcher.h"
+#include "IOCPServer.h"
+
+// benchmark는 NetworkLibrary만 link하기 때문에 server 객체가 필요하지만
+// Connection을 사용하지 않으니 아무 server도 알려주지 않는다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return nullptr;
+}
+
+// benchmark에서 사용하는 패킷 종류 수
+enum class BenchPacketId : unsigned short
+{
+	MAX = 32,
+};
+
+constexpr int BENCH_PACKET_TYPE_CNT{ static_cast<int>(BenchPacketId::MAX) };
+
+#pragma pack(push, 1)
+template <int ID>
+struct BenchPacket
+{
+	PacketHeader mHeader;
+	int mValue;
+};
+#pragma pack(pop)
+
+constexpr int BENCH_PACKET_SIZE{ sizeof(BenchPacket<0>) };
+
+// handler가 하는 일(game logic 흉내)
+// 최적화로 호출이 사라지지 않도록 결과를 전역 변수에 섞는다.
+unsigned long long gChecksum{ 0 };
+
+template <int ID>
+bool OnBenchPacket(Connection*, const BenchPacket<ID>& packet)
+{
+	gChecksum = gChecksum * 31 + static_cast<unsigned long long>(packet.mValue) + ID;
+	return true;
+}
+
+// 모든 handler를 등록한 jump table
+template <int... IDs>
+constexpr auto MakeBenchPacketDispatcher(std::integer_sequence<int, IDs...>)
+{
+	PacketDispatcher<BenchPacketId, BenchPacketId::MAX> dispatcher{};
+	((dispatcher = dispatcher.template Register<static_cast<BenchPacketId>(IDs), &OnBenchPacket<IDs>>()), ...);
+
+	return dispatcher;
+}
+
+constexpr auto gBenchPacketDispatcher = MakeBenchPacketDispatcher(std::make_integer_sequence<int, BENCH_PACKET_TYPE_CNT>{});
+
+// 직접 작성한 switch
+#define BENCH_PACKET_CASE(ID)																\
+	case ID:																				\
+		if (sizeof(BenchPacket<ID>) != size)												\
+		{																					\
+			return false;																	\
+		}																					\
+		return OnBenchPacket<ID>(pConnection, *reinterpret_cast<const BenchPacket<ID>*>(pPacket));
+
+bool DispatchSwitch(Connection* pConnection, char* pPacket, DWORD size)
+{
+	if (PACKET_HEADER_LENGTH > size)
+	{
+		return false;
+	}
+
+	unsigned short packetId{ 0 };
+	CopyMemory(&packetId, pPacket + PACKET_SIZE_LENGTH, PACKET_ID_LENGTH);
+
+	switch (packetId)
+	{
+		BENCH_PACKET_CASE(0)
+		BENCH_PACKET_CASE(1)
+		BENCH_PACKET_CASE(2)
+		BENCH_PACKET_CASE(3)
+		BENCH_PACKET_CASE(4)
+		BENCH_PACKET_CASE(5)
+		BENCH_PACKET_CASE(6)
+		BENCH_PACKET_CASE(7)
+		BENCH_PACKET_CASE(8)
+		BENCH_PACKET_CASE(9)
+		BENCH_PACKET_CASE(10)
+		BENCH_PACKET_CASE(11)
+		BENCH_PACKET_CASE(12)
+		BENCH_PACKET_CASE(13)
+		BENCH_PACKET_CASE(14)
+		BENCH_PACKET_CASE(15)
+		BENCH_PACKET_CASE(16)
+		BENCH_PACKET_CASE(17)
+		BENCH_PACKET_CASE(18)
+		BENCH_PACKET_CASE(19)
+		BENCH_PACKET_CASE(20)
+		BENCH_PACKET_CASE(21)
+		BENCH_PACKET_CASE(22)
+		BENCH_PACKET_CASE(23)
+		BENCH_PACKET_CASE(24)
+		BENCH_PACKET_CASE(25)
+		BENCH_PACKET_CASE(26)
+		BENCH_PACKET_CASE(27)
+		BENCH_PACKET_CASE(28)
+		BENCH_PACKET_CASE(29)
+		BENCH_PACKET_CASE(30)
+		BENCH_PACKET_CASE(31)
+	default:
+		return false;
+	}
+}
+
+#undef BENCH_PACKET_CASE
+
+// 실행 중에 handler를 등록하는 map
+// 크기 검사는 PacketDispatcher와 같은 thunk를 사용해서 찾는 방식만 다르게 한다.
+using PacketHandlerMap = std::unordered_map<unsigned short, std::function<bool(Connection*, char*, DWORD)>>;
+
+template <int... IDs>
+void FillPacketHandlerMap(PacketHandlerMap& handlerMap, std::integer_sequence<int, IDs...>)
+{
+	((handlerMap[static_cast<unsigned short>(IDs)] = MakePacketDispatchFunc<&OnBenchPacket<IDs>>(&OnBenchPacket<IDs>)), ...);
+}
+
+bool DispatchMap(const PacketHandlerMap& handlerMap, Connection* pConnection, char* pPacket, DWORD size)
+{
+	if (PACKET_HEADER_LENGTH > size)
+	{
+		return false;
+	}
+
+	unsigned short packetId{ 0 };
+	CopyMemory(&packetId, pPacket + PACKET_SIZE_LENGTH, PACKET_ID_LENGTH);
+
+	auto iter = handlerMap.find(packetId);
+	if (handlerMap.end() == iter)
+	{
+		return false;
+	}
+
+	return iter->second(pConnection, pPacket, size);
+}
+
+// 수신 buffer처럼 패킷을 이어 붙여둔다.
+std::vector<char> MakePacketStream(int packetCnt, bool isRandomId)
+{
+	std::vector<char> packetStream(static_cast<size_t>(packetCnt) * BENCH_PACKET_SIZE);
+
+	std::mt19937 random{ 0 };
+	std::uniform_int_distribution<int> idDistribution{ 0, BENCH_PACKET_TYPE_CNT - 1 };
+
+	for (int i = 0; i < packetCnt; ++i)
+	{
+		BenchPacket<0> packet{};
+		packet.mHeader.mSize = BENCH_PACKET_SIZE;
+		packet.mHeader.mId = static_cast<unsigned short>(isRandomId ? idDistribution(random) : 7);
+		packet.mValue = i;
+
+		CopyMemory(packetStream.data() + static_cast<size_t>(i) * BENCH_PACKET_SIZE, &packet, BENCH_PACKET_SIZE);
+	}
+
+	return packetStream;
+}
+
+// 반환값은 패킷 하나를 dispatch하는 데 걸린 시간(nsec)
+template <typename DispatchFunc>
+double RunBench(std::vector<char>& packetStream, int packetCnt, int roundCnt, DispatchFunc dispatchFunc)
+{
+	gChecksum = 0;
+
+	auto beginTime = std::chrono::steady_clock::now();
+
+	for (int round = 0; round < roundCnt; ++round)
+	{
+		char* pPacket = packetStream.data();
+		for (int i = 0; i < packetCnt; ++i)
+		{
+			if (false == dispatchFunc(nullptr, pPacket, BENCH_PACKET_SIZE))
+			{
+				std::cout << "dispatch failed" << std::endl;
+				std::exit(1);
+			}
+
+			pPacket += BENCH_PACKET_SIZE;
+		}
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+
+	double elapsedTime = std::chrono::duration<double, std::nano>(endTime - beginTime).count();
+	return elapsedTime / (static_cast<double>(packetCnt) * roundCnt);
+}
+
+int main(int argc, char* argv[])
+{
+	const char* usage = "usage: PacketDispatchBench [random|same] [packetCnt] [roundCnt]";
+
+	if (argc < 2)
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	bool isRandomId{ true };
+	if (0 == strcmp(argv[1], "same"))
+	{
+		isRandomId = false;
+	}
+	else if (0 != strcmp(argv[1], "random"))
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	int packetCnt = argc > 2 ? atoi(argv[2]) : 4096;
+	int roundCnt = argc > 3 ? atoi(argv[3]) : 5000;
+
+	std::vector<char> packetStream = MakePacketStream(packetCnt, isRandomId);
+
+	PacketHandlerMap handlerMap;
+	FillPacketHandlerMap(handlerMap, std::make_integer_sequence<int, BENCH_PACKET_TYPE_CNT>{});
+
+	std::cout << "packet id:    " << argv[1] << std::endl;
+	std::cout << "packet types: " << BENCH_PACKET_TYPE_CNT << std::endl;
+	std::cout << "packets:      " << static_cast<LONG64>(packetCnt) * roundCnt << std::endl;
+	std::cout << std::endl;
+	std::cout << "dispatch         nsec/packet  checksum" << std::endl;
+
+	double tableTime = RunBench(packetStream, packetCnt, roundCnt,
+		[](Connection* pConnection, char* pPacket, DWORD size)
+		{
+			return gBenchPacketDispatcher.Dispatch(pConnection, pPacket, size);
+		});
+	unsigned long long tableChecksum = gChecksum;
+
+	double switchTime = RunBench(packetStream, packetCnt, roundCnt, DispatchSwitch);
+	unsigned long long switchChecksum = gChecksum;
+
+	double mapTime = RunBench(packetStream, packetCnt, roundCnt,
+		[&handlerMap](Connection* pConnection, char* pPacket, DWORD size)
+		{
+			return DispatchMap(handlerMap, pConnection, pPacket, size);
+		});
+	unsigned long long mapChecksum = gChecksum;
+
+	printf("jump table       %11.2f  %016llx\n", tableTime, tableChecksum);
+	printf("switch           %11.2f  %016llx\n", switchTime, switchChecksum);
+	printf("unordered_map    %11.2f  %016llx\n", mapTime, mapChecksum);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,249 @@
+﻿// 2026 10 18 이정모 home
+//
+// 일반 RingBuffer와 mirrored RingBuffer(같은 메모리를 두 번 이어서 매핑)의 수신 성능 비교
+//
+// Connection::RecvPost(), DoRecv()와 같은 순서로 recv ring buffer를 사용한다.
+// 1. MoveMark()로 잘린 패킷 뒤에 수신할 공간을 마련하고
+// 2. kernel이 복사하는 것처럼 미리 만든 stream에서 segment 하나를 복사한 뒤
+// 3. 온전한 패킷을 하나씩 읽고(checksum) ReleaseBuffer()로 해제한다.
+//
+// 패킷 크기는 작은 패킷(이동, 채팅) 위주에 큰 패킷(맵 조각, 인벤토리)이 섞여있고
+// segment 크기도 가득 찬 수신과 작은 수신이 섞여있어서 잘린 패킷이 버퍼 끝에 자주 걸린다.
+//
+// 측정
+// - 수신 처리량(MB/s)과 패킷 하나를 처리하는 시간
+// - 버퍼 끝에서 잘린 패킷을 앞으로 복사한 횟수와 크기(mirrored는 0이어야 한다.)
+// - checksum(두 방식이 같아야 한다.)
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include "Log.h"
+#include "Connection.h"
+#include "RingBuffer.h"
+#include "IOCPServer.h"
+
+// benchmark는 NetworkLibrary만 link하기 때문에 server 객체가 필요하지만
+// Connection을 사용하지 않으니 아무 server도 알려주지 않는다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return nullptr;
+}
+
+// 한 바퀴에 사용하는 stream 크기
+constexpr int STREAM_SIZE{ 64 * 1024 * 1024 };
+
+struct RecvResult
+{
+	bool mIsMirrored;
+	double mElapsedSec;
+	LONG64 mPacketCnt;
+	LONG64 mRecvBytes;
+	LONG64 mRelocateCnt;
+	LONG64 mRelocateBytes;
+	unsigned long long mChecksum;
+};
+
+// 작은 패킷 위주에 큰 패킷이 섞인 stream(패킷 크기 4byte + 내용)
+std::vector<char> MakeStream(int maxPacketSize, std::mt19937& random)
+{
+	std::uniform_int_distribution<int> kindDist{ 0, 99 };
+	std::uniform_int_distribution<int> smallDist{ 16, 128 };
+	std::uniform_int_distribution<int> mediumDist{ 256, 1500 };
+	std::uniform_int_distribution<int> largeDist{ 2048, maxPacketSize };
+
+	std::vector<char> stream;
+	stream.reserve(STREAM_SIZE + maxPacketSize);
+
+	while (STREAM_SIZE > static_cast<int>(stream.size()))
+	{
+		int kind = kindDist(random);
+		int packetSize = 70 > kind ? smallDist(random) : (95 > kind ? mediumDist(random) : largeDist(random));
+
+		size_t offset = stream.size();
+		stream.resize(offset + packetSize);
+
+		CopyMemory(stream.data() + offset, &packetSize, PACKET_SIZE_LENGTH);
+		for (int i = PACKET_SIZE_LENGTH; i < packetSize; ++i)
+		{
+			stream[offset + i] = static_cast<char>(random());
+		}
+	}
+
+	return stream;
+}
+
+// 절반은 가득 찬 수신, 절반은 임의 크기의 수신
+std::vector<int> MakeSegmentSizes(int recvBufSize, std::mt19937& random)
+{
+	std::uniform_int_distribution<int> fullDist{ 0, 1 };
+	std::uniform_int_distribution<int> sizeDist{ 1, recvBufSize };
+
+	std::vector<int> segmentSizes(64 * 1024);
+	for (int& segmentSize : segmentSizes)
+	{
+		segmentSize = 0 == fullDist(random) ? recvBufSize : sizeDist(random);
+	}
+
+	return segmentSizes;
+}
+
+bool RunRecv(bool isMirrored, const std::vector<char>& stream, const std::vector<int>& segmentSizes,
+	int recvBufSize, int recvBufCnt, int roundCnt, RecvResult* pResult)
+{
+	RingBuffer ringBuffer;
+	ringBuffer.Create(recvBufSize * recvBufCnt, isMirrored);
+	if (isMirrored != ringBuffer.IsMirrored())
+	{
+		std::cout << "mirrored RingBuffer create failed" << std::endl;
+		return false;
+	}
+
+	*pResult = RecvResult{};
+	pResult->mIsMirrored = isMirrored;
+
+	char* pPacketStart = ringBuffer.GetBeginMark();
+	DWORD processedBytes{ 0 };
+	size_t segmentIndex{ 0 };
+
+	auto beginTime = std::chrono::steady_clock::now();
+
+	for (int round = 0; round < roundCnt; ++round)
+	{
+		size_t streamOffset{ 0 };
+		while (stream.size() > streamOffset)
+		{
+			// Connection::RecvPost()
+			int movementDistance = static_cast<int>(processedBytes) -
+				static_cast<int>(ringBuffer.GetCurrentMark() - pPacketStart);
+			char* pExpected = ringBuffer.GetCurrentMark() + movementDistance;
+
+			char* pRecv = ringBuffer.MoveMark(movementDistance, recvBufSize, processedBytes);
+			if (nullptr == pRecv)
+			{
+				std::cout << "recv ring buffer overflow" << std::endl;
+				return false;
+			}
+
+			// 잘린 패킷 뒤가 아닌 곳에서 받는다면 잘린 패킷을 앞으로 복사했다.
+			// (mirrored는 같은 위치를 앞쪽 주소로 되돌릴 뿐 복사하지 않는다.)
+			if (pExpected != pRecv && pExpected - ringBuffer.GetBufferSize() != pRecv)
+			{
+				++pResult->mRelocateCnt;
+				pResult->mRelocateBytes += processedBytes;
+			}
+
+			pPacketStart = pRecv - processedBytes;
+
+			// kernel이 수신한 데이터를 복사
+			size_t segmentSize = segmentSizes[segmentIndex++ % segmentSizes.size()];
+			if (stream.size() - streamOffset < segmentSize)
+			{
+				segmentSize = stream.size() - streamOffset;
+			}
+
+			CopyMemory(pRecv, stream.data() + streamOffset, segmentSize);
+			streamOffset += segmentSize;
+			pResult->mRecvBytes += segmentSize;
+
+			// Connection::DoRecv()
+			DWORD remainBytes = processedBytes + static_cast<DWORD>(segmentSize);
+			char* pNext = pPacketStart;
+
+			while (PACKET_SIZE_LENGTH <= remainBytes)
+			{
+				int packetSize{ 0 };
+				CopyMemory(&packetSize, pNext, PACKET_SIZE_LENGTH);
+
+				if (remainBytes < static_cast<DWORD>(packetSize))
+				{
+					break;
+				}
+
+				// 패킷의 처음과 끝을 읽는다.
+				pResult->mChecksum = pResult->mChecksum * 31 +
+					static_cast<unsigned char>(pNext[PACKET_SIZE_LENGTH]) +
+					static_cast<unsigned char>(pNext[packetSize - 1]);
+				++pResult->mPacketCnt;
+
+				ringBuffer.ReleaseBuffer(packetSize);
+
+				remainBytes -= packetSize;
+				pNext += packetSize;
+			}
+
+			pPacketStart = pNext;
+			processedBytes = remainBytes;
+		}
+	}
+
+	pResult->mElapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+	return true;
+}
+
+void PrintResult(const RecvResult& result)
+{
+	printf("%-9s %10.1f %14.2f %12lld %14.1f %20llu\n",
+		result.mIsMirrored ? "mirrored" : "ring",
+		result.mRecvBytes / (1024.0 * 1024.0) / result.mElapsedSec,
+		result.mElapsedSec * 1000000000.0 / result.mPacketCnt,
+		result.mRelocateCnt,
+		result.mRelocateBytes / 1024.0,
+		result.mChecksum);
+}
+
+int main(int argc, char* argv[])
+{
+	const char* usage = "usage: RingBufferBench [recvBufSize] [recvBufCnt] [roundCnt]";
+
+	if (argc > 1 && 0 >= atoi(argv[1]))
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	int recvBufSize = argc > 1 ? atoi(argv[1]) : 4096;
+	int recvBufCnt = argc > 2 ? atoi(argv[2]) : 4;
+	int roundCnt = argc > 3 ? atoi(argv[3]) : 8;
+
+	// 잘린 패킷 + 한 번의 수신이 recv ring buffer에 들어가야 한다.
+	int maxPacketSize = recvBufSize * (recvBufCnt - 1);
+	if (2048 > maxPacketSize)
+	{
+		std::cout << "recvBufSize * (recvBufCnt - 1) must be at least 2048" << std::endl;
+		return 0;
+	}
+
+	std::mt19937 random{ 1234 };
+	std::vector<char> stream = MakeStream(maxPacketSize, random);
+	std::vector<int> segmentSizes = MakeSegmentSizes(recvBufSize, random);
+
+	printf("recv buffer: %d x %d, stream: %d MB x %d rounds\n", recvBufSize, recvBufCnt, STREAM_SIZE / (1024 * 1024), roundCnt);
+	printf("%-9s %10s %14s %12s %14s %20s\n", "buffer", "MB/sec", "nsec/packet", "relocations", "relocated KB", "checksum");
+
+	// 순서에 따른 cache 영향을 줄이기 위해 번갈아 두 번씩 잰다.
+	for (int repeat = 0; repeat < 2; ++repeat)
+	{
+		for (bool isMirrored : { false, true })
+		{
+			RecvResult result{};
+			if (false == RunRecv(isMirrored, stream, segmentSizes, recvBufSize, recvBufCnt, roundCnt, &result))
+			{
+				return 1;
+			}
+
+			PrintResult(result);
+		}
+	}
+
+	return 0;
+}
+
+#endif
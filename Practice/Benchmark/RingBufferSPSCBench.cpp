@@ -0,0 +1,339 @@
+﻿// 2026 10 18 이정모 home
+//
+// Monitor로 보호하는 RingBuffer와 SPSC mode RingBuffer(lock 없음)의 성능 비교
+//
+// 쓰는 thread 하나(수신 완료를 흉내)가 여러 크기의 메시지를 쓰고
+// 읽는 thread 하나(패킷 처리를 흉내)가 패킷처럼 크기를 보고 메시지를 하나씩 나눠서 checksum을 구한다.
+// 메시지 내용은 memcpy()로 채우고 읽을 때는 머리(크기, 번호)만 보기 때문에
+// 버퍼를 관리하는 비용(lock 또는 atomic)이 잘 드러난다.
+// - Monitor: MoveMark()로 공간을 받아 채우고, 읽는 쪽은 GetBuffer(), ReleaseBuffer()를 사용한다.
+//   MoveMark()는 채우기 전에 공간을 읽는 쪽에 보여주기 때문에
+//   채운 크기를 따로 알려주고 읽는 쪽은 그 크기까지만 요청한다.
+// - SPSC: ReserveSPSC(), CommitSPSC()로 쓰고 PeekSPSC(), ReleaseSPSC()로 읽는다.
+//
+// 측정
+// - 한 thread에서 쓰기와 읽기를 번갈아 할 때 메시지 하나의 시간(경합 없는 lock, atomic 비용)
+// - 쓰는 thread와 읽는 thread가 다를 때 메시지 하나의 시간과 처리량
+// - 독립된 버퍼 쌍의 수를 늘렸을 때 전체 처리량(scaling)
+// - checksum(쓴 쪽과 읽은 쪽이 같아야 한다.)
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include "Log.h"
+#include "RingBuffer.h"
+#include "IOCPServer.h"
+
+// benchmark는 NetworkLibrary만 link하기 때문에 server 객체가 필요하지만
+// Connection을 사용하지 않으니 아무 server도 알려주지 않는다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return nullptr;
+}
+
+constexpr int BUFFER_SIZE{ 64 * 1024 };
+
+// 메시지: 크기(4byte) + 번호(4byte) + 내용
+constexpr int MESSAGE_HEADER_SIZE{ 8 };
+constexpr int MAX_MESSAGE_SIZE{ 128 };
+
+// 메시지 크기는 16 ~ 16 + 111byte를 돌아가며 사용한다.
+int GetMessageSize(LONG64 messageIndex)
+{
+	return 16 + static_cast<int>((messageIndex * 37) % (MAX_MESSAGE_SIZE - 16));
+}
+
+char gPattern[MAX_MESSAGE_SIZE]{};
+
+void FillMessage(char* pMessage, int messageSize, LONG64 messageIndex, unsigned long long* pChecksum)
+{
+	int index = static_cast<int>(messageIndex);
+
+	CopyMemory(pMessage, &messageSize, sizeof(messageSize));
+	CopyMemory(pMessage + 4, &index, sizeof(index));
+	CopyMemory(pMessage + MESSAGE_HEADER_SIZE, gPattern, messageSize - MESSAGE_HEADER_SIZE);
+
+	*pChecksum += messageSize * 31ULL + index;
+}
+
+// 읽은 구간을 메시지 단위로 나눈다(구간은 항상 메시지 경계에서 끝난다).
+void ReadMessages(const char* pBuffer, int size, unsigned long long* pChecksum)
+{
+	int offset{ 0 };
+	while (size > offset)
+	{
+		int messageSize{ 0 };
+		int index{ 0 };
+		CopyMemory(&messageSize, pBuffer + offset, sizeof(messageSize));
+		CopyMemory(&index, pBuffer + offset + 4, sizeof(index));
+
+		*pChecksum += messageSize * 31ULL + index;
+		offset += messageSize;
+	}
+}
+
+// 버퍼 한 쌍(쓰는 쪽, 읽는 쪽)
+struct BufferPair
+{
+	RingBuffer mRingBuffer;
+
+	// Monitor 방식에서 쓰는 쪽이 다 채운 크기
+	alignas(64) std::atomic<LONG64> mFilledSize{ 0 };
+
+	unsigned long long mWriteChecksum{ 0 };
+	unsigned long long mReadChecksum{ 0 };
+};
+
+void WriteMonitor(BufferPair* pPair, LONG64 messageCnt)
+{
+	LONG64 filledSize{ 0 };
+	for (LONG64 i = 0; i < messageCnt; ++i)
+	{
+		int messageSize = GetMessageSize(i);
+
+		char* pMessage{ nullptr };
+		while (nullptr == (pMessage = pPair->mRingBuffer.MoveMark(messageSize)))
+		{
+			std::this_thread::yield();
+		}
+
+		FillMessage(pMessage, messageSize, i, &pPair->mWriteChecksum);
+
+		filledSize += messageSize;
+		pPair->mFilledSize.store(filledSize, std::memory_order_release);
+	}
+}
+
+void ReadMonitor(BufferPair* pPair, LONG64 totalSize)
+{
+	LONG64 readSize{ 0 };
+	while (totalSize > readSize)
+	{
+		LONG64 filledSize = pPair->mFilledSize.load(std::memory_order_acquire);
+		if (filledSize == readSize)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		int realSize{ 0 };
+		char* pBuffer = pPair->mRingBuffer.GetBuffer(static_cast<int>(filledSize - readSize), &realSize);
+		if (nullptr == pBuffer || 0 == realSize)
+		{
+			continue;
+		}
+
+		ReadMessages(pBuffer, realSize, &pPair->mReadChecksum);
+		pPair->mRingBuffer.ReleaseBuffer(realSize);
+
+		readSize += realSize;
+	}
+}
+
+void WriteSPSC(BufferPair* pPair, LONG64 messageCnt)
+{
+	for (LONG64 i = 0; i < messageCnt; ++i)
+	{
+		int messageSize = GetMessageSize(i);
+
+		char* pMessage{ nullptr };
+		while (nullptr == (pMessage = pPair->mRingBuffer.ReserveSPSC(messageSize)))
+		{
+			std::this_thread::yield();
+		}
+
+		FillMessage(pMessage, messageSize, i, &pPair->mWriteChecksum);
+		pPair->mRingBuffer.CommitSPSC(messageSize);
+	}
+}
+
+void ReadSPSC(BufferPair* pPair, LONG64 totalSize)
+{
+	LONG64 readSize{ 0 };
+	while (totalSize > readSize)
+	{
+		int readableSize{ 0 };
+		char* pBuffer = pPair->mRingBuffer.PeekSPSC(&readableSize);
+		if (nullptr == pBuffer)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		ReadMessages(pBuffer, readableSize, &pPair->mReadChecksum);
+		pPair->mRingBuffer.ReleaseSPSC(readableSize);
+
+		readSize += readableSize;
+	}
+}
+
+LONG64 GetTotalSize(LONG64 messageCnt)
+{
+	LONG64 totalSize{ 0 };
+	for (LONG64 i = 0; i < messageCnt; ++i)
+	{
+		totalSize += GetMessageSize(i);
+	}
+
+	return totalSize;
+}
+
+bool CreatePair(BufferPair* pPair, bool isSPSC)
+{
+	return isSPSC ? pPair->mRingBuffer.CreateSPSC(BUFFER_SIZE) : pPair->mRingBuffer.Create(BUFFER_SIZE);
+}
+
+// 한 thread에서 쓰고 바로 읽는다.
+double RunSingleThread(bool isSPSC, LONG64 messageCnt, bool* pIsChecksumOk)
+{
+	BufferPair pair;
+	if (false == CreatePair(&pair, isSPSC))
+	{
+		std::cout << "RingBuffer create failed" << std::endl;
+		std::exit(1);
+	}
+
+	auto beginTime = std::chrono::steady_clock::now();
+
+	for (LONG64 i = 0; i < messageCnt; ++i)
+	{
+		int messageSize = GetMessageSize(i);
+		int realSize{ 0 };
+
+		if (isSPSC)
+		{
+			char* pMessage = pair.mRingBuffer.ReserveSPSC(messageSize);
+			FillMessage(pMessage, messageSize, i, &pair.mWriteChecksum);
+			pair.mRingBuffer.CommitSPSC(messageSize);
+
+			char* pBuffer = pair.mRingBuffer.PeekSPSC(&realSize);
+			ReadMessages(pBuffer, realSize, &pair.mReadChecksum);
+			pair.mRingBuffer.ReleaseSPSC(realSize);
+		}
+		else
+		{
+			char* pMessage = pair.mRingBuffer.MoveMark(messageSize);
+			FillMessage(pMessage, messageSize, i, &pair.mWriteChecksum);
+
+			char* pBuffer = pair.mRingBuffer.GetBuffer(messageSize, &realSize);
+			ReadMessages(pBuffer, realSize, &pair.mReadChecksum);
+			pair.mRingBuffer.ReleaseBuffer(realSize);
+		}
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+
+	*pIsChecksumOk = pair.mWriteChecksum == pair.mReadChecksum;
+	return std::chrono::duration<double, std::nano>(endTime - beginTime).count() / messageCnt;
+}
+
+// 버퍼 쌍마다 쓰는 thread, 읽는 thread를 하나씩 띄운다.
+double RunThreads(bool isSPSC, int pairCnt, LONG64 messageCnt, bool* pIsChecksumOk)
+{
+	std::vector<BufferPair> pairs(pairCnt);
+	for (BufferPair& pair : pairs)
+	{
+		if (false == CreatePair(&pair, isSPSC))
+		{
+			std::cout << "RingBuffer create failed" << std::endl;
+			std::exit(1);
+		}
+	}
+
+	LONG64 totalSize = GetTotalSize(messageCnt);
+
+	auto beginTime = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (BufferPair& pair : pairs)
+	{
+		if (isSPSC)
+		{
+			threads.emplace_back(WriteSPSC, &pair, messageCnt);
+			threads.emplace_back(ReadSPSC, &pair, totalSize);
+		}
+		else
+		{
+			threads.emplace_back(WriteMonitor, &pair, messageCnt);
+			threads.emplace_back(ReadMonitor, &pair, totalSize);
+		}
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+
+	*pIsChecksumOk = true;
+	for (BufferPair& pair : pairs)
+	{
+		if (pair.mWriteChecksum != pair.mReadChecksum)
+		{
+			*pIsChecksumOk = false;
+		}
+	}
+
+	// 버퍼 쌍 하나가 메시지 하나를 넘기는 시간
+	return std::chrono::duration<double, std::nano>(endTime - beginTime).count() / messageCnt;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && 0 == strcmp(argv[1], "-h"))
+	{
+		std::cout << "usage: RingBufferSPSCBench [messageCnt] [maxPairCnt]" << std::endl;
+		return 0;
+	}
+
+	LONG64 messageCnt = argc > 1 ? atoll(argv[1]) : 10000000;
+	int maxPairCnt = argc > 2 ? atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency() / 2);
+	if (1 > maxPairCnt)
+	{
+		maxPairCnt = 1;
+	}
+
+	double averageMessageSize = static_cast<double>(GetTotalSize(1024)) / 1024;
+
+	std::cout << "messages:       " << messageCnt << std::endl;
+	std::cout << "message size:   " << averageMessageSize << " (average)" << std::endl;
+	std::cout << "buffer size:    " << BUFFER_SIZE << std::endl;
+	std::cout << std::endl;
+
+	printf("%-14s %-8s %12s %12s %10s\n", "mode", "pairs", "ns/message", "MB/sec", "checksum");
+
+	for (bool isSPSC : { false, true })
+	{
+		bool isChecksumOk{ false };
+		double nsPerMessage = RunSingleThread(isSPSC, messageCnt, &isChecksumOk);
+
+		printf("%-14s %-8s %12.1f %12.1f %10s\n", isSPSC ? "spsc" : "monitor", "1 thread",
+			nsPerMessage, averageMessageSize * 1000.0 / nsPerMessage, isChecksumOk ? "ok" : "MISMATCH");
+	}
+
+	for (int pairCnt = 1; pairCnt <= maxPairCnt; pairCnt *= 2)
+	{
+		for (bool isSPSC : { false, true })
+		{
+			bool isChecksumOk{ false };
+			double nsPerMessage = RunThreads(isSPSC, pairCnt, messageCnt, &isChecksumOk);
+
+			// 전체 처리량은 모든 버퍼 쌍의 합
+			printf("%-14s %-8d %12.1f %12.1f %10s\n", isSPSC ? "spsc" : "monitor", pairCnt,
+				nsPerMessage, averageMessageSize * 1000.0 / nsPerMessage * pairCnt, isChecksumOk ? "ok" : "MISMATCH");
+		}
+	}
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,209 @@
+﻿// 2026 10 18 이정모 home
+//
+// Strand(직렬 실행기) 확장성 측정
+//
+// zone 하나를 strand 하나로 보고 zone마다 작업(game logic 흉내)을 미리 넣어둔 뒤
+// worker thread 수를 1, 2, 4, 8, 16으로 늘려가며 모든 작업을 처리하는 시간을 잰다.
+// process thread 하나가 모든 작업을 처리하던 방식은 worker thread 1개일 때와 같다.
+//
+// 측정
+// - 초당 처리한 작업 수와 worker thread 1개 대비 배율
+// - strand 순서 위반 수(같은 zone의 작업이 넣은 순서와 다르게 실행되거나 동시에 실행된 횟수, 항상 0이어야 한다.)
+//
+// worker thread 수가 core 수를 넘으면 배율이 더 오르지 않는다.
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include "Log.h"
+#include "Connection.h"
+#include "IOBackend.h"
+#include "Strand.h"
+#include "IOCPServer.h"
+
+// benchmark는 NetworkLibrary만 link하기 때문에 server 객체가 필요하지만
+// Connection을 사용하지 않으니 아무 server도 알려주지 않는다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return nullptr;
+}
+
+std::atomic<LONG64> gExecutedTaskCnt{ 0 };
+std::atomic<LONG64> gOrderViolationCnt{ 0 };
+
+// strand 하나가 맡는 zone
+struct Zone
+{
+	Strand mStrand;
+
+	// 다음에 실행되어야 하는 작업 번호
+	LONG64 mNextSeq{ 0 };
+
+	// 작업을 실행중인 thread 수(strand가 맞다면 0 또는 1)
+	std::atomic<int> mRunningCnt{ 0 };
+
+	// zone 상태를 흉내낸 값
+	unsigned long long mState{ 0 };
+};
+
+class ZoneTask : public StrandTask
+{
+public:
+	void Execute() override
+	{
+		if (0 != mZone->mRunningCnt.fetch_add(1) || mSeq != mZone->mNextSeq)
+		{
+			gOrderViolationCnt.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		++mZone->mNextSeq;
+
+		// game logic 대신 zone 상태를 work번 갱신한다.
+		unsigned long long state = mZone->mState;
+		for (int i = 0; i < mWork; ++i)
+		{
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		}
+		mZone->mState = state;
+
+		mZone->mRunningCnt.fetch_sub(1);
+		gExecutedTaskCnt.fetch_add(1, std::memory_order_relaxed);
+	}
+
+public:
+	Zone* mZone{ nullptr };
+	LONG64 mSeq{ 0 };
+	int mWork{ 0 };
+};
+
+// 반환값은 초당 처리한 작업 수
+double RunBench(eIOBackendType backendType, int workerThreadCnt, int zoneCnt, int taskCnt, int work)
+{
+	IOBackend* pIOBackend = IOBackend::CreateIOBackend(backendType);
+	if (nullptr == pIOBackend ||
+		false == pIOBackend->Create(zoneCnt))
+	{
+		std::cout << "IOBackend create failed" << std::endl;
+		std::exit(1);
+	}
+
+	std::vector<Zone> zones(zoneCnt);
+	std::vector<ZoneTask> tasks(static_cast<size_t>(zoneCnt) * taskCnt);
+
+	for (Zone& zone : zones)
+	{
+		zone.mStrand.Create(pIOBackend);
+	}
+
+	// worker thread를 만들기 전에 모든 작업을 넣어둬서
+	// 작업을 넣는 비용이 아니라 strand가 나눠서 실행하는 시간만 잰다.
+	// zone을 번갈아가며 넣어서 zone마다 작업이 여러 번 나눠서 들어가게 한다.
+	gExecutedTaskCnt.store(0);
+
+	for (int seq = 0; seq < taskCnt; ++seq)
+	{
+		for (int i = 0; i < zoneCnt; ++i)
+		{
+			ZoneTask& task = tasks[static_cast<size_t>(seq) * zoneCnt + i];
+			task.mZone = &zones[i];
+			task.mSeq = seq;
+			task.mWork = work;
+
+			zones[i].mStrand.Post(&task);
+		}
+	}
+
+	LONG64 totalTaskCnt = static_cast<LONG64>(zoneCnt) * taskCnt;
+
+	auto beginTime = std::chrono::steady_clock::now();
+
+	if (false == pIOBackend->CreateWorkerThread(workerThreadCnt))
+	{
+		std::cout << "CreateWorkerThread() failed" << std::endl;
+		std::exit(1);
+	}
+
+	while (totalTaskCnt > gExecutedTaskCnt.load())
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+
+	pIOBackend->DestroyWorkerThread();
+	pIOBackend->Destroy();
+	delete pIOBackend;
+
+	double elapsedTime = std::chrono::duration<double>(endTime - beginTime).count();
+	return totalTaskCnt / elapsedTime;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* usage = "usage: StrandBench [epoll|uring] [zoneCnt] [taskCnt per zone] [work per task] [maxWorkerThreadCnt]";
+
+	if (argc < 2)
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	eIOBackendType backendType{};
+	if (0 == strcmp(argv[1], "epoll"))
+	{
+		backendType = eIOBackendType::BACKEND_EPOLL;
+	}
+	else if (0 == strcmp(argv[1], "uring"))
+	{
+		backendType = eIOBackendType::BACKEND_IO_URING;
+	}
+	else
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	int zoneCnt = argc > 2 ? atoi(argv[2]) : 1024;
+	int taskCnt = argc > 3 ? atoi(argv[3]) : 500;
+	int work = argc > 4 ? atoi(argv[4]) : 2000;
+	int maxWorkerThreadCnt = argc > 5 ? atoi(argv[5]) : 16;
+
+	std::cout << "backend:  " << argv[1] << std::endl;
+	std::cout << "zones:    " << zoneCnt << std::endl;
+	std::cout << "tasks:    " << static_cast<LONG64>(zoneCnt) * taskCnt << std::endl;
+	std::cout << "work:     " << work << std::endl;
+	std::cout << "cores:    " << std::thread::hardware_concurrency() << std::endl;
+	std::cout << std::endl;
+	std::cout << "workers  tasks/sec    speedup  violations" << std::endl;
+
+	double baseTasksPerSec{ 0.0 };
+
+	for (int workerThreadCnt = 1; workerThreadCnt <= maxWorkerThreadCnt; workerThreadCnt *= 2)
+	{
+		gOrderViolationCnt.store(0);
+
+		double tasksPerSec = RunBench(backendType, workerThreadCnt, zoneCnt, taskCnt, work);
+		if (1 == workerThreadCnt)
+		{
+			baseTasksPerSec = tasksPerSec;
+		}
+
+		printf("%7d  %11lld  %7.2f  %10lld\n",
+			workerThreadCnt,
+			static_cast<LONG64>(tasksPerSec),
+			tasksPerSec / baseTasksPerSec,
+			gOrderViolationCnt.load());
+	}
+
+	return 0;
+}
+
+#endif
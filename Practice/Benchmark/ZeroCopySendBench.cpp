@@ -0,0 +1,330 @@
+﻿// 2026 10 18 이정모 home
+//
+// zero-copy 송신(InitConfig::mZeroCopySendThreshold) 성능 비교
+//
+// client가 요청 패킷을 보내면 server가 큰 payload로 응답한다(맵 조각, 리플레이 전송을 흉내).
+// fork()한 client 프로세스가 모든 연결에 요청을 하나씩 보낸 뒤에 모든 응답을 받는 것을 반복한다.
+//
+// server 프로세스 기준으로 측정
+// - 초당 송신량(MB/s)
+// - 1GB를 송신하는데 사용한 CPU 시간(getrusage())
+// - zero-copy 완료 알림 수, 그 중 kernel이 결국 복사한 수
+//
+// loopback은 수신 쪽으로 넘길 때 항상 복사하기 때문에(완료 알림에 copied로 표시됨)
+// zero-copy의 이득은 실제 NIC를 사용하는 두 장비 사이에서 측정해야 한다.
+// loopback에서는 완료 알림을 처리하는 추가 비용만 보인다.
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "Log.h"
+#include "Connection.h"
+#include "IOBackend.h"
+#include "IOCPServer.h"
+
+const char* SERVER_IP = "127.0.0.1";
+const int SERVER_PORT = 8101;
+
+// 요청 패킷: 패킷 크기(4byte) + 요청하는 payload 크기(4byte)
+constexpr int REQUEST_SIZE{ 8 };
+
+// 한 번에 송신 요청하는 최대 크기
+constexpr int SEND_BUF_SIZE{ 64 * 1024 };
+
+std::atomic<LONG64> gSendBytes{ 0 };
+
+// 연결을 마친 client thread 수
+std::atomic<int> gConnectedThreadCnt{ 0 };
+int gClientThreadCnt{ 4 };
+
+// 요청받은 크기의 payload로 응답하는 server
+class PayloadServer : public IOCPServer
+{
+public:
+	bool OnAccept(Connection*) override
+	{
+		return true;
+	}
+
+	bool OnRecv(Connection* pConnection, DWORD, char* pPacket) override
+	{
+		int payloadSize{ 0 };
+		CopyMemory(&payloadSize, pPacket + 4, sizeof(payloadSize));
+
+		// PrepareSendPacket()이 앞 4byte에 패킷 크기를 채워준다.
+		char* pSendPacket = pConnection->PrepareSendPacket(payloadSize);
+		if (nullptr == pSendPacket)
+		{
+			return false;
+		}
+
+		pConnection->SendPost();
+
+		gSendBytes.fetch_add(payloadSize, std::memory_order_relaxed);
+		return true;
+	}
+
+	void OnClose(Connection*) override
+	{
+	}
+
+	bool CloseConnection(Connection* pConnection) override
+	{
+		return pConnection->CloseConnection();
+	}
+};
+
+PayloadServer gPayloadServer;
+
+// benchmark는 NetworkLibrary만 link하기 때문에
+// Connection이 사용하는 server 객체를 여기서 알려준다.
+IOCPServer* IOCPServer::GetIOCPServer()
+{
+	return &gPayloadServer;
+}
+
+// client thread 하나가 연결 여러 개를 맡아서 요청하고 응답을 받는다.
+void ClientThread(int connectionCnt, int roundCnt, int payloadSize)
+{
+	SOCKADDR_IN serverAddr{};
+	serverAddr.sin_family = AF_INET;
+	serverAddr.sin_port = htons(SERVER_PORT);
+	inet_pton(AF_INET, SERVER_IP, &serverAddr.sin_addr);
+
+	std::vector<SOCKET> sockets;
+	for (int i = 0; i < connectionCnt; ++i)
+	{
+		SOCKET clientSocket = socket(AF_INET, SOCK_STREAM, 0);
+		if (0 != connect(clientSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)))
+		{
+			std::cout << "connect() failed: " << errno << std::endl;
+			std::exit(1);
+		}
+
+		sockets.push_back(clientSocket);
+	}
+
+	// 모든 연결이 끝난 뒤에 동시에 시작한다.
+	gConnectedThreadCnt.fetch_add(1);
+	while (gClientThreadCnt > gConnectedThreadCnt.load())
+	{
+		std::this_thread::yield();
+	}
+
+	char requestPacket[REQUEST_SIZE]{};
+	int requestSize = REQUEST_SIZE;
+	CopyMemory(requestPacket, &requestSize, sizeof(requestSize));
+	CopyMemory(requestPacket + 4, &payloadSize, sizeof(payloadSize));
+
+	// 응답 내용은 확인하지 않고 버린다.
+	std::vector<char> recvBuffer(SEND_BUF_SIZE);
+
+	for (int round = 0; round < roundCnt; ++round)
+	{
+		for (SOCKET clientSocket : sockets)
+		{
+			send(clientSocket, requestPacket, REQUEST_SIZE, MSG_NOSIGNAL);
+		}
+
+		for (SOCKET clientSocket : sockets)
+		{
+			int recvBytes{ 0 };
+			while (payloadSize > recvBytes)
+			{
+				int recvSize = payloadSize - recvBytes;
+				if (SEND_BUF_SIZE < recvSize)
+				{
+					recvSize = SEND_BUF_SIZE;
+				}
+
+				ssize_t ret = recv(clientSocket, recvBuffer.data(), recvSize, 0);
+				if (0 >= ret)
+				{
+					std::cout << "recv() failed: " << errno << std::endl;
+					std::exit(1);
+				}
+
+				recvBytes += static_cast<int>(ret);
+			}
+		}
+	}
+
+	for (SOCKET clientSocket : sockets)
+	{
+		close(clientSocket);
+	}
+}
+
+// 모든 연결이 끝나면 pipe로 server에게 알려주고 측정을 시작한다.
+void RunClient(int connectionCnt, int roundCnt, int payloadSize, int readyPipe)
+{
+	std::vector<std::thread> clientThreads;
+	for (int i = 0; i < gClientThreadCnt; ++i)
+	{
+		int threadConnectionCnt = connectionCnt / gClientThreadCnt + (i < connectionCnt % gClientThreadCnt ? 1 : 0);
+		clientThreads.emplace_back(ClientThread, threadConnectionCnt, roundCnt, payloadSize);
+	}
+
+	while (gClientThreadCnt > gConnectedThreadCnt.load())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	char ready{ 1 };
+	write(readyPipe, &ready, sizeof(ready));
+
+	for (std::thread& clientThread : clientThreads)
+	{
+		clientThread.join();
+	}
+}
+
+double GetCPUTime()
+{
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+		usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* usage = "usage: ZeroCopySendBench [epoll|uring] [payloadSize] [zeroCopyThreshold(0: off)] [connectionCnt] [roundCnt]";
+
+	if (argc < 2)
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	eIOBackendType backendType{};
+	if (0 == strcmp(argv[1], "epoll"))
+	{
+		backendType = eIOBackendType::BACKEND_EPOLL;
+	}
+	else if (0 == strcmp(argv[1], "uring"))
+	{
+		backendType = eIOBackendType::BACKEND_IO_URING;
+	}
+	else
+	{
+		std::cout << usage << std::endl;
+		return 0;
+	}
+
+	int payloadSize = argc > 2 ? atoi(argv[2]) : 256 * 1024;
+	int zeroCopyThreshold = argc > 3 ? atoi(argv[3]) : 16 * 1024;
+	int connectionCnt = argc > 4 ? atoi(argv[4]) : 64;
+	int roundCnt = argc > 5 ? atoi(argv[5]) : 200;
+	int workerThreadCnt{ 4 };
+
+	// client 프로세스를 먼저 만들어야 server의 CPU 시간에 client가 섞이지 않는다.
+	int readyPipe[2]{};
+	pipe(readyPipe);
+
+	pid_t clientPid = fork();
+	if (0 == clientPid)
+	{
+		close(readyPipe[0]);
+
+		// server가 listen할 때까지 기다린다.
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		RunClient(connectionCnt, roundCnt, payloadSize, readyPipe[1]);
+
+		return 0;
+	}
+
+	close(readyPipe[1]);
+
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	int reuseAddr{ 1 };
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
+
+	SOCKADDR_IN serverAddr{};
+	serverAddr.sin_family = AF_INET;
+	serverAddr.sin_port = htons(SERVER_PORT);
+	inet_pton(AF_INET, SERVER_IP, &serverAddr.sin_addr);
+
+	if (0 != bind(listenSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)) ||
+		0 != listen(listenSocket, SOMAXCONN))
+	{
+		std::cout << "bind(), listen() failed: " << errno << std::endl;
+		return 1;
+	}
+
+	IOBackend* pIOBackend = IOBackend::CreateIOBackend(backendType);
+	if (nullptr == pIOBackend ||
+		false == pIOBackend->Create(connectionCnt) ||
+		false == pIOBackend->BindListenSocket(listenSocket) ||
+		false == pIOBackend->CreateWorkerThread(workerThreadCnt))
+	{
+		std::cout << "IOBackend create failed" << std::endl;
+		return 1;
+	}
+
+	// zero-copy는 완료 알림까지 send ring buffer를 잡아두기 때문에
+	// 응답 몇 개가 들어갈 만큼 넉넉하게 잡는다.
+	int sendBufCnt = (payloadSize / SEND_BUF_SIZE + 1) * 4;
+
+	Connection* pConnections = new Connection[connectionCnt];
+	for (int i = 0; i < connectionCnt; ++i)
+	{
+		InitConfig initConfig{};
+		initConfig.mIndex = i;
+		initConfig.mListenSocket = listenSocket;
+		initConfig.mIOBackend = pIOBackend;
+		initConfig.mRecvBufCnt = 4;
+		initConfig.mSendBufCnt = sendBufCnt;
+		initConfig.mRecvBufSize = 1024;
+		initConfig.mSendBufSize = SEND_BUF_SIZE;
+		initConfig.mZeroCopySendThreshold = zeroCopyThreshold;
+
+		pConnections[i].CreateConnection(initConfig);
+	}
+
+	char ready{ 0 };
+	read(readyPipe[0], &ready, sizeof(ready));
+
+	LONG64 beginSendBytes = gSendBytes.load();
+	LONG64 beginNotifyCnt = pIOBackend->GetZeroCopyNotifyCount();
+	LONG64 beginCopiedCnt = pIOBackend->GetZeroCopyCopiedCount();
+	double beginCPUTime = GetCPUTime();
+	auto beginTime = std::chrono::steady_clock::now();
+
+	waitpid(clientPid, nullptr, 0);
+
+	auto endTime = std::chrono::steady_clock::now();
+	double cpuTime = GetCPUTime() - beginCPUTime;
+	LONG64 sendBytes = gSendBytes.load() - beginSendBytes;
+	LONG64 notifyCnt = pIOBackend->GetZeroCopyNotifyCount() - beginNotifyCnt;
+	LONG64 copiedCnt = pIOBackend->GetZeroCopyCopiedCount() - beginCopiedCnt;
+
+	double elapsedTime = std::chrono::duration<double>(endTime - beginTime).count();
+	double sendGB = sendBytes / (1024.0 * 1024.0 * 1024.0);
+
+	std::cout << "backend:            " << argv[1] << std::endl;
+	std::cout << "payload size:       " << payloadSize << std::endl;
+	std::cout << "zc threshold:       " << zeroCopyThreshold << std::endl;
+	std::cout << "connections:        " << connectionCnt << std::endl;
+	std::cout << "MB/sec:             " << sendBytes / (1024.0 * 1024.0) / elapsedTime << std::endl;
+	std::cout << "cpu msec/GB:        " << cpuTime * 1000.0 / sendGB << std::endl;
+	std::cout << "zero-copy notifies: " << notifyCnt << std::endl;
+	std::cout << "zero-copy copied:   " << copiedCnt << std::endl;
+
+	pIOBackend->DestroyWorkerThread();
+
+	return 0;
+}
+
+#endif
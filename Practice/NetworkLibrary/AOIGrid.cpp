@@ -0,0 +1,369 @@
+﻿#include <algorithm>
+#include <cstdlib>
+
+#include "Log.h"
+#include "SharedPacket.h"
+#include "AOIGrid.h"
+
+AOIGrid::AOIGrid()
+	: mMapWidth{ 0.0f }
+	, mMapHeight{ 0.0f }
+	, mCellSize{ 0.0f }
+	, mColumnCnt{ 0 }
+	, mRowCnt{ 0 }
+	, mCellHeads{}
+	, mEntities{}
+	, mEntityCnt{ 0 }
+	, mEvents{}
+	, mDeltas{}
+{
+}
+
+AOIGrid::~AOIGrid()
+{
+	Destroy();
+}
+
+bool AOIGrid::Create(float mapWidth, float mapHeight, float cellSize, int maxEntityCnt)
+{
+	if (0.0f >= mapWidth || 0.0f >= mapHeight || 0.0f >= cellSize || 0 >= maxEntityCnt)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | AOIGrid::Create() | invalid parameter, map(%f, %f) cellSize(%f) maxEntityCnt(%d)",
+			mapWidth, mapHeight, cellSize, maxEntityCnt);
+
+		return false;
+	}
+
+	mMapWidth = mapWidth;
+	mMapHeight = mapHeight;
+	mCellSize = cellSize;
+
+	// map 끝 좌표도 마지막 cell에 들어가도록 올림
+	mColumnCnt = static_cast<int>(mapWidth / cellSize) + 1;
+	mRowCnt = static_cast<int>(mapHeight / cellSize) + 1;
+
+	mCellHeads.assign(static_cast<size_t>(mColumnCnt) * mRowCnt, INVALID_AOI_ENTITY_ID);
+
+	AOIEntity emptyEntity{ 0.0f, 0.0f, -1, INVALID_AOI_ENTITY_ID, INVALID_AOI_ENTITY_ID, false, nullptr };
+	mEntities.assign(maxEntityCnt, emptyEntity);
+	mEntityCnt = 0;
+
+	mEvents.clear();
+	mDeltas.clear();
+
+	return true;
+}
+
+void AOIGrid::Destroy()
+{
+	mCellHeads.clear();
+	mEntities.clear();
+	mEntityCnt = 0;
+
+	mEvents.clear();
+	mDeltas.clear();
+}
+
+bool AOIGrid::Enter(AOIEntityId id, float x, float y, bool isObserver, Connection* pConnection)
+{
+	if (false == IsValidId(id) || -1 != mEntities[id].mCell)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | AOIGrid::Enter() | invalid id or already inside, id(%d)",
+			id);
+
+		return false;
+	}
+
+	AOIEntity& entity = mEntities[id];
+	entity.mX = std::clamp(x, 0.0f, mMapWidth);
+	entity.mY = std::clamp(y, 0.0f, mMapHeight);
+	entity.mIsObserver = isObserver;
+	entity.mConnection = pConnection;
+
+	int cell = GetCell(entity.mX, entity.mY);
+
+	// 목록에 넣기 전에 기록해야 자기 자신이 섞이지 않는다.
+	AddEvents(id, cell, -1, eAOIEventType::AOI_APPEAR);
+	LinkCell(id, cell);
+
+	++mEntityCnt;
+	return true;
+}
+
+bool AOIGrid::Leave(AOIEntityId id)
+{
+	if (false == IsInside(id))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | AOIGrid::Leave() | not inside, id(%d)",
+			id);
+
+		return false;
+	}
+
+	UnlinkCell(id);
+	AddEvents(id, mEntities[id].mCell, -1, eAOIEventType::AOI_DISAPPEAR);
+
+	mEntities[id].mCell = -1;
+	mEntities[id].mConnection = nullptr;
+
+	--mEntityCnt;
+	return true;
+}
+
+bool AOIGrid::Move(AOIEntityId id, float x, float y)
+{
+	if (false == IsInside(id))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | AOIGrid::Move() | not inside, id(%d)",
+			id);
+
+		return false;
+	}
+
+	AOIEntity& entity = mEntities[id];
+	entity.mX = std::clamp(x, 0.0f, mMapWidth);
+	entity.mY = std::clamp(y, 0.0f, mMapHeight);
+
+	// 대부분의 이동은 같은 cell 안에서 끝난다.
+	int oldCell = entity.mCell;
+	int newCell = GetCell(entity.mX, entity.mY);
+	if (oldCell == newCell)
+	{
+		return true;
+	}
+
+	UnlinkCell(id);
+
+	// 두 3x3이 겹치는 cell의 entity는 계속 보이기 때문에 기록하지 않는다.
+	AddEvents(id, oldCell, newCell, eAOIEventType::AOI_DISAPPEAR);
+	AddEvents(id, newCell, oldCell, eAOIEventType::AOI_APPEAR);
+
+	LinkCell(id, newCell);
+
+	return true;
+}
+
+const std::vector<AOIEvent>& AOIGrid::CollectDeltas()
+{
+	mDeltas.clear();
+
+	// 같은 두 entity 사이의 기록은 appear, disappear가 번갈아 남는다.
+	// 넣은 순서를 유지하며 묶어서 개수가 홀수면 처음 기록만 남기고, 짝수면 서로 상쇄되어 모두 지운다.
+	std::stable_sort(mEvents.begin(), mEvents.end(),
+		[](const AOIEvent& lhs, const AOIEvent& rhs)
+		{
+			if (lhs.mObserver != rhs.mObserver)
+			{
+				return lhs.mObserver < rhs.mObserver;
+			}
+
+			return lhs.mTarget < rhs.mTarget;
+		});
+
+	size_t begin{ 0 };
+	while (mEvents.size() > begin)
+	{
+		size_t end = begin + 1;
+		while (mEvents.size() > end &&
+			mEvents[begin].mObserver == mEvents[end].mObserver &&
+			mEvents[begin].mTarget == mEvents[end].mTarget)
+		{
+			++end;
+		}
+
+		if (0 != (end - begin) % 2)
+		{
+			mDeltas.push_back(mEvents[begin]);
+		}
+
+		begin = end;
+	}
+
+	mEvents.clear();
+
+	return mDeltas;
+}
+
+int AOIGrid::GatherNearEntities(AOIEntityId id, std::vector<AOIEntityId>& nearEntities)
+{
+	nearEntities.clear();
+
+	if (false == IsInside(id))
+	{
+		return 0;
+	}
+
+	int cell = mEntities[id].mCell;
+	int column = cell % mColumnCnt;
+	int row = cell / mColumnCnt;
+
+	for (int nearRow = std::max(row - 1, 0); nearRow <= std::min(row + 1, mRowCnt - 1); ++nearRow)
+	{
+		for (int nearColumn = std::max(column - 1, 0); nearColumn <= std::min(column + 1, mColumnCnt - 1); ++nearColumn)
+		{
+			AOIEntityId nearId = mCellHeads[nearRow * mColumnCnt + nearColumn];
+			while (INVALID_AOI_ENTITY_ID != nearId)
+			{
+				if (id != nearId)
+				{
+					nearEntities.push_back(nearId);
+				}
+
+				nearId = mEntities[nearId].mNext;
+			}
+		}
+	}
+
+	return static_cast<int>(nearEntities.size());
+}
+
+int AOIGrid::Broadcast(AOIEntityId id, SharedPacket* pPacket, bool isExcludeSelf, ePacketPriority priority)
+{
+	if (false == IsInside(id) || nullptr == pPacket)
+	{
+		return 0;
+	}
+
+	int cell = mEntities[id].mCell;
+	int column = cell % mColumnCnt;
+	int row = cell / mColumnCnt;
+
+	int sendCnt{ 0 };
+
+	for (int nearRow = std::max(row - 1, 0); nearRow <= std::min(row + 1, mRowCnt - 1); ++nearRow)
+	{
+		for (int nearColumn = std::max(column - 1, 0); nearColumn <= std::min(column + 1, mColumnCnt - 1); ++nearColumn)
+		{
+			AOIEntityId nearId = mCellHeads[nearRow * mColumnCnt + nearColumn];
+			while (INVALID_AOI_ENTITY_ID != nearId)
+			{
+				Connection* pConnection = mEntities[nearId].mConnection;
+				if (nullptr != pConnection && (false == isExcludeSelf || id != nearId))
+				{
+					// 송신 대기 목록이 가득 찼다면 SendShared()가 연결을 끊거나 패킷을 버린다.
+					if (pConnection->SendShared(pPacket, priority))
+					{
+						pConnection->SendPostCorked();
+						++sendCnt;
+					}
+				}
+
+				nearId = mEntities[nearId].mNext;
+			}
+		}
+	}
+
+	return sendCnt;
+}
+
+bool AOIGrid::IsInside(AOIEntityId id)
+{
+	return IsValidId(id) && -1 != mEntities[id].mCell;
+}
+
+int AOIGrid::GetEntityCount()
+{
+	return mEntityCnt;
+}
+
+int AOIGrid::GetCellCount()
+{
+	return static_cast<int>(mCellHeads.size());
+}
+
+bool AOIGrid::IsValidId(AOIEntityId id)
+{
+	return 0 <= id && static_cast<int>(mEntities.size()) > id;
+}
+
+int AOIGrid::GetCell(float x, float y)
+{
+	int column = std::min(static_cast<int>(x / mCellSize), mColumnCnt - 1);
+	int row = std::min(static_cast<int>(y / mCellSize), mRowCnt - 1);
+
+	return row * mColumnCnt + column;
+}
+
+void AOIGrid::LinkCell(AOIEntityId id, int cell)
+{
+	AOIEntity& entity = mEntities[id];
+	entity.mCell = cell;
+	entity.mPrev = INVALID_AOI_ENTITY_ID;
+	entity.mNext = mCellHeads[cell];
+
+	if (INVALID_AOI_ENTITY_ID != entity.mNext)
+	{
+		mEntities[entity.mNext].mPrev = id;
+	}
+
+	mCellHeads[cell] = id;
+}
+
+void AOIGrid::UnlinkCell(AOIEntityId id)
+{
+	AOIEntity& entity = mEntities[id];
+
+	if (INVALID_AOI_ENTITY_ID != entity.mPrev)
+	{
+		mEntities[entity.mPrev].mNext = entity.mNext;
+	}
+	else
+	{
+		mCellHeads[entity.mCell] = entity.mNext;
+	}
+
+	if (INVALID_AOI_ENTITY_ID != entity.mNext)
+	{
+		mEntities[entity.mNext].mPrev = entity.mPrev;
+	}
+
+	entity.mPrev = INVALID_AOI_ENTITY_ID;
+	entity.mNext = INVALID_AOI_ENTITY_ID;
+}
+
+void AOIGrid::AddEvents(AOIEntityId id, int fromCell, int exceptCell, eAOIEventType type)
+{
+	int column = fromCell % mColumnCnt;
+	int row = fromCell / mColumnCnt;
+
+	int exceptColumn = -1 == exceptCell ? 0 : exceptCell % mColumnCnt;
+	int exceptRow = -1 == exceptCell ? 0 : exceptCell / mColumnCnt;
+
+	for (int nearRow = std::max(row - 1, 0); nearRow <= std::min(row + 1, mRowCnt - 1); ++nearRow)
+	{
+		for (int nearColumn = std::max(column - 1, 0); nearColumn <= std::min(column + 1, mColumnCnt - 1); ++nearColumn)
+		{
+			// exceptCell 주변 3x3에 들어가는 cell
+			if (-1 != exceptCell &&
+				1 >= std::abs(nearRow - exceptRow) &&
+				1 >= std::abs(nearColumn - exceptColumn))
+			{
+				continue;
+			}
+
+			AOIEntityId nearId = mCellHeads[nearRow * mColumnCnt + nearColumn];
+			while (INVALID_AOI_ENTITY_ID != nearId)
+			{
+				AddPairEvent(id, nearId, type);
+				nearId = mEntities[nearId].mNext;
+			}
+		}
+	}
+}
+
+void AOIGrid::AddPairEvent(AOIEntityId lhs, AOIEntityId rhs, eAOIEventType type)
+{
+	if (mEntities[lhs].mIsObserver)
+	{
+		mEvents.push_back(AOIEvent{ lhs, rhs, type });
+	}
+
+	if (mEntities[rhs].mIsObserver)
+	{
+		mEvents.push_back(AOIEvent{ rhs, lhs, type });
+	}
+}
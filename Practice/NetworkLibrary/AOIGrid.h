@@ -0,0 +1,144 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 주변 캐릭터에게만 패킷을 보내기 위한 균일 격자 AOI(area of interest)
+//
+// 지금까지 "주변 player에게 보내기"는 모든 Connection을 훑어보는 방법 밖에 없었다.
+//
+// map을 cellSize 크기의 정사각형 cell로 나누고 entity를 자기 위치의 cell 목록에 넣는다.
+// entity는 자기 cell과 둘러싼 8개 cell(3x3) 안의 entity를 본다.
+// 그래서 cellSize는 시야 거리 이상으로 잡는다.
+//
+// cell 목록은 entity 배열의 index로 연결한 이중 연결 list라서
+// 들어오기(Enter), 나가기(Leave), cell이 바뀌는 이동(Move) 모두 O(1)에 목록을 고친다.
+// cell이 바뀌면 이전 3x3과 새 3x3이 겹치지 않는 cell만 훑어서
+// 새로 보이게 된 entity(appear)와 더 이상 보이지 않는 entity(disappear)를 기록하고
+// CollectDeltas()가 tick 동안 모은 기록을 observer별로 정리해서 돌려준다.
+// 한 tick 안에 나타났다 사라진 entity처럼 서로 상쇄되는 기록은 빠진다.
+//
+// Broadcast()는 주변 cell의 connection에게 SharedPacket을 그대로 넘겨서
+// 복사 없이 송신 대기 목록에 넣는다.
+//
+// 이 class는 동기화를 하지 않는다.
+// zone 하나에 AOIGrid 하나를 두고 그 zone의 Strand에서만 호출한다.
+
+#include <vector>
+
+#include "Platform.h"
+#include "Connection.h"
+
+class SharedPacket;
+
+// AOI에 넣는 entity 번호(0 ~ maxEntityCnt - 1), 어떤 대상에 번호를 붙일지는 game code가 정한다.
+using AOIEntityId = int;
+constexpr AOIEntityId INVALID_AOI_ENTITY_ID{ -1 };
+
+enum class eAOIEventType
+{
+	AOI_APPEAR,
+	AOI_DISAPPEAR,
+};
+
+// mObserver가 mTarget을 새로 보게 되었거나(appear) 더 이상 보지 못하게 되었다(disappear).
+struct AOIEvent
+{
+	AOIEntityId mObserver;
+	AOIEntityId mTarget;
+	eAOIEventType mType;
+};
+
+class NETLIB_API AOIGrid
+{
+public:
+	AOIGrid();
+	~AOIGrid();
+
+public:
+	// mapWidth, mapHeight: map 크기(좌표는 0 ~ 크기), cellSize: cell 한 변의 길이(시야 거리 이상)
+	// maxEntityCnt: AOIEntityId의 범위
+	bool Create(float mapWidth, float mapHeight, float cellSize, int maxEntityCnt);
+	void Destroy();
+
+public:
+	// isObserver: 주변의 변화를 알아야 하는 entity인지(player, 주변 player를 보고 움직이는 NPC)
+	// pConnection: Broadcast()를 받을 connection(없으면 nullptr)
+	// 연결이 끊기면 OnClose()에서 Leave()를 호출해야 다음 client에게 잘못 보내지 않는다.
+	// map 밖의 좌표는 map 가장자리로 맞춘다.
+	bool Enter(AOIEntityId id, float x, float y, bool isObserver, Connection* pConnection = nullptr);
+	bool Leave(AOIEntityId id);
+	bool Move(AOIEntityId id, float x, float y);
+
+	// 지난 호출 이후 모은 기록을 observer, target 순서로 정렬하고 상쇄되는 기록을 지워서 반환한다.
+	// 반환한 목록은 다음 CollectDeltas() 호출 전까지 유효하다.
+	const std::vector<AOIEvent>& CollectDeltas();
+
+	// id가 보는 entity(자신 제외)를 nearEntities에 채운다.
+	int GatherNearEntities(AOIEntityId id, std::vector<AOIEntityId>& nearEntities);
+
+	// id 주변 connection에게 pPacket을 보낸다.
+	// SendShared()로 송신 대기 목록에 넣고 SendPostCorked()로 송신한다.
+	// 반환값은 송신 대기 목록에 넣은 connection 수
+	int Broadcast(AOIEntityId id, SharedPacket* pPacket, bool isExcludeSelf,
+		ePacketPriority priority = ePacketPriority::PRIORITY_NORMAL);
+
+public:
+	bool IsInside(AOIEntityId id);
+	int GetEntityCount();
+	int GetCellCount();
+
+public:
+	AOIGrid(const AOIGrid& rhs) = delete;
+	AOIGrid(AOIGrid&& rhs) = delete;
+
+	AOIGrid& operator=(const AOIGrid& rhs) = delete;
+	AOIGrid& operator=(AOIGrid&& rhs) = delete;
+
+private:
+	struct AOIEntity
+	{
+		float mX;
+		float mY;
+
+		// 들어있는 cell(AOI 밖이면 -1)
+		int mCell;
+
+		// 같은 cell 목록의 앞뒤 entity(없으면 INVALID_AOI_ENTITY_ID)
+		AOIEntityId mPrev;
+		AOIEntityId mNext;
+
+		bool mIsObserver;
+		Connection* mConnection;
+	};
+
+private:
+	bool IsValidId(AOIEntityId id);
+	int GetCell(float x, float y);
+
+	void LinkCell(AOIEntityId id, int cell);
+	void UnlinkCell(AOIEntityId id);
+
+	// fromCell 주변 3x3 중 exceptCell 주변 3x3에 없는 cell의 entity와 id 사이에 type 기록을 남긴다.
+	// exceptCell이 -1이면 3x3 전부
+	void AddEvents(AOIEntityId id, int fromCell, int exceptCell, eAOIEventType type);
+
+	// 서로 보는 관계가 바뀐 두 entity 중 observer인 쪽에 기록을 남긴다.
+	void AddPairEvent(AOIEntityId lhs, AOIEntityId rhs, eAOIEventType type);
+
+private:
+	float mMapWidth;
+	float mMapHeight;
+	float mCellSize;
+	int mColumnCnt;
+	int mRowCnt;
+
+	// cell마다 목록의 첫 entity
+	std::vector<AOIEntityId> mCellHeads;
+
+	std::vector<AOIEntity> mEntities;
+	int mEntityCnt;
+
+	// CollectDeltas() 전까지 모은 기록과 정리한 결과
+	std::vector<AOIEvent> mEvents;
+	std::vector<AOIEvent> mDeltas;
+};
@@ -0,0 +1,324 @@
+﻿#include <chrono>
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+#include "Log.h"
+#include "Connection.h"
+#include "ConnectionManager.h"
+#include "AcceptManager.h"
+
+static LONG64 GetNowUsec()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AcceptManager::AcceptManager()
+	: mIOBackend{ nullptr }
+	, mListenSocket{ INVALID_SOCKET }
+	, mMaxConnectionCnt{ 0 }
+	, mMinAcceptCnt{ 0 }
+	, mMaxAcceptCnt{ 0 }
+	, mTargetAcceptCnt{ 0 }
+	, mPostedAcceptCnt{ 0 }
+	, mIdleConnections{ nullptr }
+	, mConnectionManager{ nullptr }
+	, mPostTimes{ nullptr }
+	, mWindowBeginUsec{ 0 }
+	, mWindowAcceptCnt{ 0 }
+	, mIsStarvedInWindow{ false }
+	, mQuietWindowCnt{ 0 }
+	, mAcceptQueueDepth{ 0 }
+	, mMaxAcceptQueueDepth{ 0 }
+	, mAcceptCnt{ 0 }
+	, mCompletionCnt{ 0 }
+	, mTotalTimeToAccept{ 0 }
+	, mMaxTimeToAccept{ 0 }
+	, mSyncObject{}
+{
+}
+
+AcceptManager::~AcceptManager()
+{
+	delete mIdleConnections;
+	delete[] mPostTimes;
+}
+
+bool AcceptManager::Create(IOBackend* pIOBackend, SOCKET listenSocket, int maxConnectionCnt, int minAcceptCnt, int maxAcceptCnt,
+	ConnectionManager* pConnectionManager)
+{
+	if (nullptr == pIOBackend || 0 >= maxConnectionCnt || 0 >= minAcceptCnt || minAcceptCnt > maxAcceptCnt)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | AcceptManager::Create() | invalid count: connection[%d] min[%d] max[%d]",
+			maxConnectionCnt, minAcceptCnt, maxAcceptCnt);
+
+		return false;
+	}
+
+	mIOBackend = pIOBackend;
+	mListenSocket = listenSocket;
+	mMaxConnectionCnt = maxConnectionCnt;
+	mMinAcceptCnt = minAcceptCnt;
+	mMaxAcceptCnt = maxAcceptCnt;
+	mTargetAcceptCnt = minAcceptCnt;
+
+	mConnectionManager = pConnectionManager;
+	if (nullptr == mConnectionManager)
+	{
+		mIdleConnections = new Queue<Connection*>{ maxConnectionCnt };
+	}
+
+	mPostTimes = new LONG64[maxConnectionCnt]{};
+
+	mWindowBeginUsec = GetNowUsec();
+
+	return true;
+}
+
+bool AcceptManager::RequestAccept(Connection* pConnection)
+{
+	if (0 > pConnection->GetIndex() || mMaxConnectionCnt <= pConnection->GetIndex())
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | AcceptManager::RequestAccept() | invalid index[%d]",
+			pConnection->GetIndex());
+
+		return false;
+	}
+
+	Monitor::Owner lock{ mSyncObject };
+
+	// 연결이 끊기는 것도 접속이 적어졌다는 신호라서 목표 수를 다시 정해본다.
+	AdjustTarget(GetNowUsec());
+
+	if (mTargetAcceptCnt > mPostedAcceptCnt)
+	{
+		return PostAccept(pConnection);
+	}
+
+	return PushIdleConnection(pConnection);
+}
+
+void AcceptManager::OnAcceptCompleted(Connection* pConnection, bool isSuccess)
+{
+	LONG64 nowUsec = GetNowUsec();
+
+	Monitor::Owner lock{ mSyncObject };
+
+	--mPostedAcceptCnt;
+
+	LONG64 timeToAccept = nowUsec - mPostTimes[pConnection->GetIndex()];
+	mTotalTimeToAccept += timeToAccept;
+	++mCompletionCnt;
+	if (mMaxTimeToAccept < timeToAccept)
+	{
+		mMaxTimeToAccept = timeToAccept;
+	}
+
+	if (isSuccess)
+	{
+		++mAcceptCnt;
+		++mWindowAcceptCnt;
+	}
+
+	// 걸어둔 accept를 다 사용했다면 다시 채우기 전에 들어온 client는 accept queue에서 기다린다.
+	if (0 == mPostedAcceptCnt)
+	{
+		mIsStarvedInWindow = true;
+	}
+
+	AdjustTarget(nowUsec);
+	PostIdleConnections();
+}
+
+void AcceptManager::AdjustTarget(LONG64 nowUsec)
+{
+	LONG64 elapsedWindowCnt = (nowUsec - mWindowBeginUsec) / (ACCEPT_ADJUST_MSEC * 1000);
+
+	// 구간이 끝나지 않았어도 접속이 몰리고 있다면 바로 늘린다.
+	bool isBusy = mIsStarvedInWindow || mWindowAcceptCnt >= mTargetAcceptCnt;
+	if (false == isBusy && 0 >= elapsedWindowCnt)
+	{
+		return;
+	}
+
+	// 구간마다 한 번만 확인한다(getsockopt() 호출).
+	if (0 < elapsedWindowCnt)
+	{
+		mAcceptQueueDepth = QueryAcceptQueueDepth();
+		if (mMaxAcceptQueueDepth < mAcceptQueueDepth)
+		{
+			mMaxAcceptQueueDepth = mAcceptQueueDepth;
+		}
+
+		isBusy = isBusy || 0 < mAcceptQueueDepth;
+	}
+
+	if (isBusy)
+	{
+		mTargetAcceptCnt = mTargetAcceptCnt * 2 < mMaxAcceptCnt ? mTargetAcceptCnt * 2 : mMaxAcceptCnt;
+		mQuietWindowCnt = 0;
+	}
+	else
+	{
+		if (mWindowAcceptCnt < mTargetAcceptCnt / 4)
+		{
+			++mQuietWindowCnt;
+		}
+		else
+		{
+			mQuietWindowCnt = 0;
+		}
+
+		// 그 뒤로 통지 없이 지나간 구간은 접속이 없던 구간이다.
+		LONG64 emptyWindowCnt = elapsedWindowCnt - 1;
+		mQuietWindowCnt += static_cast<int>(emptyWindowCnt < ACCEPT_SHRINK_WINDOW_CNT ? emptyWindowCnt : ACCEPT_SHRINK_WINDOW_CNT);
+
+		if (ACCEPT_SHRINK_WINDOW_CNT <= mQuietWindowCnt)
+		{
+			mTargetAcceptCnt = mTargetAcceptCnt / 2 > mMinAcceptCnt ? mTargetAcceptCnt / 2 : mMinAcceptCnt;
+			mQuietWindowCnt = 0;
+		}
+	}
+
+	mWindowBeginUsec = nowUsec;
+	mWindowAcceptCnt = 0;
+	mIsStarvedInWindow = false;
+}
+
+void AcceptManager::PostIdleConnections()
+{
+	while (mTargetAcceptCnt > mPostedAcceptCnt)
+	{
+		Connection* pConnection = PopIdleConnection();
+		if (nullptr == pConnection)
+		{
+			break;
+		}
+
+		// 실패한 Connection은 대기 목록으로 돌려두고 다음 완료 통지 때 다시 시도한다.
+		if (false == PostAccept(pConnection))
+		{
+			PushIdleConnection(pConnection);
+			break;
+		}
+	}
+}
+
+bool AcceptManager::PushIdleConnection(Connection* pConnection)
+{
+	if (nullptr != mConnectionManager)
+	{
+		mConnectionManager->Free(pConnection);
+		return true;
+	}
+
+	return mIdleConnections->Push(pConnection);
+}
+
+Connection* AcceptManager::PopIdleConnection()
+{
+	if (nullptr != mConnectionManager)
+	{
+		return mConnectionManager->Alloc();
+	}
+
+	if (mIdleConnections->IsEmpty())
+	{
+		return nullptr;
+	}
+
+	Connection* pConnection = mIdleConnections->Front();
+	mIdleConnections->Pop();
+
+	return pConnection;
+}
+
+bool AcceptManager::PostAccept(Connection* pConnection)
+{
+	// backend가 바로 accept를 끝내고 완료 통지를 넣을 수 있어서
+	// 걸기 전에 기록해둔다.
+	mPostTimes[pConnection->GetIndex()] = GetNowUsec();
+	++mPostedAcceptCnt;
+
+	if (false == pConnection->PostAccept())
+	{
+		--mPostedAcceptCnt;
+		return false;
+	}
+
+	return true;
+}
+
+int AcceptManager::QueryAcceptQueueDepth()
+{
+	int acceptQueueDepth = mIOBackend->GetAcceptBacklog();
+
+#ifndef _WIN32
+	// listen socket의 TCP_INFO는 tcpi_unacked에 accept queue에서 기다리는 연결 수를 넣어준다.
+	// (AcceptEx()를 사용할 때는 accept queue 크기를 알려주는 API가 없다.)
+	tcp_info info{};
+	socklen_t infoLength = sizeof(info);
+	if (0 == getsockopt(mListenSocket, IPPROTO_TCP, TCP_INFO, &info, &infoLength))
+	{
+		acceptQueueDepth += static_cast<int>(info.tcpi_unacked);
+	}
+#endif
+
+	return acceptQueueDepth;
+}
+
+int AcceptManager::GetTargetAcceptCount()
+{
+	return mTargetAcceptCnt;
+}
+
+int AcceptManager::GetPostedAcceptCount()
+{
+	return mPostedAcceptCnt;
+}
+
+int AcceptManager::GetIdleConnectionCount()
+{
+	if (nullptr != mConnectionManager)
+	{
+		return mConnectionManager->GetFreeConnectionCount();
+	}
+
+	return mIdleConnections->GetCurrentSize();
+}
+
+int AcceptManager::GetAcceptQueueDepth()
+{
+	return mAcceptQueueDepth;
+}
+
+int AcceptManager::GetMaxAcceptQueueDepth()
+{
+	return mMaxAcceptQueueDepth;
+}
+
+LONG64 AcceptManager::GetAverageTimeToAccept()
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	if (0 == mCompletionCnt)
+	{
+		return 0;
+	}
+
+	return mTotalTimeToAccept / mCompletionCnt;
+}
+
+LONG64 AcceptManager::GetMaxTimeToAccept()
+{
+	return mMaxTimeToAccept;
+}
+
+LONG64 AcceptManager::GetAcceptCount()
+{
+	return mAcceptCnt;
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// listen socket 하나에 걸어둘 accept 요청의 수를 조절하는 class
+//
+// 원래는 Connection이 CreateConnection(), CloseConnection()에서 BindAcceptExSock()을 호출해서
+// 쉬고 있는 모든 Connection이 accept를 하나씩 걸어두었다.
+// 그래서 걸어둔 accept 수는 server 시작 시 정한 connection pool 구성을 그대로 따라간다.
+//
+// InitConfig::mAcceptManager를 지정하면 BindAcceptExSock()은 Connection을 AcceptManager에게 넘기고
+// AcceptManager는 목표 수(target)만큼만 accept를 걸어두고 나머지는 대기 목록에 둔다.
+// accept가 완료될 때마다 대기 목록에서 꺼내서 목표 수를 채운다.
+//
+// 목표 수는 accept 완료 통지를 처리하거나 Connection이 돌아올 때 다시 정한다.
+// - ACCEPT_ADJUST_MSEC 구간 안에 목표 수 이상 접속했거나, 걸어둔 accept가 모두 사용되었거나,
+//   listen socket의 accept queue에 client가 대기중이면 접속이 몰리는 중이라서 목표 수를 두 배로 늘린다.
+// - 구간 동안 접속이 목표 수의 1/4보다 적은 상태가 ACCEPT_SHRINK_WINDOW_CNT번 이어지면 절반으로 줄인다.
+// 줄일 때 이미 걸어둔 accept는 취소하지 않고, 완료되어도 다시 채우지 않는 방식으로 줄어든다.
+//
+// ShardedAcceptor처럼 listen socket이 여러 개라면 listen socket마다 하나씩 만든다.
+
+#include "Platform.h"
+#include "Monitor.h"
+#include "Queue.h"
+
+class Connection;
+class ConnectionManager;
+class IOBackend;
+
+// 목표 수를 다시 정하는 간격
+constexpr LONG64 ACCEPT_ADJUST_MSEC{ 100 };
+
+// 이 횟수만큼 연속으로 접속이 적으면 목표 수를 줄인다.
+constexpr int ACCEPT_SHRINK_WINDOW_CNT{ 10 };
+
+class NETLIB_API AcceptManager
+{
+public:
+	AcceptManager();
+	~AcceptManager();
+
+public:
+	// pIOBackend, listenSocket: Connection들이 accept를 걸 backend와 listen socket
+	// maxConnectionCnt: 이 listen socket으로 받을 Connection의 index 범위
+	// minAcceptCnt, maxAcceptCnt: 목표 수의 범위(처음에는 minAcceptCnt)
+	// pConnectionManager: 지정하면 accept를 걸지 않은 Connection을 대기 목록 대신 ConnectionManager의 free list에 둔다.
+	bool Create(IOBackend* pIOBackend, SOCKET listenSocket, int maxConnectionCnt, int minAcceptCnt, int maxAcceptCnt,
+		ConnectionManager* pConnectionManager = nullptr);
+
+	// Connection::BindAcceptExSock()이 호출한다.
+	// 걸어둔 accept가 목표 수보다 적으면 바로 accept를 걸고 아니면 대기 목록에 넣는다.
+	bool RequestAccept(Connection* pConnection);
+
+	// Connection::OnIOCompleted()가 accept 완료 통지를 받으면 성공 여부와 상관없이 호출한다.
+	// 실패했다면 Connection이 CloseConnection()에서 다시 RequestAccept()를 호출한다.
+	void OnAcceptCompleted(Connection* pConnection, bool isSuccess);
+
+public:
+	int GetTargetAcceptCount();
+
+	// 지금 걸어둔 accept 수
+	int GetPostedAcceptCount();
+
+	// accept를 걸지 않고 대기 목록에 있는 Connection 수
+	int GetIdleConnectionCount();
+
+	// accept를 기다리는 client 수
+	// listen socket의 accept queue와 backend가 들고 있는 접속(IOBackend::GetAcceptBacklog())의 합
+	// (구간이 끝날 때 확인한 값, accept queue를 확인할 수 없는 플랫폼이면 backend 것만 센다.)
+	int GetAcceptQueueDepth();
+	int GetMaxAcceptQueueDepth();
+
+	// accept를 걸어둔 뒤 완료될 때까지 걸린 시간(microsecond)
+	// 0에 가까우면 걸자마자 대기중이던 client를 받은 것이라서 accept가 부족했다는 뜻이고
+	// 길면 접속보다 accept를 많이 걸어둔 것이다.
+	LONG64 GetAverageTimeToAccept();
+	LONG64 GetMaxTimeToAccept();
+
+	LONG64 GetAcceptCount();
+
+public:
+	AcceptManager(const AcceptManager& rhs) = delete;
+	AcceptManager(AcceptManager&& rhs) = delete;
+
+	AcceptManager& operator=(const AcceptManager& rhs) = delete;
+	AcceptManager& operator=(AcceptManager&& rhs) = delete;
+
+private:
+	// 목표 수를 다시 정한다. lock을 잡고 호출
+	void AdjustTarget(LONG64 nowUsec);
+
+	// 걸어둔 accept가 목표 수가 될 때까지 대기 목록에서 꺼내서 accept를 건다. lock을 잡고 호출
+	void PostIdleConnections();
+
+	// 대기 목록에 넣고 꺼낸다(ConnectionManager가 있다면 free list).
+	bool PushIdleConnection(Connection* pConnection);
+	Connection* PopIdleConnection();
+
+	// Connection::PostAccept()를 호출하고 성공하면 시간을 기록한다. lock을 잡고 호출
+	bool PostAccept(Connection* pConnection);
+
+	int QueryAcceptQueueDepth();
+
+private:
+	IOBackend* mIOBackend;
+	SOCKET mListenSocket;
+	int mMaxConnectionCnt;
+
+	int mMinAcceptCnt;
+	int mMaxAcceptCnt;
+	int mTargetAcceptCnt;
+	int mPostedAcceptCnt;
+
+	Queue<Connection*>* mIdleConnections;
+	ConnectionManager* mConnectionManager;
+
+	// Connection의 index로 접근하는, accept를 건 시각(microsecond)
+	LONG64* mPostTimes;
+
+	// 목표 수를 다시 정하는 구간의 시작 시각과 그 동안의 통계
+	LONG64 mWindowBeginUsec;
+	int mWindowAcceptCnt;
+	bool mIsStarvedInWindow;
+	int mQuietWindowCnt;
+
+	int mAcceptQueueDepth;
+	int mMaxAcceptQueueDepth;
+
+	LONG64 mAcceptCnt;
+	LONG64 mCompletionCnt;
+	LONG64 mTotalTimeToAccept;
+	LONG64 mMaxTimeToAccept;
+
+	Monitor mSyncObject;
+};
@@ -0,0 +1,259 @@
+﻿#include "Log.h"
+#include "ChainBuffer.h"
+
+ChainBuffer::ChainBuffer()
+	: mSlabPool{ nullptr }
+	, mHead{ nullptr }
+	, mTail{ nullptr }
+	, mReleaseOffset{ 0 }
+	, mSendSlab{ nullptr }
+	, mSendOffset{ 0 }
+	, mSlabCnt{ 0 }
+	, mMaxBufferSize{ 0 }
+	, mUsedBufferSize{ 0 }
+	, mHoldBufferSize{ 0 }
+	, mDeferredReleaseSize{ 0 }
+	, mReservedSize{ 0 }
+	, mSyncObject{}
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+	if (nullptr != mSlabPool)
+	{
+		FreeAllSlabs();
+	}
+}
+
+bool ChainBuffer::Create(int maxBufferSize)
+{
+	if (0 >= maxBufferSize)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | ChainBuffer::Create() | invalid max buffer size: %d",
+			maxBufferSize);
+
+		return false;
+	}
+
+	mSlabPool = SlabPool::GetInstance();
+	mMaxBufferSize = maxBufferSize;
+
+	return Initialize();
+}
+
+bool ChainBuffer::Initialize()
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	FreeAllSlabs();
+
+	mUsedBufferSize = 0;
+	mHoldBufferSize = 0;
+	mDeferredReleaseSize = 0;
+	mReservedSize = 0;
+
+	return true;
+}
+
+char* ChainBuffer::MoveMark(int moveLength)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	if (SEND_SLAB_SIZE < moveLength ||
+		mUsedBufferSize + moveLength > mMaxBufferSize)
+	{
+		return nullptr;
+	}
+
+	// 마지막 slab에 공간이 부족하면 새 slab을 붙인다.
+	if (nullptr == mTail ||
+		SEND_SLAB_SIZE - mTail->mWriteEnd < moveLength)
+	{
+		Slab* pSlab = mSlabPool->Alloc();
+		if (nullptr == pSlab)
+		{
+			return nullptr;
+		}
+
+		if (nullptr == mTail)
+		{
+			mHead = pSlab;
+			mReleaseOffset = 0;
+			mSendSlab = pSlab;
+			mSendOffset = 0;
+		}
+		else
+		{
+			mTail->mNext = pSlab;
+		}
+
+		mTail = pSlab;
+		++mSlabCnt;
+	}
+
+	char* pMark = mTail->mData + mTail->mWriteEnd;
+
+	mTail->mWriteEnd += moveLength;
+	mUsedBufferSize += moveLength;
+	mReservedSize += moveLength;
+
+	return pMark;
+}
+
+int ChainBuffer::GetBuffers(int requestSendSize, WSABUF* pBufs, int maxBufCnt, int* realSendSize)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	// 잡아두거나 해제를 미룬 크기는 이미 송신한 데이터라서 뺀다.
+	int pendingSize = mUsedBufferSize - mHoldBufferSize - mDeferredReleaseSize;
+	int remainSize = pendingSize > requestSendSize ? requestSendSize : pendingSize;
+	int bufCnt{ 0 };
+
+	*realSendSize = 0;
+
+	while (0 < remainSize && maxBufCnt > bufCnt)
+	{
+		// slab 끝까지 담았다면 다음 slab으로 넘어간다.
+		// 송신할 데이터가 남아있으니 다음 slab이 있다.
+		if (mSendOffset == mSendSlab->mWriteEnd)
+		{
+			mSendSlab = mSendSlab->mNext;
+			mSendOffset = 0;
+		}
+
+		int sendSize = mSendSlab->mWriteEnd - mSendOffset;
+		if (sendSize > remainSize)
+		{
+			sendSize = remainSize;
+		}
+
+		pBufs[bufCnt].buf = mSendSlab->mData + mSendOffset;
+		pBufs[bufCnt].len = sendSize;
+		++bufCnt;
+
+		mSendOffset += sendSize;
+		remainSize -= sendSize;
+		*realSendSize += sendSize;
+	}
+
+	return bufCnt;
+}
+
+void ChainBuffer::ReleaseBuffer(int releaseSize)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	// 앞쪽에 잡아둔 버퍼가 있다면 같이 해제될 때까지 미룬다.
+	if (0 < mHoldBufferSize)
+	{
+		mDeferredReleaseSize += releaseSize;
+		return;
+	}
+
+	mUsedBufferSize -= releaseSize;
+	MoveReleaseMark(releaseSize);
+}
+
+void ChainBuffer::HoldBuffer(int holdSize)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	mHoldBufferSize += holdSize;
+}
+
+void ChainBuffer::ReleaseHoldBuffer(int releaseSize)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	mHoldBufferSize -= releaseSize;
+	mUsedBufferSize -= releaseSize;
+	MoveReleaseMark(releaseSize);
+
+	if (0 == mHoldBufferSize && 0 < mDeferredReleaseSize)
+	{
+		mUsedBufferSize -= mDeferredReleaseSize;
+		MoveReleaseMark(mDeferredReleaseSize);
+
+		mDeferredReleaseSize = 0;
+	}
+}
+
+void ChainBuffer::MoveReleaseMark(int releaseSize)
+{
+	// 쌓인 데이터를 모두 해제했다면 slab을 모두 돌려준다.
+	if (0 == mUsedBufferSize)
+	{
+		FreeAllSlabs();
+		return;
+	}
+
+	mReleaseOffset += releaseSize;
+
+	// 끝까지 해제한 slab은 앞에서부터 돌려준다.
+	// 남은 데이터가 있으니 마지막 slab은 남는다.
+	while (mHead != mTail && mReleaseOffset >= mHead->mWriteEnd)
+	{
+		Slab* pSlab = mHead;
+
+		mReleaseOffset -= pSlab->mWriteEnd;
+		mHead = pSlab->mNext;
+
+		// 송신 위치가 돌려줄 slab의 끝에 있다면 다음 slab의 처음으로 옮긴다.
+		if (mSendSlab == pSlab)
+		{
+			mSendSlab = mHead;
+			mSendOffset = 0;
+		}
+
+		mSlabPool->Free(pSlab);
+		--mSlabCnt;
+	}
+}
+
+void ChainBuffer::FreeAllSlabs()
+{
+	while (nullptr != mHead)
+	{
+		Slab* pSlab = mHead;
+		mHead = pSlab->mNext;
+
+		mSlabPool->Free(pSlab);
+	}
+
+	mTail = nullptr;
+	mReleaseOffset = 0;
+	mSendSlab = nullptr;
+	mSendOffset = 0;
+	mSlabCnt = 0;
+}
+
+int ChainBuffer::GetBufferSize()
+{
+	return mMaxBufferSize;
+}
+
+int ChainBuffer::GetUsedBufferSize()
+{
+	return mUsedBufferSize;
+}
+
+int ChainBuffer::GetPendingSendSize()
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	return mUsedBufferSize - mHoldBufferSize - mDeferredReleaseSize;
+}
+
+LONG64 ChainBuffer::GetReservedSize()
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	return mReservedSize;
+}
+
+int ChainBuffer::GetSlabCount()
+{
+	return mSlabCnt;
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// SlabPool에서 가져온 slab을 이어 붙여서 만든 send buffer
+//
+// RingBuffer는 CreateConnection()에서 최대 크기를 한 번에 잡아두기 때문에
+// 모든 connection이 가장 많이 몰릴 때를 기준으로 메모리를 차지한다.
+// ChainBuffer는 송신할 데이터가 늘어나면 slab을 하나씩 붙이고
+// 송신이 끝난 slab은 바로 pool에 돌려줘서 실제로 쌓인 만큼만 메모리를 사용한다.
+//
+// 패킷은 slab 하나 안에 연속으로 담기 때문에 SEND_SLAB_SIZE보다 큰 패킷은 담을 수 없다.
+// 마지막 slab에 남은 공간이 부족하면 남은 공간을 비워두고 새 slab에 담는다.
+
+#include "Platform.h"
+#include "Monitor.h"
+#include "SendBuffer.h"
+#include "SlabPool.h"
+
+class NETLIB_API ChainBuffer : public SendBuffer
+{
+public:
+	ChainBuffer();
+	~ChainBuffer() override;
+
+public:
+	// maxBufferSize: 송신하지 못하고 쌓아둘 수 있는 최대 크기
+	bool Create(int maxBufferSize);
+	bool Initialize() override;
+
+public:
+	char* MoveMark(int moveLength) override;
+	int GetBuffers(int requestSendSize, WSABUF* pBufs, int maxBufCnt, int* realSendSize) override;
+
+	void ReleaseBuffer(int releaseSize) override;
+	void HoldBuffer(int holdSize) override;
+	void ReleaseHoldBuffer(int releaseSize) override;
+
+public:
+	int GetBufferSize() override;
+	int GetUsedBufferSize() override;
+	int GetPendingSendSize() override;
+	LONG64 GetReservedSize() override;
+
+	// 현재 가지고 있는 slab 수
+	int GetSlabCount();
+
+public:
+	ChainBuffer(const ChainBuffer& rhs) = delete;
+	ChainBuffer(ChainBuffer&& rhs) = delete;
+
+	ChainBuffer& operator=(const ChainBuffer& rhs) = delete;
+	ChainBuffer& operator=(ChainBuffer&& rhs) = delete;
+
+private:
+	// 해제한 크기만큼 mReleaseOffset을 옮기고 다 해제한 slab은 pool에 돌려준다. lock을 잡고 호출
+	void MoveReleaseMark(int releaseSize);
+
+	// 모든 slab을 pool에 돌려준다. lock을 잡고 호출
+	void FreeAllSlabs();
+
+private:
+	SlabPool* mSlabPool;
+
+	// 가장 오래된 slab과 데이터를 쓰고 있는 slab
+	Slab* mHead;
+	Slab* mTail;
+
+	// mHead에서 아직 해제되지 않은 데이터의 시작 위치
+	int mReleaseOffset;
+
+	// 다음에 송신할 데이터의 위치
+	Slab* mSendSlab;
+	int mSendOffset;
+
+	int mSlabCnt;
+	int mMaxBufferSize;
+
+	// RingBuffer와 같은 의미
+	int mUsedBufferSize;
+	int mHoldBufferSize;
+	int mDeferredReleaseSize;
+	LONG64 mReservedSize;
+
+	Monitor mSyncObject;
+};
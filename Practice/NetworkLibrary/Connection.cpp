@@ -1,40 +1,125 @@
-﻿// AcceptEx() 함수를 호출하려면 mswsock.h가 필요한데
-// ws2tcpip.h를 포함하지 않으면, AcceptEx() 함수를 식별하지 못함.
-// 정확한 이유는 찾지 못함
-#include <ws2tcpip.h>
-#include <mswsock.h>
+﻿// AcceptEx(), WSARecv(), WSASend() 호출은 IOCPBackend로 옮겼다.
+
+#include <new>
+#include <vector>
 
 #include "Log.h"
 #include "IOCPServer.h"
 #include "Connection.h"
+#include "Coroutine.h"
+#include "SharedPacket.h"
+#include "ConnectionManager.h"
+
+// coroutine이 꺼내가지 않은 패킷이 이 크기 이상 쌓이면
+// 다음 수신 요청을 미뤄두었다가 coroutine이 꺼내갈 때 다시 요청한다.
+constexpr size_t COROUTINE_INBOX_PAUSE_SIZE{ 64 * 1024 };
+
+// 수신을 멈출 수 없는 backend(multishot recv)에서 쌓아둘 수 있는 최대 크기
+// 넘으면 처리하지 못할 만큼 보내는 client로 보고 연결을 끊는다.
+constexpr size_t MAX_COROUTINE_INBOX_SIZE{ 256 * 1024 };
+
+// SendPostCorked()로 모아둔, 호출한 thread의 송신 대기 목록
+static thread_local std::vector<Connection*> tCorkedConnections;
+
+// 호출한 thread가 WithConnection()으로 읽기로 잡고 있는 Connection
+static thread_local Connection* tSharedAccessConnection{ nullptr };
+
+// mDeferredClose의 하위 2비트(종료 방법), 그 위는 미룬 client의 세대(handle의 상위 32비트)
+constexpr LONG64 DEFERRED_CLOSE_GRACEFUL{ 1 };
+constexpr LONG64 DEFERRED_CLOSE_FORCE{ 2 };
+constexpr LONG64 DEFERRED_CLOSE_TYPE_MASK{ 3 };
+
+static LONG64 MakeDeferredClose(ConnectionHandle handle, LONG64 closeType)
+{
+	return static_cast<LONG64>((handle >> 32) << 2) | closeType;
+}
 
-#pragma comment(lib, "ws2_32")
-#pragma comment(lib, "Mswsock")
+// 송신 요청의 조각 중에 SendShared()로 넣은 패킷이 있는지
+// 공유 패킷은 송신이 끝나면 바로 해제될 수 있어서 zero-copy로 보내지 않는다.
+static bool HasSharedPacket(OVERLAPPED_EX* pOverlappedEx)
+{
+	for (int i = 0; i < pOverlappedEx->mSendBufCnt; ++i)
+	{
+		if (nullptr != pOverlappedEx->mSendPackets[i])
+		{
+			return true;
+		}
+	}
 
-constexpr int PACKET_SIZE_LENGTH = 4;
+	return false;
+}
 
 Connection::Connection()
-	: mListenSocket{ INVALID_SOCKET }
-	, mClientSocket{ INVALID_SOCKET }
-	, mRecvOverlappedEx{ nullptr }
+	: mRecvOverlappedEx{ nullptr }
 	, mSendOverlappedEx{ nullptr }
-	, mSendBufSize{ 0 }
-	, mRecvBufSize{ 0 }
+	, mZeroCopyOverlappedEx{ nullptr }
+	, mSendBuffer{ &mSendRingBuffer }
+	, mSendChainBuffer{ nullptr }
+	, mSendQueue{ nullptr }
+	, mStrand{}
 	, mAddressBuf{ 0, }
 	, mIsClosed{ false }
 	, mIsConnected{ false }
 	, mIsSending{ true }
+	, mClientSocket{ INVALID_SOCKET }
+	, mListenSocket{ INVALID_SOCKET }
+	, mRecvBufSize{ 0 }
+	, mSendBufSize{ 0 }
 	, mClientIP{ 0, }
 	, mIndex{ -1 }
-	, mIOCP{ NULL }
+	, mGeneration{ 1 }
+	, mDeferredClose{ 0 }
+	, mIOBackend{ nullptr }
 	, mSendIORefCount{ 0 }
 	, mRecvIORefCount{ 0 }
 	, mAcceptIORefCount{ 0 }
+	, mIsSharedRecvBuffer{ false }
+	, mReassemblySlab{ nullptr }
+	, mReassemblyBuf{ nullptr }
+	, mReassemblyBufSize{ 0 }
+	, mReassemblyBytes{ 0 }
+	, mZeroCopySendThreshold{ 0 }
+	, mUseCorkedSend{ false }
+	, mCorkFlushThreshold{ 0 }
+	, mIsCorked{ false }
+	, mSendHighWatermark{ 0 }
+	, mSendLowWatermark{ 0 }
+	, mSendBufferListener{ nullptr }
+	, mSendOverflowPolicy{ eSendOverflowPolicy::OVERFLOW_DISCONNECT }
+	, mAcceptManager{ nullptr }
+	, mConnectionManager{ nullptr }
+	, mIsSendBufferHigh{ false }
+	, mDroppedSendCnt{ 0 }
+	, mMaxPacketSize{ 0 }
+	, mUseCoroutine{ false }
+	, mCoInbox{}
+	, mCoReadBuf{}
+	, mCoReadOffset{ 0 }
+	, mCoReadHandle{ INVALID_CONNECTION_HANDLE }
+	, mIsRecvPaused{ false }
+	, mPausedPacketStart{ nullptr }
+	, mPausedProcessedBytes{ 0 }
+	, mReadWaiter{}
+	, mReadWaiterData{ nullptr }
+	, mReadWaiterSize{ nullptr }
+	, mFlushWaiter{}
+	, mFlushWaiterResult{ nullptr }
+	, mCoroutineSyncObj{}
+	, mSharedSendQueue{}
+	, mSharedSendBytes{ 0 }
+	, mSendGatheredSize{ 0 }
+	, mSharedSendSyncObj{}
 {
 }
 
 Connection::~Connection()
 {
+	ReleaseSharedPackets();
+
+	ReleaseReassemblyBuf();
+	delete mZeroCopyOverlappedEx;
+	delete mSendChainBuffer;
+	delete mSendQueue;
 }
 
 void Connection::InitializeConnection()
@@ -56,8 +141,18 @@ void Connection::InitializeConnection()
 	mRecvIORefCount = 0;
 	mAcceptIORefCount = 0;
 
-	mSendRingBuffer.Initialize();
+	mSendBuffer->Initialize();
 	mRecvRingBuffer.Initialize();
+
+	// mIsConnected를 false로 바꾼 뒤에 해제해야 SendShared()가 다음 client의 목록에 넣지 않는다.
+	ReleaseSharedPackets();
+	mSendGatheredSize = 0;
+
+	mIsSendBufferHigh = false;
+
+	// 다른 worker thread가 아직 재조립 공간을 읽고 있을 수 있어서 여기서 돌려주지 않고
+	// 다음 client의 DoSharedRecv()가 끝날 때 비어있으면 돌려준다.
+	mReassemblyBytes = 0;
 }
 
 bool Connection::CreateConnection(InitConfig& initConfig)
@@ -68,15 +163,121 @@ bool Connection::CreateConnection(InitConfig& initConfig)
 
 	mIndex = initConfig.mIndex;
 	mListenSocket = initConfig.mListenSocket;
+	mIOBackend = initConfig.mIOBackend;
 
 	mRecvOverlappedEx = new OVERLAPPED_EX{ this };
 	mSendOverlappedEx = new OVERLAPPED_EX{ this };
 
+	if (false == mStrand.Create(mIOBackend))
+	{
+		return false;
+	}
+
 	mRecvBufSize = initConfig.mRecvBufSize;
 	mSendBufSize = initConfig.mSendBufSize;
 
-	mRecvRingBuffer.Create(mRecvBufSize * initConfig.mRecvBufCnt);
-	mSendRingBuffer.Create(mSendBufSize * initConfig.mSendBufCnt);
+	mMaxPacketSize = mRecvBufSize * initConfig.mRecvBufCnt;
+
+	mIsSharedRecvBuffer = initConfig.mUseSharedRecvBuffer;
+	if (mIsSharedRecvBuffer && false == mIOBackend->IsSharedRecvBufferSupported())
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::CreateConnection() | index[%d] backend does not support shared recv buffer",
+			mIndex);
+
+		mIsSharedRecvBuffer = false;
+	}
+
+	// 공유 recv 버퍼를 사용한다면 recv ring buffer는 만들지 않고
+	// 재조립 공간을 빌려올 SlabPool을 worker thread들이 동시에 처음 접근하기 전에 만들어둔다.
+	if (false == mIsSharedRecvBuffer)
+	{
+		mRecvRingBuffer.Create(mMaxPacketSize, initConfig.mUseMirroredRingBuffer);
+	}
+	else
+	{
+		SlabPool::GetInstance();
+	}
+
+	if (initConfig.mUseSendQueue)
+	{
+		mSendQueue = new SendQueue{};
+		if (false == mSendQueue->Create(mSendBufSize * initConfig.mSendBufCnt))
+		{
+			return false;
+		}
+
+		mSendBuffer = mSendQueue;
+	}
+	else if (initConfig.mUseChainedSendBuffer)
+	{
+		mSendChainBuffer = new ChainBuffer{};
+		if (false == mSendChainBuffer->Create(mSendBufSize * initConfig.mSendBufCnt))
+		{
+			return false;
+		}
+
+		mSendBuffer = mSendChainBuffer;
+	}
+	else
+	{
+		mSendRingBuffer.Create(mSendBufSize * initConfig.mSendBufCnt, initConfig.mUseMirroredRingBuffer);
+	}
+
+	mZeroCopySendThreshold = initConfig.mZeroCopySendThreshold;
+	if (0 < mZeroCopySendThreshold && false == mIOBackend->IsZeroCopySendSupported())
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::CreateConnection() | index[%d] backend does not support zero-copy send",
+			mIndex);
+
+		mZeroCopySendThreshold = 0;
+	}
+
+	// SendQueue는 송신 권한을 가진 thread만 해제할 수 있어서 완료 알림으로 해제하는 zero-copy를 사용하지 않는다.
+	if (0 < mZeroCopySendThreshold && nullptr != mSendQueue)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::CreateConnection() | index[%d] send queue does not support zero-copy send",
+			mIndex);
+
+		mZeroCopySendThreshold = 0;
+	}
+
+	if (0 < mZeroCopySendThreshold)
+	{
+		mZeroCopyOverlappedEx = new OVERLAPPED_EX{ this };
+		mZeroCopyOverlappedEx->mOperation = eOperationType::OP_ZEROCOPY_RELEASE;
+	}
+
+	mUseCorkedSend = initConfig.mUseCorkedSend;
+	mCorkFlushThreshold = 0 < initConfig.mCorkFlushThreshold ? initConfig.mCorkFlushThreshold : mSendBufSize;
+
+	int sendRingBufferSize = mSendBuffer->GetBufferSize();
+	mSendHighWatermark = 0 < initConfig.mSendHighWatermark ? initConfig.mSendHighWatermark : sendRingBufferSize / 4 * 3;
+	mSendLowWatermark = 0 < initConfig.mSendLowWatermark ? initConfig.mSendLowWatermark : sendRingBufferSize / 4;
+	if (mSendLowWatermark >= mSendHighWatermark || sendRingBufferSize < mSendHighWatermark)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::CreateConnection() | index[%d] invalid send watermark high[%d] low[%d]",
+			mIndex, mSendHighWatermark, mSendLowWatermark);
+
+		mSendHighWatermark = sendRingBufferSize / 4 * 3;
+		mSendLowWatermark = sendRingBufferSize / 4;
+	}
+
+	mSendBufferListener = initConfig.mSendBufferListener;
+	mSendOverflowPolicy = initConfig.mSendOverflowPolicy;
+
+	mAcceptManager = initConfig.mAcceptManager;
+	mConnectionManager = initConfig.mConnectionManager;
+
+	mUseCoroutine = initConfig.mUseCoroutine;
+	if (mUseCoroutine)
+	{
+		// SlabPool처럼 worker thread들이 동시에 처음 접근하기 전에 만들어둔다.
+		CoroutineFramePool::GetInstance();
+	}
 
 	// connection 객체를 생성했으면,
 	// cilent의 접속 요청 받을 준비
@@ -96,7 +297,42 @@ bool Connection::CloseConnection(bool isForce)
 	// (1개의 스레드만 1개의 Connection 객체에 대해 RecvPost() 호출)
 	// 그래서 하나의 Connection 객체에 대해서 오직 하나의 스레드만 접근하는 것으로 확인했는데
 	// 왜 lock이 필요한 것인가..?
-	Monitor::Owner lock{ mConnectionSyncObj };
+
+	// WithConnection()으로 읽기로 잡은 thread라면 lock을 푼 뒤에 끊는다.
+	// 읽기로 잡은 동안에는 세대가 바뀌지 않기 때문에 지금 handle과 같이 남겨둔다.
+	// 같은 client에게 미뤄둔 종료가 있다면 강제 종료만 우아한 종료를 덮어쓰고
+	// 이전 client에게 미뤄두고 아무도 가져가지 않은 종료는 덮어쓴다.
+	if (this == tSharedAccessConnection)
+	{
+		LONG64 deferredClose = MakeDeferredClose(GetHandle(), isForce ? DEFERRED_CLOSE_FORCE : DEFERRED_CLOSE_GRACEFUL);
+
+		while (true)
+		{
+			LONG64 oldDeferredClose = mDeferredClose;
+			if ((oldDeferredClose & ~DEFERRED_CLOSE_TYPE_MASK) == (deferredClose & ~DEFERRED_CLOSE_TYPE_MASK) &&
+				oldDeferredClose >= deferredClose)
+			{
+				break;
+			}
+
+			if (InterlockedCompareExchange64(&mDeferredClose, deferredClose, oldDeferredClose) == oldDeferredClose)
+			{
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	SharedMonitor::Owner lock{ mConnectionSyncObj };
+
+	// 이 client에게 나눠준 handle은 더 이상 사용할 수 없다.
+	InterlockedIncrement64(&mGeneration);
+
+	if (mUseCoroutine)
+	{
+		ResumeCoroutineWaiters();
+	}
 
 	// 기본은 우아한 종료 
 	struct linger lingerOption { 0, 0 };
@@ -129,7 +365,9 @@ bool Connection::CloseConnection(bool isForce)
 		reinterpret_cast<const char*>(&lingerOption),
 		sizeof(lingerOption));
 
-	closesocket(mClientSocket);
+	// IOCP는 socket을 닫으면 진행중이던 작업이 실패로 완료되고
+	// 다른 backend도 같은 동작을 하도록 backend에게 닫아달라고 요청
+	mIOBackend->CloseSocket(this);
 	mClientSocket = INVALID_SOCKET;
 
 	if (mRecvOverlappedEx)
@@ -156,55 +394,26 @@ bool Connection::CloseConnection(bool isForce)
 	return BindAcceptExSock();
 }
 
-bool Connection::BindIOCP(HANDLE hIOCP)
+bool Connection::BindIOBackend()
 {
-	HANDLE retIOCP{ NULL };
-
 	// 새로운 client가 접속했고
 	// IOCP 객체에 새로운 client socket을 등록하는 과정인데
 	// 나는 굳이 lock을 걸 필요는 없다고 생각한다.
 	// 이 함수에서는 CreateIoCompletionPort()만 호출하는데
 	// 이 IOCP 객체는 커널이 관리하는 객체고
 	// 당연히 커널 내부적으로 동기화를 시키고 있을 것이기 때문이다.
-	Monitor::Owner lock{ mConnectionSyncObj };
-
-	// 여러 client가 동시에 접속해서
-	// BindIOCP()함수가 병렬적으로 호출된다고 하더라도
-	// CreateIoCompletionPort() 함수 내에서 IOCP 객체에 접근할 때
-	// kernel이 내부적으로 동기화를 분명 할텐데
-	// 사용자 코드에서 lock을 걸지 않아도 된다고 생각
-	retIOCP = CreateIoCompletionPort(
-		reinterpret_cast<HANDLE>(mClientSocket),
-		hIOCP,
-		// Connection 객체의 주소를 캐스팅해서 key값으로 넣어줌.
-		// Connection 객체들은 배열로 선언되어 메모리에 할당되어 있기 때문에
-		// 주소가 겹칠 수 없고
-		// 고유한 key값이 될 자격이 있다.
-		// 후에 Overlapped IO작업이 끝나고
-		// GQCS() 함수에서 완료 통지를 꺼내올 때
-		// 이 key값을 Connection class로 받아서
-		// Connection 객체의 주소를 복구할 수 있다.
-		reinterpret_cast<DWORD64>(this),
-		// 그런데 이 방법 말고도
-		// GQCS() 함수를 호출해서 IOCP queue에서 작업 완료 통지를 꺼내올 때
-		// Overlapped IO를 요청할 때 넘긴 Overlapped 구조체의 포인터를 받아올 수 있는데
-		// 이 Overlapped 구조체를 OVERLAPPED_EX로 캐스팅해서 Connection 객체의 주소를 복구할 수도 있다.
-		0);
-
-	// 어떤 핸들(여기서는 소켓)을 IOCP 객체에 등록하는
-	// CreateIoCompletionPort() 함수가 성공하면,
-	// 반환 값은 2번째 인자로 넣어준 IOCP 핸들이다.
-	if (NULL != retIOCP || hIOCP != retIOCP)
+	// (epoll_ctl()도 마찬가지)
+	SharedMonitor::Owner lock{ mConnectionSyncObj };
+
+	if (false == mIOBackend->BindSocket(this))
 	{
 		LOG(eLogInfoType::LOG_ERROR_NORMAL,
-			L"SYSTEM | Connection::BindIOCP() | CreateIoCompletionPort() failed: %lu",
-			GetLastError());
+			L"SYSTEM | Connection::BindIOBackend() | BindSocket() failed: index[%d]",
+			mIndex);
 
 		return false;
 	}
 
-	mIOCP = hIOCP;
-
 	return true;
 }
 
@@ -252,7 +461,7 @@ bool Connection::RecvPost(char* pPacketStart, DWORD processedBytes)
 
 		LOG(eLogInfoType::LOG_ERROR_NORMAL,
 			L"SYSTEM | Connection::RecvPost() | Socket[%llu] RecvRingBuffer overflow",
-			mClientSocket);
+			static_cast<unsigned long long>(mClientSocket));
 
 		return false;
 	}
@@ -264,28 +473,56 @@ bool Connection::RecvPost(char* pPacketStart, DWORD processedBytes)
 	// 이 위치를 시작으로 패킷을 해석한다.
 	mRecvOverlappedEx->mPacketStart = mRecvOverlappedEx->mWSABuf.buf - processedBytes;
 
+	// 한번에 수신할 수 있는 최대 크기
+	// MoveMark()가 current mark 뒤로 mRecvBufSize만큼의 공간을 보장해준다.
+	mRecvOverlappedEx->mWSABuf.len = mRecvBufSize;
+
 	memset(&mRecvOverlappedEx->mOverlapped, 0x00, sizeof(mRecvOverlappedEx->mOverlapped));
 	IncrementRecvIORefCount();
 
-	DWORD numOfBytesRecvd{ 0 };
-	DWORD flag{ 0 };
-	int ret = WSARecv(
-		mClientSocket,
-		&mRecvOverlappedEx->mWSABuf,
-		1,
-		&numOfBytesRecvd,
-		&flag,
-		&mRecvOverlappedEx->mOverlapped,
-		NULL);
+	if (false == mIOBackend->Recv(this, mRecvOverlappedEx))
+	{
+		DecrementRecvIORefCount();
+
+		IOCPServer::GetIOCPServer()->CloseConnection(this);
+
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::RecvPost() | Recv() failed: %d",
+			WSAGetLastError());
+
+		return false;
+	}
+
+	return true;
+}
+
+bool Connection::RecvSharedPost()
+{
+	if (false == mIsConnected || nullptr == mRecvOverlappedEx)
+	{
+		return false;
+	}
+
+	mRecvOverlappedEx->mOperation = eOperationType::OP_RECV;
+	mRecvOverlappedEx->mProcessedBytes = 0;
+
+	// 받을 위치는 backend가 공유 recv 버퍼에서 골라서 채워준다.
+	mRecvOverlappedEx->mWSABuf.buf = nullptr;
+	mRecvOverlappedEx->mWSABuf.len = 0;
+	mRecvOverlappedEx->mPacketStart = nullptr;
+	mRecvOverlappedEx->mBufferID = -1;
+
+	memset(&mRecvOverlappedEx->mOverlapped, 0x00, sizeof(mRecvOverlappedEx->mOverlapped));
+	IncrementRecvIORefCount();
 
-	if (SOCKET_ERROR == ret && WSA_IO_PENDING != WSAGetLastError())
+	if (false == mIOBackend->Recv(this, mRecvOverlappedEx))
 	{
 		DecrementRecvIORefCount();
 
 		IOCPServer::GetIOCPServer()->CloseConnection(this);
 
 		LOG(eLogInfoType::LOG_ERROR_NORMAL,
-			L"SYSTEM | Connection::RecvPost() | WSARecv() failed: %d",
+			L"SYSTEM | Connection::RecvSharedPost() | Recv() failed: %d",
 			WSAGetLastError());
 
 		return false;
@@ -327,23 +564,44 @@ bool Connection::SendPost()
 	// 결국 24바이트까지 완전히 전송되고 나면,
 	// send 작업 완료 통지에서 mIsSending 변수를 true로 바꾸고
 	// 다음 send 작업을 SendPost() 함수에서 수행할 수 있게된다.
-	if (InterlockedCompareExchange64(
+
+	// SendQueue라면 이 thread가 PrepareSendPacket()으로 채운 데이터를 먼저 송신할 수 있게 넘긴다.
+	if (nullptr != mSendQueue)
+	{
+		mSendQueue->Commit();
+	}
+
+	// 송신할 데이터가 없다고 송신 권한을 내려놓은 직후에 들어온 데이터가 있다면
+	// 권한을 다시 가져와서 반복한다(재귀 호출하면 경쟁이 심할 때 stack이 계속 깊어진다).
+	while (InterlockedCompareExchange64(
 		reinterpret_cast<LONG64*>(&mIsSending),
 		static_cast<unsigned long long>(false),
 		static_cast<unsigned long long>(true)) == static_cast<unsigned long long>(true))
 	{
 		int realSendSize{ 0 };
-		
-		// 메모리에서 송신할 데이터의 시작 위치가 반환되며, realSendSize에는 송신 가능한 바이트 수가 담긴다.
-		char* pBuf{ mSendRingBuffer.GetBuffer(mSendBufSize, &realSendSize) };
+
+		// 송신할 데이터 조각들이 mSendBufs에 담기며, realSendSize에는 송신 가능한 바이트 수가 담긴다.
+		// 데이터가 버퍼의 끝에서 처음으로 이어져 있으면 두 조각을 한 번에 송신하고
+		// SendShared()로 넣은 패킷도 복사하지 않고 조각으로 끼워서 같이 송신한다.
+		int sendBufCnt{ GatherSendBuffers(&realSendSize) };
 
 		// send ring buffer에 송신할 데이터가 없다
-		if (nullptr == pBuf)
+		if (0 == sendBufCnt)
 		{
 			InterlockedExchange64(
 				reinterpret_cast<LONG64*>(&mIsSending),
 				static_cast<unsigned long long>(true));
 
+			// 송신할 데이터가 없음을 확인한 직후에
+			// 다른 thread가 PrepareSendPacket()으로 데이터를 넣고 SendPost()를 호출했다면,
+			// mIsSending이 false라서 그냥 반환했을 것이다.
+			// 이러면 아무도 그 데이터를 송신하지 않기 때문에 다시 확인한다.
+			// (zero-copy 완료 알림을 기다리며 잡아둔 공간은 이미 송신한 데이터라서 제외)
+			if (0 < GetUnsentSize())
+			{
+				continue;
+			}
+
 			// 더 이상 send할 데이터가 없으니 false 반환
 			return false;
 		}
@@ -359,25 +617,16 @@ bool Connection::SendPost()
 		mSendOverlappedEx->mTotalBytes = realSendSize;
 
 		ZeroMemory(&mSendOverlappedEx->mOverlapped, sizeof(mSendOverlappedEx->mOverlapped));
-		mSendOverlappedEx->mWSABuf.buf = pBuf;
-		mSendOverlappedEx->mWSABuf.len = realSendSize;
+		mSendOverlappedEx->mSendBufCnt = sendBufCnt;
+		mSendOverlappedEx->mIsZeroCopy = 0 < mZeroCopySendThreshold && mZeroCopySendThreshold <= realSendSize &&
+			false == HasSharedPacket(mSendOverlappedEx);
 		mSendOverlappedEx->mConnection = this;
 
 		// WSASend()를 호출하기 때문에
 		// 잊지말고 출력 카운트를 올려주자
 		IncrementSendIORefCount();
 
-		DWORD numOfBytesSent{ 0 };
-		int ret = WSASend(
-			mClientSocket,
-			&mSendOverlappedEx->mWSABuf,
-			1,
-			&numOfBytesSent,
-			0,
-			&mSendOverlappedEx->mOverlapped,
-			NULL);
-
-		if (SOCKET_ERROR == ret && WSA_IO_PENDING != WSAGetLastError())
+		if (false == mIOBackend->Send(this, mSendOverlappedEx))
 		{
 			DecrementSendIORefCount();
 
@@ -385,7 +634,7 @@ bool Connection::SendPost()
 
 			LOG(eLogInfoType::LOG_ERROR_NORMAL,
 				L"[ERROR] socket[%llu] WSAsend(): SOCKET_ERROR, %d",
-				mClientSocket, WSAGetLastError());
+				static_cast<unsigned long long>(mClientSocket), WSAGetLastError());
 
 			// WSASend() 실패했으니
 			return false;
@@ -394,10 +643,8 @@ bool Connection::SendPost()
 		// 이쪽 if문을 타서 진입했다면,
 		// mIsSending은 InterlockedCompareExchange() 함수 호출로 false로 바뀐 상태인데
 		// 책에서는 이를 한번 더 변경하고 있다.
-		// 이 코드는 제거해도 괜찮을 것 같다.
-		InterlockedExchange64(
-			reinterpret_cast<LONG64*>(&mIsSending),
-			static_cast<unsigned long long>(false));
+		// 그런데 송신 작업이 바로 완료되어 다른 worker thread가 DoSend()에서 true로 바꾼 뒤에
+		// 여기서 다시 false로 덮어쓰면, 더 이상 SendPost()가 진행되지 않기 때문에 제거했다.
 
 		// WSASend()를 호출했고
 		// 요청이 정상적으로 진행
@@ -410,7 +657,78 @@ bool Connection::SendPost()
 	return false;
 }
 
+bool Connection::SendPostCorked()
+{
+	// 모아두는 동안 다른 thread가 송신할 수 있도록 채운 데이터를 넘겨둔다.
+	if (nullptr != mSendQueue)
+	{
+		mSendQueue->Commit();
+	}
+
+	if (false == mUseCorkedSend)
+	{
+		return SendPost();
+	}
+
+	// 한 번에 송신할 만큼 모였다면 tick이 끝나기를 기다리지 않는다.
+	// 목록에 남아있어도 flush에서 SendPost()를 한 번 더 호출할 뿐이다.
+	if (mCorkFlushThreshold <= GetUnsentSize())
+	{
+		return SendPost();
+	}
+
+	// 이미 다른 thread의 목록에 있다면 그 thread가 flush할 때 같이 송신된다.
+	if (InterlockedCompareExchange64(
+		&mIsCorked,
+		static_cast<LONG64>(true),
+		static_cast<LONG64>(false)) == static_cast<LONG64>(false))
+	{
+		tCorkedConnections.push_back(this);
+	}
+
+	return true;
+}
+
+void Connection::FlushCorkedSends()
+{
+	// SendPost()가 실패해서 연결을 끊는 동안 OnClose()에서
+	// 다시 SendPostCorked()를 호출할 수 있어서 index로 순회한다.
+	for (size_t i = 0; i < tCorkedConnections.size(); ++i)
+	{
+		Connection* pConnection = tCorkedConnections[i];
+
+		// 송신 전에 목록에서 빠진 것으로 표시해야
+		// SendPost()가 데이터를 가져간 뒤에 추가된 데이터가 다시 목록에 들어온다.
+		InterlockedExchange64(&pConnection->mIsCorked, static_cast<LONG64>(false));
+
+		// 모아두는 사이에 연결이 끊겼다면 보낼 필요가 없다.
+		if (pConnection->mIsConnected)
+		{
+			pConnection->SendPost();
+		}
+	}
+
+	tCorkedConnections.clear();
+}
+
 bool Connection::BindAcceptExSock()
+{
+	if (nullptr != mAcceptManager)
+	{
+		return mAcceptManager->RequestAccept(this);
+	}
+
+	// 누가 꺼내서 PostAccept()를 호출할 때까지 free list에서 기다린다.
+	if (nullptr != mConnectionManager)
+	{
+		mConnectionManager->Free(this);
+		return true;
+	}
+
+	return PostAccept();
+}
+
+bool Connection::PostAccept()
 {
 	memset(&mRecvOverlappedEx->mOverlapped, 0x00, sizeof(mRecvOverlappedEx->mOverlapped));
 
@@ -424,55 +742,20 @@ bool Connection::BindAcceptExSock()
 	mRecvOverlappedEx->mOperation = eOperationType::OP_ACCEPT;
 	mRecvOverlappedEx->mConnection = this;
 
-	// Accept() 함수는 client의 연결 요청이 들어오면 반환하면서
-	// 해당 유저와 통신하는 전용 client socket을 생성한다.
-	// 하지만 AcceptEx() 함수는 client 연결 요청을 비동기로 처리하고
-	// 이 때 미리 생성해둔 client socket을 인자로 넣어야 한다.
-	mClientSocket = WSASocket(AF_INET,
-		SOCK_STREAM,
-		IPPROTO_TCP,
-		NULL,
-		0,
-		WSA_FLAG_OVERLAPPED);
-	if (INVALID_SOCKET == mClientSocket)
-	{
-		LOG(eLogInfoType::LOG_ERROR_NORMAL,
-			L"SYSTEM | Connection::BindAcceptExSock() | WSASocket() Failed: error[%d]",
-			WSAGetLastError());
-
-		return false;
-	}
-
 	// accept 비동기 IO 작업을 요청하기 때문에 카운트 1 증가.
 	// 후에 IOCP queue에서 accpet 작업에 대한 완료 통지를 받으면, 카운트 1 감소.
 	IncrementAcceptIORefCount();
 
-	DWORD bytesReceived{ 0 };
-	bool ret = AcceptEx(mListenSocket,
-		mClientSocket,
-		mRecvOverlappedEx->mWSABuf.buf,
-		// 자동으로 송신되는 server 로컬 주소, client 원격 주소를 제외하고는
-		// 아무 정보도 받지 않을 것이라서 0으로 세팅.
-		// 그렇다면, client로부터 연결 요청이 들어오면,
-		// 추가적인 데이터 수신을 위해 대기하지 않고 바로 작업이 완료되고
-		// IOCP queue에 완료 작업이 추가됨
-		0,
-		sizeof(SOCKADDR_IN) + 16,
-		sizeof(SOCKADDR_IN) + 16,
-		&bytesReceived,
-		// overlapped 구조체를 포함하여 추가 정보를 넣어서 확장한
-		// OverlappedEx 구조체는
-		// 가장 선두에 overlapped 구조체가 위치하고 있기 때문에
-		// OverlappedEx 데이터의 시작 주소가 곧 overlapped 데이터 시작 주소이다.
-		reinterpret_cast<LPOVERLAPPED>(mRecvOverlappedEx));
-
-	if (!ret && WSA_IO_PENDING != WSAGetLastError())
+	// IOCP backend는 client socket을 미리 생성해서 AcceptEx()를 호출하고
+	// epoll backend는 접속 요청이 들어오면 accept()로 client socket을 생성한다.
+	// 어느 쪽이든 SetSocket()으로 mClientSocket이 세팅된다.
+	if (false == mIOBackend->Accept(mListenSocket, mRecvOverlappedEx))
 	{
 		DecrementAcceptIORefCount();
 
 		LOG(eLogInfoType::LOG_ERROR_NORMAL,
-			L"SYSTEM | Connection::BindAcceptExSock() | AcceptEx() failed: error[%d]",
-			WSAGetLastError());
+			L"SYSTEM | Connection::PostAccept() | Accept() failed: index[%d]",
+			mIndex);
 
 		return false;
 	}
@@ -480,15 +763,32 @@ bool Connection::BindAcceptExSock()
 	return true;
 }
 
-char* Connection::PrepareSendPacket(int sendLength)
+char* Connection::PrepareSendPacket(int sendLength, ePacketPriority priority)
 {
 	if (false == mIsConnected)
 	{
 		return nullptr;
 	}
 
+	bool isDroppable = eSendOverflowPolicy::OVERFLOW_DROP_LOW_PRIORITY == mSendOverflowPolicy &&
+		ePacketPriority::PRIORITY_LOW == priority;
+
+	// client가 느려서 송신 데이터가 쌓이고 있다면
+	// 남은 공간은 중요한 패킷을 위해 남겨둔다.
+	if (isDroppable && IsSendBufferHigh())
+	{
+		InterlockedIncrement64(&mDroppedSendCnt);
+		return nullptr;
+	}
+
 	// sendLength만큼의 버퍼를 확보
-	char* pBuf = mSendRingBuffer.MoveMark(sendLength);
+	char* pBuf = mSendBuffer->MoveMark(sendLength);
+	if (nullptr == pBuf && isDroppable)
+	{
+		InterlockedIncrement64(&mDroppedSendCnt);
+		return nullptr;
+	}
+
 	if (nullptr == pBuf)
 	{
 		// IOCPServer의 CloseConnection()을 호출하면,
@@ -499,8 +799,8 @@ char* Connection::PrepareSendPacket(int sendLength)
 		IOCPServer::GetIOCPServer()->CloseConnection(this);
 
 		LOG(eLogInfoType::LOG_ERROR_NORMAL,
-			L"SYSTEM | Connection::PrepareSendPacket() | Socket[%d] SendRingBuffer overflow",
-			mClientSocket);
+			L"SYSTEM | Connection::PrepareSendPacket() | Socket[%llu] SendRingBuffer overflow",
+			static_cast<unsigned long long>(mClientSocket));
 
 		return nullptr;
 	}
@@ -517,42 +817,1116 @@ char* Connection::PrepareSendPacket(int sendLength)
 	// 이를 처리한다.
 	CopyMemory(pBuf, &sendLength, PACKET_SIZE_LENGTH);
 
+	if (false == IsSendBufferHigh() && mSendHighWatermark <= mSendBuffer->GetUsedBufferSize())
+	{
+		UpdateSendBufferState();
+	}
+
 	return pBuf;
 }
 
-void Connection::SetSocket(SOCKET socket)
+bool Connection::SendShared(SharedPacket* pPacket, ePacketPriority priority)
 {
-	mClientSocket = socket;
-}
+	if (nullptr == pPacket || false == mIsConnected)
+	{
+		return false;
+	}
 
-SOCKET Connection::GetSocket()
-{
-	return mClientSocket;
-}
+	bool isDroppable = eSendOverflowPolicy::OVERFLOW_DROP_LOW_PRIORITY == mSendOverflowPolicy &&
+		ePacketPriority::PRIORITY_LOW == priority;
 
-void Connection::SetConnectionIP(char* IP)
-{
-	memcpy(mClientIP, IP, sizeof(mClientIP));
+	if (isDroppable && IsSendBufferHigh())
+	{
+		InterlockedIncrement64(&mDroppedSendCnt);
+		return false;
+	}
+
+	int packetSize = pPacket->GetPacketSize();
+
+	if (nullptr != mSendQueue)
+	{
+		// 이 thread가 앞서 PrepareSendPacket()으로 채운 데이터 뒤에 node로 넣어서 lock을 잡지 않는다.
+		if (mSendQueue->PushShared(pPacket))
+		{
+			return true;
+		}
+	}
+	else
+	{
+		Monitor::Owner lock{ mSharedSendSyncObj };
+
+		// 연결 종료가 목록을 비운 뒤라면 넣지 않는다.
+		if (false == mIsConnected)
+		{
+			return false;
+		}
+
+		// 복사하지 않아도 client가 받지 못하고 쌓이는 것은 같기 때문에
+		// send buffer에 쌓인 데이터와 합쳐서 send buffer 크기까지만 넣는다.
+		if (mSendBuffer->GetUsedBufferSize() + mSharedSendBytes + packetSize <= mSendBuffer->GetBufferSize())
+		{
+			// 지금까지 마련된 send buffer의 데이터를 모두 송신 요청한 뒤에 보낸다.
+			pPacket->AddRef();
+			mSharedSendQueue.push_back(SharedSendEntry{ pPacket, mSendBuffer->GetReservedSize() });
+			mSharedSendBytes += packetSize;
+
+			return true;
+		}
+	}
+
+	if (isDroppable)
+	{
+		InterlockedIncrement64(&mDroppedSendCnt);
+		return false;
+	}
+
+	IOCPServer::GetIOCPServer()->CloseConnection(this);
+
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | Connection::SendShared() | Socket[%llu] shared send queue overflow",
+		static_cast<unsigned long long>(mClientSocket));
+
+	return false;
 }
 
-char* Connection::GetConnectionIP()
+ReadPacketAwaiter Connection::ReadPacket()
 {
-	return mClientIP;
+	return ReadPacketAwaiter{ this };
 }
 
-int Connection::GetIndex()
+FlushAwaiter Connection::Flush()
 {
-	return mIndex;
+	return FlushAwaiter{ this };
 }
 
-int Connection::GetRecvBufSize()
+void Connection::OnIOCompleted(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes, bool isSuccess)
 {
-	return mRecvBufSize;
+	// 요청했던 overlapped IO 하나가 끝났으니 작업 횟수 1 감소
+	switch (pOverlappedEx->mOperation)
+	{
+	case eOperationType::OP_ACCEPT:
+		DecrementAcceptIORefCount();
+
+		// 실패했다면 아래에서 CloseConnection()이 다시 BindAcceptExSock()을 호출하기 때문에
+		// 그 전에 걸어둔 accept 수를 줄여둔다.
+		if (nullptr != mAcceptManager)
+		{
+			mAcceptManager->OnAcceptCompleted(this, isSuccess);
+		}
+		break;
+	case eOperationType::OP_RECV:
+		DecrementRecvIORefCount();
+		break;
+	case eOperationType::OP_SEND:
+		DecrementSendIORefCount();
+		break;
+	default:
+		break;
+	}
+
+	// zero-copy 완료 알림은 송신 작업이 아니고 socket이 닫혀도 연결 종료와 상관없다.
+	if (eOperationType::OP_ZEROCOPY_RELEASE == pOverlappedEx->mOperation)
+	{
+		DoZeroCopyRelease(transferredBytes);
+		return;
+	}
+
+	// AcceptEx()는 주소 외에 추가 데이터를 받지 않도록 요청했기 때문에
+	// 성공해도 전송 바이트가 0이다.
+	// recv, send 작업에서 전송 바이트가 0이라면 client가 연결을 끊은 것이다.
+	if (false == isSuccess ||
+		(eOperationType::OP_ACCEPT != pOverlappedEx->mOperation && 0 == transferredBytes))
+	{
+		// 연결 종료는 ProcessThread에서 순서성 있게 처리하도록 IOCPServer에게 요청
+		IOCPServer::GetIOCPServer()->CloseConnection(this);
+		return;
+	}
+
+	// 다른 worker thread가 연결 종료를 먼저 처리했다면
+	// 늦게 꺼낸 recv, send 완료 통지가 이미 초기화된 버퍼를 해제하지 않도록 버린다.
+	// (송신 완료를 기다리는 coroutine은 send ring buffer 사용량으로 완료를 판단한다.)
+	if (eOperationType::OP_ACCEPT != pOverlappedEx->mOperation && false == mIsConnected)
+	{
+		return;
+	}
+
+	switch (pOverlappedEx->mOperation)
+	{
+	case eOperationType::OP_ACCEPT:
+		DoAccept(pOverlappedEx);
+		break;
+	case eOperationType::OP_RECV:
+		DoRecv(pOverlappedEx, transferredBytes);
+		break;
+	case eOperationType::OP_SEND:
+		DoSend(pOverlappedEx, transferredBytes);
+		break;
+	default:
+		break;
+	}
 }
 
-int Connection::GetSendBufSize()
+bool Connection::DoAccept(OVERLAPPED_EX* pOverlappedEx)
 {
-	return mSendBufSize;
+	// mAddressBuf에 저장된 client의 remote 주소를 꺼낸다.
+	char clientIP[MAX_IP_LENGTH]{};
+	mIOBackend->GetRemoteAddress(pOverlappedEx, clientIP, sizeof(clientIP));
+	SetConnectionIP(clientIP);
+
+	// 새로운 client socket의 작업 완료 통지도 받을 수 있도록 backend에 등록
+	if (false == BindIOBackend())
+	{
+		// 등록에 실패한 socket은 사용할 수 없으니
+		// 강제 종료하고 새로운 client를 받을 준비
+		CloseConnection(true);
+		return false;
+	}
+
+	// 연결이 끊긴 뒤에 늦게 도착한 이전 client의 패킷을 버린다.
+	if (mUseCoroutine)
+	{
+		Monitor::Owner lock{ mCoroutineSyncObj };
+
+		mCoInbox.clear();
+		mIsRecvPaused = false;
+	}
+
+	// 쉬는 동안 얻은 handle로 새 client에 접근하지 못하도록 세대를 바꾼다.
+	InterlockedIncrement64(&mGeneration);
+
+	mIsConnected = true;
+
+	// IOCPServer를 상속한 class의 OnAccept() 호출
+	IOCPServer::GetIOCPServer()->OnAccept(this);
+
+	// 첫 수신 요청
+	if (mIsSharedRecvBuffer)
+	{
+		return RecvSharedPost();
+	}
+
+	// recv ring buffer의 처음부터, 잘린 패킷 없이 시작
+	return RecvPost(mRecvRingBuffer.GetBeginMark(), 0);
+}
+
+bool Connection::DoRecv(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes)
+{
+	if (mIsSharedRecvBuffer)
+	{
+		return DoSharedRecv(pOverlappedEx, transferredBytes);
+	}
+
+	// 잘린 패킷의 시작 위치(mPacketStart)부터
+	// 지금까지 모인 바이트 수
+	DWORD remainBytes{ pOverlappedEx->mProcessedBytes + transferredBytes };
+	char* pNext{ pOverlappedEx->mPacketStart };
+
+	// 선두 4바이트(패킷 길이)를 읽을 수 있는 동안
+	// 온전한 패킷을 하나씩 처리한다.
+	while (PACKET_SIZE_LENGTH <= remainBytes)
+	{
+		int packetSize{ 0 };
+		CopyMemory(&packetSize, pNext, PACKET_SIZE_LENGTH);
+
+		// 패킷 길이는 길이 필드를 포함하고
+		// recv ring buffer 전체보다 클 수 없다.
+		if (PACKET_SIZE_LENGTH > packetSize || mRecvRingBuffer.GetBufferSize() < packetSize)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | Connection::DoRecv() | index[%d] invalid packet size: %d",
+				mIndex, packetSize);
+
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		pOverlappedEx->mTotalBytes = packetSize;
+
+		// 아직 패킷을 다 받지 못했다.
+		if (remainBytes < static_cast<DWORD>(packetSize))
+		{
+			break;
+		}
+
+		// 온전한 하나의 패킷을 수신
+		if (false == DeliverPacket(packetSize, pNext))
+		{
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		// 처리가 끝난 패킷이 차지하던 공간을 해제
+		mRecvRingBuffer.ReleaseBuffer(packetSize);
+
+		remainBytes -= packetSize;
+		pNext += packetSize;
+	}
+
+	// coroutine이 아직 꺼내가지 않은 패킷이 많다면 꺼내갈 때까지 수신을 미룬다.
+	if (mUseCoroutine && PauseRecv(pNext, remainBytes))
+	{
+		return true;
+	}
+
+	// 잘린 패킷의 시작 위치와 지금까지 받은 바이트 수를 넘겨서
+	// 이어서 수신
+	return RecvPost(pNext, remainBytes);
+}
+
+bool Connection::DoSharedRecv(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes)
+{
+	char* pNext{ pOverlappedEx->mWSABuf.buf };
+	DWORD remainBytes{ transferredBytes };
+
+	// 이전 버퍼 끝에서 잘린 패킷이 있다면 먼저 이어 붙인다.
+	// 길이 필드(4바이트)까지 잘렸을 수도 있어서 길이 필드부터 채운다.
+	while (0 < mReassemblyBytes && 0 < remainBytes)
+	{
+		int packetSize{ PACKET_SIZE_LENGTH };
+		if (PACKET_SIZE_LENGTH <= mReassemblyBytes)
+		{
+			CopyMemory(&packetSize, mReassemblyBuf, PACKET_SIZE_LENGTH);
+		}
+
+		DWORD copyBytes{ static_cast<DWORD>(packetSize - mReassemblyBytes) };
+		if (remainBytes < copyBytes)
+		{
+			copyBytes = remainBytes;
+		}
+
+		CopyMemory(mReassemblyBuf + mReassemblyBytes, pNext, copyBytes);
+		mReassemblyBytes += copyBytes;
+		pNext += copyBytes;
+		remainBytes -= copyBytes;
+
+		if (PACKET_SIZE_LENGTH > mReassemblyBytes)
+		{
+			break;
+		}
+
+		CopyMemory(&packetSize, mReassemblyBuf, PACKET_SIZE_LENGTH);
+		if (PACKET_SIZE_LENGTH > packetSize || mMaxPacketSize < packetSize)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | Connection::DoSharedRecv() | index[%d] invalid packet size: %d",
+				mIndex, packetSize);
+
+			mIOBackend->ReleaseRecvBuffer(this, pOverlappedEx->mBufferID);
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		// 패킷 크기를 알았으니 패킷 전체가 들어갈 공간을 마련해둔다.
+		if (false == ReserveReassemblyBuf(packetSize))
+		{
+			mIOBackend->ReleaseRecvBuffer(this, pOverlappedEx->mBufferID);
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		// 재조립이 끝난 패킷을 처리
+		if (packetSize == mReassemblyBytes)
+		{
+			mReassemblyBytes = 0;
+
+			if (false == DeliverPacket(packetSize, mReassemblyBuf))
+			{
+				mIOBackend->ReleaseRecvBuffer(this, pOverlappedEx->mBufferID);
+				IOCPServer::GetIOCPServer()->CloseConnection(this);
+				return false;
+			}
+		}
+	}
+
+	// 버퍼 안에 온전히 들어있는 패킷은 복사하지 않고 바로 처리
+	while (PACKET_SIZE_LENGTH <= remainBytes)
+	{
+		int packetSize{ 0 };
+		CopyMemory(&packetSize, pNext, PACKET_SIZE_LENGTH);
+
+		if (PACKET_SIZE_LENGTH > packetSize || mMaxPacketSize < packetSize)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | Connection::DoSharedRecv() | index[%d] invalid packet size: %d",
+				mIndex, packetSize);
+
+			mIOBackend->ReleaseRecvBuffer(this, pOverlappedEx->mBufferID);
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		if (remainBytes < static_cast<DWORD>(packetSize))
+		{
+			break;
+		}
+
+		if (false == DeliverPacket(packetSize, pNext))
+		{
+			mIOBackend->ReleaseRecvBuffer(this, pOverlappedEx->mBufferID);
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		remainBytes -= packetSize;
+		pNext += packetSize;
+	}
+
+	// 버퍼 끝에서 잘린 패킷만 재조립 공간에 복사
+	// 길이 필드까지 받았다면 위에서 크기를 확인했으니 패킷 전체가 들어갈 공간을 마련하고
+	// 길이 필드도 잘렸다면 길이 필드가 들어갈 공간만 마련한다.
+	if (0 < remainBytes)
+	{
+		int needBytes{ PACKET_SIZE_LENGTH };
+		if (PACKET_SIZE_LENGTH <= remainBytes)
+		{
+			CopyMemory(&needBytes, pNext, PACKET_SIZE_LENGTH);
+		}
+
+		if (false == ReserveReassemblyBuf(needBytes))
+		{
+			mIOBackend->ReleaseRecvBuffer(this, pOverlappedEx->mBufferID);
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		CopyMemory(mReassemblyBuf + mReassemblyBytes, pNext, remainBytes);
+		mReassemblyBytes += remainBytes;
+	}
+
+	// 재조립중인 패킷이 없다면 재조립 공간을 돌려준다.
+	if (0 == mReassemblyBytes)
+	{
+		ReleaseReassemblyBuf();
+	}
+
+	// 공유 recv 버퍼는 다른 connection도 사용해야 하니 바로 돌려준다.
+	mIOBackend->ReleaseRecvBuffer(this, pOverlappedEx->mBufferID);
+
+	if (mUseCoroutine && PauseRecv(nullptr, 0))
+	{
+		return true;
+	}
+
+	return RecvSharedPost();
+}
+
+bool Connection::DoSend(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes)
+{
+	pOverlappedEx->mProcessedBytes += transferredBytes;
+
+	// 송신된 만큼 앞 조각부터 잘라낸다.
+	// 다 보낸 공유 패킷은 참조를 해제하고 send buffer의 조각은 해제할 크기만 모은다.
+	WSABUF* pSendBufs = pOverlappedEx->mSendBufs;
+	SharedPacket** pSendPackets = pOverlappedEx->mSendPackets;
+	DWORD remainBytes = transferredBytes;
+	int releaseSize{ 0 };
+	while (0 < pOverlappedEx->mSendBufCnt && remainBytes >= pSendBufs[0].len)
+	{
+		remainBytes -= pSendBufs[0].len;
+
+		if (nullptr != pSendPackets[0])
+		{
+			pSendPackets[0]->Release();
+		}
+		else
+		{
+			releaseSize += static_cast<int>(pSendBufs[0].len);
+		}
+
+		--pOverlappedEx->mSendBufCnt;
+		for (int i = 0; i < pOverlappedEx->mSendBufCnt; ++i)
+		{
+			pSendBufs[i] = pSendBufs[i + 1];
+			pSendPackets[i] = pSendPackets[i + 1];
+		}
+	}
+
+	// 일부만 송신된 조각
+	if (0 < pOverlappedEx->mSendBufCnt && 0 < remainBytes)
+	{
+		if (nullptr == pSendPackets[0])
+		{
+			releaseSize += static_cast<int>(remainBytes);
+		}
+
+		pSendBufs[0].buf += remainBytes;
+		pSendBufs[0].len -= remainBytes;
+	}
+
+	// 송신된 만큼 send ring buffer에서 해제한다.
+	// zero-copy로 송신했다면 kernel이 아직 버퍼를 참조하고 있기 때문에
+	// 완료 알림(DoZeroCopyRelease())을 받을 때까지 잡아둔다.
+	// (zero-copy 송신에는 공유 패킷이 없어서 송신된 크기가 모두 send ring buffer의 크기다.)
+	if (pOverlappedEx->mIsZeroCopy)
+	{
+		mSendBuffer->HoldBuffer(releaseSize);
+	}
+	else
+	{
+		mSendBuffer->ReleaseBuffer(releaseSize);
+	}
+
+	if (IsSendBufferHigh())
+	{
+		UpdateSendBufferState();
+	}
+
+	// 요청한 바이트가 모두 송신되지 않았다면,
+	// mIsSending을 false로 유지한 채 나머지를 이어서 송신
+	if (static_cast<DWORD>(pOverlappedEx->mTotalBytes) > pOverlappedEx->mProcessedBytes)
+	{
+		ZeroMemory(&pOverlappedEx->mOverlapped, sizeof(pOverlappedEx->mOverlapped));
+
+		// 남은 크기로 zero-copy 여부를 다시 정한다.
+		DWORD remainSendBytes = static_cast<DWORD>(pOverlappedEx->mTotalBytes) - pOverlappedEx->mProcessedBytes;
+		pOverlappedEx->mIsZeroCopy = 0 < mZeroCopySendThreshold &&
+			static_cast<DWORD>(mZeroCopySendThreshold) <= remainSendBytes &&
+			false == HasSharedPacket(pOverlappedEx);
+
+		IncrementSendIORefCount();
+
+		if (false == mIOBackend->Send(this, pOverlappedEx))
+		{
+			DecrementSendIORefCount();
+
+			IOCPServer::GetIOCPServer()->CloseConnection(this);
+			return false;
+		}
+
+		return true;
+	}
+
+	// 모두 송신했으니 다음 송신을 진행할 수 있도록 mIsSending을 true로 바꾼다.
+	InterlockedExchange64(
+		reinterpret_cast<LONG64*>(&mIsSending),
+		static_cast<unsigned long long>(true));
+
+	// 그 사이에 쌓인 송신 데이터가 있다면 이어서 송신
+	SendPost();
+
+	if (mUseCoroutine)
+	{
+		ResumeFlushWaiter();
+	}
+
+	return true;
+}
+
+void Connection::DoZeroCopyRelease(DWORD releaseBytes)
+{
+	// 완료 알림이 송신 완료 통지(DoSend())보다 먼저 처리될 수도 있다.
+	// 잠시 hold 크기가 음수가 되지만 송신이 끝나기 전에는 GetBuffers()를 호출하지 않으니 문제없다.
+	mSendBuffer->ReleaseHoldBuffer(static_cast<int>(releaseBytes));
+
+	if (IsSendBufferHigh())
+	{
+		UpdateSendBufferState();
+	}
+}
+
+void Connection::UpdateSendBufferState()
+{
+	// 상태를 바꾸는 사이에 다른 thread가 사용량을 바꿨을 수 있어서
+	// 상태를 바꿨다면 사용량을 다시 확인한다.
+	while (true)
+	{
+		int usedBufferSize = mSendBuffer->GetUsedBufferSize();
+
+		if (mSendHighWatermark <= usedBufferSize)
+		{
+			if (InterlockedCompareExchange64(
+				&mIsSendBufferHigh,
+				static_cast<LONG64>(true),
+				static_cast<LONG64>(false)) != static_cast<LONG64>(false))
+			{
+				return;
+			}
+
+			if (nullptr != mSendBufferListener)
+			{
+				mSendBufferListener->OnSendBufferHigh(this);
+			}
+		}
+		else if (mSendLowWatermark >= usedBufferSize)
+		{
+			if (InterlockedCompareExchange64(
+				&mIsSendBufferHigh,
+				static_cast<LONG64>(false),
+				static_cast<LONG64>(true)) != static_cast<LONG64>(true))
+			{
+				return;
+			}
+
+			if (nullptr != mSendBufferListener)
+			{
+				mSendBufferListener->OnSendBufferLow(this);
+			}
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+int Connection::GatherSendBuffers(int* realSendSize)
+{
+	WSABUF* pSendBufs = mSendOverlappedEx->mSendBufs;
+	SharedPacket** pSendPackets = mSendOverlappedEx->mSendPackets;
+	int bufCnt{ 0 };
+
+	*realSendSize = 0;
+
+	while (MAX_SEND_BUF_CNT > bufCnt && mSendBufSize > *realSendSize)
+	{
+		SharedPacket* pPacket{ nullptr };
+		LONG64 sendPosition{ 0 };
+
+		{
+			Monitor::Owner lock{ mSharedSendSyncObj };
+
+			if (false == mSharedSendQueue.empty())
+			{
+				pPacket = mSharedSendQueue.front().mPacket;
+				sendPosition = mSharedSendQueue.front().mSendPosition;
+
+				// 앞에 넣은 send buffer의 데이터를 모두 담았다면 공유 패킷을 담을 차례
+				// 참조는 조각으로 옮겨가서 송신이 끝날 때 해제한다.
+				if (mSendGatheredSize >= sendPosition)
+				{
+					mSharedSendQueue.pop_front();
+					mSharedSendBytes -= pPacket->GetPacketSize();
+				}
+			}
+		}
+
+		if (nullptr != pPacket && mSendGatheredSize >= sendPosition)
+		{
+			pSendBufs[bufCnt].buf = pPacket->GetBuffer();
+			pSendBufs[bufCnt].len = pPacket->GetPacketSize();
+			pSendPackets[bufCnt] = pPacket;
+			++bufCnt;
+
+			*realSendSize += pPacket->GetPacketSize();
+			continue;
+		}
+
+		// GetBuffers()는 아직 해제하지 않은 데이터를 모두 송신할 데이터로 보기 때문에
+		// 이번에 이미 담은 데이터를 다시 담지 않도록 마련된 크기까지만 요청하고
+		// 다음 공유 패킷이 있다면 그 앞까지만 담는다.
+		LONG64 sendEndPosition = nullptr != pPacket ? sendPosition : mSendBuffer->GetReservedSize();
+		if (mSendGatheredSize >= sendEndPosition)
+		{
+			break;
+		}
+
+		int requestSendSize = mSendBufSize - *realSendSize;
+		if (sendEndPosition - mSendGatheredSize < requestSendSize)
+		{
+			requestSendSize = static_cast<int>(sendEndPosition - mSendGatheredSize);
+		}
+
+		int gatheredSize{ 0 };
+		int gatheredBufCnt{ mSendBuffer->GetBuffers(requestSendSize,
+			pSendBufs + bufCnt,
+			MAX_SEND_BUF_CNT - bufCnt,
+			&gatheredSize) };
+
+		if (0 == gatheredBufCnt)
+		{
+			break;
+		}
+
+		for (int i = bufCnt; i < bufCnt + gatheredBufCnt; ++i)
+		{
+			pSendPackets[i] = nullptr;
+		}
+
+		bufCnt += gatheredBufCnt;
+		mSendGatheredSize += gatheredSize;
+		*realSendSize += gatheredSize;
+	}
+
+	return bufCnt;
+}
+
+int Connection::GetUnsentSize()
+{
+	return mSendBuffer->GetPendingSendSize() + static_cast<int>(mSharedSendBytes);
+}
+
+void Connection::ReleaseSharedPackets()
+{
+	Monitor::Owner lock{ mSharedSendSyncObj };
+
+	for (SharedSendEntry& entry : mSharedSendQueue)
+	{
+		entry.mPacket->Release();
+	}
+
+	mSharedSendQueue.clear();
+	mSharedSendBytes = 0;
+
+	// 연결이 끊겨서 송신 완료 통지를 처리하지 않으니 송신중이던 조각의 참조도 해제한다.
+	if (nullptr != mSendOverlappedEx)
+	{
+		for (int i = 0; i < mSendOverlappedEx->mSendBufCnt; ++i)
+		{
+			if (nullptr != mSendOverlappedEx->mSendPackets[i])
+			{
+				mSendOverlappedEx->mSendPackets[i]->Release();
+				mSendOverlappedEx->mSendPackets[i] = nullptr;
+			}
+		}
+
+		mSendOverlappedEx->mSendBufCnt = 0;
+	}
+}
+
+bool Connection::ReserveReassemblyBuf(int needBytes)
+{
+	if (needBytes <= mReassemblyBufSize)
+	{
+		return true;
+	}
+
+	Slab* pNewSlab{ nullptr };
+	char* pNewBuf{ nullptr };
+	int newBufSize{ 0 };
+
+	// 대부분의 패킷은 slab 하나에 들어가기 때문에 SlabPool에서 빌려온다.
+	if (SEND_SLAB_SIZE >= needBytes)
+	{
+		pNewSlab = SlabPool::GetInstance()->Alloc();
+		if (nullptr != pNewSlab)
+		{
+			pNewBuf = pNewSlab->mData;
+			newBufSize = SEND_SLAB_SIZE;
+		}
+	}
+
+	if (nullptr == pNewBuf)
+	{
+		pNewBuf = new (std::nothrow) char[needBytes];
+		newBufSize = needBytes;
+	}
+
+	if (nullptr == pNewBuf)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::ReserveReassemblyBuf() | index[%d] allocation failed: %d",
+			mIndex, needBytes);
+
+		return false;
+	}
+
+	// 길이 필드만 받아두었던 공간보다 큰 패킷이라면 받아둔 데이터를 옮긴다.
+	if (0 < mReassemblyBytes)
+	{
+		CopyMemory(pNewBuf, mReassemblyBuf, mReassemblyBytes);
+	}
+
+	int reassemblyBytes = mReassemblyBytes;
+	ReleaseReassemblyBuf();
+
+	mReassemblySlab = pNewSlab;
+	mReassemblyBuf = pNewBuf;
+	mReassemblyBufSize = newBufSize;
+	mReassemblyBytes = reassemblyBytes;
+
+	return true;
+}
+
+void Connection::ReleaseReassemblyBuf()
+{
+	if (nullptr != mReassemblySlab)
+	{
+		SlabPool::GetInstance()->Free(mReassemblySlab);
+	}
+	else
+	{
+		delete[] mReassemblyBuf;
+	}
+
+	mReassemblySlab = nullptr;
+	mReassemblyBuf = nullptr;
+	mReassemblyBufSize = 0;
+	mReassemblyBytes = 0;
+}
+
+bool Connection::DeliverPacket(DWORD packetSize, char* pPacket)
+{
+	if (false == mUseCoroutine)
+	{
+		IOCPServer::GetIOCPServer()->OnRecv(this, packetSize, pPacket);
+		return true;
+	}
+
+	std::coroutine_handle<> readWaiter{};
+
+	{
+		Monitor::Owner lock{ mCoroutineSyncObj };
+
+		if (MAX_COROUTINE_INBOX_SIZE < mCoInbox.size() + packetSize)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | Connection::DeliverPacket() | index[%d] coroutine inbox is full: %d bytes",
+				mIndex, static_cast<int>(mCoInbox.size()));
+
+			return false;
+		}
+
+		mCoInbox.insert(mCoInbox.end(), pPacket, pPacket + packetSize);
+
+		// 기다리던 coroutine이 있다면 재개하기 전에 패킷을 꺼내서 넘겨준다.
+		if (mReadWaiter)
+		{
+			PopCoroutinePacketLocked(mReadWaiterData, mReadWaiterSize);
+
+			readWaiter = mReadWaiter;
+			mReadWaiter = {};
+		}
+	}
+
+	if (readWaiter)
+	{
+		CoTask::Resume(CoTask::Handle::from_address(readWaiter.address()));
+	}
+
+	return true;
+}
+
+bool Connection::PopCoroutinePacket(ConnectionHandle connectionHandle, std::coroutine_handle<> handle, char** ppData, DWORD* pSize)
+{
+	*ppData = nullptr;
+	*pSize = 0;
+
+	if (false == mUseCoroutine)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::PopCoroutinePacket() | index[%d] InitConfig::mUseCoroutine is off",
+			mIndex);
+
+		return true;
+	}
+
+	bool isPopped{ true };
+	bool isRecvResumed{ false };
+	char* pPacketStart{ nullptr };
+	DWORD processedBytes{ 0 };
+
+	{
+		Monitor::Owner lock{ mCoroutineSyncObj };
+
+		// 연결이 끊겼다면 세대가 바뀌어 있다.
+		if (false == mIsConnected || connectionHandle != GetHandle())
+		{
+			return true;
+		}
+
+		if (mCoReadHandle != connectionHandle)
+		{
+			mCoReadBuf.clear();
+			mCoReadOffset = 0;
+			mCoReadHandle = connectionHandle;
+		}
+
+		if (false == PopCoroutinePacketLocked(ppData, pSize))
+		{
+			if (mReadWaiter)
+			{
+				LOG(eLogInfoType::LOG_ERROR_NORMAL,
+					L"SYSTEM | Connection::PopCoroutinePacket() | index[%d] another coroutine is already reading",
+					mIndex);
+
+				return true;
+			}
+
+			mReadWaiter = handle;
+			mReadWaiterData = ppData;
+			mReadWaiterSize = pSize;
+
+			isPopped = false;
+		}
+
+		// 쌓인 패킷을 꺼내갔으니 미뤄두었던 수신을 다시 요청한다.
+		if (mIsRecvPaused && COROUTINE_INBOX_PAUSE_SIZE > mCoInbox.size())
+		{
+			mIsRecvPaused = false;
+			isRecvResumed = true;
+			pPacketStart = mPausedPacketStart;
+			processedBytes = mPausedProcessedBytes;
+		}
+	}
+
+	if (isRecvResumed)
+	{
+		if (mIsSharedRecvBuffer)
+		{
+			RecvSharedPost();
+		}
+		else
+		{
+			RecvPost(pPacketStart, processedBytes);
+		}
+	}
+
+	return isPopped;
+}
+
+bool Connection::PauseRecv(char* pPacketStart, DWORD processedBytes)
+{
+	Monitor::Owner lock{ mCoroutineSyncObj };
+
+	if (COROUTINE_INBOX_PAUSE_SIZE > mCoInbox.size())
+	{
+		return false;
+	}
+
+	mIsRecvPaused = true;
+	mPausedPacketStart = pPacketStart;
+	mPausedProcessedBytes = processedBytes;
+
+	return true;
+}
+
+bool Connection::WaitFlush(ConnectionHandle connectionHandle, std::coroutine_handle<> handle, bool* pIsFlushed)
+{
+	*pIsFlushed = false;
+
+	if (false == mUseCoroutine)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Connection::WaitFlush() | index[%d] InitConfig::mUseCoroutine is off",
+			mIndex);
+
+		return true;
+	}
+
+	{
+		Monitor::Owner lock{ mCoroutineSyncObj };
+
+		if (false == mIsConnected || connectionHandle != GetHandle())
+		{
+			return true;
+		}
+
+		// 송신 완료 통지에서 같은 lock을 잡고 확인하기 때문에
+		// 여기서 남아있는 것을 확인했다면 마지막 송신이 끝날 때 재개된다.
+		if (0 >= GetUnsentSize())
+		{
+			*pIsFlushed = true;
+			return true;
+		}
+
+		if (mFlushWaiter)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | Connection::WaitFlush() | index[%d] another coroutine is already flushing",
+				mIndex);
+
+			return true;
+		}
+
+		mFlushWaiter = handle;
+		mFlushWaiterResult = pIsFlushed;
+	}
+
+	// SendPostCorked()로 모아두었던 데이터도 바로 송신한다.
+	SendPost();
+
+	return false;
+}
+
+bool Connection::PopCoroutinePacketLocked(char** ppData, DWORD* pSize)
+{
+	if (mCoReadBuf.size() <= mCoReadOffset)
+	{
+		if (mCoInbox.empty())
+		{
+			return false;
+		}
+
+		// 다 꺼낸 공간은 비워서 다음 수신 대기 공간으로 사용한다.
+		mCoReadBuf.clear();
+		mCoReadBuf.swap(mCoInbox);
+		mCoReadOffset = 0;
+	}
+
+	int packetSize{ 0 };
+	CopyMemory(&packetSize, mCoReadBuf.data() + mCoReadOffset, PACKET_SIZE_LENGTH);
+
+	*ppData = mCoReadBuf.data() + mCoReadOffset;
+	*pSize = static_cast<DWORD>(packetSize);
+	mCoReadOffset += packetSize;
+
+	return true;
+}
+
+void Connection::ResumeFlushWaiter()
+{
+	std::coroutine_handle<> flushWaiter{};
+
+	{
+		Monitor::Owner lock{ mCoroutineSyncObj };
+
+		if (!mFlushWaiter || 0 < GetUnsentSize())
+		{
+			return;
+		}
+
+		*mFlushWaiterResult = true;
+
+		flushWaiter = mFlushWaiter;
+		mFlushWaiter = {};
+	}
+
+	CoTask::Resume(CoTask::Handle::from_address(flushWaiter.address()));
+}
+
+void Connection::ResumeCoroutineWaiters()
+{
+	std::coroutine_handle<> readWaiter{};
+	std::coroutine_handle<> flushWaiter{};
+
+	{
+		Monitor::Owner lock{ mCoroutineSyncObj };
+
+		mCoInbox.clear();
+		mIsRecvPaused = false;
+
+		// 꺼낸 패킷 없이(크기 0) 재개해서 연결이 끊긴 것을 알린다.
+		readWaiter = mReadWaiter;
+		mReadWaiter = {};
+
+		flushWaiter = mFlushWaiter;
+		mFlushWaiter = {};
+		if (flushWaiter)
+		{
+			*mFlushWaiterResult = false;
+		}
+	}
+
+	if (readWaiter)
+	{
+		CoTask::Resume(CoTask::Handle::from_address(readWaiter.address()));
+	}
+
+	if (flushWaiter)
+	{
+		CoTask::Resume(CoTask::Handle::from_address(flushWaiter.address()));
+	}
+}
+
+void Connection::SetSocket(SOCKET socket)
+{
+	mClientSocket = socket;
+}
+
+SOCKET Connection::GetSocket()
+{
+	return mClientSocket;
+}
+
+void Connection::SetConnectionIP(char* IP)
+{
+	memcpy(mClientIP, IP, sizeof(mClientIP));
+}
+
+char* Connection::GetConnectionIP()
+{
+	return mClientIP;
+}
+
+int Connection::GetIndex()
+{
+	return mIndex;
+}
+
+Connection* Connection::BeginSharedAccess()
+{
+	Connection* pPrevConnection = tSharedAccessConnection;
+	tSharedAccessConnection = this;
+
+	return pPrevConnection;
+}
+
+void Connection::EndSharedAccess(Connection* pPrevConnection, ConnectionHandle handle, bool isFound)
+{
+	tSharedAccessConnection = pPrevConnection;
+
+	// handle을 다시 확인하지 못한 thread(그 사이 새 client가 들어왔다)는
+	// 새 client에게 미뤄둔 종료를 가져가서 버리면 안 된다.
+	if (false == isFound)
+	{
+		return;
+	}
+
+	// 여러 thread가 같이 읽기로 잡고 있었다면 먼저 나온 thread가 이 handle에 미뤄둔 종료를 가져가서 끊는다.
+	LONG64 deferredClose{ 0 };
+	while (true)
+	{
+		deferredClose = mDeferredClose;
+		if ((deferredClose & ~DEFERRED_CLOSE_TYPE_MASK) != MakeDeferredClose(handle, 0))
+		{
+			return;
+		}
+
+		if (InterlockedCompareExchange64(&mDeferredClose, 0, deferredClose) == deferredClose)
+		{
+			break;
+		}
+	}
+
+	SharedMonitor::Owner lock{ mConnectionSyncObj };
+
+	// 미뤄둔 사이에 다른 thread가 먼저 끊었다면 새로 들어온 client를 끊으면 안 된다.
+	if (false == mIsConnected || GetHandle() != handle)
+	{
+		return;
+	}
+
+	CloseConnection(DEFERRED_CLOSE_FORCE == (deferredClose & DEFERRED_CLOSE_TYPE_MASK));
+}
+
+ConnectionHandle Connection::GetHandle()
+{
+	return (static_cast<ConnectionHandle>(mGeneration) << 32) | static_cast<unsigned int>(mIndex);
+}
+
+Strand* Connection::GetStrand()
+{
+	return &mStrand;
+}
+
+int Connection::GetRecvBufSize()
+{
+	return mRecvBufSize;
+}
+
+int Connection::GetSendBufSize()
+{
+	return mSendBufSize;
+}
+
+bool Connection::IsSharedRecvBuffer()
+{
+	return mIsSharedRecvBuffer;
+}
+
+int Connection::GetSendBacklog()
+{
+	return mSendBuffer->GetUsedBufferSize() + static_cast<int>(mSharedSendBytes);
+}
+
+bool Connection::IsSendBufferHigh()
+{
+	return static_cast<LONG64>(true) == mIsSendBufferHigh;
+}
+
+LONG64 Connection::GetDroppedSendCount()
+{
+	return mDroppedSendCnt;
 }
 
 int Connection::GetRecvIORefCount()
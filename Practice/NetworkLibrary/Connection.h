@@ -5,17 +5,71 @@
 // client의 연결 정보를 나타내는 class
 // client에게 데이터를 수신하기 위해 WSARecv()를 호출하고
 // client에게 데이터를 송신하기 위해 WSASend()를 호출한다.
+// (2026 10 18 실제 IO 요청은 IOBackend를 통해서 한다.
+// Windows에서는 IOCP, Linux에서는 epoll이 처리)
 
-#ifdef NETWORKLIBRARY_EXPORTS
-#define NETLIB_API __declspec(dllexport)
-#else
-#define NETLIB_API __declspec(dllimport)
-#endif
-
-#include <WinSock2.h>
+#include <coroutine>
+#include <deque>
+#include <vector>
 
+#include "Platform.h"
 #include "RingBuffer.h"
+#include "ChainBuffer.h"
+#include "SendQueue.h"
+#include "AcceptManager.h"
 #include "Monitor.h"
+#include "SharedMonitor.h"
+#include "IOBackend.h"
+#include "Strand.h"
+
+class Connection;
+class ConnectionManager;
+class ReadPacketAwaiter;
+class FlushAwaiter;
+class SharedPacket;
+
+// 모든 패킷은 앞 4byte에 패킷 전체 크기를 담고 있다.
+constexpr int PACKET_SIZE_LENGTH{ 4 };
+
+// send ring buffer가 가득 찼을 때의 처리
+enum class eSendOverflowPolicy
+{
+	// 연결을 끊는다.
+	OVERFLOW_DISCONNECT,
+
+	// 사용량이 high watermark 이상인 동안 낮은 우선순위 패킷은 버려서
+	// 남은 공간을 중요한 패킷에 쓰고, 중요한 패킷까지 넣을 수 없을 때만 연결을 끊는다.
+	OVERFLOW_DROP_LOW_PRIORITY,
+};
+
+// PrepareSendPacket()으로 보내는 패킷의 우선순위
+enum class ePacketPriority
+{
+	PRIORITY_NORMAL,
+
+	// 주변 캐릭터 이동, 이펙트처럼 빠져도 다음 갱신으로 복구되는 패킷
+	PRIORITY_LOW,
+};
+
+// send ring buffer 사용량이 watermark를 넘나들 때 알림을 받는다.
+// 느린 client에게 보내는 중요하지 않은 broadcast를 줄이는 데 사용한다.
+// PrepareSendPacket()을 호출한 thread나 송신 완료 통지를 처리하는 worker thread에서 호출된다.
+class NETLIB_API SendBufferListener
+{
+public:
+	virtual ~SendBufferListener() = default;
+
+	// 사용량이 high watermark 이상이 되었다.
+	virtual void OnSendBufferHigh(Connection* pConnection) = 0;
+
+	// high가 된 뒤에 사용량이 low watermark 이하로 내려왔다.
+	virtual void OnSendBufferLow(Connection* pConnection) = 0;
+};
+
+// ConnectionManager가 나눠주는 Connection의 handle
+// 상위 32비트는 세대(접속을 수락할 때와 연결을 끊을 때 바뀜), 하위 32비트는 index
+using ConnectionHandle = unsigned long long;
+constexpr ConnectionHandle INVALID_CONNECTION_HANDLE{ 0 };
 
 // connection class 초기화를 위한 구성 정보
 struct InitConfig
@@ -28,6 +82,10 @@ struct InitConfig
 	// 연결 요청을 받을 server socket
 	SOCKET mListenSocket;
 
+	// 비동기 IO를 요청하고 작업 완료 통지를 받을 backend
+	// server가 하나를 생성해서 모든 connection이 공유한다.
+	IOBackend* mIOBackend;
+
 	// recv ring buffer size = recvBufCnt * recvBufSize
 	// send ring buffer size = sendBufCnt * sendBufSize
 	int mRecvBufCnt;
@@ -39,6 +97,78 @@ struct InitConfig
 	int mRecvBufSize;
 	int mSendBufSize;
 
+	// connection마다 recv ring buffer를 미리 만들지 않고
+	// backend가 모든 connection이 같이 사용하는 recv 버퍼로 받는다.
+	// 잘린 패킷만 connection의 재조립 공간에 복사하기 때문에
+	// 대부분 쉬고 있는 connection이 많을 때 메모리가 connection 수가 아니라 트래픽을 따라간다.
+	// backend가 지원하지 않는다면 recv ring buffer를 사용한다.
+	bool mUseSharedRecvBuffer;
+
+	// backend가 모든 connection의 recv에 같이 사용하는 버퍼 하나의 크기와 개수
+	// server가 backend를 만들 때 IOBackend::SetSharedRecvBuffer()에 넘긴다(0이면 기본값).
+	// (ShardedAcceptor를 사용한다면 ShardedAcceptor::SetSharedRecvBuffer())
+	int mSharedRecvBufSize;
+	int mSharedRecvBufCnt;
+
+	// 한 번에 송신할 데이터가 이 크기 이상이면 zero-copy로 송신한다(0이면 사용하지 않음).
+	// 맵 조각, 리플레이처럼 큰 데이터를 kernel 송신 버퍼로 다시 복사하지 않지만
+	// kernel이 완료 알림을 줄 때까지(상대가 ACK할 때까지) send ring buffer의 공간을 해제하지 못하고
+	// 완료 알림을 처리하는 비용이 있어서 작은 패킷에는 오히려 손해다.
+	// send ring buffer가 kernel 송신 버퍼 역할을 대신하게 되니 넉넉하게 잡아야 한다.
+	// backend가 지원하지 않는다면 복사 송신을 사용한다.
+	int mZeroCopySendThreshold;
+
+	// tick마다 여러 패킷을 보내는 connection은
+	// PrepareSendPacket() 뒤에 SendPost() 대신 SendPostCorked()를 호출해서
+	// 바로 송신하지 않고 호출한 thread의 목록에 모아두었다가
+	// tick이 끝날 때 Connection::FlushCorkedSends()로 한 번에 송신한다.
+	// 작은 패킷마다 send()를 호출하지 않으니 시스템 콜과 TCP segment 수가 줄어든다.
+	bool mUseCorkedSend;
+
+	// 모아둔 송신 데이터가 이 크기 이상이면 tick이 끝나기 전에 바로 송신한다(0이면 mSendBufSize).
+	int mCorkFlushThreshold;
+
+	// send ring buffer 사용량(아직 해제하지 못한 송신 데이터)의 watermark
+	// 0이면 send ring buffer 크기의 3/4, 1/4을 사용한다.
+	int mSendHighWatermark;
+	int mSendLowWatermark;
+
+	// watermark 알림을 받을 대상(nullptr이면 알리지 않음)
+	SendBufferListener* mSendBufferListener;
+
+	// send ring buffer가 가득 찼을 때의 처리
+	eSendOverflowPolicy mSendOverflowPolicy;
+
+	// send ring buffer 대신 SlabPool의 slab을 이어 붙인 ChainBuffer로 송신한다.
+	// 최대 크기(sendBufCnt * sendBufSize)를 미리 잡아두지 않고 쌓인 만큼만 slab을 가져오고
+	// 송신이 끝나면 돌려주기 때문에 connection 메모리가 최대치가 아니라 실제 사용량을 따라간다.
+	// 패킷 하나가 slab 하나에 담겨야 해서 SEND_SLAB_SIZE보다 큰 패킷은 보낼 수 없다.
+	bool mUseChainedSendBuffer;
+
+	// recv, send ring buffer를 같은 메모리를 두 번 이어서 매핑한 mirrored ring buffer로 만든다(RingBuffer.h).
+	// 버퍼 끝에서 잘린 수신 패킷을 앞으로 복사하지 않고 송신할 데이터는 항상 한 조각이 된다.
+	// 지원하지 않는다면(Windows) 일반 ring buffer를 사용한다.
+	bool mUseMirroredRingBuffer;
+
+	// send ring buffer 대신 여러 thread가 lock 없이 넣는 SendQueue로 송신한다(SendQueue.h).
+	// zone logic, 채팅, broadcast처럼 여러 thread가 같은 connection에 보낼 때 사용한다.
+	// PrepareSendPacket()으로 마련한 공간은 같은 thread가 SendPost()(SendPostCorked(), SendShared())를
+	// 호출해야 송신할 수 있게 되고, SendShared()도 lock을 잡지 않는다.
+	// ChainBuffer처럼 SEND_SLAB_SIZE보다 큰 패킷은 보낼 수 없고 zero-copy 송신은 사용하지 않는다.
+	bool mUseSendQueue;
+
+	// 걸어둘 accept 수를 조절할 AcceptManager(nullptr이면 쉬고 있는 Connection마다 accept를 건다.)
+	// 같은 listen socket을 사용하는 Connection은 같은 AcceptManager를 지정한다.
+	AcceptManager* mAcceptManager;
+
+	// Connection을 빌려주는 ConnectionManager(ConnectionManager::Create()가 채운다.)
+	// AcceptManager 없이 지정하면 쉬고 있는 Connection은 accept를 걸지 않고 ConnectionManager의 free list에서 기다린다.
+	ConnectionManager* mConnectionManager;
+
+	// 수신한 패킷을 OnRecv()로 넘기지 않고 모아두었다가
+	// coroutine이 co_await ReadPacket()으로 하나씩 꺼내간다(Coroutine.h).
+	bool mUseCoroutine;
+
 	// 순서성 있게 처리해야하는 패킷의 최대 수.
 	// process IOCP가 순서성 있는 작업을 처리하는데 처리할 수 있는 최대치를 정해둔 것이다.
 	// process IOCP queue에 추가할 때 1 감소하고 작업 완료 통지를 꺼내서 후처리가 끝나면 1 증가한다.
@@ -52,7 +182,13 @@ struct InitConfig
 	// client 접속, 데이터 송수신 뒤처리 하는 thread
 	int mWorkerThreadCnt;
 
+	// worker thread가 한 번 깨어났을 때 꺼내올 작업 완료 통지의 최대 개수
+	// IOBackend::CreateWorkerThread()(ShardedAcceptor::Start())에 넘기고 0이면 DEFAULT_COMPLETION_BATCH를 사용한다.
+	int mCompletionBatchSize;
+
 	// 순서성이 있는, 동시에 진행되면 안되는 작업을 처리하는 thread
+	// (2026 10 18 순서는 client나 zone 단위로만 지키면 되기 때문에
+	// Connection::GetStrand()나 zone마다 둔 Strand에 넣으면 worker thread 여럿이 나눠서 처리한다.)
 	int mProcessThreadCnt;
 
 	InitConfig()
@@ -75,6 +211,14 @@ enum class eOperationType
 	// (새로운 client도 IOCP 객체에 연결, 데이터 수신을 위한 connection class의 RecvPost() 함수 호출 등)
 	// 를 진행한다.
 	OP_ACCEPT,
+
+	// zero-copy로 송신한 데이터를 kernel이 다 사용했다는 완료 알림
+	// 송신 작업이 아니라서 IO 작업 횟수에 포함하지 않는다.
+	OP_ZEROCOPY_RELEASE,
+
+	// Strand의 작업을 실행하라는 요청(IOBackend::PostCompletion())
+	// mConnection에 Connection 대신 Strand가 들어있다.
+	OP_STRAND,
 };
 
 // Overlapped IO 작업을 진행하기 위한 Overlapped 구조체와
@@ -117,6 +261,25 @@ struct OVERLAPPED_EX
 	// 그것을 OVERLAPPED_EX구조체로 캐스팅하면 connection class를 복구할 수 있다.
 	void* mConnection;
 
+	// 공유 recv 버퍼를 사용할 때
+	// backend가 넘겨준 버퍼의 id(다 사용하면 ReleaseRecvBuffer()로 돌려준다.)
+	int mBufferID;
+
+	// 송신할 데이터 조각들
+	// send ring buffer가 끝에서 처음으로 이어져 있어도 한 번의 WSASend()로 보내기 위해
+	// 송신 요청은 mWSABuf 대신 이 배열을 사용한다.
+	// 일부만 송신되었다면, 보낸 만큼 앞 조각부터 잘라내고 남은 조각들을 다시 요청한다.
+	WSABUF mSendBufs[MAX_SEND_BUF_CNT];
+	int mSendBufCnt;
+
+	// mSendBufs의 조각이 SendShared()로 넣은 패킷이라면 그 패킷(send buffer의 조각이면 nullptr)
+	// 조각을 모두 송신하면 참조를 해제한다.
+	SharedPacket* mSendPackets[MAX_SEND_BUF_CNT];
+
+	// 이번 송신 요청을 zero-copy로 보낼지
+	// backend가 복사 송신을 했다면 false로 바꿔둔다.
+	bool mIsZeroCopy;
+
 	OVERLAPPED_EX(void* pConnection)
 	{
 		ZeroMemory(this, sizeof(OVERLAPPED_EX));
@@ -150,7 +313,8 @@ public:
 	// client socket에 대한 비동기 입출력 완료를
 	// IOCP queue에 넣고 후 처리하기 위해
 	// IOCP 객체에 client socket을 연결한다.
-	bool BindIOCP(HANDLE hIOCP);
+	// (epoll backend라면 epoll 객체에 client socket을 등록)
+	bool BindIOBackend();
 
 	// recv ring buffer에 수신할 공간을 마련하고 WSARecv()를 호출하는 함수다.
 	// 한가지 고려할 점이,
@@ -160,19 +324,151 @@ public:
 	// 다음에 수신할 버퍼의 메모리 위치를 계산해야 한다.
 	bool RecvPost(char* pPacketStart, DWORD processedBytes);
 
+	// 공유 recv 버퍼를 사용할 때의 수신 요청
+	// 받을 위치를 마련할 필요 없이 backend가 데이터가 들어있는 버퍼를 넘겨준다.
+	bool RecvSharedPost();
+
 	// send ring buffer에 송신할 데이터가 저장되어 있을텐데
 	// ring buffer.GetBuffer() 함수를 호출하여,
 	// 송신할 버퍼의 시작 위치와 송신할 버퍼의 크기를 알아와서
 	// WSASend()를 호출하여 데이터를 송신한다.
 	bool SendPost();
 
+	// InitConfig::mUseCorkedSend라면 바로 송신하지 않고
+	// 호출한 thread의 송신 대기 목록에 넣어둔다.
+	// 모아둔 데이터가 mCorkFlushThreshold 이상이면 바로 SendPost()를 호출한다.
+	// mUseCorkedSend가 아니라면 SendPost()와 같다.
+	bool SendPostCorked();
+
+	// 호출한 thread의 송신 대기 목록에 있는 connection을 모두 송신한다.
+	// game logic thread는 tick이 끝날 때 호출하고
+	// worker thread는 꺼내온 작업 완료 통지를 모두 처리한 뒤에 IOBackend가 호출한다.
+	static void FlushCorkedSends();
+
 	// AcceptEx() 함수를 호출해서 client 접속 요청을 비동기로 처리한다.
 	// client 접속이 수락되면, Worker IOCP queue에 작업 완료 통지가 추가된다.
+	// AcceptManager를 지정했다면 accept를 걸지 않고 AcceptManager에게 맡긴다.
+	// AcceptManager 없이 ConnectionManager만 지정했다면 free list로 돌아간다.
 	bool BindAcceptExSock();
 
+	// 실제로 backend에 accept를 요청한다.
+	// AcceptManager가 accept를 걸 차례가 된 Connection에 호출한다.
+	// (ConnectionManager::Alloc()으로 꺼낸 Connection도 이것으로 accept를 건다.)
+	bool PostAccept();
+
 	// 송신할 데이터를 저장하기 공간을 마련하기 위해서
 	// send ring buffer에 sendLength 크기만큼의 버퍼를 확보하라고 요청
-	char* PrepareSendPacket(int sendLength);
+	// 공간이 없으면 연결을 끊고 nullptr 반환
+	// OVERFLOW_DROP_LOW_PRIORITY라면 낮은 우선순위 패킷은
+	// high watermark 이상이거나 공간이 없을 때 연결을 끊지 않고 버린다(nullptr 반환).
+	// mUseSendQueue라면 같은 thread가 SendPost()를 호출할 때 송신할 수 있게 된다.
+	char* PrepareSendPacket(int sendLength, ePacketPriority priority = ePacketPriority::PRIORITY_NORMAL);
+
+	// 여러 connection에게 보내는 패킷을 복사하지 않고 참조만 송신 대기 목록에 넣는다.
+	// 지금까지 PrepareSendPacket()으로 넣은 데이터 뒤에 송신되고, 보내려면 SendPost()를 호출한다.
+	// 송신 대기 중인 크기가 send buffer 크기를 넘으면 PrepareSendPacket()처럼
+	// 연결을 끊거나 낮은 우선순위 패킷은 버리고 false를 반환한다.
+	bool SendShared(SharedPacket* pPacket, ePacketPriority priority = ePacketPriority::PRIORITY_NORMAL);
+
+	// co_await로 다음 패킷을 기다린다(InitConfig::mUseCoroutine).
+	// 사용하려면 Coroutine.h를 include한다.
+	ReadPacketAwaiter ReadPacket();
+
+	// co_await로 지금까지 넣은 송신 데이터를 모두 송신할 때까지 기다린다.
+	FlushAwaiter Flush();
+
+public:
+	// worker thread가 IOBackend::GetCompletions()로 꺼낸 작업 완료 통지를
+	// 작업 종류(mOperation)에 맞게 후처리한다.
+	// 작업이 실패했거나, recv/send 작업의 전송 바이트가 0이라면
+	// client와 연결이 끊긴 것으로 보고 연결 종료를 요청한다.
+	void OnIOCompleted(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes, bool isSuccess);
+
+	// client 주소를 세팅하고 backend에 client socket을 등록한 뒤
+	// 첫 번째 RecvPost()를 호출한다.
+	bool DoAccept(OVERLAPPED_EX* pOverlappedEx);
+
+	// recv ring buffer에 모인 데이터 중 온전한 패킷을 모두 처리하고
+	// 잘린 패킷의 시작 위치와 받은 바이트 수로 다시 RecvPost()를 호출한다.
+	bool DoRecv(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes);
+
+	// backend가 넘겨준 공유 recv 버퍼에서 바로 패킷을 처리하고
+	// 버퍼 끝에서 잘린 패킷만 재조립 공간에 복사해둔다.
+	bool DoSharedRecv(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes);
+
+	// 송신된 만큼 send ring buffer에서 해제하고(zero-copy라면 완료 알림까지 잡아두고)
+	// 요청한 바이트가 모두 송신되지 않았다면 나머지를 다시 송신하고
+	// 모두 송신되었다면 다음 SendPost()를 호출한다.
+	bool DoSend(OVERLAPPED_EX* pOverlappedEx, DWORD transferredBytes);
+
+	// kernel이 zero-copy로 송신한 데이터를 다 사용했으니
+	// 잡아두었던 send ring buffer 공간을 해제한다.
+	void DoZeroCopyRelease(DWORD releaseBytes);
+
+private:
+	// send ring buffer 사용량으로 watermark 상태를 바꾸고 listener에게 알린다.
+	void UpdateSendBufferState();
+
+	// send buffer의 조각과 SendShared()로 넣은 패킷을 넣은 순서대로 mSendOverlappedEx에 담는다.
+	// 반환값은 담은 조각의 개수이고, 송신할 크기는 realSendSize에 넣어준다.
+	// mIsSending을 가져온 thread만 호출한다.
+	int GatherSendBuffers(int* realSendSize);
+
+	// 아직 송신 요청하지 않은 크기(send buffer + SendShared()로 넣은 패킷)
+	int GetUnsentSize();
+
+	// 송신 대기 목록과 송신중인 조각의 공유 패킷 참조를 모두 해제한다.
+	void ReleaseSharedPackets();
+
+	// 재조립 공간에 needBytes가 들어갈 수 있게 한다. 할당할 수 없으면 false
+	// 재조립중인 데이터는 새 공간으로 옮긴다.
+	bool ReserveReassemblyBuf(int needBytes);
+
+	// 재조립 공간을 SlabPool(또는 heap)에 돌려준다.
+	void ReleaseReassemblyBuf();
+
+	// 온전히 받은 패킷을 OnRecv()로 넘기거나
+	// mUseCoroutine이라면 수신 대기 공간에 넣고 기다리던 coroutine을 재개한다.
+	// 수신 대기 공간이 가득 찼다면 false
+	bool DeliverPacket(DWORD packetSize, char* pPacket);
+
+	// 받아둔 패킷을 하나 꺼내서 ppData, pSize에 담는다.
+	// 연결이 끊겼거나 connectionHandle이 지금 client가 아니라면 크기 0인 패킷을 담는다.
+	// 받아둔 패킷이 없다면 coroutine을 수신 대기로 등록하고 false를 반환한다.
+	// 패킷이 오면 ppData, pSize를 채운 뒤에 재개한다.
+	bool PopCoroutinePacket(ConnectionHandle connectionHandle, std::coroutine_handle<> handle, char** ppData, DWORD* pSize);
+
+	// coroutine이 꺼내가지 않은 패킷이 많다면 다음 수신 요청을 미뤄두고 true를 반환한다.
+	// PopCoroutinePacket()이 패킷을 꺼내간 뒤에 다시 요청한다.
+	bool PauseRecv(char* pPacketStart, DWORD processedBytes);
+
+	// 송신할 데이터가 남아있다면 coroutine을 송신 대기로 등록하고 false를 반환한다.
+	// 모두 송신했다면 *pIsFlushed를 true로, 연결이 끊겼다면 false로 바꾼 뒤에 재개한다.
+	bool WaitFlush(ConnectionHandle connectionHandle, std::coroutine_handle<> handle, bool* pIsFlushed);
+
+	// mCoroutineSyncObj를 잡고 호출한다.
+	// mCoReadBuf에서 다음 패킷을 꺼내고 다 꺼냈다면 mCoInbox와 바꾼다.
+	bool PopCoroutinePacketLocked(char** ppData, DWORD* pSize);
+
+	// 송신할 데이터가 남지 않았다면 송신 대기중인 coroutine을 재개한다.
+	void ResumeFlushWaiter();
+
+	// 연결이 끊겼으니 기다리던 coroutine을 모두 재개한다.
+	void ResumeCoroutineWaiters();
+
+	friend class ReadPacketAwaiter;
+	friend class FlushAwaiter;
+
+	// WithConnection()에서 mConnectionSyncObj를 읽기로 잡고 handle을 다시 확인한다.
+	friend class ConnectionManager;
+
+	// WithConnection()이 mConnectionSyncObj를 읽기로 잡기 전과 푼 뒤에 호출한다.
+	// 읽기로 잡은 thread가 func 안에서 CloseConnection()을 호출하면 쓰기로 다시 잡을 수 없어서(deadlock)
+	// 끊는 것을 미뤄두었다가 EndSharedAccess()에서 handle을 다시 확인하고 끊는다.
+	// BeginSharedAccess()는 이 thread가 이전에 읽기로 잡고 있던 Connection을 반환한다.
+	// isFound: 읽기로 잡은 뒤에 handle을 다시 확인했는지(아니라면 미뤄둔 종료를 가져가지 않는다.)
+	Connection* BeginSharedAccess();
+	void EndSharedAccess(Connection* pPrevConnection, ConnectionHandle handle, bool isFound);
 
 public:
 	void SetSocket(SOCKET socket);
@@ -186,9 +482,29 @@ public:
 
 	int GetIndex();
 
+	// 지금 client의 handle(index + 세대)
+	// 연결이 끊기면 세대가 바뀌어서 이전 handle은 ConnectionManager::Find()에서 거부된다.
+	ConnectionHandle GetHandle();
+
+	// 이 client의 작업을 순서대로 실행하는 strand
+	// 작업이 실행될 때는 이미 다른 client가 사용중일 수 있으니 GetHandle()로 확인한다.
+	Strand* GetStrand();
+
 	int GetRecvBufSize();
 	int GetSendBufSize();
 
+	bool IsSharedRecvBuffer();
+
+	// 아직 해제하지 못한 송신 데이터의 크기(SendShared()로 넣고 아직 송신 요청하지 않은 패킷 포함)
+	// game logic이 느린 client에게 보낼 broadcast를 줄일 때 참고한다.
+	int GetSendBacklog();
+
+	// high watermark를 넘어서 아직 low watermark로 내려오지 않았는지
+	bool IsSendBufferHigh();
+
+	// OVERFLOW_DROP_LOW_PRIORITY로 버린 패킷 수
+	LONG64 GetDroppedSendCount();
+
 	int GetRecvIORefCount();
 	int GetSendIORefCount();
 	int GetAcceptIORefCount();
@@ -242,9 +558,24 @@ public:
 	// 앞서 요청한 Overlapped IO의 후처리 과정에서는 덮어 써진 데이터를 참조하기 때문에 문제가 발생한다.
 	OVERLAPPED_EX* mSendOverlappedEx;
 
+	// zero-copy 송신의 완료 알림을 받기 위한 변수
+	// 송신 요청과 완료 알림이 서로 겹치기 때문에 mSendOverlappedEx와 따로 둔다.
+	// zero-copy 송신을 사용할 때만 생성한다.
+	OVERLAPPED_EX* mZeroCopyOverlappedEx;
+
 	RingBuffer mRecvRingBuffer;
 	RingBuffer mSendRingBuffer;
 
+	// 송신은 mSendBuffer로만 한다.
+	// mUseSendQueue라면 mSendQueue를, mUseChainedSendBuffer라면 mSendChainBuffer를, 아니면 mSendRingBuffer를 가리킨다.
+	// (mSendRingBuffer는 Create()하지 않아서 메모리를 차지하지 않는다.)
+	SendBuffer* mSendBuffer;
+	ChainBuffer* mSendChainBuffer;
+	SendQueue* mSendQueue;
+
+	// Connection이 재사용되어도 그대로 사용한다.
+	Strand mStrand;
+
 	// AcceptEx() 함수 호출 후 client 접속 요청을 비동기로 받으면,
 	// OS가 IOCP queue에 작업 완료 통지를 넣고
 	// Worker Thread가 IOCP queue에서 완료 통지를 꺼낸 뒤
@@ -273,7 +604,9 @@ public:
 	// 그래서 송신 작업 완료 통지를 받고나서
 	// 요청한 바이트가 모두 송신되지 않았다면, 이 값을 false로 유지한 상태에서 WSASend()를 호출하고
 	// 온전히 모든 패킷이 송신되었음을 확인하면, 이 값을 true로 바꿔서 SendPost()를 호출한다.
-	bool mIsSending;
+	// InterlockedCompareExchange64()로 8바이트 단위로 값을 바꾸기 때문에
+	// bool로 선언하면 뒤에 있는 멤버 변수까지 덮어쓰게 되어 LONG64로 선언했다.
+	LONG64 mIsSending;
 
 private:
 	SOCKET mClientSocket;
@@ -292,6 +625,10 @@ private:
 	char mClientIP[MAX_IP_LENGTH];
 	int mIndex;
 
+	// 접속을 수락할 때와 연결을 끊을 때 1 증가(GetHandle()의 상위 32비트)
+	// 다른 thread가 GetHandle()로 읽기 때문에 Interlocked 함수로 바꾼다.
+	LONG64 mGeneration;
+
 	// Connection Manager에서 Connection 추가 및 삭제와 같은 작업이 발생할 떄
 	// 다른 스레드들이 Connection을 관리하는 컨테이너에 접근하지 못하도록
 	// lock을 걸기 위함
@@ -299,17 +636,120 @@ private:
 	// OnClose 내부에서 Connection Manager가 관리하는 Connection 객체 컨테이너에서
 	// 연결을 끊고자 하는 Connection 객체의 데이터를 삭제하는 과정이 있는데
 	// 이런 상황에서 사용한다.
-	Monitor mConnectionSyncObj;
+	// 연결을 맺고 끊을 때는 쓰기로 잡고
+	// ConnectionManager::WithConnection()은 SendQueue를 사용할 때만 읽기로 잡아서 서로 기다리지 않는다.
+	SharedMonitor mConnectionSyncObj;
+
+	// WithConnection() 안에서 미룬 CloseConnection()
+	// 미룬 client의 세대 << 2 | 종료 방법(0: 없음, 1: 우아한 종료, 2: 강제 종료)
+	// 세대가 같은 handle로 WithConnection()을 마친 thread만 가져가서 끊는다.
+	LONG64 mDeferredClose;
 
 	// 새롭게 연결된 client에 대해서
 	// Overlapped IO 요청을 하고 완료 통지를 받아야하기 때문에
 	// Worker IOCP 객체와 연결한다.
-	HANDLE mIOCP;
+	// (IOCP 객체 대신 플랫폼에 맞는 IO backend를 사용)
+	IOBackend* mIOBackend;
 
 	// overlapped IO 작업의 횟수를 카운팅한다.
 	// 모든 작업이 완료되어 모든 횟수가 0이되면,
 	// 그 때 connection class를 초기화하고 새로운 client를 받을 준비를 한다.
-	DWORD mSendIORefCount;
-	DWORD mRecvIORefCount;
-	DWORD mAcceptIORefCount;
+	// Interlocked 64비트 함수로 값을 바꾸기 때문에 LONG64로 선언
+	LONG64 mSendIORefCount;
+	LONG64 mRecvIORefCount;
+	LONG64 mAcceptIORefCount;
+
+	// 공유 recv 버퍼 사용 여부
+	bool mIsSharedRecvBuffer;
+
+	// 공유 recv 버퍼 끝에서 잘린 패킷을 이어 붙이는 공간
+	// 잘린 패킷이 생기면 SlabPool에서 slab을 빌려오고 재조립이 끝나면 돌려줘서
+	// 쉬고 있는 connection은 재조립 공간을 들고 있지 않는다.
+	// slab보다 큰 패킷은 길이 필드를 받은 뒤에 패킷 크기만큼 따로 할당한다.
+	Slab* mReassemblySlab;
+	char* mReassemblyBuf;
+	int mReassemblyBufSize;
+	int mReassemblyBytes;
+
+	// zero-copy로 송신할 최소 크기(0이면 사용하지 않음)
+	int mZeroCopySendThreshold;
+
+	// SendPostCorked()로 송신을 모아둘지, 모아둔 데이터를 바로 송신할 크기
+	bool mUseCorkedSend;
+	int mCorkFlushThreshold;
+
+	// 어떤 thread의 송신 대기 목록에 들어있는지
+	// 여러 thread가 SendPostCorked()를 호출해도 한 목록에만 넣는다.
+	// mIsSending처럼 Interlocked 64비트 함수로 바꾸기 때문에 LONG64로 선언
+	LONG64 mIsCorked;
+
+	// send ring buffer watermark
+	int mSendHighWatermark;
+	int mSendLowWatermark;
+	SendBufferListener* mSendBufferListener;
+	eSendOverflowPolicy mSendOverflowPolicy;
+
+	AcceptManager* mAcceptManager;
+	ConnectionManager* mConnectionManager;
+
+	// 송신 데이터를 넣는 thread와 해제하는 thread가 달라서
+	// 상태가 바뀌는 것을 한 thread만 알리도록 Interlocked 함수로 바꾼다.
+	LONG64 mIsSendBufferHigh;
+	LONG64 mDroppedSendCnt;
+
+	// 받을 수 있는 패킷의 최대 크기(recvBufSize * recvBufCnt)
+	int mMaxPacketSize;
+
+	// 수신한 패킷을 coroutine으로 처리하는지
+	bool mUseCoroutine;
+
+	// coroutine이 아직 꺼내지 않은 패킷(받은 그대로 이어 붙인다.)
+	std::vector<char> mCoInbox;
+
+	// ReadPacket()이 패킷을 꺼내가는 공간과 다음에 꺼낼 위치
+	// 꺼내간 패킷이 다음 ReadPacket()까지 유효하도록 다 꺼낸 뒤에만 mCoInbox와 바꾼다.
+	// 두 공간 모두 capacity를 유지하기 때문에 한동안 받고 나면 더 할당하지 않는다.
+	std::vector<char> mCoReadBuf;
+	size_t mCoReadOffset;
+
+	// mCoReadBuf를 채운 client(다른 client라면 비우고 시작한다.)
+	ConnectionHandle mCoReadHandle;
+
+	// 수신 요청을 미뤄두었는지와 다시 요청할 때 RecvPost()에 넘길 값
+	bool mIsRecvPaused;
+	char* mPausedPacketStart;
+	DWORD mPausedProcessedBytes;
+
+	// 패킷을 기다리는 coroutine과 꺼낸 패킷을 담을 곳
+	std::coroutine_handle<> mReadWaiter;
+	char** mReadWaiterData;
+	DWORD* mReadWaiterSize;
+
+	// 송신 완료를 기다리는 coroutine과 결과를 담을 곳
+	std::coroutine_handle<> mFlushWaiter;
+	bool* mFlushWaiterResult;
+
+	// 수신 대기 공간과 기다리는 coroutine을 보호한다.
+	// 패킷을 넣는 worker thread와 꺼내는 strand가 다르다.
+	Monitor mCoroutineSyncObj;
+
+	// SendShared()로 넣은 패킷과 송신할 위치
+	struct SharedSendEntry
+	{
+		SharedPacket* mPacket;
+
+		// send buffer에 이만큼 마련된 데이터를 모두 송신 요청한 뒤에 송신한다(SendBuffer::GetReservedSize()).
+		LONG64 mSendPosition;
+	};
+
+	std::deque<SharedSendEntry> mSharedSendQueue;
+
+	// mSharedSendQueue에 있는 패킷 크기의 합
+	LONG64 mSharedSendBytes;
+
+	// 지금까지 send buffer에서 송신 요청한 크기
+	// mSendPosition과 비교해서 공유 패킷을 끼워 넣을 차례인지 확인한다.
+	LONG64 mSendGatheredSize;
+
+	Monitor mSharedSendSyncObj;
 };
\ No newline at end of file
@@ -0,0 +1,166 @@
+﻿#include "Log.h"
+#include "ConnectionManager.h"
+
+// free list head의 하위 32비트(index + 1)와 상위 32비트(tag)
+constexpr unsigned long long CONNECTION_INDEX_MASK{ 0xFFFFFFFF };
+
+static LONG64 MakeFreeHead(unsigned long long tag, int index)
+{
+	return static_cast<LONG64>((tag << 32) | static_cast<unsigned int>(index + 1));
+}
+
+ConnectionManager::ConnectionManager()
+	: mConnections{ nullptr }
+	, mConnectionCnt{ 0 }
+	, mNextFree{ nullptr }
+	, mFreeHead{ 0 }
+	, mFreeConnectionCnt{ 0 }
+{
+}
+
+ConnectionManager::~ConnectionManager()
+{
+	delete[] mConnections;
+	delete[] mNextFree;
+}
+
+bool ConnectionManager::Create(InitConfig& initConfig, int connectionCnt)
+{
+	if (0 >= connectionCnt)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | ConnectionManager::Create() | invalid connection count: %d",
+			connectionCnt);
+
+		return false;
+	}
+
+	// CreateConnection()에서 AcceptManager나 Connection이 free list를 사용할 수 있어서 먼저 준비한다.
+	mConnections = new Connection[connectionCnt];
+	mNextFree = new int[connectionCnt];
+	mConnectionCnt = connectionCnt;
+
+	// AcceptManager가 없다면 CreateConnection()의 BindAcceptExSock()이
+	// accept를 거는 대신 Free()로 free list를 채운다.
+	initConfig.mConnectionManager = this;
+
+	for (int i = 0; i < connectionCnt; ++i)
+	{
+		initConfig.mIndex = i;
+
+		if (false == mConnections[i].CreateConnection(initConfig))
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | ConnectionManager::Create() | CreateConnection() failed: index[%d]",
+				i);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Connection* ConnectionManager::Alloc()
+{
+	while (true)
+	{
+		LONG64 head = mFreeHead;
+		int index = static_cast<int>(static_cast<unsigned long long>(head) & CONNECTION_INDEX_MASK) - 1;
+
+		if (-1 == index)
+		{
+			return nullptr;
+		}
+
+		// 읽은 뒤에 다른 thread가 꺼냈다가 다시 넣어서 mNextFree가 바뀌었다면
+		// head의 tag도 바뀌어서 아래 CAS가 실패한다.
+		unsigned long long tag = static_cast<unsigned long long>(head) >> 32;
+
+		if (InterlockedCompareExchange64(&mFreeHead, MakeFreeHead(tag + 1, mNextFree[index]), head) == head)
+		{
+			InterlockedDecrement64(&mFreeConnectionCnt);
+			return &mConnections[index];
+		}
+	}
+}
+
+void ConnectionManager::Free(Connection* pConnection)
+{
+	int index = pConnection->GetIndex();
+
+	while (true)
+	{
+		LONG64 head = mFreeHead;
+		unsigned long long tag = static_cast<unsigned long long>(head) >> 32;
+
+		mNextFree[index] = static_cast<int>(static_cast<unsigned long long>(head) & CONNECTION_INDEX_MASK) - 1;
+
+		if (InterlockedCompareExchange64(&mFreeHead, MakeFreeHead(tag + 1, index), head) == head)
+		{
+			InterlockedIncrement64(&mFreeConnectionCnt);
+			return;
+		}
+	}
+}
+
+Connection* ConnectionManager::Find(ConnectionHandle handle)
+{
+	unsigned long long index = handle & CONNECTION_INDEX_MASK;
+	if (static_cast<unsigned long long>(mConnectionCnt) <= index)
+	{
+		return nullptr;
+	}
+
+	// 쉬고 있는 Connection은 아직 나눠준 handle이 없다.
+	Connection* pConnection = &mConnections[index];
+	if (false == pConnection->mIsConnected || pConnection->GetHandle() != handle)
+	{
+		return nullptr;
+	}
+
+	return pConnection;
+}
+
+bool ConnectionManager::SendTo(ConnectionHandle handle, const char* pData, int dataSize)
+{
+	bool isSent{ false };
+
+	WithConnection(handle, [&](Connection* pConnection)
+		{
+			char* pSendPacket = pConnection->PrepareSendPacket(PACKET_SIZE_LENGTH + dataSize);
+			if (nullptr == pSendPacket)
+			{
+				return;
+			}
+
+			CopyMemory(pSendPacket + PACKET_SIZE_LENGTH, pData, dataSize);
+
+			// SendPost()는 앞선 송신이 진행중이면 false를 반환하지만
+			// 넣은 패킷은 송신 완료 통지에서 이어서 송신된다.
+			pConnection->SendPost();
+			isSent = true;
+		});
+
+	return isSent;
+}
+
+Connection* ConnectionManager::GetConnection(int index)
+{
+	if (0 > index || mConnectionCnt <= index)
+	{
+		return nullptr;
+	}
+
+	return &mConnections[index];
+}
+
+int ConnectionManager::GetConnectionCount()
+{
+	return mConnectionCnt;
+}
+
+int ConnectionManager::GetFreeConnectionCount()
+{
+	return static_cast<int>(mFreeConnectionCnt);
+}
@@ -0,0 +1,145 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// Connection 객체를 미리 만들어두고 빌려주고 돌려받는 pool
+//
+// Connection은 한 번 만든 뒤에 client가 바뀌어도 InitializeConnection()으로 초기화해서 재사용한다.
+// 그래서 game 코드가 Connection 포인터나 index를 들고 있으면
+// 그 사이에 연결이 끊기고 다른 client가 같은 Connection을 사용하게 되었는지 알 수 없다.
+// (지연된 패킷 처리나 timer가 엉뚱한 client에게 보내게 된다.)
+//
+// ConnectionManager는 Connection마다 세대(generation)를 두고
+// index와 세대를 합친 64비트 handle(ConnectionHandle)을 나눠준다.
+// 접속을 수락할 때와 연결을 끊을 때 세대가 바뀌기 때문에
+// 이전 client의 handle로 Find()하면 배열 접근과 비교 한 번으로 nullptr이 반환된다.
+// 다만 Find()가 돌려준 뒤에 다른 thread에서 연결이 끊기고 다른 client가 들어올 수 있어서
+// 찾은 Connection에 무언가를 하려면 WithConnection(), SendTo()를 사용한다.
+// 둘은 Connection의 lock(CloseConnection()이 세대를 바꿀 때 쓰기로 잡는 lock)을 잡고 handle을 다시 확인한다.
+// InitConfig::mUseSendQueue라면 읽기로 잡아서
+// 같은 client에게 여러 thread가 동시에 보내거나 timer가 실행되어도 서로 기다리지 않는다.
+// RingBuffer, ChainBuffer는 PrepareSendPacket()으로 마련한 공간을 채우기 전에
+// 다른 thread의 SendPost()가 그 공간까지 송신할 수 있어서 쓰기로 잡고 한 thread씩 실행한다.
+//
+// Connection은 연속된 배열 하나에 만들고
+// accept를 걸지 않고 쉬고 있는 Connection은 lock 없는 free list에 둔다(SlabPool과 같은 Treiber stack).
+// AcceptManager에 ConnectionManager를 넘기면 대기 목록 대신 이 free list를 사용한다.
+// AcceptManager 없이 사용하면 Create()에서 모든 Connection이 accept를 걸지 않고 free list에 들어가고
+// Alloc()으로 꺼내서 Connection::PostAccept()로 accept를 건다.
+// 연결이 끊긴 Connection은 다시 free list로 돌아온다.
+// 하나의 ConnectionManager는 하나의 listen socket, AcceptManager와 같이 사용한다.
+
+#include "Platform.h"
+#include "Connection.h"
+
+class NETLIB_API ConnectionManager
+{
+public:
+	ConnectionManager();
+	~ConnectionManager();
+
+public:
+	// connectionCnt개의 Connection을 만들고 initConfig로 CreateConnection()을 호출한다.
+	// mIndex는 배열의 index로, mConnectionManager는 this로 채운다.
+	// AcceptManager가 없다면 모든 Connection이 free list에 들어간다.
+	bool Create(InitConfig& initConfig, int connectionCnt);
+
+	// 쉬고 있는 Connection을 free list에서 꺼낸다. 없으면 nullptr
+	Connection* Alloc();
+
+	// 쉬게 된 Connection을 free list에 넣는다.
+	void Free(Connection* pConnection);
+
+public:
+	// handle이 가리키는 Connection
+	// 범위를 벗어났거나 세대가 다르면(이미 끊긴 client의 handle) nullptr
+	// lock 없이 확인하기 때문에 반환한 뒤에 다른 thread에서 연결이 끊길 수 있다.
+	// 연결 여부를 빠르게 걸러낼 때만 사용하고 Connection을 사용할 때는 WithConnection()을 사용한다.
+	Connection* Find(ConnectionHandle handle);
+
+	// handle이 가리키는 Connection의 lock을 잡고 handle을 다시 확인한 뒤에 func(Connection*)을 실행한다.
+	// SendQueue를 사용한다면 읽기로, 아니면 쓰기로 잡는다.
+	// func이 끝날 때까지 연결이 끊기지 않는다(CloseConnection()은 쓰기로 잡으려고 기다린다).
+	// 실행했다면 true, 이미 끊긴 client의 handle이라면 false
+	// 읽기로 잡았을 때 func 안에서 CloseConnection()을 호출하면 lock을 푼 뒤에 끊는다(읽기에서 쓰기로 바꿀 수 없다).
+	// 읽기로 잡았을 때 func 안에서 같은 Connection의 WithConnection()을 다시 호출하면 안 된다.
+	// 그 사이에 다른 thread가 쓰기로 기다리고 있으면 새로 들어오는 읽기도 기다리기 때문에 deadlock이다.
+	// 다른 Connection의 WithConnection()도 두 thread가 서로의 lock을 기다릴 수 있어서 피한다.
+	template <typename Func>
+	bool WithConnection(ConnectionHandle handle, Func&& func);
+
+	// handle이 가리키는 client에게 pData를 패킷 하나로 보낸다(앞에 4byte 크기를 붙인다).
+	// 이미 끊긴 client의 handle이거나 send 버퍼가 부족하면 false
+	// true는 send 버퍼에 넣었다는 뜻이다(앞선 송신이 진행중이라면 그 뒤에 송신된다).
+	bool SendTo(ConnectionHandle handle, const char* pData, int dataSize);
+
+	Connection* GetConnection(int index);
+
+	int GetConnectionCount();
+	int GetFreeConnectionCount();
+
+public:
+	ConnectionManager(const ConnectionManager& rhs) = delete;
+	ConnectionManager(ConnectionManager&& rhs) = delete;
+
+	ConnectionManager& operator=(const ConnectionManager& rhs) = delete;
+	ConnectionManager& operator=(ConnectionManager&& rhs) = delete;
+
+private:
+	Connection* mConnections;
+	int mConnectionCnt;
+
+	// free list에서 다음 Connection의 index(-1이면 끝)
+	int* mNextFree;
+
+	// free list head(tag << 32 | (index + 1)), 하위 32비트가 0이면 비어있다.
+	LONG64 mFreeHead;
+	LONG64 mFreeConnectionCnt;
+};
+
+template <typename Func>
+bool ConnectionManager::WithConnection(ConnectionHandle handle, Func&& func)
+{
+	// 끊긴 client의 handle은 lock 없이 먼저 걸러낸다.
+	Connection* pConnection = Find(handle);
+	if (nullptr == pConnection)
+	{
+		return false;
+	}
+
+	bool isFound{ false };
+
+	// PrepareSendPacket()으로 마련하고 아직 채우지 않은 공간을 다른 thread가 송신하지 않도록
+	// RingBuffer, ChainBuffer는 한 thread씩 실행한다.
+	if (nullptr == pConnection->mSendQueue)
+	{
+		SharedMonitor::Owner lock{ pConnection->mConnectionSyncObj };
+
+		// lock을 기다리는 동안 연결이 끊겼을 수 있다.
+		if (true == pConnection->mIsConnected && pConnection->GetHandle() == handle)
+		{
+			func(pConnection);
+			isFound = true;
+		}
+
+		return isFound;
+	}
+
+	Connection* pPrevConnection = pConnection->BeginSharedAccess();
+
+	{
+		SharedMonitor::SharedOwner lock{ pConnection->mConnectionSyncObj };
+
+		// lock을 기다리는 동안 연결이 끊겼을 수 있다.
+		if (true == pConnection->mIsConnected && pConnection->GetHandle() == handle)
+		{
+			func(pConnection);
+			isFound = true;
+		}
+	}
+
+	// func 안에서 미룬 CloseConnection()은 lock을 푼 여기서 끊는다.
+	pConnection->EndSharedAccess(pPrevConnection, handle, isFound);
+
+	return isFound;
+}
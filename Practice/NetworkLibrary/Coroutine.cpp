@@ -0,0 +1,430 @@
+﻿#include <exception>
+
+#include "Log.h"
+#include "Coroutine.h"
+
+IMPLEMENT_SINGLETON(CoroutineFramePool);
+
+// Sleep()의 timer가 만료되면 기다리던 coroutine을 재개한다.
+// param에 coroutine handle의 주소가 들어있다.
+class SleepTimerListener : public TimerListener
+{
+public:
+	void OnTimer(Connection*, int, LONG64 param) override
+	{
+		CoTask::Resume(CoTask::Handle::from_address(reinterpret_cast<void*>(param)));
+	}
+};
+
+static SleepTimerListener sSleepTimerListener;
+
+void CoroutineFramePool::Initialize()
+{
+	for (FrameClass& frameClass : mFrameClasses)
+	{
+		frameClass.mFreeHead = nullptr;
+	}
+
+	mUsedFrameCnt = 0;
+	mFreeFrameCnt = 0;
+}
+
+void CoroutineFramePool::Finalize()
+{
+	for (FrameClass& frameClass : mFrameClasses)
+	{
+		for (char* pChunk : frameClass.mChunks)
+		{
+			delete[] pChunk;
+		}
+
+		frameClass.mChunks.clear();
+		frameClass.mFreeHead = nullptr;
+	}
+}
+
+void* CoroutineFramePool::Alloc(size_t size)
+{
+	InterlockedIncrement64(&mUsedFrameCnt);
+
+	int frameClassIndex = GetFrameClass(size);
+	if (-1 == frameClassIndex)
+	{
+		return ::operator new(size);
+	}
+
+	FrameClass& frameClass = mFrameClasses[frameClassIndex];
+	Monitor::Owner lock{ frameClass.mSyncObject };
+
+	if (nullptr == frameClass.mFreeHead)
+	{
+		Grow(frameClassIndex);
+	}
+
+	FreeFrame* pFrame = frameClass.mFreeHead;
+	frameClass.mFreeHead = pFrame->mNext;
+
+	InterlockedDecrement64(&mFreeFrameCnt);
+	return pFrame;
+}
+
+void CoroutineFramePool::Free(void* pFrame, size_t size)
+{
+	InterlockedDecrement64(&mUsedFrameCnt);
+
+	int frameClassIndex = GetFrameClass(size);
+	if (-1 == frameClassIndex)
+	{
+		::operator delete(pFrame);
+		return;
+	}
+
+	FrameClass& frameClass = mFrameClasses[frameClassIndex];
+	Monitor::Owner lock{ frameClass.mSyncObject };
+
+	FreeFrame* pFreeFrame = static_cast<FreeFrame*>(pFrame);
+	pFreeFrame->mNext = frameClass.mFreeHead;
+	frameClass.mFreeHead = pFreeFrame;
+
+	InterlockedIncrement64(&mFreeFrameCnt);
+}
+
+LONG64 CoroutineFramePool::GetUsedFrameCount()
+{
+	return mUsedFrameCnt;
+}
+
+LONG64 CoroutineFramePool::GetFreeFrameCount()
+{
+	return mFreeFrameCnt;
+}
+
+int CoroutineFramePool::GetFrameClass(size_t size)
+{
+	size_t frameSize = COROUTINE_FRAME_MIN_SIZE;
+	for (int i = 0; i < COROUTINE_FRAME_CLASS_CNT; ++i)
+	{
+		if (size <= frameSize)
+		{
+			return i;
+		}
+
+		frameSize *= 2;
+	}
+
+	return -1;
+}
+
+void CoroutineFramePool::Grow(int frameClassIndex)
+{
+	FrameClass& frameClass = mFrameClasses[frameClassIndex];
+	size_t frameSize = static_cast<size_t>(COROUTINE_FRAME_MIN_SIZE) << frameClassIndex;
+
+	// new[]로 할당한 메모리는 기본 정렬(16byte)을 지키고 frame 크기도 16의 배수라서
+	// chunk 안의 frame도 모두 정렬되어 있다.
+	char* pChunk = new char[frameSize * COROUTINE_FRAMES_PER_CHUNK];
+	frameClass.mChunks.push_back(pChunk);
+
+	for (int i = 0; i < COROUTINE_FRAMES_PER_CHUNK; ++i)
+	{
+		FreeFrame* pFrame = reinterpret_cast<FreeFrame*>(pChunk + frameSize * i);
+		pFrame->mNext = frameClass.mFreeHead;
+		frameClass.mFreeHead = pFrame;
+	}
+
+	InterlockedAdd64(&mFreeFrameCnt, COROUTINE_FRAMES_PER_CHUNK);
+}
+
+CoResumeTask::CoResumeTask()
+	: mHandle{}
+{
+}
+
+void CoResumeTask::Execute()
+{
+	// coroutine이 끝나면 이 작업이 들어있는 frame까지 해제되니 resume() 뒤에 멤버를 건드리지 않는다.
+	mHandle.resume();
+}
+
+bool CoTask::FinalAwaiter::await_ready() noexcept
+{
+	return false;
+}
+
+std::coroutine_handle<> CoTask::FinalAwaiter::await_suspend(Handle handle) noexcept
+{
+	promise_type& promise = handle.promise();
+
+	if (promise.mIsDetached)
+	{
+		handle.destroy();
+		return std::noop_coroutine();
+	}
+
+	// 부모가 있다면 같은 thread에서 바로 이어서 실행한다(symmetric transfer).
+	if (promise.mContinuation)
+	{
+		return promise.mContinuation;
+	}
+
+	return std::noop_coroutine();
+}
+
+void CoTask::FinalAwaiter::await_resume() noexcept
+{
+}
+
+CoTask::promise_type::promise_type()
+	: mStrand{ nullptr }
+	, mConnectionHandle{ INVALID_CONNECTION_HANDLE }
+	, mResumeTask{}
+	, mContinuation{}
+	, mIsDetached{ false }
+{
+}
+
+CoTask CoTask::promise_type::get_return_object()
+{
+	return CoTask{ Handle::from_promise(*this) };
+}
+
+std::suspend_always CoTask::promise_type::initial_suspend() noexcept
+{
+	// Start()하거나 부모가 co_await할 때 실행을 시작한다.
+	return {};
+}
+
+CoTask::FinalAwaiter CoTask::promise_type::final_suspend() noexcept
+{
+	return {};
+}
+
+void CoTask::promise_type::return_void()
+{
+}
+
+void CoTask::promise_type::unhandled_exception()
+{
+	// 예외를 넘겨받을 곳이 없고 strand 작업 중간에 멈춘 coroutine을 되살릴 방법도 없다.
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | CoTask::promise_type::unhandled_exception() | unhandled exception in coroutine");
+
+	std::terminate();
+}
+
+void* CoTask::promise_type::operator new(size_t size)
+{
+	return CoroutineFramePool::GetInstance()->Alloc(size);
+}
+
+void CoTask::promise_type::operator delete(void* pFrame, size_t size)
+{
+	CoroutineFramePool::GetInstance()->Free(pFrame, size);
+}
+
+bool CoTask::Awaiter::await_ready()
+{
+	return !mHandle || mHandle.done();
+}
+
+std::coroutine_handle<> CoTask::Awaiter::await_suspend(Handle parent)
+{
+	promise_type& promise = mHandle.promise();
+	promise.mStrand = parent.promise().mStrand;
+	promise.mConnectionHandle = parent.promise().mConnectionHandle;
+	promise.mContinuation = parent;
+
+	// 부모는 멈추고 자식을 바로 실행한다.
+	return mHandle;
+}
+
+void CoTask::Awaiter::await_resume()
+{
+}
+
+CoTask::CoTask()
+	: mHandle{}
+{
+}
+
+CoTask::CoTask(Handle handle)
+	: mHandle{ handle }
+{
+}
+
+CoTask::CoTask(CoTask&& rhs) noexcept
+	: mHandle{ rhs.mHandle }
+{
+	rhs.mHandle = {};
+}
+
+CoTask::~CoTask()
+{
+	if (mHandle)
+	{
+		mHandle.destroy();
+	}
+}
+
+CoTask& CoTask::operator=(CoTask&& rhs) noexcept
+{
+	if (this != &rhs)
+	{
+		if (mHandle)
+		{
+			mHandle.destroy();
+		}
+
+		mHandle = rhs.mHandle;
+		rhs.mHandle = {};
+	}
+
+	return *this;
+}
+
+bool CoTask::Start(Strand* pStrand, ConnectionHandle connectionHandle)
+{
+	if (!mHandle)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | CoTask::Start() | coroutine is empty");
+
+		return false;
+	}
+
+	if (nullptr == pStrand)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | CoTask::Start() | strand is nullptr");
+
+		return false;
+	}
+
+	promise_type& promise = mHandle.promise();
+	promise.mStrand = pStrand;
+	promise.mConnectionHandle = connectionHandle;
+	promise.mIsDetached = true;
+
+	Handle handle = mHandle;
+	mHandle = {};
+
+	Resume(handle);
+	return true;
+}
+
+bool CoTask::Start(Connection* pConnection)
+{
+	return Start(pConnection->GetStrand(), pConnection->GetHandle());
+}
+
+CoTask::Awaiter CoTask::operator co_await() &&
+{
+	return Awaiter{ mHandle };
+}
+
+bool CoTask::IsDone()
+{
+	return !mHandle || mHandle.done();
+}
+
+void CoTask::Resume(Handle handle)
+{
+	// 재개는 항상 strand에 넣는다.
+	// 재개를 요청하는 thread는 IO 완료 통지나 timer를 처리하는 worker thread라서
+	// 여기서 바로 실행하면 같은 strand의 다른 작업과 동시에 실행될 수 있다.
+	promise_type& promise = handle.promise();
+	promise.mResumeTask.mHandle = handle;
+	promise.mStrand->Post(&promise.mResumeTask);
+}
+
+ReadPacketAwaiter::ReadPacketAwaiter(Connection* pConnection)
+	: mConnection{ pConnection }
+	, mPacket{ nullptr, 0 }
+{
+}
+
+bool ReadPacketAwaiter::await_ready()
+{
+	// coroutine이 어느 client를 대상으로 하는지 promise에서 알아야 해서
+	// 받아둔 패킷이 있는지는 await_suspend()에서 확인한다.
+	return false;
+}
+
+bool ReadPacketAwaiter::await_suspend(CoTask::Handle handle)
+{
+	ConnectionHandle connectionHandle = handle.promise().mConnectionHandle;
+	if (INVALID_CONNECTION_HANDLE == connectionHandle)
+	{
+		connectionHandle = mConnection->GetHandle();
+		handle.promise().mConnectionHandle = connectionHandle;
+	}
+
+	// 패킷이 있거나 연결이 끊겼다면 멈추지 않고 이어서 실행한다.
+	return false == mConnection->PopCoroutinePacket(connectionHandle, handle, &mPacket.mData, &mPacket.mSize);
+}
+
+CoPacket ReadPacketAwaiter::await_resume()
+{
+	return mPacket;
+}
+
+FlushAwaiter::FlushAwaiter(Connection* pConnection)
+	: mConnection{ pConnection }
+	, mIsFlushed{ false }
+{
+}
+
+bool FlushAwaiter::await_ready()
+{
+	return false;
+}
+
+bool FlushAwaiter::await_suspend(CoTask::Handle handle)
+{
+	ConnectionHandle connectionHandle = handle.promise().mConnectionHandle;
+	if (INVALID_CONNECTION_HANDLE == connectionHandle)
+	{
+		connectionHandle = mConnection->GetHandle();
+		handle.promise().mConnectionHandle = connectionHandle;
+	}
+
+	return false == mConnection->WaitFlush(connectionHandle, handle, &mIsFlushed);
+}
+
+bool FlushAwaiter::await_resume()
+{
+	return mIsFlushed;
+}
+
+SleepAwaiter::SleepAwaiter(TimingWheel* pTimingWheel, DWORD delayMsec)
+	: mTimingWheel{ pTimingWheel }
+	, mDelayMsec{ delayMsec }
+	, mIsSlept{ true }
+{
+}
+
+bool SleepAwaiter::await_ready()
+{
+	return 0 == mDelayMsec;
+}
+
+bool SleepAwaiter::await_suspend(CoTask::Handle handle)
+{
+	// timer가 await_suspend()를 반환하기 전에 만료되어도
+	// 재개는 지금 실행중인 strand에 들어가서 이 작업이 끝난 뒤에 실행된다.
+	TimerHandle timerHandle = mTimingWheel->AddTimer(mDelayMsec, &sSleepTimerListener, 0,
+		reinterpret_cast<LONG64>(handle.address()));
+
+	if (INVALID_TIMER_HANDLE == timerHandle)
+	{
+		mIsSlept = false;
+		return false;
+	}
+
+	return true;
+}
+
+bool SleepAwaiter::await_resume()
+{
+	return mIsSlept;
+}
@@ -0,0 +1,261 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// Connection IO와 timer를 co_await로 기다리는 C++20 coroutine
+//
+// 지금까지 client 처리는 OnRecv()가 불릴 때마다 상태를 보고 다음 단계로 넘어가는 상태 기계였다.
+// 로그인 -> 캐릭터 선택 -> 입장처럼 여러 패킷을 주고받는 흐름은 상태와 중간 값을 Connection 밖에 따로 들고 있어야 했다.
+// coroutine을 사용하면 그 흐름을 함수 하나에 순서대로 적을 수 있다.
+//
+//	CoTask Session(Connection* pConnection)
+//	{
+//		CoPacket packet = co_await pConnection->ReadPacket();
+//		...
+//		co_await pConnection->Flush();
+//		co_await pTimingWheel->Sleep(1000);
+//	}
+//
+//	Session(pConnection).Start(pConnection);
+//
+// 기다리는 동안 coroutine은 thread를 잡지 않고 frame만 남는다.
+// frame은 CoroutineFramePool에서 크기별로 빌려오고 다 사용하면 돌려주기 때문에
+// 기다리는 session 하나는 thread 하나나 heap 할당 여러 개가 아니라 frame 하나(수백 byte)를 차지한다.
+//
+// coroutine은 항상 Start()에 넘긴 Strand에서 실행된다.
+// 패킷이 오거나, 송신이 끝나거나, timer가 만료되면 worker thread가 바로 이어서 실행하지 않고
+// strand에 재개 작업을 넣기 때문에 같은 strand의 다른 작업과 동시에 실행되지 않는다.
+// co_await로 부른 자식 CoTask는 부모의 strand와 connection을 그대로 이어받는다.
+//
+// ReadPacket()을 사용하려면 InitConfig::mUseCoroutine을 켜야 한다.
+// 켜면 수신한 패킷을 OnRecv()로 넘기지 않고 connection의 수신 대기 공간에 모아둔다.
+//
+// CoTask는 반환값이 없는 coroutine만 지원한다.
+// 결과가 필요하면 인자로 넘긴 변수에 담아서 돌려준다.
+
+#include <coroutine>
+#include <vector>
+
+#include "Platform.h"
+#include "Monitor.h"
+#include "Singleton.h"
+#include "Strand.h"
+#include "Connection.h"
+#include "TimingWheel.h"
+
+// frame 크기 구간: 128, 256, 512, 1024, 2048byte
+// 그보다 큰 frame은 pool을 사용하지 않고 바로 할당한다.
+constexpr int COROUTINE_FRAME_MIN_SIZE{ 128 };
+constexpr int COROUTINE_FRAME_CLASS_CNT{ 5 };
+
+// frame이 모자랄 때 한 번에 할당하는 frame 수
+constexpr int COROUTINE_FRAMES_PER_CHUNK{ 64 };
+
+// coroutine frame을 크기 구간별로 재사용하는 pool
+// SlabPool처럼 한 번 할당한 frame은 프로세스가 끝날 때까지 해제하지 않는다.
+class NETLIB_API CoroutineFramePool : public Singleton
+{
+	DECLEAR_SINGLETON(CoroutineFramePool);
+
+public:
+	// size byte 이상인 frame을 빌려온다.
+	void* Alloc(size_t size);
+
+	// Alloc()할 때와 같은 size를 넘겨서 돌려준다.
+	void Free(void* pFrame, size_t size);
+
+public:
+	// 지금 사용중인 frame 수와 pool에 쉬고 있는 frame 수
+	LONG64 GetUsedFrameCount();
+	LONG64 GetFreeFrameCount();
+
+private:
+	// size가 들어갈 크기 구간(pool을 사용하지 않으면 -1)
+	int GetFrameClass(size_t size);
+
+	// 크기 구간에 frame 묶음(chunk)을 하나 더 할당한다.
+	void Grow(int frameClass);
+
+private:
+	struct FreeFrame
+	{
+		FreeFrame* mNext;
+	};
+
+	struct FrameClass
+	{
+		FreeFrame* mFreeHead;
+		std::vector<char*> mChunks;
+		Monitor mSyncObject;
+	};
+
+	FrameClass mFrameClasses[COROUTINE_FRAME_CLASS_CNT];
+
+	LONG64 mUsedFrameCnt;
+	LONG64 mFreeFrameCnt;
+
+private:
+	CoroutineFramePool(const CoroutineFramePool& rhs) = delete;
+	CoroutineFramePool(CoroutineFramePool&& rhs) = delete;
+
+	CoroutineFramePool& operator=(const CoroutineFramePool& rhs) = delete;
+	CoroutineFramePool& operator=(CoroutineFramePool&& rhs) = delete;
+};
+
+// 기다리던 coroutine을 strand에서 재개하는 작업
+// promise 안에 하나씩 들어있고 coroutine은 한 번에 한 곳에서만 기다리기 때문에 재사용한다.
+class NETLIB_API CoResumeTask : public StrandTask
+{
+public:
+	CoResumeTask();
+
+	void Execute() override;
+
+public:
+	std::coroutine_handle<> mHandle;
+};
+
+class NETLIB_API CoTask
+{
+public:
+	struct promise_type;
+	using Handle = std::coroutine_handle<promise_type>;
+
+	// coroutine이 끝났을 때
+	// 기다리던 부모가 있다면 부모로 넘어가고, Start()한 coroutine이라면 frame을 해제한다.
+	struct FinalAwaiter
+	{
+		bool await_ready() noexcept;
+		std::coroutine_handle<> await_suspend(Handle handle) noexcept;
+		void await_resume() noexcept;
+	};
+
+	struct promise_type
+	{
+		promise_type();
+
+		CoTask get_return_object();
+		std::suspend_always initial_suspend() noexcept;
+		FinalAwaiter final_suspend() noexcept;
+		void return_void();
+		void unhandled_exception();
+
+		// frame을 CoroutineFramePool에서 빌려온다.
+		static void* operator new(size_t size);
+		static void operator delete(void* pFrame, size_t size);
+
+		// 실행할 strand와 대상 client(Start()나 부모에게 받는다.)
+		Strand* mStrand;
+		ConnectionHandle mConnectionHandle;
+
+		CoResumeTask mResumeTask;
+
+		// co_await로 기다리고 있는 부모
+		std::coroutine_handle<> mContinuation;
+
+		// Start()로 실행해서 소유자가 없는지(끝나면 스스로 frame을 해제한다.)
+		bool mIsDetached;
+	};
+
+	// 부모 coroutine이 co_await로 자식 CoTask를 기다릴 때 사용
+	struct Awaiter
+	{
+		bool await_ready();
+		std::coroutine_handle<> await_suspend(Handle parent);
+		void await_resume();
+
+		Handle mHandle;
+	};
+
+public:
+	CoTask();
+	explicit CoTask(Handle handle);
+	CoTask(CoTask&& rhs) noexcept;
+	~CoTask();
+
+	CoTask& operator=(CoTask&& rhs) noexcept;
+
+public:
+	// coroutine을 pStrand에서 실행하기 시작하고 소유권을 넘긴다.
+	// 반환 뒤로 CoTask는 비어있고 coroutine은 끝날 때 스스로 frame을 해제한다.
+	bool Start(Strand* pStrand, ConnectionHandle connectionHandle = INVALID_CONNECTION_HANDLE);
+
+	// pConnection의 strand에서 지금 client를 대상으로 실행한다.
+	// ReadPacket(), Flush()는 다른 client가 Connection을 재사용하면 끊긴 것으로 처리한다.
+	bool Start(Connection* pConnection);
+
+	Awaiter operator co_await() &&;
+
+	// 실행한 적이 없거나 이미 끝났는지
+	bool IsDone();
+
+	// 기다리던 coroutine을 strand에서 재개한다.
+	static void Resume(Handle handle);
+
+public:
+	CoTask(const CoTask& rhs) = delete;
+	CoTask& operator=(const CoTask& rhs) = delete;
+
+private:
+	Handle mHandle;
+};
+
+// ReadPacket()이 돌려주는 패킷
+// mData는 패킷 크기(4byte)부터 시작하고 다음 ReadPacket()을 호출할 때까지 유효하다.
+// 연결이 끊겼다면 mSize가 0이다.
+struct CoPacket
+{
+	char* mData;
+	DWORD mSize;
+};
+
+// co_await pConnection->ReadPacket()
+class NETLIB_API ReadPacketAwaiter
+{
+public:
+	explicit ReadPacketAwaiter(Connection* pConnection);
+
+	bool await_ready();
+
+	// 이미 받은 패킷이 있거나 연결이 끊겼다면 기다리지 않는다.
+	bool await_suspend(CoTask::Handle handle);
+	CoPacket await_resume();
+
+private:
+	Connection* mConnection;
+	CoPacket mPacket;
+};
+
+// co_await pConnection->Flush()
+// 지금까지 넣은 송신 데이터를 모두 송신할 때까지 기다린다.
+// 연결이 끊겼다면 false
+class NETLIB_API FlushAwaiter
+{
+public:
+	explicit FlushAwaiter(Connection* pConnection);
+
+	bool await_ready();
+	bool await_suspend(CoTask::Handle handle);
+	bool await_resume();
+
+private:
+	Connection* mConnection;
+	bool mIsFlushed;
+};
+
+// co_await pTimingWheel->Sleep(msec)
+// timer를 걸지 못했다면 기다리지 않고 false
+class NETLIB_API SleepAwaiter
+{
+public:
+	SleepAwaiter(TimingWheel* pTimingWheel, DWORD delayMsec);
+
+	bool await_ready();
+	bool await_suspend(CoTask::Handle handle);
+	bool await_resume();
+
+private:
+	TimingWheel* mTimingWheel;
+	DWORD mDelayMsec;
+	bool mIsSlept;
+};
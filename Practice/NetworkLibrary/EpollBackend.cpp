@@ -0,0 +1,858 @@
+﻿#ifndef _WIN32
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/errqueue.h>
+
+#include "Log.h"
+#include "Connection.h"
+#include "EpollBackend.h"
+
+// ready queue에 들어갈 수 있는 완료 통지는
+// connection마다 accept(recv와 같은 overlapped를 사용), recv, send, zero-copy 완료 알림, strand 실행 요청 최대 4개와
+// connection에 속하지 않은 strand(zone 등), worker thread 종료 요청 정도라서 넉넉하게 잡아둔다.
+constexpr int READY_QUEUE_SIZE_PER_CONNECTION{ 5 };
+constexpr int READY_QUEUE_EXTRA_SIZE{ 1024 };
+
+EpollBackend::EpollBackend()
+	: mEpoll{ -1 }
+	, mEventFd{ -1 }
+	, mMaxConnectionCnt{ 0 }
+	, mContexts{ nullptr }
+	, mListenContext{}
+	, mPendingAccepts{ nullptr }
+	, mReadyQueue{ nullptr }
+{
+}
+
+EpollBackend::~EpollBackend()
+{
+	Destroy();
+}
+
+bool EpollBackend::Create(int maxConnectionCnt)
+{
+	mEpoll = epoll_create1(EPOLL_CLOEXEC);
+	if (-1 == mEpoll)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::Create() | epoll_create1() failed: %d",
+			errno);
+
+		return false;
+	}
+
+	mEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (-1 == mEventFd)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::Create() | eventfd() failed: %d",
+			errno);
+
+		return false;
+	}
+
+	// eventfd는 data.ptr을 nullptr로 등록해서 socket과 구분한다.
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLET;
+	event.data.ptr = nullptr;
+
+	if (-1 == epoll_ctl(mEpoll, EPOLL_CTL_ADD, mEventFd, &event))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::Create() | epoll_ctl(eventfd) failed: %d",
+			errno);
+
+		return false;
+	}
+
+	mMaxConnectionCnt = maxConnectionCnt;
+	mContexts = new EpollContext[mMaxConnectionCnt]{};
+
+	mPendingAccepts = new Queue<OVERLAPPED_EX*>{ mMaxConnectionCnt };
+	mReadyQueue = new MPMCQueue<IOCompletion>{
+		mMaxConnectionCnt * READY_QUEUE_SIZE_PER_CONNECTION + READY_QUEUE_EXTRA_SIZE };
+
+	return true;
+}
+
+void EpollBackend::Destroy()
+{
+	if (-1 != mEpoll)
+	{
+		close(mEpoll);
+		mEpoll = -1;
+	}
+
+	if (-1 != mEventFd)
+	{
+		close(mEventFd);
+		mEventFd = -1;
+	}
+
+	delete[] mContexts;
+	mContexts = nullptr;
+
+	delete mPendingAccepts;
+	mPendingAccepts = nullptr;
+
+	delete mReadyQueue;
+	mReadyQueue = nullptr;
+}
+
+bool EpollBackend::BindListenSocket(SOCKET listenSocket)
+{
+	// accept()가 접속 요청이 없을 때 blocking 되지 않도록
+	fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL, 0) | O_NONBLOCK);
+
+	mListenContext.mSocket = listenSocket;
+	mListenContext.mIsListen = true;
+
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLET;
+	event.data.ptr = &mListenContext;
+
+	if (-1 == epoll_ctl(mEpoll, EPOLL_CTL_ADD, listenSocket, &event))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::BindListenSocket() | epoll_ctl() failed: %d",
+			errno);
+
+		return false;
+	}
+
+	return true;
+}
+
+bool EpollBackend::BindSocket(Connection* pConnection)
+{
+	EpollContext* pContext = GetContext(pConnection);
+	if (nullptr == pContext)
+	{
+		return false;
+	}
+
+	// connection pool의 객체를 재사용하는 것처럼
+	// context도 새로운 client socket으로 다시 세팅해서 사용한다.
+	pContext->mSocket = pConnection->GetSocket();
+	pContext->mIsListen = false;
+	pContext->mPendingRecv.store(nullptr);
+	pContext->mPendingSend.store(nullptr);
+	pContext->mIsReadable.store(false);
+	pContext->mIsWritable.store(false);
+	ResetZeroCopy(*pContext);
+
+	// 읽기, 쓰기 통지를 처음부터 함께 등록해두면
+	// 송수신 중에 epoll_ctl(MOD)를 호출할 필요가 없다.
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.ptr = pContext;
+
+	int ret = epoll_ctl(mEpoll, EPOLL_CTL_ADD, pContext->mSocket, &event);
+	CountSyscall();
+
+	if (-1 == ret)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::BindSocket() | socket[%d] epoll_ctl() failed: %d",
+			pConnection->GetSocket(), errno);
+
+		return false;
+	}
+
+	return true;
+}
+
+bool EpollBackend::Accept(SOCKET, OVERLAPPED_EX* pOverlappedEx)
+{
+	{
+		Monitor::Owner lock{ mAcceptSyncObject };
+
+		if (false == mPendingAccepts->Push(pOverlappedEx))
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | EpollBackend::Accept() | pending accept queue is full");
+
+			return false;
+		}
+	}
+
+	// 이미 backlog에 접속 요청이 쌓여있을 수 있으니 바로 시도해본다.
+	IOCompletion completion{};
+	while (TryAccept(completion))
+	{
+		PushReady(completion);
+	}
+
+	return true;
+}
+
+bool EpollBackend::Recv(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx)
+{
+	EpollContext* pContext = GetContext(pConnection);
+	if (nullptr == pContext)
+	{
+		return false;
+	}
+
+	pContext->mPendingRecv.store(pOverlappedEx);
+
+	// 대부분의 경우 socket 수신 버퍼에 이미 데이터가 있거나
+	// 앞서 받은 준비 통지가 기억되어 있기 때문에 바로 시도해본다.
+	IOCompletion completion{};
+	if (TryRecv(*pContext, completion))
+	{
+		PushReady(completion);
+	}
+
+	return true;
+}
+
+bool EpollBackend::Send(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx)
+{
+	EpollContext* pContext = GetContext(pConnection);
+	if (nullptr == pContext)
+	{
+		return false;
+	}
+
+	pContext->mPendingSend.store(pOverlappedEx);
+
+	// socket 송신 버퍼는 대부분 비어있기 때문에 바로 시도해본다.
+	IOCompletion completion{};
+	if (TrySend(*pContext, completion))
+	{
+		PushReady(completion);
+	}
+
+	return true;
+}
+
+void EpollBackend::GetRemoteAddress(OVERLAPPED_EX* pOverlappedEx, char* pIP, int ipLength)
+{
+	// TryAccept()에서 mWSABuf.buf(mAddressBuf)에 client 주소를 저장해두었다.
+	SOCKADDR_IN* pRemoteAddr = reinterpret_cast<SOCKADDR_IN*>(pOverlappedEx->mWSABuf.buf);
+
+	inet_ntop(AF_INET,
+		&pRemoteAddr->sin_addr,
+		pIP,
+		ipLength);
+}
+
+void EpollBackend::CloseSocket(Connection* pConnection)
+{
+	EpollContext* pContext = GetContext(pConnection);
+	if (nullptr == pContext)
+	{
+		return;
+	}
+
+	// close()한 fd 번호는 kernel이 바로 새 client socket에 다시 줄 수 있기 때문에
+	// 닫기 전에 먼저 context에서 socket을 떼어내서
+	// 이후에 다른 thread가 recv(), send()를 시도하면 실패하도록 한다.
+	SOCKET socket = pContext->mSocket.exchange(INVALID_SOCKET);
+
+	// BindSocket() 전에 닫는 경우에는 context에 socket이 없다.
+	if (INVALID_SOCKET == socket)
+	{
+		socket = pConnection->GetSocket();
+	}
+
+	// IOCP처럼 대기중이던 작업을 실패로 완료시킨다.
+	// 이래야 Connection의 IO 작업 횟수가 0이 될 수 있다.
+	OVERLAPPED_EX* pPendingRecv = pContext->mPendingRecv.exchange(nullptr);
+	OVERLAPPED_EX* pPendingSend = pContext->mPendingSend.exchange(nullptr);
+
+	// 떼어내기 전에 socket을 가져간 thread가 recv(), send()를 끝낼 때까지 기다린다.
+	// system call 하나가 끝나는 시간이라서 짧다.
+	while (0 != pContext->mSocketUseCnt.load())
+	{
+		YieldProcessor();
+	}
+
+	if (INVALID_SOCKET != socket)
+	{
+		// close()만 해도 epoll에서 빠지지만
+		// 다른 thread가 socket을 dup하고 있을 수도 있어서 명시적으로 제거
+		epoll_ctl(mEpoll, EPOLL_CTL_DEL, socket, nullptr);
+		close(socket);
+		CountSyscall();
+		CountSyscall();
+	}
+
+	// socket을 닫으면 error queue에 남은 완료 알림도 사라지기 때문에
+	// 다음 client의 send ring buffer를 잘못 해제하지 않도록 비워둔다.
+	ResetZeroCopy(*pContext);
+
+	if (nullptr != pPendingRecv)
+	{
+		PushReady(IOCompletion{ pPendingRecv, 0, false });
+	}
+
+	if (nullptr != pPendingSend)
+	{
+		PushReady(IOCompletion{ pPendingSend, 0, false });
+	}
+}
+
+int EpollBackend::GetCompletions(IOCompletion* pCompletions, int maxCount, DWORD timeout)
+{
+	if (MAX_COMPLETION_BATCH < maxCount)
+	{
+		maxCount = MAX_COMPLETION_BATCH;
+	}
+
+	// 먼저 쌓여있는 완료 통지를 꺼낸다.
+	int completionCnt = PopReady(pCompletions, maxCount);
+	if (maxCount == completionCnt)
+	{
+		return completionCnt;
+	}
+
+	// 이미 꺼낸 완료 통지가 있다면 대기하지 않고
+	// 지금 준비된 socket만 확인한다.
+	int waitTimeout{ 0 };
+	if (0 == completionCnt)
+	{
+		waitTimeout = INFINITE == timeout ? -1 : static_cast<int>(timeout);
+	}
+
+	epoll_event events[MAX_COMPLETION_BATCH];
+	int eventCnt = epoll_wait(mEpoll, events, maxCount - completionCnt, waitTimeout);
+	CountSyscall();
+
+	if (-1 == eventCnt)
+	{
+		if (EINTR != errno)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | EpollBackend::GetCompletions() | epoll_wait() failed: %d",
+				errno);
+		}
+
+		return completionCnt;
+	}
+
+	// 한 번의 준비 통지로 완료 통지가 여러 개 생길 수 있는데(recv + send, 여러 accept)
+	// pCompletions에 자리가 없으면 ready queue로 넘긴다.
+	auto addCompletion = [&](const IOCompletion& completion)
+		{
+			if (maxCount > completionCnt)
+			{
+				pCompletions[completionCnt++] = completion;
+				return;
+			}
+
+			PushReady(completion);
+		};
+
+	for (int i = 0; i < eventCnt; ++i)
+	{
+		epoll_event& event = events[i];
+
+		// eventfd로 깨어났다면
+		// 다른 thread가 ready queue에 넣은 완료 통지를 아래에서 꺼낸다.
+		if (nullptr == event.data.ptr)
+		{
+			uint64_t value{ 0 };
+			read(mEventFd, &value, sizeof(value));
+			CountSyscall();
+			continue;
+		}
+
+		EpollContext* pContext = reinterpret_cast<EpollContext*>(event.data.ptr);
+		IOCompletion completion{};
+
+		if (pContext->mIsListen)
+		{
+			pContext->mIsReadable.store(true);
+
+			while (TryAccept(completion))
+			{
+				addCompletion(completion);
+			}
+
+			continue;
+		}
+
+		// zero-copy 완료 알림은 error queue로 오기 때문에 EPOLLERR로 통지된다.
+		if (event.events & EPOLLERR)
+		{
+			if (TryZeroCopyNotify(*pContext, completion))
+			{
+				addCompletion(completion);
+			}
+		}
+
+		// 연결이 끊기거나(HUP) 에러가 발생하면
+		// recv(), send()가 0 또는 에러를 반환하기 때문에 양쪽 모두 시도한다.
+		if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+		{
+			pContext->mIsReadable.store(true);
+
+			if (TryRecv(*pContext, completion))
+			{
+				addCompletion(completion);
+			}
+		}
+
+		if (event.events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+		{
+			pContext->mIsWritable.store(true);
+
+			if (TrySend(*pContext, completion))
+			{
+				addCompletion(completion);
+			}
+		}
+	}
+
+	if (maxCount > completionCnt)
+	{
+		completionCnt += PopReady(pCompletions + completionCnt, maxCount - completionCnt);
+	}
+
+	return completionCnt;
+}
+
+bool EpollBackend::PostQuit()
+{
+	PushReady(IOCompletion{ nullptr, 0, true });
+
+	// 종료 요청은 worker thread가 다른 worker thread 몫을 다시 넣어주는 경우도 있어서
+	// 누가 넣든 항상 깨운다.
+	WakeUp();
+
+	return true;
+}
+
+bool EpollBackend::PostCompletion(OVERLAPPED_EX* pOverlappedEx)
+{
+	if (false == mReadyQueue->TryPush(IOCompletion{ pOverlappedEx, 0, true }))
+	{
+		return false;
+	}
+
+	// worker thread가 넣었더라도 그 thread는 하던 일을 마저 처리해야 하니
+	// 쉬고 있는 다른 worker thread가 가져가도록 깨운다.
+	WakeUp();
+
+	return true;
+}
+
+bool EpollBackend::IsZeroCopySendSupported()
+{
+	return true;
+}
+
+bool EpollBackend::TryAccept(IOCompletion& completion)
+{
+	while (true)
+	{
+		OVERLAPPED_EX* pOverlappedEx{ nullptr };
+
+		{
+			Monitor::Owner lock{ mAcceptSyncObject };
+
+			if (mPendingAccepts->IsEmpty())
+			{
+				return false;
+			}
+
+			pOverlappedEx = mPendingAccepts->Front();
+			mPendingAccepts->Pop();
+		}
+
+		// accept()를 호출하기 전에 지워야
+		// 호출하는 동안 들어온 통지를 놓치지 않는다.
+		mListenContext.mIsReadable.store(false);
+
+		SOCKADDR_IN clientAddr{};
+		socklen_t addrLength = sizeof(clientAddr);
+
+		SOCKET clientSocket = accept4(mListenContext.mSocket,
+			reinterpret_cast<SOCKADDR*>(&clientAddr),
+			&addrLength,
+			SOCK_NONBLOCK | SOCK_CLOEXEC);
+		CountSyscall();
+
+		if (INVALID_SOCKET != clientSocket)
+		{
+			// AcceptEx()처럼 mAddressBuf에 client 주소를 저장해두고
+			// Connection에 client socket을 세팅한다.
+			CopyMemory(pOverlappedEx->mWSABuf.buf, &clientAddr, sizeof(clientAddr));
+			reinterpret_cast<Connection*>(pOverlappedEx->mConnection)->SetSocket(clientSocket);
+
+			completion = IOCompletion{ pOverlappedEx, 0, true };
+			return true;
+		}
+
+		int error = errno;
+
+		{
+			Monitor::Owner lock{ mAcceptSyncObject };
+			mPendingAccepts->Push(pOverlappedEx);
+		}
+
+		// 접속 요청을 보낸 client가 그 사이에 포기했다면, 다음 요청을 받는다.
+		if (EINTR == error || ECONNABORTED == error)
+		{
+			continue;
+		}
+
+		if (EAGAIN == error || EWOULDBLOCK == error)
+		{
+			// accept() 호출 중에 새로운 통지가 왔다면 다시 시도
+			if (mListenContext.mIsReadable.load())
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		// EMFILE 같은 자원 부족은 다음 통지 때 다시 시도
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::TryAccept() | accept4() failed: %d",
+			error);
+
+		return false;
+	}
+}
+
+bool EpollBackend::TryRecv(EpollContext& context, IOCompletion& completion)
+{
+	while (true)
+	{
+		// 작업을 먼저 가져와야 다른 thread와 같은 작업을 두 번 수행하지 않는다.
+		OVERLAPPED_EX* pOverlappedEx = context.mPendingRecv.exchange(nullptr);
+		if (nullptr == pOverlappedEx)
+		{
+			return false;
+		}
+
+		context.mIsReadable.store(false);
+
+		// 작업을 가져온 사이에 CloseSocket()이 socket을 떼어냈다면
+		// CloseSocket()은 이 작업을 보지 못했기 때문에 여기서 실패로 완료한다.
+		SOCKET socket = AcquireSocket(context);
+		if (INVALID_SOCKET == socket)
+		{
+			ReleaseSocket(context);
+
+			completion = IOCompletion{ pOverlappedEx, 0, false };
+			return true;
+		}
+
+		ssize_t ret = recv(socket,
+			pOverlappedEx->mWSABuf.buf,
+			pOverlappedEx->mWSABuf.len,
+			0);
+		CountSyscall();
+
+		ReleaseSocket(context);
+
+		if (0 <= ret)
+		{
+			// 0이면 client가 연결을 끊은 것이고
+			// Connection::OnIOCompleted()가 연결 종료를 처리한다.
+			completion = IOCompletion{ pOverlappedEx, static_cast<DWORD>(ret), true };
+			return true;
+		}
+
+		int error = errno;
+		if (EINTR == error)
+		{
+			context.mPendingRecv.store(pOverlappedEx);
+			continue;
+		}
+
+		if (EAGAIN == error || EWOULDBLOCK == error)
+		{
+			// 다시 대기시키고
+			// 그 사이에 준비 통지가 왔다면 다시 시도
+			context.mPendingRecv.store(pOverlappedEx);
+
+			if (context.mIsReadable.load())
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		completion = IOCompletion{ pOverlappedEx, 0, false };
+		return true;
+	}
+}
+
+bool EpollBackend::TrySend(EpollContext& context, IOCompletion& completion)
+{
+	while (true)
+	{
+		OVERLAPPED_EX* pOverlappedEx = context.mPendingSend.exchange(nullptr);
+		if (nullptr == pOverlappedEx)
+		{
+			return false;
+		}
+
+		context.mIsWritable.store(false);
+
+		// 버퍼 조각이 여러 개여도 sendmsg() 한 번으로 송신한다.
+		// WSABUF와 iovec은 멤버 순서가 달라서 옮겨 담는다.
+		iovec sendIov[MAX_SEND_BUF_CNT];
+		for (int i = 0; i < pOverlappedEx->mSendBufCnt; ++i)
+		{
+			sendIov[i].iov_base = pOverlappedEx->mSendBufs[i].buf;
+			sendIov[i].iov_len = pOverlappedEx->mSendBufs[i].len;
+		}
+
+		msghdr sendMsg{};
+		sendMsg.msg_iov = sendIov;
+		sendMsg.msg_iovlen = pOverlappedEx->mSendBufCnt;
+
+		SOCKET socket = AcquireSocket(context);
+		if (INVALID_SOCKET == socket)
+		{
+			ReleaseSocket(context);
+
+			completion = IOCompletion{ pOverlappedEx, 0, false };
+			return true;
+		}
+
+		ssize_t ret{ 0 };
+		if (pOverlappedEx->mIsZeroCopy)
+		{
+			ret = SendZeroCopy(context, socket, pOverlappedEx, sendMsg);
+		}
+		else
+		{
+			// 끊어진 socket에 send()를 하면 SIGPIPE로 프로세스가 종료되기 때문에
+			// MSG_NOSIGNAL로 에러만 반환하게 한다.
+			ret = sendmsg(socket, &sendMsg, MSG_NOSIGNAL);
+			CountSyscall();
+		}
+
+		ReleaseSocket(context);
+
+		if (0 <= ret)
+		{
+			// 일부만 송신되었다면, Connection::DoSend()가 나머지를 다시 요청한다.
+			completion = IOCompletion{ pOverlappedEx, static_cast<DWORD>(ret), true };
+			return true;
+		}
+
+		int error = errno;
+		if (EINTR == error)
+		{
+			context.mPendingSend.store(pOverlappedEx);
+			continue;
+		}
+
+		if (EAGAIN == error || EWOULDBLOCK == error)
+		{
+			context.mPendingSend.store(pOverlappedEx);
+
+			if (context.mIsWritable.load())
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		completion = IOCompletion{ pOverlappedEx, 0, false };
+		return true;
+	}
+}
+
+ssize_t EpollBackend::SendZeroCopy(EpollContext& context, SOCKET socket, OVERLAPPED_EX* pOverlappedEx, msghdr& sendMsg)
+{
+	// 완료 알림을 다른 thread가 먼저 꺼내가지 못하도록
+	// 송신하고 송신 크기를 기억할 때까지 lock을 잡는다.
+	Monitor::Owner lock{ context.mZeroCopySyncObject };
+
+	// socket마다 처음 zero-copy로 송신할 때 SO_ZEROCOPY를 설정한다.
+	if (false == context.mIsZeroCopyEnabled)
+	{
+		int option{ 1 };
+		context.mIsZeroCopyEnabled = 0 == setsockopt(socket, SOL_SOCKET, SO_ZEROCOPY, &option, sizeof(option));
+		CountSyscall();
+	}
+
+	Connection* pConnection = reinterpret_cast<Connection*>(pOverlappedEx->mConnection);
+
+	// 완료 알림을 기다리는 송신이 너무 많으면 복사 송신
+	if (context.mIsZeroCopyEnabled && false == context.mZeroCopyQueue.IsFull())
+	{
+		context.mZeroCopyOverlappedEx = pConnection->mZeroCopyOverlappedEx;
+
+		ssize_t ret = sendmsg(socket, &sendMsg, MSG_NOSIGNAL | MSG_ZEROCOPY);
+		CountSyscall();
+
+		if (0 < ret)
+		{
+			// kernel은 MSG_ZEROCOPY로 성공한 send()마다 0부터 번호를 붙여서 완료 알림을 준다.
+			context.mZeroCopyQueue.Push(static_cast<DWORD>(ret));
+			return ret;
+		}
+
+		// 완료 알림에 사용할 메모리(optmem)가 부족하면 ENOBUFS를 반환하는데
+		// 이 때는 복사 송신으로 보낸다.
+		if (-1 != ret || ENOBUFS != errno)
+		{
+			return ret;
+		}
+	}
+
+	pOverlappedEx->mIsZeroCopy = false;
+
+	ssize_t ret = sendmsg(socket, &sendMsg, MSG_NOSIGNAL);
+	CountSyscall();
+
+	return ret;
+}
+
+bool EpollBackend::TryZeroCopyNotify(EpollContext& context, IOCompletion& completion)
+{
+	Monitor::Owner lock{ context.mZeroCopySyncObject };
+
+	if (context.mZeroCopyQueue.IsEmpty())
+	{
+		return false;
+	}
+
+	SOCKET socket = AcquireSocket(context);
+	if (INVALID_SOCKET == socket)
+	{
+		ReleaseSocket(context);
+		return false;
+	}
+
+	DWORD releaseBytes{ 0 };
+
+	while (true)
+	{
+		// 완료 알림은 데이터 없이 control message(sock_extended_err)로만 온다.
+		char control[128]{};
+		msghdr msg{};
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		ssize_t ret = recvmsg(socket, &msg, MSG_ERRQUEUE);
+		CountSyscall();
+
+		// EAGAIN: 더 이상 완료 알림이 없다.
+		if (-1 == ret)
+		{
+			break;
+		}
+
+		for (cmsghdr* pCmsg = CMSG_FIRSTHDR(&msg); nullptr != pCmsg; pCmsg = CMSG_NXTHDR(&msg, pCmsg))
+		{
+			bool isRecvErr = (SOL_IP == pCmsg->cmsg_level && IP_RECVERR == pCmsg->cmsg_type) ||
+				(SOL_IPV6 == pCmsg->cmsg_level && IPV6_RECVERR == pCmsg->cmsg_type);
+			if (false == isRecvErr)
+			{
+				continue;
+			}
+
+			sock_extended_err* pError = reinterpret_cast<sock_extended_err*>(CMSG_DATA(pCmsg));
+			if (SO_EE_ORIGIN_ZEROCOPY != pError->ee_origin)
+			{
+				continue;
+			}
+
+			// ee_info번째부터 ee_data번째 송신까지 kernel이 버퍼를 다 사용했다.
+			// 여러 송신의 완료 알림이 하나로 합쳐져서 올 수 있다.
+			unsigned int doneCnt = pError->ee_data - pError->ee_info + 1;
+			for (unsigned int i = 0; i < doneCnt; ++i)
+			{
+				releaseBytes += context.mZeroCopyQueue.Pop();
+			}
+
+			// kernel이 결국 복사해서 보냈다면(loopback 등) COPIED가 표시된다.
+			CountZeroCopyNotify(0 != (pError->ee_code & SO_EE_CODE_ZEROCOPY_COPIED));
+		}
+	}
+
+	ReleaseSocket(context);
+
+	if (0 == releaseBytes)
+	{
+		return false;
+	}
+
+	completion = IOCompletion{ context.mZeroCopyOverlappedEx, releaseBytes, true };
+	return true;
+}
+
+void EpollBackend::ResetZeroCopy(EpollContext& context)
+{
+	Monitor::Owner lock{ context.mZeroCopySyncObject };
+
+	context.mZeroCopyQueue.Clear();
+	context.mZeroCopyOverlappedEx = nullptr;
+	context.mIsZeroCopyEnabled = false;
+}
+
+SOCKET EpollBackend::AcquireSocket(EpollContext& context)
+{
+	// 사용 횟수를 먼저 올리고 socket을 읽어야
+	// CloseSocket()이 socket을 떼어낸 뒤에 사용 횟수를 확인할 때 놓치지 않는다.
+	context.mSocketUseCnt.fetch_add(1);
+
+	return context.mSocket.load();
+}
+
+void EpollBackend::ReleaseSocket(EpollContext& context)
+{
+	context.mSocketUseCnt.fetch_sub(1);
+}
+
+void EpollBackend::PushReady(const IOCompletion& completion)
+{
+	if (false == mReadyQueue->TryPush(completion))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::PushReady() | ready queue is full");
+
+		return;
+	}
+
+	// worker thread는 요청 직후에 GetCompletions()로 돌아와서
+	// 직접 꺼내가기 때문에 다른 thread를 깨울 필요가 없다.
+	if (false == IsWorkerThread())
+	{
+		WakeUp();
+	}
+}
+
+int EpollBackend::PopReady(IOCompletion* pCompletions, int maxCount)
+{
+	return mReadyQueue->PopBatch(std::span<IOCompletion>{ pCompletions, static_cast<size_t>(maxCount) });
+}
+
+void EpollBackend::WakeUp()
+{
+	uint64_t value{ 1 };
+	write(mEventFd, &value, sizeof(value));
+	CountSyscall();
+}
+
+EpollBackend::EpollContext* EpollBackend::GetContext(Connection* pConnection)
+{
+	int index = GetContextIndex(pConnection->GetIndex());
+	if (0 > index || mMaxConnectionCnt <= index)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | EpollBackend::GetContext() | invalid connection index: %d",
+			pConnection->GetIndex());
+
+		return nullptr;
+	}
+
+	return &mContexts[index];
+}
+
+#endif
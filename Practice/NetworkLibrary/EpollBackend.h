@@ -0,0 +1,148 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// Linux edge-triggered epoll을 사용하는 backend
+//
+// epoll은 "읽을(쓸) 수 있다"는 준비 통지만 주기 때문에
+// Connection이 Recv(), Send(), Accept()로 요청한 작업을 socket마다 대기시켜 두었다가
+// 준비 통지를 받은 worker thread가 직접 recv(), send(), accept()를 수행하고
+// 그 결과를 IOCompletion으로 만들어서 IOCP의 작업 완료 통지처럼 넘겨준다.
+//
+// edge-triggered라서 상태가 바뀔 때 통지가 한 번만 오는데,
+// 작업 요청이 없을 때 온 통지를 잃어버리지 않도록
+// mIsReadable, mIsWritable에 기억해둔다.
+//
+// zero-copy 송신은 send()에 MSG_ZEROCOPY를 넘기고
+// kernel이 버퍼를 다 사용하면 socket의 error queue에 완료 알림을 넣어주는데(EPOLLERR)
+// 이 알림을 꺼내서 OP_ZEROCOPY_RELEASE 완료 통지로 바꿔준다.
+
+#include "IOBackend.h"
+
+#ifndef _WIN32
+
+#include <atomic>
+
+#include "Monitor.h"
+#include "Queue.h"
+#include "MPMCQueue.h"
+
+class NETLIB_API EpollBackend : public IOBackend
+{
+public:
+	EpollBackend();
+	~EpollBackend() override;
+
+public:
+	bool Create(int maxConnectionCnt) override;
+	void Destroy() override;
+
+	bool BindListenSocket(SOCKET listenSocket) override;
+	bool BindSocket(Connection* pConnection) override;
+
+	bool Accept(SOCKET listenSocket, OVERLAPPED_EX* pOverlappedEx) override;
+	bool Recv(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) override;
+	bool Send(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) override;
+
+	void GetRemoteAddress(OVERLAPPED_EX* pOverlappedEx, char* pIP, int ipLength) override;
+	void CloseSocket(Connection* pConnection) override;
+
+	int GetCompletions(IOCompletion* pCompletions, int maxCount, DWORD timeout) override;
+	bool PostQuit() override;
+	bool PostCompletion(OVERLAPPED_EX* pOverlappedEx) override;
+
+	bool IsZeroCopySendSupported() override;
+
+private:
+	// epoll에 등록한 socket마다 유지하는 상태
+	// epoll_event.data.ptr에 주소를 넣어서 어떤 socket의 통지인지 구분한다.
+	// client socket용은 Connection의 index로 배열에서 찾는다.
+	struct EpollContext
+	{
+		// CloseSocket()과 다른 thread의 recv(), send()가 겹칠 수 있어서 atomic
+		std::atomic<SOCKET> mSocket;
+
+		// AcquireSocket()으로 socket을 가져가서 사용중인 thread 수
+		std::atomic<int> mSocketUseCnt;
+		bool mIsListen;
+
+		// 요청을 받았지만 아직 처리하지 못한 작업
+		// (IOCP라면 OS가 들고 있었을 overlapped IO)
+		// Connection은 recv, send를 각각 하나씩만 요청하기 때문에 하나면 충분하다.
+		std::atomic<OVERLAPPED_EX*> mPendingRecv;
+		std::atomic<OVERLAPPED_EX*> mPendingSend;
+
+		// 대기중인 작업이 없을 때 준비 통지가 오면 기억해둔다.
+		std::atomic<bool> mIsReadable;
+		std::atomic<bool> mIsWritable;
+
+		// zero-copy 송신 상태
+		// send()와 error queue의 완료 알림 처리가 다른 thread에서 겹칠 수 있어서 lock으로 보호한다.
+		Monitor mZeroCopySyncObject;
+		ZeroCopySendQueue mZeroCopyQueue;
+		OVERLAPPED_EX* mZeroCopyOverlappedEx;
+
+		// socket에 SO_ZEROCOPY를 설정했는지
+		bool mIsZeroCopyEnabled;
+	};
+
+private:
+	// 대기중인 작업을 꺼내서 실제로 수행해본다.
+	// 작업이 끝났으면(성공이든 실패든) completion을 채우고 true 반환
+	// EAGAIN이라면 작업을 다시 대기시키고 false 반환
+	bool TryAccept(IOCompletion& completion);
+	bool TryRecv(EpollContext& context, IOCompletion& completion);
+	bool TrySend(EpollContext& context, IOCompletion& completion);
+
+	// MSG_ZEROCOPY로 송신한다. 반환값은 sendmsg()와 같다.
+	// zero-copy로 보낼 수 없다면 복사 송신하고 pOverlappedEx->mIsZeroCopy를 false로 바꾼다.
+	ssize_t SendZeroCopy(EpollContext& context, SOCKET socket, OVERLAPPED_EX* pOverlappedEx, msghdr& sendMsg);
+
+	// error queue에서 zero-copy 완료 알림을 모두 꺼낸다.
+	// 해제할 바이트가 있으면 completion을 채우고 true 반환
+	bool TryZeroCopyNotify(EpollContext& context, IOCompletion& completion);
+
+	// socket이 바뀔 때 zero-copy 상태를 초기화한다.
+	void ResetZeroCopy(EpollContext& context);
+
+	// recv(), send()를 호출하는 동안 socket을 사용중으로 표시한다.
+	// CloseSocket()은 사용중인 thread가 없어진 뒤에 close()하기 때문에
+	// 닫힌 fd 번호가 새 client에게 다시 주어져도 그 client에게 잘못 recv(), send()하지 않는다.
+	// 떼어낸 socket이라면 INVALID_SOCKET을 반환하고, 반환값과 상관없이 ReleaseSocket()을 호출해야 한다.
+	SOCKET AcquireSocket(EpollContext& context);
+	void ReleaseSocket(EpollContext& context);
+
+	// GetCompletions()에서 꺼낼 작업 완료 통지를 ready queue에 넣고 꺼낸다.
+	void PushReady(const IOCompletion& completion);
+	int PopReady(IOCompletion* pCompletions, int maxCount);
+
+	// epoll_wait()에서 대기중인 worker thread를 깨운다.
+	void WakeUp();
+
+	EpollContext* GetContext(Connection* pConnection);
+
+private:
+	int mEpoll;
+
+	// 다른 thread가 ready queue에 완료 통지를 넣었을 때
+	// epoll_wait()에서 대기중인 worker thread를 깨우기 위한 eventfd
+	int mEventFd;
+
+	int mMaxConnectionCnt;
+
+	// Connection의 index로 접근하는 client socket 상태 배열
+	EpollContext* mContexts;
+	EpollContext mListenContext;
+
+	// Accept()로 요청받은 accept 작업들
+	// listen socket 하나에 여러 Connection이 동시에 accept를 요청한다.
+	Queue<OVERLAPPED_EX*>* mPendingAccepts;
+	Monitor mAcceptSyncObject;
+
+	// 즉시 끝난 작업, 실패로 끝난 작업, 한 번에 다 꺼내지 못한 작업의 완료 통지
+	// worker thread와 Strand::Post()가 동시에 넣고 꺼내기 때문에 lock 없는 queue를 사용하고
+	// PopReady()는 PopBatch()로 한 번에 꺼낸다.
+	MPMCQueue<IOCompletion>* mReadyQueue;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,448 @@
+﻿#include "Log.h"
+#include "Connection.h"
+#include "IOBackend.h"
+#include "TimingWheel.h"
+#include "Strand.h"
+#include "JobSystem.h"
+
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+
+#include "IOCPBackend.h"
+#else
+#include <pthread.h>
+
+#include "EpollBackend.h"
+#include "IOUringBackend.h"
+#endif
+
+// worker thread로 생성된 thread만 true
+// 현재 thread가 worker thread로 일하고 있는 backend
+// backend가 여러 개일 때(ShardedAcceptor) 다른 backend의 worker thread와 구분하기 위해 backend를 기억한다.
+static thread_local IOBackend* tWorkerBackend{ nullptr };
+
+IOBackend::IOBackend()
+	: mSharedRecvBufSize{ DEFAULT_SHARED_RECV_BUF_SIZE }
+	, mSharedRecvBufCnt{ DEFAULT_SHARED_RECV_BUF_CNT }
+	, mConnectionIndexOffset{ 0 }
+	, mConnectionIndexStride{ 1 }
+	, mWorkerThreads{ nullptr }
+	, mWorkerThreadCnt{ 0 }
+	, mWorkerThreadFirstCpu{ -1 }
+	, mCompletionBatchSize{ DEFAULT_COMPLETION_BATCH }
+	, mTimingWheel{ nullptr }
+	, mJobSystem{ nullptr }
+	, mSyscallCnt{ 0 }
+	, mWakeupCnt{ 0 }
+	, mCompletionCnt{ 0 }
+	, mZeroCopyNotifyCnt{ 0 }
+	, mZeroCopyCopiedCnt{ 0 }
+{
+}
+
+IOBackend::~IOBackend()
+{
+	delete[] mWorkerThreads;
+}
+
+IOBackend* IOBackend::CreateIOBackend(eIOBackendType backendType)
+{
+	switch (backendType)
+	{
+#ifdef _WIN32
+	case eIOBackendType::BACKEND_IOCP:
+		return new IOCPBackend{};
+#else
+	case eIOBackendType::BACKEND_EPOLL:
+		return new EpollBackend{};
+	case eIOBackendType::BACKEND_IO_URING:
+		return new IOUringBackend{};
+#endif
+	default:
+		break;
+	}
+
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | IOBackend::CreateIOBackend() | unsupported backend type: %d",
+		static_cast<int>(backendType));
+
+	return nullptr;
+}
+
+// thread가 실행할 함수로 멤버 함수를 바로 넘길 수 없기 때문에
+// this 포인터를 넘겨서 멤버 함수를 호출해준다.
+#ifdef _WIN32
+unsigned int WINAPI CallWorkerThread(LPVOID p)
+#else
+void* CallWorkerThread(void* p)
+#endif
+{
+	IOBackend* pIOBackend = reinterpret_cast<IOBackend*>(p);
+
+	pIOBackend->WorkerThread();
+
+#ifdef _WIN32
+	return 0;
+#else
+	return nullptr;
+#endif
+}
+
+bool IOBackend::CreateWorkerThread(int workerThreadCnt, int completionBatchSize)
+{
+	if (0 == completionBatchSize)
+	{
+		completionBatchSize = DEFAULT_COMPLETION_BATCH;
+	}
+
+	if (0 >= completionBatchSize || MAX_COMPLETION_BATCH < completionBatchSize)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOBackend::CreateWorkerThread() | invalid completion batch size: %d",
+			completionBatchSize);
+
+		return false;
+	}
+
+	mCompletionBatchSize = completionBatchSize;
+
+#ifdef _WIN32
+	mWorkerThreads = new HANDLE[workerThreadCnt]{};
+#else
+	mWorkerThreads = new pthread_t[workerThreadCnt]{};
+#endif
+
+	for (int i = 0; i < workerThreadCnt; ++i)
+	{
+#ifdef _WIN32
+		unsigned int threadID{ 0 };
+
+		mWorkerThreads[i] = reinterpret_cast<HANDLE>(_beginthreadex(
+			NULL,
+			0,
+			CallWorkerThread,
+			this,
+			0,
+			&threadID));
+
+		bool isCreated = NULL != mWorkerThreads[i];
+#else
+		bool isCreated = 0 == pthread_create(&mWorkerThreads[i], nullptr, CallWorkerThread, this);
+#endif
+
+		if (false == isCreated)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | IOBackend::CreateWorkerThread() | WorkerThread 생성 실패: Error(%lu)",
+				GetLastError());
+
+			// 이미 생성된 thread들은 정리
+			DestroyWorkerThread();
+			return false;
+		}
+
+		++mWorkerThreadCnt;
+
+		if (0 <= mWorkerThreadFirstCpu)
+		{
+			PinWorkerThread(i);
+		}
+	}
+
+	return true;
+}
+
+void IOBackend::DestroyWorkerThread()
+{
+	// 살아있는 worker thread 수만큼 종료 요청을 넣고
+	// worker thread는 종료 요청을 하나씩 꺼내가서 종료한다.
+	for (int i = 0; i < mWorkerThreadCnt; ++i)
+	{
+		PostQuit();
+	}
+
+	for (int i = 0; i < mWorkerThreadCnt; ++i)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(mWorkerThreads[i], INFINITE);
+		CloseHandle(mWorkerThreads[i]);
+#else
+		pthread_join(mWorkerThreads[i], nullptr);
+#endif
+	}
+
+	delete[] mWorkerThreads;
+	mWorkerThreads = nullptr;
+	mWorkerThreadCnt = 0;
+}
+
+void IOBackend::SetTimingWheel(TimingWheel* pTimingWheel)
+{
+	mTimingWheel = pTimingWheel;
+}
+
+void IOBackend::SetJobSystem(JobSystem* pJobSystem)
+{
+	mJobSystem = pJobSystem;
+}
+
+void IOBackend::SetSharedRecvBuffer(int bufSize, int bufCnt)
+{
+	mSharedRecvBufSize = 0 < bufSize ? bufSize : DEFAULT_SHARED_RECV_BUF_SIZE;
+	mSharedRecvBufCnt = 0 < bufCnt ? bufCnt : DEFAULT_SHARED_RECV_BUF_CNT;
+}
+
+void IOBackend::SetConnectionIndexMapping(int indexOffset, int indexStride)
+{
+	mConnectionIndexOffset = indexOffset;
+	mConnectionIndexStride = 0 < indexStride ? indexStride : 1;
+}
+
+void IOBackend::SetWorkerThreadAffinity(int firstCpu)
+{
+	mWorkerThreadFirstCpu = firstCpu;
+}
+
+void IOBackend::WorkerThread()
+{
+	tWorkerBackend = this;
+
+	IOCompletion completions[MAX_COMPLETION_BATCH]{};
+	bool isQuit{ false };
+
+	// timer를 실행해야 하면 완료 통지가 없어도 tick마다 깨어난다.
+	DWORD waitTimeout = nullptr != mTimingWheel ? TIMER_TICK_MSEC : INFINITE;
+
+	// 등록하지 못하면 job을 공용 queue로 넣고 꺼내는 thread로 돕는다.
+	if (nullptr != mJobSystem)
+	{
+		mJobSystem->RegisterThread();
+	}
+
+	// 바로 전에 job을 실행했다면 기다리지 않고 완료 통지만 확인한다.
+	bool isJobExecuted{ false };
+
+	while (false == isQuit)
+	{
+		// 작업 완료 통지가 없으면,
+		// GetCompletions() 안에서 대기하다가
+		// 완료 통지가 생기면 깨어나서 한 번에 여러 개를 꺼내온다.
+		int completionCnt = GetCompletions(completions, mCompletionBatchSize, isJobExecuted ? 0 : waitTimeout);
+		if (0 < completionCnt)
+		{
+			InterlockedIncrement64(&mWakeupCnt);
+			InterlockedAdd64(&mCompletionCnt, completionCnt);
+		}
+
+		// 한 번에 여러 개를 꺼내다 보니
+		// 다른 worker thread 몫의 종료 요청까지 같이 꺼내올 수 있다.
+		// 그래서 종료 요청의 개수를 세어두었다가
+		// 첫 번째 요청만 내가 사용하고 나머지는 다시 넣어준다.
+		int quitCnt{ 0 };
+
+		for (int i = 0; i < completionCnt; ++i)
+		{
+			IOCompletion& completion = completions[i];
+
+			if (nullptr == completion.mOverlappedEx)
+			{
+				++quitCnt;
+				continue;
+			}
+
+			// strand 실행 요청은 Connection이 아니라 Strand가 처리한다.
+			if (eOperationType::OP_STRAND == completion.mOverlappedEx->mOperation)
+			{
+				reinterpret_cast<Strand*>(completion.mOverlappedEx->mConnection)->Run();
+				continue;
+			}
+
+			Connection* pConnection = reinterpret_cast<Connection*>(completion.mOverlappedEx->mConnection);
+			pConnection->OnIOCompleted(completion.mOverlappedEx,
+				completion.mTransferredBytes,
+				completion.mIsSuccess);
+		}
+
+		// 완료 통지를 처리하면서 SendPostCorked()로 모아둔 송신을 한 번에 보낸다.
+		Connection::FlushCorkedSends();
+
+		// 지나간 tick의 timer를 실행한다.
+		// 다른 worker thread가 실행중이면 기다리지 않고 넘어간다.
+		if (nullptr != mTimingWheel)
+		{
+			mTimingWheel->Advance();
+
+			// OnTimer()에서 SendPostCorked()를 호출했을 수 있다.
+			Connection::FlushCorkedSends();
+		}
+
+		for (int i = 1; i < quitCnt; ++i)
+		{
+			PostQuit();
+		}
+
+		isQuit = 0 < quitCnt;
+
+		// 완료 통지 처리를 마쳤으니 남은 job을 하나 돕는다.
+		isJobExecuted = false == isQuit && nullptr != mJobSystem && mJobSystem->RunPendingJob();
+	}
+
+	if (nullptr != mJobSystem)
+	{
+		mJobSystem->UnregisterThread();
+	}
+
+	tWorkerBackend = nullptr;
+}
+
+int IOBackend::GetContextIndex(int connectionIndex)
+{
+	int relativeIndex = connectionIndex - mConnectionIndexOffset;
+	if (0 > relativeIndex || 0 != relativeIndex % mConnectionIndexStride)
+	{
+		return -1;
+	}
+
+	return relativeIndex / mConnectionIndexStride;
+}
+
+void IOBackend::PinWorkerThread(int workerIndex)
+{
+	int cpuCnt = static_cast<int>(std::thread::hardware_concurrency());
+	if (0 >= cpuCnt)
+	{
+		return;
+	}
+
+	int cpu = (mWorkerThreadFirstCpu + workerIndex) % cpuCnt;
+
+	// 실패해도 pin하지 않은 것과 같아서 log만 남긴다.
+#ifdef _WIN32
+	bool isPinned = 0 != SetThreadAffinityMask(mWorkerThreads[workerIndex], static_cast<DWORD_PTR>(1) << cpu);
+#else
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+
+	bool isPinned = 0 == pthread_setaffinity_np(mWorkerThreads[workerIndex], sizeof(cpuSet), &cpuSet);
+#endif
+
+	if (false == isPinned)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOBackend::PinWorkerThread() | worker thread[%d] cpu[%d] affinity failed",
+			workerIndex, cpu);
+	}
+}
+
+bool IOBackend::IsWorkerThread()
+{
+	return this == tWorkerBackend;
+}
+
+bool IOBackend::IsSharedRecvBufferSupported()
+{
+	return false;
+}
+
+void IOBackend::ReleaseRecvBuffer(Connection*, int)
+{
+}
+
+bool IOBackend::IsZeroCopySendSupported()
+{
+	return false;
+}
+
+int IOBackend::GetAcceptBacklog()
+{
+	return 0;
+}
+
+LONG64 IOBackend::GetSyscallCount()
+{
+	return mSyscallCnt;
+}
+
+LONG64 IOBackend::GetWakeupCount()
+{
+	return mWakeupCnt;
+}
+
+LONG64 IOBackend::GetCompletionCount()
+{
+	return mCompletionCnt;
+}
+
+double IOBackend::GetAverageCompletionsPerWakeup()
+{
+	LONG64 wakeupCnt = mWakeupCnt;
+	if (0 == wakeupCnt)
+	{
+		return 0.0;
+	}
+
+	return static_cast<double>(mCompletionCnt) / wakeupCnt;
+}
+
+LONG64 IOBackend::GetZeroCopyNotifyCount()
+{
+	return mZeroCopyNotifyCnt;
+}
+
+LONG64 IOBackend::GetZeroCopyCopiedCount()
+{
+	return mZeroCopyCopiedCnt;
+}
+
+void IOBackend::CountSyscall()
+{
+	InterlockedIncrement64(&mSyscallCnt);
+}
+
+void IOBackend::CountZeroCopyNotify(bool isCopied)
+{
+	InterlockedIncrement64(&mZeroCopyNotifyCnt);
+
+	if (isCopied)
+	{
+		InterlockedIncrement64(&mZeroCopyCopiedCnt);
+	}
+}
+
+void ZeroCopySendQueue::Clear()
+{
+	mHead = 0;
+	mTail = 0;
+}
+
+bool ZeroCopySendQueue::IsEmpty()
+{
+	return mHead == mTail;
+}
+
+bool ZeroCopySendQueue::IsFull()
+{
+	return MAX_ZEROCOPY_INFLIGHT <= mTail - mHead;
+}
+
+void ZeroCopySendQueue::Push(DWORD bytes)
+{
+	mBytes[mTail % MAX_ZEROCOPY_INFLIGHT] = bytes;
+	++mTail;
+}
+
+DWORD ZeroCopySendQueue::Pop()
+{
+	if (IsEmpty())
+	{
+		return 0;
+	}
+
+	DWORD bytes = mBytes[mHead % MAX_ZEROCOPY_INFLIGHT];
+	++mHead;
+
+	return bytes;
+}
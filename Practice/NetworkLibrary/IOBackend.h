@@ -0,0 +1,299 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// Connection이 요청하는 비동기 IO를 운영체제로부터 분리하기 위한 class
+//
+// 지금까지 Connection은 WSARecv(), WSASend(), AcceptEx()와 IOCP 객체를 직접 사용했는데
+// 이러면 Windows가 아닌 곳(Linux 서버)에서는 library를 사용할 수가 없다.
+// 그래서 IO 요청과 작업 완료 통지를 꺼내오는 부분을 IOBackend로 감추고
+// Windows에서는 IOCP를 사용하는 IOCPBackend를,
+// Linux에서는 edge-triggered epoll을 사용하는 EpollBackend를 사용한다.
+//
+// IOCP는 "작업이 완료되었다"는 통지를 주고
+// epoll은 "지금 읽을(쓸) 수 있다"는 통지를 주는 차이가 있지만,
+// EpollBackend는 통지를 받은 worker thread가 직접 recv(), send(), accept()를 수행한 뒤
+// 그 결과를 IOCP의 작업 완료 통지와 같은 모양(IOCompletion)으로 만들어서 넘겨준다.
+// 그래서 Connection 입장에서는
+// OVERLAPPED_EX로 작업을 요청하고, 완료 통지를 받아서 후처리하는 흐름이 똑같다.
+
+#include "Platform.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+class Connection;
+class TimingWheel;
+class JobSystem;
+struct OVERLAPPED_EX;
+
+// worker thread가 한 번 깨어났을 때
+// 꺼내올 수 있는 작업 완료 통지의 최대 개수
+// backend가 완료 통지를 꺼내는 임시 배열의 크기이기도 하다.
+constexpr int MAX_COMPLETION_BATCH{ 256 };
+
+// CreateWorkerThread()에 batch 크기를 지정하지 않았을 때 사용하는 값
+constexpr int DEFAULT_COMPLETION_BATCH{ 64 };
+
+// SetSharedRecvBuffer()로 지정하지 않았을 때 backend가 recv에 사용하는 공유 버퍼 하나의 크기와 개수
+// (4KB * 4096 = 16MB)
+constexpr int DEFAULT_SHARED_RECV_BUF_SIZE{ 4096 };
+constexpr int DEFAULT_SHARED_RECV_BUF_CNT{ 4096 };
+
+// 한 번의 송신 요청(OVERLAPPED_EX::mSendBufs)에 담을 수 있는 버퍼 조각의 최대 개수
+// send ring buffer에서 송신할 데이터는 버퍼의 끝과 처음, 최대 두 조각으로 나뉘고
+// ChainBuffer는 slab마다 한 조각이라서 mSendBufSize / SEND_SLAB_SIZE + 1개 까지 담으면 한 번에 보낼 수 있다.
+// Connection::SendShared()로 넣은 패킷도 하나가 한 조각을 차지한다.
+constexpr int MAX_SEND_BUF_CNT{ 16 };
+
+// connection 하나가 완료 알림을 기다릴 수 있는 zero-copy 송신의 최대 개수
+// 가득 차면 완료 알림이 올 때까지 복사 송신을 사용한다.
+constexpr int MAX_ZEROCOPY_INFLIGHT{ 32 };
+
+// 사용할 backend의 종류
+enum class eIOBackendType
+{
+	// Windows IO Completion Port
+	BACKEND_IOCP,
+
+	// Linux edge-triggered epoll
+	BACKEND_EPOLL,
+
+	// Linux io_uring (multishot accept, multishot recv)
+	BACKEND_IO_URING,
+};
+
+// GQCS() 함수가 꺼내주는 정보를
+// 플랫폼과 상관없이 같은 모양으로 담아두는 구조체
+struct IOCompletion
+{
+	// Overlapped IO 작업을 요청할 때 넘겼던 OVERLAPPED_EX로
+	// mConnection을 통해 Connection 객체를 복구할 수 있다.
+	// nullptr이면 worker thread를 종료하라는 의미(PostQuit())
+	OVERLAPPED_EX* mOverlappedEx;
+
+	// 송수신된 바이트 수
+	DWORD mTransferredBytes;
+
+	// GQCS() 함수의 반환 값과 같은 의미로
+	// false면 작업이 실패했다(socket 연결이 끊겼다).
+	bool mIsSuccess;
+};
+
+// zero-copy 송신마다 송신한 바이트 수를 순서대로 기억해두는 원형 queue
+// kernel이 완료 알림을 주면 앞에서부터 꺼내서 send ring buffer에서 해제할 크기를 구한다.
+// TCP는 보낸 순서대로 ACK를 받고 버퍼를 놓아주기 때문에 완료 알림도 송신 순서대로 온다.
+// backend의 connection context마다 하나씩 두고 context의 lock으로 보호한다.
+struct NETLIB_API ZeroCopySendQueue
+{
+	DWORD mBytes[MAX_ZEROCOPY_INFLIGHT];
+	unsigned int mHead;
+	unsigned int mTail;
+
+	void Clear();
+	bool IsEmpty();
+	bool IsFull();
+	void Push(DWORD bytes);
+	DWORD Pop();
+};
+
+class NETLIB_API IOBackend
+{
+public:
+	IOBackend();
+	virtual ~IOBackend();
+
+public:
+	// 플랫폼에 맞는 backend 객체를 생성한다.
+	// 현재 플랫폼에서 지원하지 않는 종류라면 nullptr을 반환
+	static IOBackend* CreateIOBackend(eIOBackendType backendType);
+
+public:
+	// IOCP 객체 또는 epoll 객체를 생성한다.
+	// maxConnectionCnt는 backend 내부에서 미리 잡아둘 자원의 크기를 정할 때 사용
+	virtual bool Create(int maxConnectionCnt) = 0;
+	virtual void Destroy() = 0;
+
+	// client의 접속 요청을 받을 listen socket을 backend에 등록한다.
+	virtual bool BindListenSocket(SOCKET listenSocket) = 0;
+
+	// 접속을 수락한 client socket을 backend에 등록한다.
+	// (기존 Connection::BindIOCP()가 하던 일)
+	virtual bool BindSocket(Connection* pConnection) = 0;
+
+	// client 접속 요청을 비동기로 받는다.
+	// 접속이 수락되면, Connection에 client socket이 세팅되고
+	// OP_ACCEPT 작업 완료 통지가 만들어진다.
+	virtual bool Accept(SOCKET listenSocket, OVERLAPPED_EX* pOverlappedEx) = 0;
+
+	// pOverlappedEx->mWSABuf에 세팅된 위치와 크기만큼 데이터를 수신한다.
+	// 송신은 pOverlappedEx->mSendBufs에 담긴 조각들을 순서대로 한 번에 송신한다.
+	// 성공하면 작업 완료 통지가 만들어지고
+	// false를 반환하면 작업 요청 자체가 실패한 것이라 완료 통지도 없다.
+	virtual bool Recv(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) = 0;
+	virtual bool Send(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) = 0;
+
+	// accept 작업 완료 통지를 꺼낸 뒤
+	// 접속한 client의 주소를 문자열로 얻어온다.
+	virtual void GetRemoteAddress(OVERLAPPED_EX* pOverlappedEx, char* pIP, int ipLength) = 0;
+
+	// client socket을 닫는다.
+	// IOCP는 socket을 닫으면 진행중이던 overlapped IO가 실패로 완료되는데
+	// 다른 backend도 대기중이던 작업을 실패로 완료시켜서 같은 동작을 보장해야 한다.
+	virtual void CloseSocket(Connection* pConnection) = 0;
+
+	// 작업 완료 통지를 최대 maxCount개 꺼내서 pCompletions에 담는다.
+	// 완료 통지가 없으면, timeout(ms)만큼 대기하고
+	// 반환 값은 꺼낸 작업 완료 통지의 개수
+	virtual int GetCompletions(IOCompletion* pCompletions, int maxCount, DWORD timeout) = 0;
+
+	// GetCompletions()에서 대기중인 worker thread 하나를 깨워서 종료시킨다.
+	// IOCP의 PQCS(0, 0, nullptr)와 같은 역할
+	virtual bool PostQuit() = 0;
+
+	// IO 작업 없이 pOverlappedEx의 완료 통지를 직접 넣는다(IOCP의 PQCS(0, 0, pOverlappedEx)).
+	// Strand가 worker thread에게 실행을 맡길 때 사용하고
+	// 다른 worker thread가 바로 가져갈 수 있도록 항상 깨운다.
+	// 완료 통지를 넣을 공간이 없으면 false
+	virtual bool PostCompletion(OVERLAPPED_EX* pOverlappedEx) = 0;
+
+	// 모든 connection이 같이 사용하는 recv 버퍼를 지원하는지
+	// 지원한다면 Recv()는 mWSABuf로 복사하지 않고
+	// 데이터가 들어있는 공유 버퍼의 위치(mWSABuf.buf)와 id(mBufferID)를 넘겨준다.
+	// Connection은 다 사용한 버퍼를 ReleaseRecvBuffer()로 돌려준다.
+	virtual bool IsSharedRecvBufferSupported();
+	virtual void ReleaseRecvBuffer(Connection* pConnection, int bufferID);
+
+	// zero-copy 송신(MSG_ZEROCOPY, io_uring SEND_ZC)을 지원하는지
+	// 지원한다면 Send()는 pOverlappedEx->mIsZeroCopy가 true일 때 복사하지 않고 송신하고
+	// kernel이 버퍼를 다 사용했다는 완료 알림을 받으면
+	// Connection::mZeroCopyOverlappedEx로 OP_ZEROCOPY_RELEASE 완료 통지를 만들어준다.
+	// (mTransferredBytes: send ring buffer에서 해제할 바이트 수)
+	// 사정이 있어서 복사 송신을 했다면 pOverlappedEx->mIsZeroCopy를 false로 바꿔둔다.
+	virtual bool IsZeroCopySendSupported();
+
+	// backend가 이미 받았지만 아직 Connection에 넘겨주지 못한 접속 수
+	// (listen socket의 accept queue 대신 backend가 들고 있는 접속)
+	virtual int GetAcceptBacklog();
+
+public:
+	// GetCompletions()로 작업 완료 통지를 꺼내서
+	// Connection에게 후처리를 맡기는 worker thread를 생성한다.
+	// completionBatchSize: worker thread가 한 번 깨어났을 때 꺼내올 완료 통지의 최대 개수(1 ~ MAX_COMPLETION_BATCH)
+	// (InitConfig::mCompletionBatchSize, 0이면 DEFAULT_COMPLETION_BATCH)
+	// 크게 잡으면 부하가 높을 때 시스템 콜 한 번에 많은 완료 통지를 처리하지만
+	// 한 worker thread가 많이 가져가는 동안 다른 worker thread는 놀 수 있다.
+	bool CreateWorkerThread(int workerThreadCnt, int completionBatchSize = DEFAULT_COMPLETION_BATCH);
+
+	// 모든 worker thread에게 종료 요청을 보내고 종료될 때까지 기다린다.
+	void DestroyWorkerThread();
+
+	// worker thread가 완료 통지를 처리한 뒤마다 pTimingWheel->Advance()를 호출한다.
+	// 등록하면 완료 통지가 없어도 TIMER_TICK_MSEC마다 깨어나서 timer를 실행한다.
+	// CreateWorkerThread() 전에 호출한다.
+	void SetTimingWheel(TimingWheel* pTimingWheel);
+
+	// worker thread가 완료 통지를 처리한 뒤에 pJobSystem의 job을 하나씩 돕는다.
+	// job을 실행했다면 다음 GetCompletions()는 기다리지 않고 완료 통지만 확인해서
+	// IO 처리를 미루지 않으면서 job이 남아있는 동안 계속 돕는다.
+	// pJobSystem은 worker thread 수만큼 helperThreadCnt를 잡아서 Create()해야 하고
+	// CreateWorkerThread() 전에 호출한다.
+	void SetJobSystem(JobSystem* pJobSystem);
+
+	// 모든 connection이 같이 사용하는 recv 버퍼 하나의 크기와 개수
+	// (InitConfig::mSharedRecvBufSize, mSharedRecvBufCnt, 0이면 DEFAULT_SHARED_RECV_BUF_SIZE, CNT)
+	// 공유 recv 버퍼를 지원하는 backend(io_uring)는 모든 recv를 이 버퍼로 받기 때문에
+	// 동시에 데이터가 도착하는 connection 수와 트래픽에 맞춰 잡는다.
+	// Create() 전에 호출한다.
+	void SetSharedRecvBuffer(int bufSize, int bufCnt);
+
+	// backend가 connection index indexOffset, indexOffset + indexStride, indexOffset + indexStride * 2, ...만 맡는다.
+	// backend는 connection index로 자원을 찾는데
+	// 이렇게 맡은 connection들만 0부터 이어지는 번호로 바꿔서 찾기 때문에
+	// Create()에는 맡은 connection 수만 넘기면 된다(ShardedAcceptor).
+	// Create() 전에 호출한다.
+	void SetConnectionIndexMapping(int indexOffset, int indexStride);
+
+	// worker thread를 firstCpu번 CPU부터 하나씩 고정한다(CPU 수를 넘으면 0번부터 다시).
+	// 지정하지 않으면(-1) OS가 정한다.
+	// CreateWorkerThread() 전에 호출한다.
+	void SetWorkerThreadAffinity(int firstCpu);
+
+	// worker thread 본체
+	// 한 번 깨어날 때마다 여러 작업 완료 통지를 한꺼번에 꺼내서 처리한다.
+	void WorkerThread();
+
+	// backend가 지금까지 호출한 시스템 콜 횟수
+	// backend마다 패킷 하나를 처리하는데 시스템 콜을 얼마나 쓰는지 비교하기 위한 값
+	LONG64 GetSyscallCount();
+
+	// worker thread가 완료 통지를 꺼내온 횟수와 꺼내온 완료 통지 수
+	// 평균(완료 통지 수 / 깨어난 횟수)이 batch 크기에 계속 닿는다면 batch 크기를 늘려볼 수 있다.
+	LONG64 GetWakeupCount();
+	LONG64 GetCompletionCount();
+	double GetAverageCompletionsPerWakeup();
+
+	// zero-copy 송신의 완료 알림 수와
+	// 그 중에서 kernel이 결국 복사해서 보낸 수(loopback, zero-copy를 지원하지 않는 NIC)
+	LONG64 GetZeroCopyNotifyCount();
+	LONG64 GetZeroCopyCopiedCount();
+
+public:
+	IOBackend(const IOBackend& rhs) = delete;
+	IOBackend(IOBackend&& rhs) = delete;
+
+	IOBackend& operator=(const IOBackend& rhs) = delete;
+	IOBackend& operator=(IOBackend&& rhs) = delete;
+
+protected:
+	// 현재 thread가 worker thread인지 여부
+	// worker thread는 요청을 한 뒤에 곧바로 GetCompletions()를 다시 호출하기 때문에
+	// backend가 잠들어 있는 다른 worker thread를 깨울지 판단할 때 사용한다.
+	// 다른 backend의 worker thread라면 false
+	bool IsWorkerThread();
+
+	// SetConnectionIndexMapping()에 따라 connection index를 backend의 자원 번호로 바꾼다.
+	// 이 backend가 맡지 않은 connection이라면 -1
+	int GetContextIndex(int connectionIndex);
+
+	// 시스템 콜을 호출할 때마다 backend가 직접 센다.
+	void CountSyscall();
+
+	// zero-copy 송신의 완료 알림을 받을 때마다 센다.
+	void CountZeroCopyNotify(bool isCopied);
+
+protected:
+	// SetSharedRecvBuffer()로 지정한 공유 recv 버퍼 하나의 크기와 개수
+	int mSharedRecvBufSize;
+	int mSharedRecvBufCnt;
+
+	// SetConnectionIndexMapping()으로 지정한 값
+	int mConnectionIndexOffset;
+	int mConnectionIndexStride;
+
+private:
+	// SetWorkerThreadAffinity()에 따라 workerIndex번째 worker thread를 CPU에 고정한다.
+	void PinWorkerThread(int workerIndex);
+
+private:
+#ifdef _WIN32
+	HANDLE* mWorkerThreads;
+#else
+	pthread_t* mWorkerThreads;
+#endif
+
+	int mWorkerThreadCnt;
+	int mWorkerThreadFirstCpu;
+	int mCompletionBatchSize;
+
+	TimingWheel* mTimingWheel;
+	JobSystem* mJobSystem;
+
+	LONG64 mSyscallCnt;
+	LONG64 mWakeupCnt;
+	LONG64 mCompletionCnt;
+
+	LONG64 mZeroCopyNotifyCnt;
+	LONG64 mZeroCopyCopiedCnt;
+};
\ No newline at end of file
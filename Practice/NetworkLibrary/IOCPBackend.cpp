@@ -0,0 +1,315 @@
+﻿#ifdef _WIN32
+
+// AcceptEx() 함수를 호출하려면 mswsock.h가 필요한데
+// ws2tcpip.h를 포함하지 않으면, AcceptEx() 함수를 식별하지 못함.
+#include <ws2tcpip.h>
+#include <mswsock.h>
+
+#include "Log.h"
+#include "Connection.h"
+#include "IOCPBackend.h"
+
+#pragma comment(lib, "ws2_32")
+#pragma comment(lib, "Mswsock")
+
+IOCPBackend::IOCPBackend()
+	: mIOCP{ NULL }
+{
+}
+
+IOCPBackend::~IOCPBackend()
+{
+	Destroy();
+}
+
+bool IOCPBackend::Create(int maxConnectionCnt)
+{
+	// IOCP 객체를 생성할 때는
+	// 1,2,3번째 인자는 NULL을 넣어주고
+	// 마지막 인자에 동시에 실행 가능한 thread의 개수를 넣어주면 된다.
+	// 0을 넣게되면 머신의 CPU개수와 동일하게 설정된다.
+	mIOCP = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+	if (NULL == mIOCP)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOCPBackend::Create() | CreateIoCompletionPort() failed: %lu",
+			GetLastError());
+
+		return false;
+	}
+
+	return true;
+}
+
+void IOCPBackend::Destroy()
+{
+	if (mIOCP)
+	{
+		CloseHandle(mIOCP);
+		mIOCP = NULL;
+	}
+}
+
+bool IOCPBackend::BindListenSocket(SOCKET listenSocket)
+{
+	// AcceptEx()의 작업 완료 통지도 worker IOCP queue로 받기 위해
+	// listen socket도 IOCP 객체에 연결한다.
+	HANDLE retIOCP = CreateIoCompletionPort(
+		reinterpret_cast<HANDLE>(listenSocket),
+		mIOCP,
+		0,
+		0);
+
+	if (NULL == retIOCP || mIOCP != retIOCP)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOCPBackend::BindListenSocket() | CreateIoCompletionPort() failed: %lu",
+			GetLastError());
+
+		return false;
+	}
+
+	return true;
+}
+
+bool IOCPBackend::BindSocket(Connection* pConnection)
+{
+	HANDLE retIOCP = CreateIoCompletionPort(
+		reinterpret_cast<HANDLE>(pConnection->GetSocket()),
+		mIOCP,
+		// Connection 객체의 주소를 캐스팅해서 key값으로 넣어줌.
+		// Connection 객체들은 배열로 선언되어 메모리에 할당되어 있기 때문에
+		// 주소가 겹칠 수 없고
+		// 고유한 key값이 될 자격이 있다.
+		// 다만 작업 완료 통지를 꺼낼 때는
+		// OVERLAPPED_EX의 mConnection으로 Connection 객체를 복구한다.
+		reinterpret_cast<ULONG_PTR>(pConnection),
+		0);
+
+	// 어떤 핸들(여기서는 소켓)을 IOCP 객체에 등록하는
+	// CreateIoCompletionPort() 함수가 성공하면,
+	// 반환 값은 2번째 인자로 넣어준 IOCP 핸들이다.
+	if (NULL == retIOCP || mIOCP != retIOCP)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOCPBackend::BindSocket() | CreateIoCompletionPort() failed: %lu",
+			GetLastError());
+
+		return false;
+	}
+
+	return true;
+}
+
+bool IOCPBackend::Accept(SOCKET listenSocket, OVERLAPPED_EX* pOverlappedEx)
+{
+	Connection* pConnection = reinterpret_cast<Connection*>(pOverlappedEx->mConnection);
+
+	// Accept() 함수는 client의 연결 요청이 들어오면 반환하면서
+	// 해당 유저와 통신하는 전용 client socket을 생성한다.
+	// 하지만 AcceptEx() 함수는 client 연결 요청을 비동기로 처리하고
+	// 이 때 미리 생성해둔 client socket을 인자로 넣어야 한다.
+	SOCKET clientSocket = WSASocket(AF_INET,
+		SOCK_STREAM,
+		IPPROTO_TCP,
+		NULL,
+		0,
+		WSA_FLAG_OVERLAPPED);
+	if (INVALID_SOCKET == clientSocket)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOCPBackend::Accept() | WSASocket() Failed: error[%d]",
+			WSAGetLastError());
+
+		return false;
+	}
+
+	pConnection->SetSocket(clientSocket);
+
+	DWORD bytesReceived{ 0 };
+	BOOL ret = AcceptEx(listenSocket,
+		clientSocket,
+		pOverlappedEx->mWSABuf.buf,
+		// 자동으로 송신되는 server 로컬 주소, client 원격 주소를 제외하고는
+		// 아무 정보도 받지 않을 것이라서 0으로 세팅.
+		// 그렇다면, client로부터 연결 요청이 들어오면,
+		// 추가적인 데이터 수신을 위해 대기하지 않고 바로 작업이 완료되고
+		// IOCP queue에 완료 작업이 추가됨
+		0,
+		sizeof(SOCKADDR_IN) + 16,
+		sizeof(SOCKADDR_IN) + 16,
+		&bytesReceived,
+		// overlapped 구조체를 포함하여 추가 정보를 넣어서 확장한
+		// OverlappedEx 구조체는
+		// 가장 선두에 overlapped 구조체가 위치하고 있기 때문에
+		// OverlappedEx 데이터의 시작 주소가 곧 overlapped 데이터 시작 주소이다.
+		reinterpret_cast<LPOVERLAPPED>(pOverlappedEx));
+	CountSyscall();
+
+	if (FALSE == ret && WSA_IO_PENDING != WSAGetLastError())
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOCPBackend::Accept() | AcceptEx() failed: error[%d]",
+			WSAGetLastError());
+
+		return false;
+	}
+
+	return true;
+}
+
+bool IOCPBackend::Recv(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx)
+{
+	DWORD numOfBytesRecvd{ 0 };
+	DWORD flag{ 0 };
+	int ret = WSARecv(
+		pConnection->GetSocket(),
+		&pOverlappedEx->mWSABuf,
+		1,
+		&numOfBytesRecvd,
+		&flag,
+		&pOverlappedEx->mOverlapped,
+		NULL);
+	CountSyscall();
+
+	if (SOCKET_ERROR == ret && WSA_IO_PENDING != WSAGetLastError())
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOCPBackend::Recv() | WSARecv() failed: %d",
+			WSAGetLastError());
+
+		return false;
+	}
+
+	return true;
+}
+
+bool IOCPBackend::Send(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx)
+{
+	DWORD numOfBytesSent{ 0 };
+
+	// 버퍼 조각이 여러 개여도 WSASend() 한 번으로 송신한다.
+	int ret = WSASend(
+		pConnection->GetSocket(),
+		pOverlappedEx->mSendBufs,
+		static_cast<DWORD>(pOverlappedEx->mSendBufCnt),
+		&numOfBytesSent,
+		0,
+		&pOverlappedEx->mOverlapped,
+		NULL);
+	CountSyscall();
+
+	if (SOCKET_ERROR == ret && WSA_IO_PENDING != WSAGetLastError())
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOCPBackend::Send() | socket[%llu] WSASend() failed: %d",
+			pConnection->GetSocket(), WSAGetLastError());
+
+		return false;
+	}
+
+	return true;
+}
+
+void IOCPBackend::GetRemoteAddress(OVERLAPPED_EX* pOverlappedEx, char* pIP, int ipLength)
+{
+	SOCKADDR* pLocalAddr{ nullptr };
+	SOCKADDR* pRemoteAddr{ nullptr };
+	int localAddrLength{ 0 };
+	int remoteAddrLength{ 0 };
+
+	// AcceptEx()가 mWSABuf.buf에 저장해둔
+	// server의 local 주소와 client의 remote 주소를 꺼낸다.
+	GetAcceptExSockaddrs(pOverlappedEx->mWSABuf.buf,
+		0,
+		sizeof(SOCKADDR_IN) + 16,
+		sizeof(SOCKADDR_IN) + 16,
+		&pLocalAddr,
+		&localAddrLength,
+		&pRemoteAddr,
+		&remoteAddrLength);
+
+	inet_ntop(AF_INET,
+		&reinterpret_cast<SOCKADDR_IN*>(pRemoteAddr)->sin_addr,
+		pIP,
+		ipLength);
+}
+
+void IOCPBackend::CloseSocket(Connection* pConnection)
+{
+	// socket을 닫으면, 진행중이던 overlapped IO는 중단되고
+	// 실패한 작업 완료 통지로 IOCP queue에 들어간다.
+	closesocket(pConnection->GetSocket());
+	CountSyscall();
+}
+
+int IOCPBackend::GetCompletions(IOCompletion* pCompletions, int maxCount, DWORD timeout)
+{
+	if (MAX_COMPLETION_BATCH < maxCount)
+	{
+		maxCount = MAX_COMPLETION_BATCH;
+	}
+
+	OVERLAPPED_ENTRY entries[MAX_COMPLETION_BATCH];
+	ULONG entryCnt{ 0 };
+
+	// GQCS() 함수는 한 번에 완료 통지를 하나만 꺼내기 때문에
+	// 부하가 높으면 완료 통지 수만큼 시스템 콜을 호출하게 된다.
+	// GQCSEx() 함수는 IOCP queue에 쌓인 완료 통지를 최대 maxCount개까지 한 번에 꺼내온다.
+	// 완료된 IO 작업이 없다면,
+	// 호출한 thread는 Waiting Thread Queue에 들어가 대기하고 있는다.
+	BOOL success = GetQueuedCompletionStatusEx(
+		mIOCP,
+		entries,
+		static_cast<ULONG>(maxCount),
+		&entryCnt,
+		timeout,
+		FALSE);
+	CountSyscall();
+
+	// timeout 등으로 완료 통지를 하나도 꺼내오지 못했다.
+	if (FALSE == success)
+	{
+		return 0;
+	}
+
+	for (ULONG i = 0; i < entryCnt; ++i)
+	{
+		OVERLAPPED_ENTRY& entry = entries[i];
+
+		// PostQuit()에서 넣은 종료 요청이라면
+		// mOverlappedEx가 nullptr인 채로 넘겨준다.
+		pCompletions[i].mOverlappedEx = reinterpret_cast<OVERLAPPED_EX*>(entry.lpOverlapped);
+		pCompletions[i].mTransferredBytes = entry.dwNumberOfBytesTransferred;
+
+		// GQCS() 함수는 실패한 작업을 반환 값(FALSE)으로 알려주지만
+		// GQCSEx() 함수는 작업마다 결과를 알려주지 않기 때문에
+		// kernel이 OVERLAPPED::Internal에 남긴 상태 코드(NTSTATUS)로 확인한다.
+		// 음수면 실패
+		pCompletions[i].mIsSuccess = nullptr == entry.lpOverlapped ||
+			0 <= static_cast<LONG>(entry.lpOverlapped->Internal);
+	}
+
+	return static_cast<int>(entryCnt);
+}
+
+bool IOCPBackend::PostQuit()
+{
+	// 전송 바이트 수를 0으로
+	// overlapped 구조체에 대한 값은 nullptr로 세팅하여
+	// GQCS() 함수에서 이를 그대로 확인하여 worker thread가 종료한다.
+	CountSyscall();
+	return FALSE != PostQueuedCompletionStatus(mIOCP, 0, 0, nullptr);
+}
+
+bool IOCPBackend::PostCompletion(OVERLAPPED_EX* pOverlappedEx)
+{
+	// IOCP queue에 넣으면 대기중인 worker thread 하나가 깨어나서 가져간다.
+	// Internal이 0이라서 GetCompletions()는 성공한 작업으로 본다.
+	ZeroMemory(&pOverlappedEx->mOverlapped, sizeof(pOverlappedEx->mOverlapped));
+
+	CountSyscall();
+	return FALSE != PostQueuedCompletionStatus(mIOCP, 0, 0, &pOverlappedEx->mOverlapped);
+}
+
+#endif
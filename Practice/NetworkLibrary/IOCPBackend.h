@@ -0,0 +1,43 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// IO Completion Port를 사용하는 backend
+// 기존 Connection 코드가 직접 호출하던
+// CreateIoCompletionPort(), AcceptEx(), WSARecv(), WSASend(), GQCS()를
+// 그대로 옮겨온 것이다.
+
+#include "IOBackend.h"
+
+#ifdef _WIN32
+
+class NETLIB_API IOCPBackend : public IOBackend
+{
+public:
+	IOCPBackend();
+	~IOCPBackend() override;
+
+public:
+	bool Create(int maxConnectionCnt) override;
+	void Destroy() override;
+
+	bool BindListenSocket(SOCKET listenSocket) override;
+	bool BindSocket(Connection* pConnection) override;
+
+	bool Accept(SOCKET listenSocket, OVERLAPPED_EX* pOverlappedEx) override;
+	bool Recv(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) override;
+	bool Send(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) override;
+
+	void GetRemoteAddress(OVERLAPPED_EX* pOverlappedEx, char* pIP, int ipLength) override;
+	void CloseSocket(Connection* pConnection) override;
+
+	int GetCompletions(IOCompletion* pCompletions, int maxCount, DWORD timeout) override;
+	bool PostQuit() override;
+	bool PostCompletion(OVERLAPPED_EX* pOverlappedEx) override;
+
+private:
+	// Worker IOCP 객체
+	HANDLE mIOCP;
+};
+
+#endif
\ No newline at end of file
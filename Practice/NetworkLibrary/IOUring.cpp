@@ -0,0 +1,320 @@
+﻿#ifndef _WIN32
+
+#include <cstdlib>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "Log.h"
+#include "IOUring.h"
+
+// glibc가 io_uring 함수를 제공하지 않아서 syscall()로 직접 호출한다.
+static int io_uring_setup(unsigned int entries, io_uring_params* pParams)
+{
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, pParams));
+}
+
+static int io_uring_enter(int ringFd, unsigned int toSubmit, unsigned int minComplete,
+	unsigned int flags, void* pArg, size_t argSize)
+{
+	return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, pArg, argSize));
+}
+
+static int io_uring_register(int ringFd, unsigned int opcode, void* pArg, unsigned int argCnt)
+{
+	return static_cast<int>(syscall(__NR_io_uring_register, ringFd, opcode, pArg, argCnt));
+}
+
+IOUring::IOUring()
+	: mRingFd{ -1 }
+	, mSQRing{ nullptr }
+	, mSQRingSize{ 0 }
+	, mCQRing{ nullptr }
+	, mCQRingSize{ 0 }
+	, mSQEs{ nullptr }
+	, mSQEsSize{ 0 }
+	, mSQHead{ nullptr }
+	, mSQTail{ nullptr }
+	, mSQArray{ nullptr }
+	, mSQMask{ 0 }
+	, mSQEntries{ 0 }
+	, mSQLocalTail{ 0 }
+	, mSQFlushedTail{ 0 }
+	, mCQHead{ nullptr }
+	, mCQTail{ nullptr }
+	, mCQEs{ nullptr }
+	, mCQMask{ 0 }
+{
+}
+
+IOUring::~IOUring()
+{
+	Destroy();
+}
+
+bool IOUring::Create(unsigned int entries, unsigned int cqEntries)
+{
+	io_uring_params params{};
+
+	// SUBMIT_ALL: SQE 하나가 실패해도 나머지는 계속 제출
+	params.flags = IORING_SETUP_SUBMIT_ALL;
+	if (0 < cqEntries)
+	{
+		// multishot 요청은 SQE 하나로 CQE를 여러 개 만들기 때문에
+		// CQ를 SQ보다 넉넉하게 잡는다.
+		// 연결이 많아서 kernel의 최대 CQ 크기를 넘으면 setup이 실패하기 때문에
+		// CLAMP로 최대 크기에 맞춰 줄인다.
+		params.flags |= IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+		params.cq_entries = cqEntries;
+	}
+
+	mRingFd = io_uring_setup(entries, &params);
+	if (0 > mRingFd)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOUring::Create() | io_uring_setup() failed: %d",
+			errno);
+
+		mRingFd = -1;
+		return false;
+	}
+
+	mSQRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	mCQRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	// 지원한다면 SQ, CQ를 한 번의 mmap으로 매핑
+	bool isSingleMmap = 0 != (params.features & IORING_FEAT_SINGLE_MMAP);
+	if (isSingleMmap)
+	{
+		if (mCQRingSize > mSQRingSize)
+		{
+			mSQRingSize = mCQRingSize;
+		}
+
+		mCQRingSize = mSQRingSize;
+	}
+
+	mSQRing = mmap(nullptr, mSQRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQ_RING);
+	if (MAP_FAILED == mSQRing)
+	{
+		mSQRing = nullptr;
+		Destroy();
+		return false;
+	}
+
+	if (isSingleMmap)
+	{
+		mCQRing = mSQRing;
+	}
+	else
+	{
+		mCQRing = mmap(nullptr, mCQRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_CQ_RING);
+		if (MAP_FAILED == mCQRing)
+		{
+			mCQRing = nullptr;
+			Destroy();
+			return false;
+		}
+	}
+
+	mSQEsSize = params.sq_entries * sizeof(io_uring_sqe);
+	void* pSQEs = mmap(nullptr, mSQEsSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQES);
+	if (MAP_FAILED == pSQEs)
+	{
+		Destroy();
+		return false;
+	}
+
+	mSQEs = reinterpret_cast<io_uring_sqe*>(pSQEs);
+
+	char* pSQRing = reinterpret_cast<char*>(mSQRing);
+	mSQHead = reinterpret_cast<unsigned int*>(pSQRing + params.sq_off.head);
+	mSQTail = reinterpret_cast<unsigned int*>(pSQRing + params.sq_off.tail);
+	mSQArray = reinterpret_cast<unsigned int*>(pSQRing + params.sq_off.array);
+	mSQMask = *reinterpret_cast<unsigned int*>(pSQRing + params.sq_off.ring_mask);
+	mSQEntries = params.sq_entries;
+
+	// SQ array는 SQE의 index를 담는 간접 참조 배열인데
+	// SQE를 순서대로 사용하기 때문에 항상 자기 자신을 가리키게 해둔다.
+	for (unsigned int i = 0; i < mSQEntries; ++i)
+	{
+		mSQArray[i] = i;
+	}
+
+	mSQLocalTail = *mSQTail;
+	mSQFlushedTail = mSQLocalTail;
+
+	char* pCQRing = reinterpret_cast<char*>(mCQRing);
+	mCQHead = reinterpret_cast<unsigned int*>(pCQRing + params.cq_off.head);
+	mCQTail = reinterpret_cast<unsigned int*>(pCQRing + params.cq_off.tail);
+	mCQEs = reinterpret_cast<io_uring_cqe*>(pCQRing + params.cq_off.cqes);
+	mCQMask = *reinterpret_cast<unsigned int*>(pCQRing + params.cq_off.ring_mask);
+
+	return true;
+}
+
+void IOUring::Destroy()
+{
+	if (mSQEs)
+	{
+		munmap(mSQEs, mSQEsSize);
+		mSQEs = nullptr;
+	}
+
+	if (mCQRing && mCQRing != mSQRing)
+	{
+		munmap(mCQRing, mCQRingSize);
+	}
+	mCQRing = nullptr;
+
+	if (mSQRing)
+	{
+		munmap(mSQRing, mSQRingSize);
+		mSQRing = nullptr;
+	}
+
+	if (-1 != mRingFd)
+	{
+		close(mRingFd);
+		mRingFd = -1;
+	}
+}
+
+io_uring_sqe* IOUring::GetSQE()
+{
+	// kernel이 가져간 위치(head)까지는 다시 사용할 수 있다.
+	unsigned int head = __atomic_load_n(mSQHead, __ATOMIC_ACQUIRE);
+	if (mSQEntries <= mSQLocalTail - head)
+	{
+		return nullptr;
+	}
+
+	io_uring_sqe* pSQE = &mSQEs[mSQLocalTail & mSQMask];
+	++mSQLocalTail;
+
+	ZeroMemory(pSQE, sizeof(io_uring_sqe));
+	return pSQE;
+}
+
+unsigned int IOUring::FlushSQ()
+{
+	unsigned int flushCnt = mSQLocalTail - mSQFlushedTail;
+	if (0 == flushCnt)
+	{
+		return 0;
+	}
+
+	// SQE 내용을 모두 쓴 뒤에 tail이 보이도록 release로 저장
+	__atomic_store_n(mSQTail, mSQLocalTail, __ATOMIC_RELEASE);
+	mSQFlushedTail = mSQLocalTail;
+
+	return flushCnt;
+}
+
+int IOUring::Enter(unsigned int minComplete, const __kernel_timespec* pTimeout)
+{
+	unsigned int toSubmit = __atomic_load_n(mSQTail, __ATOMIC_ACQUIRE) - __atomic_load_n(mSQHead, __ATOMIC_ACQUIRE);
+	unsigned int flags{ 0 };
+	if (0 < minComplete)
+	{
+		flags |= IORING_ENTER_GETEVENTS;
+	}
+
+	int ret{ 0 };
+
+	if (nullptr != pTimeout)
+	{
+		// timeout은 확장 인자로 넘긴다(5.11 이상).
+		io_uring_getevents_arg arg{};
+		arg.ts = reinterpret_cast<unsigned long long>(pTimeout);
+
+		ret = io_uring_enter(mRingFd, toSubmit, minComplete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	}
+	else
+	{
+		ret = io_uring_enter(mRingFd, toSubmit, minComplete, flags, nullptr, 0);
+	}
+
+	return 0 > ret ? -errno : ret;
+}
+
+unsigned int IOUring::CopyCQEs(io_uring_cqe* pCQEs, unsigned int maxCount)
+{
+	unsigned int head = *mCQHead;
+	unsigned int tail = __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE);
+
+	unsigned int copyCnt{ 0 };
+	while (head != tail && maxCount > copyCnt)
+	{
+		pCQEs[copyCnt++] = mCQEs[head & mCQMask];
+		++head;
+	}
+
+	// 복사가 끝난 뒤에 kernel이 그 자리를 다시 쓸 수 있도록 release로 저장
+	__atomic_store_n(mCQHead, head, __ATOMIC_RELEASE);
+
+	return copyCnt;
+}
+
+bool IOUring::HasCQE()
+{
+	return *mCQHead != __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE);
+}
+
+io_uring_buf_ring* IOUring::RegisterBufferRing(unsigned int entries, unsigned short groupID)
+{
+	// kernel이 ring을 page 단위로 고정하기 때문에 page 경계에 맞춰 할당한다.
+	size_t ringSize = entries * sizeof(io_uring_buf);
+
+	void* pRing = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (MAP_FAILED == pRing)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOUring::RegisterBufferRing() | mmap() failed: %d",
+			errno);
+
+		return nullptr;
+	}
+
+	io_uring_buf_reg reg{};
+	reg.ring_addr = reinterpret_cast<unsigned long long>(pRing);
+	reg.ring_entries = entries;
+	reg.bgid = groupID;
+
+	int ret = io_uring_register(mRingFd, IORING_REGISTER_PBUF_RING, &reg, 1);
+	if (0 > ret)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOUring::RegisterBufferRing() | io_uring_register(PBUF_RING) failed: %d",
+			errno);
+
+		munmap(pRing, ringSize);
+		return nullptr;
+	}
+
+	// tail은 첫 번째 항목의 예약 필드와 겹쳐있고 0부터 시작한다.
+	return reinterpret_cast<io_uring_buf_ring*>(pRing);
+}
+
+void IOUring::UnregisterBufferRing(io_uring_buf_ring* pBufferRing, unsigned int entries, unsigned short groupID)
+{
+	if (nullptr == pBufferRing)
+	{
+		return;
+	}
+
+	if (-1 != mRingFd)
+	{
+		io_uring_buf_reg reg{};
+		reg.bgid = groupID;
+
+		io_uring_register(mRingFd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+	}
+
+	munmap(pBufferRing, entries * sizeof(io_uring_buf));
+}
+
+#endif
@@ -0,0 +1,106 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// io_uring 시스템 콜을 직접 감싼 최소한의 wrapper
+//
+// io_uring은 user 영역과 kernel이 공유하는 두 개의 원형 queue로 동작한다.
+// submission queue(SQ)에 작업 요청(SQE)을 채워서 io_uring_enter()로 알려주면
+// kernel이 작업을 수행하고 completion queue(CQ)에 작업 완료 통지(CQE)를 넣어준다.
+// IOCP queue에서 GQCS()로 완료 통지를 꺼내던 것과 흐름이 같다.
+//
+// liburing을 사용하면 편하지만
+// 필요한 기능이 많지 않고, 동작 원리를 알기 위해 직접 작성했다.
+//
+// 이 class는 동기화를 하지 않는다.
+// SQ, CQ를 여러 thread가 사용한다면 사용하는 쪽에서 lock을 걸어야 한다.
+
+#include "Platform.h"
+
+#ifndef _WIN32
+
+#include <linux/io_uring.h>
+
+class NETLIB_API IOUring
+{
+public:
+	IOUring();
+	~IOUring();
+
+public:
+	// entries: SQ 크기, cqEntries: CQ 크기(0이면 SQ의 2배)
+	bool Create(unsigned int entries, unsigned int cqEntries);
+	void Destroy();
+
+public:
+	// 비어있는 SQE를 하나 얻어온다.
+	// SQ가 가득 찼다면 nullptr 반환
+	io_uring_sqe* GetSQE();
+
+	// GetSQE()로 채운 SQE들을 kernel이 볼 수 있도록 SQ tail에 반영한다.
+	// 반환값은 이번에 반영한 SQE의 개수
+	// 여기까지는 SQ lock을 잡고 호출하고
+	// Enter()는 대기할 수 있기 때문에 lock을 풀고 호출한다.
+	unsigned int FlushSQ();
+
+	// SQ tail에 반영된 SQE 중 kernel이 아직 가져가지 않은 것을 모두 넘기고
+	// minComplete개의 완료 통지가 생길 때까지 대기한다.
+	// 여러 thread가 동시에 호출해도 kernel이 SQ head를 기준으로 가져가기 때문에
+	// 같은 SQE가 두 번 제출되지 않는다.
+	// pTimeout이 nullptr이면 무한 대기
+	// 반환값은 io_uring_enter()의 반환값(실패하면 -errno)
+	int Enter(unsigned int minComplete, const __kernel_timespec* pTimeout);
+
+	// CQ에 쌓인 완료 통지를 최대 maxCount개 복사해오고 CQ에서 제거한다.
+	unsigned int CopyCQEs(io_uring_cqe* pCQEs, unsigned int maxCount);
+
+	bool HasCQE();
+
+public:
+	// kernel이 multishot recv에 사용할 버퍼를 고르는 provided buffer ring을 만들어서 등록한다.
+	// entries는 2의 거듭제곱(최대 32768)이어야 한다.
+	// 반환한 ring의 (tail & (entries - 1))번째 io_uring_buf에 버퍼를 채우고 tail을 올리면
+	// 시스템 콜 없이 kernel에게 버퍼를 넘겨줄 수 있다.
+	// SQE의 buf_group에 groupID를 지정하고 IOSQE_BUFFER_SELECT로 요청한다.
+	io_uring_buf_ring* RegisterBufferRing(unsigned int entries, unsigned short groupID);
+	void UnregisterBufferRing(io_uring_buf_ring* pBufferRing, unsigned int entries, unsigned short groupID);
+
+public:
+	IOUring(const IOUring& rhs) = delete;
+	IOUring(IOUring&& rhs) = delete;
+
+	IOUring& operator=(const IOUring& rhs) = delete;
+	IOUring& operator=(IOUring&& rhs) = delete;
+
+private:
+	int mRingFd;
+
+	// SQ, CQ 공유 메모리
+	// kernel이 single mmap을 지원하면 둘은 같은 메모리다.
+	void* mSQRing;
+	size_t mSQRingSize;
+	void* mCQRing;
+	size_t mCQRingSize;
+
+	io_uring_sqe* mSQEs;
+	size_t mSQEsSize;
+
+	// kernel과 공유하는 SQ 변수들
+	unsigned int* mSQHead;
+	unsigned int* mSQTail;
+	unsigned int* mSQArray;
+	unsigned int mSQMask;
+	unsigned int mSQEntries;
+
+	// GetSQE()로 채웠지만 아직 mSQTail에 반영하지 않은 위치
+	unsigned int mSQLocalTail;
+	unsigned int mSQFlushedTail;
+
+	// kernel과 공유하는 CQ 변수들
+	unsigned int* mCQHead;
+	unsigned int* mCQTail;
+	io_uring_cqe* mCQEs;
+	unsigned int mCQMask;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1130 @@
+﻿#ifndef _WIN32
+
+#include "Log.h"
+#include "Connection.h"
+#include "IOUringBackend.h"
+
+// SQ 크기
+// worker thread가 모아두었다가 한 번에 제출하는 SQE가 들어갈 자리
+constexpr unsigned int URING_SQ_ENTRIES{ 4096 };
+
+// multishot recv가 사용하는 provided buffer group id
+constexpr unsigned short URING_BUFFER_GROUP{ 0 };
+
+// kernel이 허용하는 buffer ring의 최대 크기
+// buffer id가 16비트라서 공유 recv 버퍼의 최대 개수이기도 하다.
+constexpr unsigned int URING_MAX_BUFFER_RING_ENTRIES{ 32768 };
+
+// ready queue 크기는 EpollBackend와 같은 기준으로 잡는다.
+constexpr int URING_READY_QUEUE_SIZE_PER_CONNECTION{ 5 };
+constexpr int URING_READY_QUEUE_EXTRA_SIZE{ 1024 };
+
+// SQE의 user_data 하위 3비트에 요청 종류를 기록해두고
+// 완료 통지를 꺼냈을 때 어떤 요청의 결과인지 구분한다.
+// OVERLAPPED_EX는 8바이트 단위로 정렬되어 있어서 주소의 하위 3비트는 항상 0이다.
+enum class eUringRequestType : unsigned long long
+{
+	REQUEST_NONE,
+	REQUEST_ACCEPT,
+	REQUEST_RECV,
+	REQUEST_SEND,
+	REQUEST_WAKEUP,
+	REQUEST_SEND_ZC,
+};
+
+constexpr unsigned long long URING_REQUEST_TYPE_MASK{ 0x7 };
+
+// multishot recv, SEND_ZC는 OVERLAPPED_EX 대신 context의 index와 generation을 user_data에 담는다.
+// 상위 32비트: generation, 하위 32비트: index << 3 | 요청 종류
+static unsigned long long MakeContextUserData(int index, unsigned int generation, eUringRequestType requestType)
+{
+	return (static_cast<unsigned long long>(generation) << 32) |
+		(static_cast<unsigned long long>(index) << 3) |
+		static_cast<unsigned long long>(requestType);
+}
+
+IOUringBackend::IOUringBackend()
+	: mRing{}
+	, mMaxConnectionCnt{ 0 }
+	, mContexts{ nullptr }
+	, mListenSocket{ INVALID_SOCKET }
+	, mIsAcceptArmed{ false }
+	, mPendingAccepts{ nullptr }
+	, mAcceptedSockets{ nullptr }
+	, mRecvBuffers{ nullptr }
+	, mRecvBufferSize{ 0 }
+	, mRecvBufferCnt{ 0 }
+	, mBufferRing{ nullptr }
+	, mBufferRingEntries{ 0 }
+	, mBufferRingTail{ 0 }
+	, mIsBufferReturned{ false }
+	, mBufferOffset{ nullptr }
+	, mBufferLength{ nullptr }
+	, mBufferNext{ nullptr }
+	, mStarvedQueue{ nullptr }
+	, mReadyQueue{ nullptr }
+{
+}
+
+IOUringBackend::~IOUringBackend()
+{
+	Destroy();
+}
+
+bool IOUringBackend::Create(int maxConnectionCnt)
+{
+	// multishot 요청은 SQE 하나가 CQE를 계속 만들어내기 때문에
+	// CQ는 connection 수에 맞춰 넉넉하게 잡는다.
+	unsigned int cqEntries = URING_SQ_ENTRIES * 2;
+	if (static_cast<unsigned int>(maxConnectionCnt) * 4 > cqEntries)
+	{
+		cqEntries = static_cast<unsigned int>(maxConnectionCnt) * 4;
+	}
+
+	if (false == mRing.Create(URING_SQ_ENTRIES, cqEntries))
+	{
+		return false;
+	}
+
+	mRecvBufferSize = static_cast<unsigned int>(mSharedRecvBufSize);
+	mRecvBufferCnt = static_cast<unsigned int>(mSharedRecvBufCnt);
+	if (URING_MAX_BUFFER_RING_ENTRIES < mRecvBufferCnt)
+	{
+		LOG(eLogInfoType::LOG_INFO_NORMAL,
+			L"SYSTEM | IOUringBackend::Create() | shared recv buffer count %u is clamped to %u",
+			mRecvBufferCnt, URING_MAX_BUFFER_RING_ENTRIES);
+
+		mRecvBufferCnt = URING_MAX_BUFFER_RING_ENTRIES;
+	}
+
+	// buffer ring 크기는 2의 거듭제곱이어야 해서 버퍼 수보다 크거나 같게 잡는다.
+	mBufferRingEntries = 1;
+	while (mRecvBufferCnt > mBufferRingEntries)
+	{
+		mBufferRingEntries <<= 1;
+	}
+
+	mRecvBuffers = new char[static_cast<size_t>(mRecvBufferCnt) * mRecvBufferSize];
+	mBufferOffset = new unsigned int[mRecvBufferCnt]{};
+	mBufferLength = new unsigned int[mRecvBufferCnt]{};
+	mBufferNext = new int[mRecvBufferCnt]{};
+
+	// 처음에는 모든 버퍼를 ring에 채워서 kernel에게 넘겨둔다.
+	mBufferRing = mRing.RegisterBufferRing(mBufferRingEntries, URING_BUFFER_GROUP);
+	if (nullptr == mBufferRing)
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < mRecvBufferCnt; ++i)
+	{
+		ReturnBuffer(static_cast<unsigned short>(i));
+	}
+
+	// 처음 채운 버퍼로 다시 걸 recv는 없다.
+	mIsBufferReturned = false;
+
+	mMaxConnectionCnt = maxConnectionCnt;
+	mContexts = new UringContext[mMaxConnectionCnt]{};
+
+	for (int i = 0; i < mMaxConnectionCnt; ++i)
+	{
+		UringContext& context = mContexts[i];
+
+		context.mSocket = INVALID_SOCKET;
+		context.mIndex = i;
+		context.mGeneration = 0;
+		context.mPendingRecv = nullptr;
+		context.mChunkHead = -1;
+		context.mChunkTail = -1;
+		context.mIsRecvArmed = false;
+		context.mIsSharedRecv = false;
+		context.mIsEOF = false;
+		context.mIsRecvFailed = false;
+		context.mZeroCopySend = nullptr;
+		context.mZeroCopyOverlappedEx = nullptr;
+		context.mZeroCopyQueue.Clear();
+		context.mZeroCopyEarlyNotifyCnt = 0;
+	}
+
+	mPendingAccepts = new Queue<OVERLAPPED_EX*>{ mMaxConnectionCnt };
+	mAcceptedSockets = new Queue<SOCKET>{ mMaxConnectionCnt };
+	mStarvedQueue = new Queue<int>{ mMaxConnectionCnt };
+	mReadyQueue = new MPMCQueue<IOCompletion>{
+		mMaxConnectionCnt * URING_READY_QUEUE_SIZE_PER_CONNECTION + URING_READY_QUEUE_EXTRA_SIZE };
+
+	return true;
+}
+
+void IOUringBackend::Destroy()
+{
+	// ring을 닫으면 걸려있던 multishot 요청과 넘겨둔 버퍼도 모두 정리된다.
+	mRing.UnregisterBufferRing(mBufferRing, mBufferRingEntries, URING_BUFFER_GROUP);
+	mBufferRing = nullptr;
+	mBufferRingTail = 0;
+	mIsBufferReturned = false;
+
+	mRing.Destroy();
+
+	delete[] mRecvBuffers;
+	mRecvBuffers = nullptr;
+
+	delete[] mBufferOffset;
+	mBufferOffset = nullptr;
+
+	delete[] mBufferLength;
+	mBufferLength = nullptr;
+
+	delete[] mBufferNext;
+	mBufferNext = nullptr;
+
+	delete[] mContexts;
+	mContexts = nullptr;
+
+	delete mPendingAccepts;
+	mPendingAccepts = nullptr;
+
+	if (nullptr != mAcceptedSockets)
+	{
+		while (false == mAcceptedSockets->IsEmpty())
+		{
+			close(mAcceptedSockets->Front());
+			mAcceptedSockets->Pop();
+		}
+	}
+
+	delete mAcceptedSockets;
+	mAcceptedSockets = nullptr;
+
+	delete mStarvedQueue;
+	mStarvedQueue = nullptr;
+
+	delete mReadyQueue;
+	mReadyQueue = nullptr;
+}
+
+bool IOUringBackend::BindListenSocket(SOCKET listenSocket)
+{
+	// 실제 accept 요청은 Connection이 처음 Accept()를 호출할 때 건다.
+	mListenSocket = listenSocket;
+
+	return true;
+}
+
+bool IOUringBackend::BindSocket(Connection* pConnection)
+{
+	UringContext* pContext = GetContext(pConnection);
+	if (nullptr == pContext)
+	{
+		return false;
+	}
+
+	Monitor::Owner lock{ pContext->mSyncObject };
+
+	pContext->mSocket = pConnection->GetSocket();
+	pContext->mIsSharedRecv = pConnection->IsSharedRecvBuffer();
+	pContext->mPendingRecv = nullptr;
+	pContext->mChunkHead = -1;
+	pContext->mChunkTail = -1;
+	pContext->mIsEOF = false;
+	pContext->mIsRecvFailed = false;
+	pContext->mZeroCopyOverlappedEx = pConnection->mZeroCopyOverlappedEx;
+	pContext->mZeroCopyQueue.Clear();
+	pContext->mZeroCopyEarlyNotifyCnt = 0;
+
+	// client socket을 등록하면서 multishot recv를 한 번만 걸어둔다.
+	ArmRecv(*pContext);
+
+	return pContext->mIsRecvArmed;
+}
+
+bool IOUringBackend::Accept(SOCKET, OVERLAPPED_EX* pOverlappedEx)
+{
+	Monitor::Owner lock{ mAcceptSyncObject };
+
+	// 받을 Connection이 없어서 들고 있던 접속이 있다면 바로 넘겨준다.
+	if (false == mAcceptedSockets->IsEmpty())
+	{
+		reinterpret_cast<Connection*>(pOverlappedEx->mConnection)->SetSocket(mAcceptedSockets->Front());
+		mAcceptedSockets->Pop();
+
+		PushReady(IOCompletion{ pOverlappedEx, 0, true });
+		return true;
+	}
+
+	// AcceptEx()를 거는 대신 접속을 받을 대기 목록에 넣는다.
+	if (false == mPendingAccepts->Push(pOverlappedEx))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOUringBackend::Accept() | pending accept queue is full");
+
+		return false;
+	}
+
+	if (false == mIsAcceptArmed)
+	{
+		ArmAccept();
+	}
+
+	return true;
+}
+
+bool IOUringBackend::Recv(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx)
+{
+	UringContext* pContext = GetContext(pConnection);
+	if (nullptr == pContext)
+	{
+		return false;
+	}
+
+	IOCompletion completion{};
+	bool isCompleted{ false };
+
+	{
+		Monitor::Owner lock{ pContext->mSyncObject };
+
+		if (INVALID_SOCKET == pContext->mSocket)
+		{
+			return false;
+		}
+
+		// multishot recv가 이미 걸려있기 때문에 새로운 요청을 하지 않는다.
+		// 도착해 있는 데이터가 있다면 바로 채워주고
+		// 없다면 다음 recv 완료 통지가 채워준다.
+		pContext->mPendingRecv = pOverlappedEx;
+		isCompleted = FillRecv(*pContext, completion);
+	}
+
+	if (isCompleted)
+	{
+		PushReady(completion);
+	}
+
+	return true;
+}
+
+bool IOUringBackend::Send(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx)
+{
+	io_uring_sqe sqe{};
+	sqe.fd = pConnection->GetSocket();
+
+	UringContext* pContext = GetContext(pConnection);
+
+	if (pOverlappedEx->mIsZeroCopy)
+	{
+		if (nullptr == pContext)
+		{
+			return false;
+		}
+
+		Monitor::Owner lock{ pContext->mSyncObject };
+
+		// notif를 기다리는 송신이 너무 많으면 복사 송신
+		if (pContext->mZeroCopyQueue.IsFull())
+		{
+			pOverlappedEx->mIsZeroCopy = false;
+		}
+		else
+		{
+			pContext->mZeroCopySend = pOverlappedEx;
+
+			sqe.user_data = MakeContextUserData(pContext->mIndex, pContext->mGeneration, eUringRequestType::REQUEST_SEND_ZC);
+
+			// kernel이 결국 복사해서 보냈는지 notif의 res에 알려달라고 요청
+			sqe.ioprio = IORING_SEND_ZC_REPORT_USAGE;
+		}
+	}
+
+	if (1 == pOverlappedEx->mSendBufCnt)
+	{
+		sqe.opcode = pOverlappedEx->mIsZeroCopy ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+		sqe.addr = reinterpret_cast<unsigned long long>(pOverlappedEx->mSendBufs[0].buf);
+		sqe.len = pOverlappedEx->mSendBufs[0].len;
+	}
+	else
+	{
+		// 버퍼 조각이 여러 개면 sendmsg 요청 하나로 송신한다.
+		if (nullptr == pContext)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < pOverlappedEx->mSendBufCnt; ++i)
+		{
+			pContext->mSendIov[i].iov_base = pOverlappedEx->mSendBufs[i].buf;
+			pContext->mSendIov[i].iov_len = pOverlappedEx->mSendBufs[i].len;
+		}
+
+		pContext->mSendMsg = msghdr{};
+		pContext->mSendMsg.msg_iov = pContext->mSendIov;
+		pContext->mSendMsg.msg_iovlen = pOverlappedEx->mSendBufCnt;
+
+		sqe.opcode = pOverlappedEx->mIsZeroCopy ? IORING_OP_SENDMSG_ZC : IORING_OP_SENDMSG;
+		sqe.addr = reinterpret_cast<unsigned long long>(&pContext->mSendMsg);
+		sqe.len = 1;
+	}
+
+	// 끊어진 socket에 send()를 하면 SIGPIPE로 프로세스가 종료되기 때문에
+	// MSG_NOSIGNAL로 에러만 반환하게 한다.
+	sqe.msg_flags = MSG_NOSIGNAL;
+	if (false == pOverlappedEx->mIsZeroCopy)
+	{
+		sqe.user_data = reinterpret_cast<unsigned long long>(pOverlappedEx) |
+			static_cast<unsigned long long>(eUringRequestType::REQUEST_SEND);
+	}
+
+	return PushSQE(sqe);
+}
+
+void IOUringBackend::GetRemoteAddress(OVERLAPPED_EX* pOverlappedEx, char* pIP, int ipLength)
+{
+	// multishot accept는 완료 통지마다 주소를 따로 받을 수 없어서
+	// 접속한 socket에게 직접 물어본다.
+	Connection* pConnection = reinterpret_cast<Connection*>(pOverlappedEx->mConnection);
+
+	SOCKADDR_IN remoteAddr{};
+	socklen_t addrLength = sizeof(remoteAddr);
+
+	getpeername(pConnection->GetSocket(), reinterpret_cast<SOCKADDR*>(&remoteAddr), &addrLength);
+	CountSyscall();
+
+	inet_ntop(AF_INET,
+		&remoteAddr.sin_addr,
+		pIP,
+		ipLength);
+}
+
+void IOUringBackend::CloseSocket(Connection* pConnection)
+{
+	UringContext* pContext = GetContext(pConnection);
+	SOCKET socket = pConnection->GetSocket();
+	OVERLAPPED_EX* pPendingRecv{ nullptr };
+
+	if (nullptr != pContext)
+	{
+		Monitor::Owner lock{ pContext->mSyncObject };
+
+		// 이전 client의 multishot recv가 늦게 보내는 완료 통지는 무시하도록
+		++pContext->mGeneration;
+		pContext->mSocket = INVALID_SOCKET;
+
+		// 아직 Connection이 가져가지 않은 버퍼는 kernel에게 돌려준다.
+		while (-1 != pContext->mChunkHead)
+		{
+			int bufferID = pContext->mChunkHead;
+			pContext->mChunkHead = mBufferNext[bufferID];
+
+			ReturnBuffer(static_cast<unsigned short>(bufferID));
+		}
+
+		pContext->mChunkTail = -1;
+		pContext->mIsRecvArmed = false;
+		pContext->mIsEOF = false;
+		pContext->mIsRecvFailed = false;
+
+		// 이전 client의 notif는 generation으로 걸러지니 기다리던 송신 크기는 버린다.
+		pContext->mZeroCopyQueue.Clear();
+		pContext->mZeroCopyEarlyNotifyCnt = 0;
+
+		pPendingRecv = pContext->mPendingRecv;
+		pContext->mPendingRecv = nullptr;
+	}
+
+	if (INVALID_SOCKET != socket)
+	{
+		// io_uring 요청은 socket을 닫아도 취소되지 않고 file을 붙잡고 있다.
+		// shutdown()으로 걸려있는 multishot recv와 send가 바로 끝나게 만든 뒤에 닫는다.
+		shutdown(socket, SHUT_RDWR);
+		close(socket);
+		CountSyscall();
+		CountSyscall();
+	}
+
+	// IOCP처럼 대기중이던 recv 작업을 실패로 완료시킨다.
+	if (nullptr != pPendingRecv)
+	{
+		PushReady(IOCompletion{ pPendingRecv, 0, false });
+	}
+}
+
+int IOUringBackend::GetCompletions(IOCompletion* pCompletions, int maxCount, DWORD timeout)
+{
+	if (MAX_COMPLETION_BATCH < maxCount)
+	{
+		maxCount = MAX_COMPLETION_BATCH;
+	}
+
+	int completionCnt = PopReady(pCompletions, maxCount);
+	if (maxCount == completionCnt)
+	{
+		return completionCnt;
+	}
+
+	// 지난번 완료 통지를 처리하면서 모아둔 SQE를
+	// 완료 통지를 기다리는 io_uring_enter() 한 번에 같이 제출한다.
+	unsigned int flushCnt{ 0 };
+	{
+		Monitor::Owner lock{ mSQSyncObject };
+		flushCnt = mRing.FlushSQ();
+	}
+
+	// 이미 꺼낼 완료 통지가 있다면 대기하지 않는다.
+	unsigned int minComplete = (0 == completionCnt && false == mRing.HasCQE()) ? 1 : 0;
+
+	if (0 < flushCnt || 0 < minComplete)
+	{
+		__kernel_timespec waitTime{};
+		__kernel_timespec* pWaitTime{ nullptr };
+
+		if (INFINITE != timeout)
+		{
+			waitTime.tv_sec = timeout / 1000;
+			waitTime.tv_nsec = (timeout % 1000) * 1000000LL;
+			pWaitTime = &waitTime;
+		}
+
+		int ret = mRing.Enter(minComplete, pWaitTime);
+		CountSyscall();
+
+		if (0 > ret && -EINTR != ret && -ETIME != ret && -EAGAIN != ret && -EBUSY != ret)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | IOUringBackend::GetCompletions() | io_uring_enter() failed: %d",
+				-ret);
+		}
+	}
+
+	// CQE 하나는 최대 하나의 완료 통지가 되기 때문에
+	// 남은 자리만큼만 꺼내온다.
+	io_uring_cqe cqes[MAX_COMPLETION_BATCH];
+	unsigned int cqeCnt{ 0 };
+	{
+		Monitor::Owner lock{ mCQSyncObject };
+		cqeCnt = mRing.CopyCQEs(cqes, static_cast<unsigned int>(maxCount - completionCnt));
+	}
+
+	for (unsigned int i = 0; i < cqeCnt; ++i)
+	{
+		IOCompletion completion{};
+		if (HandleCQE(cqes[i], completion))
+		{
+			pCompletions[completionCnt++] = completion;
+		}
+	}
+
+	RearmStarved();
+
+	if (maxCount > completionCnt)
+	{
+		completionCnt += PopReady(pCompletions + completionCnt, maxCount - completionCnt);
+	}
+
+	return completionCnt;
+}
+
+bool IOUringBackend::PostQuit()
+{
+	PushReady(IOCompletion{ nullptr, 0, true });
+
+	// 종료 요청은 worker thread가 다른 worker thread 몫을 다시 넣어주는 경우도 있어서
+	// 누가 넣든 항상 깨운다.
+	WakeUp();
+
+	return true;
+}
+
+bool IOUringBackend::PostCompletion(OVERLAPPED_EX* pOverlappedEx)
+{
+	if (false == mReadyQueue->TryPush(IOCompletion{ pOverlappedEx, 0, true }))
+	{
+		return false;
+	}
+
+	// worker thread가 넣었더라도 그 thread는 하던 일을 마저 처리해야 하니
+	// 쉬고 있는 다른 worker thread가 가져가도록 깨운다.
+	WakeUp();
+
+	return true;
+}
+
+bool IOUringBackend::IsZeroCopySendSupported()
+{
+	return true;
+}
+
+int IOUringBackend::GetAcceptBacklog()
+{
+	return mAcceptedSockets->GetCurrentSize();
+}
+
+bool IOUringBackend::IsSharedRecvBufferSupported()
+{
+	return true;
+}
+
+void IOUringBackend::ReleaseRecvBuffer(Connection*, int bufferID)
+{
+	if (0 > bufferID || static_cast<int>(mRecvBufferCnt) <= bufferID)
+	{
+		return;
+	}
+
+	ReturnBuffer(static_cast<unsigned short>(bufferID));
+}
+
+bool IOUringBackend::PushSQE(const io_uring_sqe& sqe)
+{
+	Monitor::Owner lock{ mSQSyncObject };
+
+	io_uring_sqe* pSQE = mRing.GetSQE();
+	if (nullptr == pSQE)
+	{
+		// SQ가 가득 찼다면 먼저 제출해서 자리를 비운다.
+		mRing.FlushSQ();
+		mRing.Enter(0, nullptr);
+		CountSyscall();
+
+		pSQE = mRing.GetSQE();
+		if (nullptr == pSQE)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | IOUringBackend::PushSQE() | submission queue is full");
+
+			return false;
+		}
+	}
+
+	*pSQE = sqe;
+
+	// worker thread는 곧 GetCompletions()로 돌아가서 모아둔 SQE를 제출한다.
+	// 다른 thread(Connection 생성, 게임 로직 thread의 SendPost() 등)는
+	// 언제 다시 올지 모르기 때문에 바로 제출
+	if (false == IsWorkerThread())
+	{
+		mRing.FlushSQ();
+		mRing.Enter(0, nullptr);
+		CountSyscall();
+	}
+
+	return true;
+}
+
+void IOUringBackend::SubmitNow()
+{
+	Monitor::Owner lock{ mSQSyncObject };
+
+	mRing.FlushSQ();
+	mRing.Enter(0, nullptr);
+	CountSyscall();
+}
+
+bool IOUringBackend::HandleCQE(const io_uring_cqe& cqe, IOCompletion& completion)
+{
+	eUringRequestType requestType = static_cast<eUringRequestType>(cqe.user_data & URING_REQUEST_TYPE_MASK);
+
+	switch (requestType)
+	{
+	case eUringRequestType::REQUEST_ACCEPT:
+		return HandleAcceptCQE(cqe, completion);
+
+	case eUringRequestType::REQUEST_RECV:
+		return HandleRecvCQE(cqe, completion);
+
+	case eUringRequestType::REQUEST_SEND:
+		// send는 socket을 닫은 뒤에 도착한 완료 통지라도 그대로 넘겨야
+		// Connection의 send IO 작업 횟수가 0이 될 수 있다.
+		completion.mOverlappedEx = reinterpret_cast<OVERLAPPED_EX*>(cqe.user_data & ~URING_REQUEST_TYPE_MASK);
+		completion.mTransferredBytes = 0 < cqe.res ? static_cast<DWORD>(cqe.res) : 0;
+		completion.mIsSuccess = 0 <= cqe.res;
+		return true;
+
+	case eUringRequestType::REQUEST_SEND_ZC:
+		return HandleSendZeroCopyCQE(cqe, completion);
+
+	default:
+		// REQUEST_WAKEUP: worker thread를 깨우기만 하는 요청
+		return false;
+	}
+}
+
+bool IOUringBackend::HandleAcceptCQE(const io_uring_cqe& cqe, IOCompletion& completion)
+{
+	OVERLAPPED_EX* pOverlappedEx{ nullptr };
+	bool isKept{ false };
+
+	{
+		Monitor::Owner lock{ mAcceptSyncObject };
+
+		// 더 이상 완료 통지가 없다면(F_MORE가 없음) multishot accept가 끝난 것
+		if (0 == (cqe.flags & IORING_CQE_F_MORE))
+		{
+			mIsAcceptArmed = false;
+		}
+
+		if (0 <= cqe.res && false == mPendingAccepts->IsEmpty())
+		{
+			pOverlappedEx = mPendingAccepts->Front();
+			mPendingAccepts->Pop();
+		}
+		// 받을 Connection이 없다면 다음 Accept()까지 들고 있는다.
+		else if (0 <= cqe.res)
+		{
+			isKept = mAcceptedSockets->Push(cqe.res);
+		}
+
+		// 접속을 받을 Connection이 남아있다면 다시 걸어둔다.
+		if (false == mIsAcceptArmed && false == mPendingAccepts->IsEmpty())
+		{
+			ArmAccept();
+		}
+	}
+
+	if (isKept)
+	{
+		return false;
+	}
+
+	if (0 > cqe.res)
+	{
+		if (-ECANCELED != cqe.res)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | IOUringBackend::HandleAcceptCQE() | accept failed: %d",
+				-cqe.res);
+		}
+
+		return false;
+	}
+
+	// connection pool이 모두 사용중이라서 들고 있을 자리도 없다면 끊는다.
+	// (AcceptEx()를 미리 걸어둔 Connection이 없을 때 접속 요청이 backlog에서 기다리는 것과 다름)
+	if (nullptr == pOverlappedEx)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOUringBackend::HandleAcceptCQE() | no connection to accept socket[%d]",
+			cqe.res);
+
+		close(cqe.res);
+		CountSyscall();
+
+		return false;
+	}
+
+	reinterpret_cast<Connection*>(pOverlappedEx->mConnection)->SetSocket(cqe.res);
+
+	completion.mOverlappedEx = pOverlappedEx;
+	completion.mTransferredBytes = 0;
+	completion.mIsSuccess = true;
+
+	return true;
+}
+
+bool IOUringBackend::HandleRecvCQE(const io_uring_cqe& cqe, IOCompletion& completion)
+{
+	unsigned int generation = static_cast<unsigned int>(cqe.user_data >> 32);
+	int index = static_cast<int>((cqe.user_data & 0xFFFFFFFF) >> 3);
+
+	bool hasBuffer = 0 != (cqe.flags & IORING_CQE_F_BUFFER);
+	unsigned short bufferID = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+	UringContext& context = mContexts[index];
+	Monitor::Owner lock{ context.mSyncObject };
+
+	// 이미 닫은 client의 완료 통지
+	if (generation != context.mGeneration)
+	{
+		if (hasBuffer)
+		{
+			ReturnBuffer(bufferID);
+		}
+
+		return false;
+	}
+
+	bool isMore = 0 != (cqe.flags & IORING_CQE_F_MORE);
+	if (false == isMore)
+	{
+		context.mIsRecvArmed = false;
+	}
+
+	if (0 < cqe.res && hasBuffer)
+	{
+		// 받은 버퍼를 목록 끝에 붙여둔다.
+		mBufferOffset[bufferID] = 0;
+		mBufferLength[bufferID] = static_cast<unsigned int>(cqe.res);
+		mBufferNext[bufferID] = -1;
+
+		if (-1 == context.mChunkTail)
+		{
+			context.mChunkHead = bufferID;
+		}
+		else
+		{
+			mBufferNext[context.mChunkTail] = bufferID;
+		}
+
+		context.mChunkTail = bufferID;
+
+		// 연결은 살아있는데 kernel이 multishot을 끝냈다면 다시 건다.
+		if (false == isMore)
+		{
+			ArmRecv(context);
+		}
+	}
+	else if (0 == cqe.res)
+	{
+		if (hasBuffer)
+		{
+			ReturnBuffer(bufferID);
+		}
+
+		context.mIsEOF = true;
+	}
+	else if (-ENOBUFS == cqe.res)
+	{
+		// buffer ring이 비어서 kernel이 multishot recv를 끝냈다.
+		// 다른 connection이 버퍼를 돌려준 뒤에 다시 건다.
+		Monitor::Owner starvedLock{ mStarvedSyncObject };
+		mStarvedQueue->Push(index);
+	}
+	else
+	{
+		context.mIsRecvFailed = true;
+	}
+
+	return FillRecv(context, completion);
+}
+
+bool IOUringBackend::HandleSendZeroCopyCQE(const io_uring_cqe& cqe, IOCompletion& completion)
+{
+	unsigned int generation = static_cast<unsigned int>(cqe.user_data >> 32);
+	int index = static_cast<int>((cqe.user_data & 0xFFFFFFFF) >> 3);
+
+	UringContext& context = mContexts[index];
+	Monitor::Owner lock{ context.mSyncObject };
+
+	// notif: kernel이 송신 버퍼를 다 사용했다.
+	if (0 != (cqe.flags & IORING_CQE_F_NOTIF))
+	{
+		// IORING_SEND_ZC_REPORT_USAGE를 요청했기 때문에 복사했다면 res에 표시된다.
+		CountZeroCopyNotify(0 != (cqe.res & IORING_NOTIF_USAGE_ZC_COPIED));
+
+		// 이미 닫은 client의 notif
+		if (generation != context.mGeneration)
+		{
+			return false;
+		}
+
+		if (context.mZeroCopyQueue.IsEmpty())
+		{
+			++context.mZeroCopyEarlyNotifyCnt;
+			return false;
+		}
+
+		DWORD releaseBytes = context.mZeroCopyQueue.Pop();
+		if (0 == releaseBytes)
+		{
+			return false;
+		}
+
+		completion = IOCompletion{ context.mZeroCopyOverlappedEx, releaseBytes, true };
+		return true;
+	}
+
+	// 송신 결과는 REQUEST_SEND처럼 socket을 닫은 뒤라도 그대로 넘긴다.
+	completion.mOverlappedEx = context.mZeroCopySend;
+	completion.mTransferredBytes = 0 < cqe.res ? static_cast<DWORD>(cqe.res) : 0;
+	completion.mIsSuccess = 0 <= cqe.res;
+
+	// F_MORE: 이 송신의 notif가 뒤에 온다.
+	if (0 != (cqe.flags & IORING_CQE_F_MORE) && generation == context.mGeneration)
+	{
+		if (0 < context.mZeroCopyEarlyNotifyCnt)
+		{
+			--context.mZeroCopyEarlyNotifyCnt;
+
+			if (0 < completion.mTransferredBytes)
+			{
+				PushReady(IOCompletion{ context.mZeroCopyOverlappedEx, completion.mTransferredBytes, true });
+			}
+		}
+		else
+		{
+			context.mZeroCopyQueue.Push(completion.mTransferredBytes);
+		}
+	}
+
+	return true;
+}
+
+void IOUringBackend::ArmAccept()
+{
+	io_uring_sqe sqe{};
+	sqe.opcode = IORING_OP_ACCEPT;
+	sqe.fd = mListenSocket;
+	sqe.ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe.accept_flags = SOCK_CLOEXEC;
+	sqe.user_data = static_cast<unsigned long long>(eUringRequestType::REQUEST_ACCEPT);
+
+	mIsAcceptArmed = PushSQE(sqe);
+}
+
+void IOUringBackend::ArmRecv(UringContext& context)
+{
+	io_uring_sqe sqe{};
+	sqe.opcode = IORING_OP_RECV;
+	sqe.fd = context.mSocket;
+
+	// 버퍼를 지정하지 않고 provided buffer ring에서 kernel이 고르게 한다.
+	sqe.ioprio = IORING_RECV_MULTISHOT;
+	sqe.flags = IOSQE_BUFFER_SELECT;
+	sqe.buf_group = URING_BUFFER_GROUP;
+	sqe.user_data = MakeContextUserData(context.mIndex, context.mGeneration, eUringRequestType::REQUEST_RECV);
+
+	context.mIsRecvArmed = PushSQE(sqe);
+}
+
+bool IOUringBackend::FillRecv(UringContext& context, IOCompletion& completion)
+{
+	OVERLAPPED_EX* pOverlappedEx = context.mPendingRecv;
+	if (nullptr == pOverlappedEx)
+	{
+		return false;
+	}
+
+	if (-1 != context.mChunkHead && context.mIsSharedRecv)
+	{
+		// 가장 앞의 버퍼를 목록에서 빼서 그대로 넘겨준다.
+		int bufferID = context.mChunkHead;
+
+		context.mChunkHead = mBufferNext[bufferID];
+		if (-1 == context.mChunkHead)
+		{
+			context.mChunkTail = -1;
+		}
+
+		context.mPendingRecv = nullptr;
+
+		pOverlappedEx->mWSABuf.buf = GetRecvBuffer(bufferID) + mBufferOffset[bufferID];
+		pOverlappedEx->mBufferID = bufferID;
+
+		completion.mOverlappedEx = pOverlappedEx;
+		completion.mTransferredBytes = mBufferLength[bufferID];
+		completion.mIsSuccess = true;
+
+		return true;
+	}
+
+	if (-1 != context.mChunkHead)
+	{
+		// RecvPost()가 마련해둔 recv ring buffer 공간에 들어가는 만큼 복사
+		char* pDst = pOverlappedEx->mWSABuf.buf;
+		DWORD capacity = static_cast<DWORD>(pOverlappedEx->mWSABuf.len);
+		DWORD copiedBytes{ 0 };
+
+		while (-1 != context.mChunkHead && capacity > copiedBytes)
+		{
+			int bufferID = context.mChunkHead;
+
+			DWORD copyBytes = mBufferLength[bufferID];
+			if (capacity - copiedBytes < copyBytes)
+			{
+				copyBytes = capacity - copiedBytes;
+			}
+
+			CopyMemory(pDst + copiedBytes,
+				GetRecvBuffer(bufferID) + mBufferOffset[bufferID],
+				copyBytes);
+
+			copiedBytes += copyBytes;
+			mBufferOffset[bufferID] += copyBytes;
+			mBufferLength[bufferID] -= copyBytes;
+
+			// 다 복사한 버퍼는 kernel에게 돌려준다.
+			if (0 == mBufferLength[bufferID])
+			{
+				context.mChunkHead = mBufferNext[bufferID];
+				if (-1 == context.mChunkHead)
+				{
+					context.mChunkTail = -1;
+				}
+
+				ReturnBuffer(static_cast<unsigned short>(bufferID));
+			}
+		}
+
+		context.mPendingRecv = nullptr;
+
+		completion.mOverlappedEx = pOverlappedEx;
+		completion.mTransferredBytes = copiedBytes;
+		completion.mIsSuccess = true;
+
+		return true;
+	}
+
+	// 남은 데이터를 모두 넘겨준 뒤에 연결 종료를 알린다.
+	if (context.mIsEOF || context.mIsRecvFailed)
+	{
+		context.mPendingRecv = nullptr;
+
+		completion.mOverlappedEx = pOverlappedEx;
+		completion.mTransferredBytes = 0;
+		completion.mIsSuccess = false == context.mIsRecvFailed;
+
+		return true;
+	}
+
+	return false;
+}
+
+void IOUringBackend::ReturnBuffer(unsigned short bufferID)
+{
+	bool isStarved{ false };
+
+	{
+		Monitor::Owner lock{ mBufferRingSyncObject };
+
+		// C++에서는 bufs가 __DECLARE_FLEX_ARRAY의 빈 struct 때문에 8바이트 밀려서 선언되는 header가 있어서
+		// bufs를 쓰지 않고 ring 시작 주소부터 직접 센다(tail은 첫 번째 항목의 resv와 겹친다).
+		io_uring_buf& buffer = reinterpret_cast<io_uring_buf*>(mBufferRing)[mBufferRingTail & (mBufferRingEntries - 1)];
+		buffer.addr = reinterpret_cast<unsigned long long>(GetRecvBuffer(bufferID));
+		buffer.len = mRecvBufferSize;
+		buffer.bid = bufferID;
+
+		// 버퍼 내용을 모두 쓴 뒤에 tail이 보이도록 release로 저장
+		// kernel은 다음 recv에서 tail까지의 버퍼를 사용한다.
+		++mBufferRingTail;
+		__atomic_store_n(&mBufferRing->tail, mBufferRingTail, __ATOMIC_RELEASE);
+
+		mIsBufferReturned = true;
+
+		isStarved = nullptr != mStarvedQueue && false == mStarvedQueue->IsEmpty();
+	}
+
+	// 버퍼가 없어서 멈춘 recv가 있다면 worker thread를 깨워서 RearmStarved()로 다시 걸게 한다.
+	// 모든 recv가 멈춰서 worker thread가 모두 대기중이라면 아무도 RearmStarved()를 호출하지 않는다.
+	if (isStarved)
+	{
+		WakeUp();
+	}
+}
+
+char* IOUringBackend::GetRecvBuffer(int bufferID)
+{
+	return mRecvBuffers + static_cast<size_t>(bufferID) * mRecvBufferSize;
+}
+
+void IOUringBackend::RearmStarved()
+{
+	// 돌려준 버퍼가 없다면 ring이 아직 비어있어서 걸어도 바로 ENOBUFS로 끝난다.
+	// 멈춘 recv가 없을 때는 표시를 지우지 않는다.
+	// (버퍼를 돌려준 뒤에 그 전에 끝난 recv의 ENOBUFS를 처리했다면 그 recv는 이 표시로 다시 걸어야 한다.)
+	// 돌려준 버퍼 수만큼만 걸지 않고 멈춘 recv를 모두 건다.
+	// 다시 건 recv에 아직 도착한 데이터가 없으면 버퍼를 쓰지 않아서
+	// 버퍼가 ring에 남아있는데도 데이터가 있는 다른 recv가 계속 멈춰있을 수 있다.
+	{
+		Monitor::Owner bufferRingLock{ mBufferRingSyncObject };
+
+		if (false == mIsBufferReturned)
+		{
+			return;
+		}
+
+		Monitor::Owner lock{ mStarvedSyncObject };
+
+		if (mStarvedQueue->IsEmpty())
+		{
+			return;
+		}
+
+		mIsBufferReturned = false;
+	}
+
+	while (true)
+	{
+		int index{ -1 };
+
+		{
+			Monitor::Owner lock{ mStarvedSyncObject };
+
+			if (mStarvedQueue->IsEmpty())
+			{
+				return;
+			}
+
+			index = mStarvedQueue->Front();
+			mStarvedQueue->Pop();
+		}
+
+		// 버퍼가 아직 부족하다면 바로 ENOBUFS로 끝나고 다시 이 목록에 들어온다.
+		// 다음에 버퍼를 돌려줄 때까지는 다시 걸지 않는다.
+		UringContext& context = mContexts[index];
+		Monitor::Owner lock{ context.mSyncObject };
+
+		if (INVALID_SOCKET != context.mSocket &&
+			false == context.mIsRecvArmed &&
+			false == context.mIsEOF &&
+			false == context.mIsRecvFailed)
+		{
+			ArmRecv(context);
+		}
+	}
+}
+
+void IOUringBackend::PushReady(const IOCompletion& completion)
+{
+	if (false == mReadyQueue->TryPush(completion))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOUringBackend::PushReady() | ready queue is full");
+
+		return;
+	}
+
+	// worker thread는 요청 직후에 GetCompletions()로 돌아와서
+	// 직접 꺼내가기 때문에 다른 thread를 깨울 필요가 없다.
+	if (false == IsWorkerThread())
+	{
+		WakeUp();
+	}
+}
+
+int IOUringBackend::PopReady(IOCompletion* pCompletions, int maxCount)
+{
+	return mReadyQueue->PopBatch(std::span<IOCompletion>{ pCompletions, static_cast<size_t>(maxCount) });
+}
+
+void IOUringBackend::WakeUp()
+{
+	// 아무 일도 하지 않는 NOP 요청의 완료 통지로
+	// io_uring_enter()에서 대기중인 worker thread를 깨운다.
+	{
+		Monitor::Owner lock{ mSQSyncObject };
+
+		io_uring_sqe* pSQE = mRing.GetSQE();
+		if (nullptr != pSQE)
+		{
+			pSQE->opcode = IORING_OP_NOP;
+			pSQE->user_data = static_cast<unsigned long long>(eUringRequestType::REQUEST_WAKEUP);
+		}
+	}
+
+	SubmitNow();
+}
+
+IOUringBackend::UringContext* IOUringBackend::GetContext(Connection* pConnection)
+{
+	int index = GetContextIndex(pConnection->GetIndex());
+	if (0 > index || mMaxConnectionCnt <= index)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | IOUringBackend::GetContext() | invalid connection index: %d",
+			pConnection->GetIndex());
+
+		return nullptr;
+	}
+
+	return &mContexts[index];
+}
+
+#endif
@@ -0,0 +1,220 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// Linux io_uring을 사용하는 backend
+//
+// io_uring은 IOCP처럼 "작업이 완료되었다"는 통지를 주기 때문에
+// Connection의 작업 요청 - 완료 통지 흐름에 그대로 맞는다.
+//
+// 여기에 더해서 multishot 요청으로 시스템 콜 횟수를 줄인다.
+// - multishot accept
+//   Connection마다 AcceptEx()를 미리 걸어두는 대신
+//   listen socket에 accept 요청을 하나만 걸어두면 접속할 때마다 완료 통지가 계속 생긴다.
+//   Accept()는 접속을 받을 Connection을 대기 목록에 넣기만 한다.
+//   받을 Connection이 없을 때 들어온 접속은 닫지 않고 들고 있다가 다음 Accept()에 넘겨준다.
+// - multishot recv
+//   client socket마다 recv 요청을 한 번만 걸어두면
+//   데이터가 도착할 때마다 kernel이 provided buffer ring(IORING_REGISTER_PBUF_RING)에서 버퍼를 골라 채워준다.
+//   다 쓴 버퍼는 ring에 다시 채우고 tail만 올리면 돼서 버퍼를 돌려줄 때 SQE나 시스템 콜이 필요 없다.
+//   Connection::RecvPost()가 호출하는 Recv()는 도착해 있는 데이터를 recv ring buffer로 복사만 하고
+//   시스템 콜을 호출하지 않는다.
+//   공유 recv 버퍼(InitConfig::mUseSharedRecvBuffer)를 사용하는 Connection에게는
+//   복사하지 않고 받은 버퍼를 그대로 넘겨준다.
+// - zero-copy send
+//   OVERLAPPED_EX::mIsZeroCopy인 송신은 SEND_ZC 요청으로 보낸다.
+//   송신 결과 완료 통지와 kernel이 버퍼를 다 사용했다는 알림(notif)이 따로 오는데
+//   notif를 받으면 Connection에게 OP_ZEROCOPY_RELEASE 완료 통지를 넘겨준다.
+// - send, 다른 요청들은 worker thread라면 바로 제출하지 않고 모아두었다가
+//   다음 GetCompletions()에서 완료 통지를 기다리는 io_uring_enter() 한 번에 같이 제출한다.
+
+#include "IOBackend.h"
+
+#ifndef _WIN32
+
+#include "Monitor.h"
+#include "Queue.h"
+#include "MPMCQueue.h"
+#include "IOUring.h"
+
+class NETLIB_API IOUringBackend : public IOBackend
+{
+public:
+	IOUringBackend();
+	~IOUringBackend() override;
+
+public:
+	bool Create(int maxConnectionCnt) override;
+	void Destroy() override;
+
+	bool BindListenSocket(SOCKET listenSocket) override;
+	bool BindSocket(Connection* pConnection) override;
+
+	bool Accept(SOCKET listenSocket, OVERLAPPED_EX* pOverlappedEx) override;
+	bool Recv(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) override;
+	bool Send(Connection* pConnection, OVERLAPPED_EX* pOverlappedEx) override;
+
+	void GetRemoteAddress(OVERLAPPED_EX* pOverlappedEx, char* pIP, int ipLength) override;
+	void CloseSocket(Connection* pConnection) override;
+
+	int GetCompletions(IOCompletion* pCompletions, int maxCount, DWORD timeout) override;
+	bool PostQuit() override;
+	bool PostCompletion(OVERLAPPED_EX* pOverlappedEx) override;
+
+	bool IsSharedRecvBufferSupported() override;
+	void ReleaseRecvBuffer(Connection* pConnection, int bufferID) override;
+
+	bool IsZeroCopySendSupported() override;
+
+	int GetAcceptBacklog() override;
+
+private:
+	// client socket마다 유지하는 상태
+	// Connection의 index로 배열에서 찾는다.
+	struct UringContext
+	{
+		Monitor mSyncObject;
+
+		SOCKET mSocket;
+		int mIndex;
+
+		// CloseSocket()마다 증가시켜서
+		// 이전 client의 multishot recv가 늦게 보내는 완료 통지를 걸러낸다.
+		unsigned int mGeneration;
+
+		// Connection이 Recv()로 요청했지만 아직 채워주지 못한 작업
+		OVERLAPPED_EX* mPendingRecv;
+
+		// 버퍼 조각이 여러 개인 송신은 sendmsg 요청으로 보내는데
+		// 요청이 끝날 때까지 msghdr, iovec이 살아있어야 한다.
+		// connection의 송신 요청은 한 번에 하나만 진행되기 때문에 context에 하나씩 둔다.
+		msghdr mSendMsg;
+		iovec mSendIov[MAX_SEND_BUF_CNT];
+
+		// SEND_ZC 요청은 multishot recv처럼 index와 generation을 user_data에 담기 때문에
+		// 송신 결과를 넘겨줄 OVERLAPPED_EX를 기억해둔다.
+		OVERLAPPED_EX* mZeroCopySend;
+		OVERLAPPED_EX* mZeroCopyOverlappedEx;
+
+		// notif를 기다리는 송신 크기
+		// notif가 송신 결과보다 먼저 도착하면 개수만 세어두었다가 송신 결과를 받을 때 해제한다.
+		ZeroCopySendQueue mZeroCopyQueue;
+		int mZeroCopyEarlyNotifyCnt;
+
+		// multishot recv로 받았지만 Connection이 아직 가져가지 않은 버퍼 목록
+		// 버퍼 id로 mBufferNext를 따라가는 연결 리스트
+		int mChunkHead;
+		int mChunkTail;
+
+		// multishot recv가 걸려있는지
+		bool mIsRecvArmed;
+
+		// Connection이 공유 recv 버퍼를 사용한다면
+		// 복사하지 않고 받은 버퍼를 그대로 넘겨준다.
+		bool mIsSharedRecv;
+
+		// client가 연결을 끊었거나(recv 0) recv가 실패했다.
+		// 남은 데이터를 모두 넘겨준 뒤에 Connection에게 알려준다.
+		bool mIsEOF;
+		bool mIsRecvFailed;
+	};
+
+private:
+	// SQE를 SQ에 넣는다.
+	// worker thread가 아니라면 바로 kernel에 제출한다.
+	bool PushSQE(const io_uring_sqe& sqe);
+
+	// SQ에 넣어둔 SQE를 지금 바로 제출
+	void SubmitNow();
+
+	// 완료 통지 하나를 IOCompletion으로 바꾼다.
+	// Connection에게 넘길 완료 통지가 생기면 true
+	bool HandleCQE(const io_uring_cqe& cqe, IOCompletion& completion);
+	bool HandleAcceptCQE(const io_uring_cqe& cqe, IOCompletion& completion);
+	bool HandleRecvCQE(const io_uring_cqe& cqe, IOCompletion& completion);
+	bool HandleSendZeroCopyCQE(const io_uring_cqe& cqe, IOCompletion& completion);
+
+	// listen socket에 multishot accept를 건다.
+	void ArmAccept();
+
+	// client socket에 multishot recv를 건다. context lock을 잡고 호출
+	void ArmRecv(UringContext& context);
+
+	// 대기중인 recv 작업을 도착한 데이터로 채운다. context lock을 잡고 호출
+	// 공유 recv 버퍼를 사용한다면 복사하지 않고 가장 앞의 버퍼를 넘겨준다.
+	// 작업이 끝났으면 completion을 채우고 true
+	bool FillRecv(UringContext& context, IOCompletion& completion);
+
+	// 다 쓴 provided buffer를 buffer ring에 다시 채워서 kernel에게 돌려준다.
+	void ReturnBuffer(unsigned short bufferID);
+
+	char* GetRecvBuffer(int bufferID);
+
+	// provided buffer가 부족해서 멈춘 multishot recv를 다시 건다.
+	// 지난번에 다시 건 뒤로 ReturnBuffer()가 버퍼를 돌려줬을 때만 건다.
+	// (버퍼 없이 걸면 바로 ENOBUFS로 끝나고 그 완료 통지로 worker가 깨어나서 계속 다시 걸게 된다.)
+	void RearmStarved();
+
+	void PushReady(const IOCompletion& completion);
+	int PopReady(IOCompletion* pCompletions, int maxCount);
+
+	// io_uring_enter()에서 대기중인 worker thread를 깨운다.
+	void WakeUp();
+
+	UringContext* GetContext(Connection* pConnection);
+
+private:
+	IOUring mRing;
+
+	// SQ에 SQE를 넣을 때, CQ에서 CQE를 꺼낼 때 사용하는 lock
+	Monitor mSQSyncObject;
+	Monitor mCQSyncObject;
+
+	int mMaxConnectionCnt;
+	UringContext* mContexts;
+
+	// multishot accept
+	SOCKET mListenSocket;
+	bool mIsAcceptArmed;
+	Queue<OVERLAPPED_EX*>* mPendingAccepts;
+	Monitor mAcceptSyncObject;
+
+	// multishot accept가 받았지만 받을 Connection이 대기 목록에 없던 client socket
+	// AcceptManager가 accept 수를 줄여두면 걸어둔 accept보다 접속이 많을 수 있는데
+	// listen socket의 accept queue에서 기다리는 것처럼 다음 Accept()까지 들고 있는다.
+	Queue<SOCKET>* mAcceptedSockets;
+
+	// provided buffer(SetSharedRecvBuffer()로 지정한 크기와 개수)
+	// 모든 connection이 같이 사용한다.
+	char* mRecvBuffers;
+	unsigned int mRecvBufferSize;
+	unsigned int mRecvBufferCnt;
+
+	// kernel과 공유하는 provided buffer ring
+	// 여러 thread가 버퍼를 돌려주기 때문에 ring에 채우고 tail을 올리는 동안 lock을 잡는다.
+	io_uring_buf_ring* mBufferRing;
+	unsigned int mBufferRingEntries;
+	unsigned short mBufferRingTail;
+
+	// RearmStarved()가 멈춘 recv를 다시 건 뒤로 ReturnBuffer()가 버퍼를 돌려줬는지
+	bool mIsBufferReturned;
+	Monitor mBufferRingSyncObject;
+
+	// 버퍼마다 connection이 아직 가져가지 않은 데이터의 위치와 길이
+	// 버퍼 하나는 한 connection만 사용하기 때문에 그 connection의 context lock으로 보호된다.
+	// (Connection에게 넘겨준 버퍼는 목록에서 빠지고 ReleaseRecvBuffer()로 돌아올 때까지 사용하지 않는다.)
+	unsigned int* mBufferOffset;
+	unsigned int* mBufferLength;
+	int* mBufferNext;
+
+	// provided buffer가 부족해서 multishot recv가 멈춘 connection의 index
+	Queue<int>* mStarvedQueue;
+	Monitor mStarvedSyncObject;
+
+	// 즉시 끝난 작업, 실패로 끝난 작업, 종료 요청
+	// worker thread와 Strand::Post()가 동시에 넣고 꺼내기 때문에 lock 없는 queue를 사용하고
+	// PopReady()는 PopBatch()로 한 번에 꺼낸다.
+	MPMCQueue<IOCompletion>* mReadyQueue;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,653 @@
+﻿#include <thread>
+#include <chrono>
+
+#ifdef _WIN32
+#include <process.h>
+#endif
+
+#include "Log.h"
+#include "JobSystem.h"
+
+// 현재 thread가 등록한 job system과 JobWorker의 index
+static thread_local JobSystem* tJobSystem{ nullptr };
+static thread_local int tJobWorkerIndex{ -1 };
+
+// 현재 thread가 job thread인지
+static thread_local bool tIsJobThread{ false };
+
+// 훔쳐올 deque를 고를 때 thread마다 다른 곳에서 시작하기 위한 값
+static thread_local unsigned int tStealIndex{ 0 };
+
+constexpr LONG64 JOB_POOL_MASK{ JOB_POOL_SIZE - 1 };
+
+// ParallelFor()가 나눈 범위 하나를 담는 job 데이터
+struct ParallelForData
+{
+	JobSystem* mJobSystem;
+	ParallelForFunction mFunction;
+	void* mContext;
+	int mBegin;
+	int mEnd;
+	int mSplitCnt;
+};
+
+static_assert(sizeof(ParallelForData) <= JOB_DATA_SIZE, "ParallelForData is too big for a job");
+
+static void ParallelForJob(Job* pJob, const void* pData)
+{
+	const ParallelForData* pForData = reinterpret_cast<const ParallelForData*>(pData);
+
+	int count = pForData->mEnd - pForData->mBegin;
+	if (pForData->mSplitCnt >= count)
+	{
+		pForData->mFunction(pForData->mBegin, pForData->mEnd, pForData->mContext);
+		return;
+	}
+
+	// 반으로 나눈 자식 job을 만든다.
+	// 이 job은 두 자식이 끝나야 끝나기 때문에 기다릴 필요가 없다.
+	ParallelForData leftData{ *pForData };
+	leftData.mEnd = pForData->mBegin + count / 2;
+
+	ParallelForData rightData{ *pForData };
+	rightData.mBegin = leftData.mEnd;
+
+	// job이 모자라면 이 thread에서 바로 처리한다.
+	JobSystem* pJobSystem = pForData->mJobSystem;
+	ParallelForData* childDatas[2]{ &leftData, &rightData };
+
+	for (ParallelForData* pChildData : childDatas)
+	{
+		Job* pChildJob = pJobSystem->CreateChildJob(pJob, ParallelForJob, pChildData, sizeof(ParallelForData));
+		if (nullptr == pChildJob)
+		{
+			ParallelForJob(pJob, pChildData);
+			continue;
+		}
+
+		pJobSystem->Run(pChildJob);
+	}
+}
+
+JobDeque::JobDeque()
+	: mTop{ 0 }
+	, mBottom{ 0 }
+	, mJobs{}
+{
+}
+
+bool JobDeque::Push(Job* pJob)
+{
+	LONG64 bottom = mBottom.load(std::memory_order_relaxed);
+	LONG64 top = mTop.load(std::memory_order_acquire);
+
+	if (JOB_POOL_SIZE <= bottom - top)
+	{
+		return false;
+	}
+
+	mJobs[bottom & JOB_POOL_MASK].store(pJob, std::memory_order_relaxed);
+
+	// job을 쓴 뒤에 bottom이 보이도록 release로 저장
+	mBottom.store(bottom + 1, std::memory_order_release);
+
+	return true;
+}
+
+Job* JobDeque::Pop()
+{
+	LONG64 bottom = mBottom.load(std::memory_order_relaxed) - 1;
+	mBottom.store(bottom, std::memory_order_relaxed);
+
+	// bottom을 줄인 것이 도둑에게 보인 뒤에 top을 읽어야
+	// 마지막 하나를 도둑과 동시에 가져가는 경우를 알아챌 수 있다.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	LONG64 top = mTop.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// 비어있다.
+		mBottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* pJob = mJobs[bottom & JOB_POOL_MASK].load(std::memory_order_relaxed);
+
+	if (top == bottom)
+	{
+		// 마지막 하나는 도둑과 경쟁하기 때문에 top을 CAS로 가져간다.
+		if (false == mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			pJob = nullptr;
+		}
+
+		mBottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	return pJob;
+}
+
+Job* JobDeque::Steal()
+{
+	LONG64 top = mTop.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	LONG64 bottom = mBottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	Job* pJob = mJobs[top & JOB_POOL_MASK].load(std::memory_order_relaxed);
+
+	// 다른 도둑이나 주인이 먼저 가져갔다면 실패
+	if (false == mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+
+	return pJob;
+}
+
+// thread가 실행할 함수로 멤버 함수를 바로 넘길 수 없기 때문에
+// this 포인터를 넘겨서 멤버 함수를 호출해준다.
+#ifdef _WIN32
+unsigned int WINAPI CallJobThread(LPVOID p)
+#else
+void* CallJobThread(void* p)
+#endif
+{
+	JobSystem* pJobSystem = reinterpret_cast<JobSystem*>(p);
+
+	pJobSystem->JobThread();
+
+#ifdef _WIN32
+	return 0;
+#else
+	return nullptr;
+#endif
+}
+
+JobSystem::JobSystem()
+	: mWorkers{ nullptr }
+	, mWorkerCnt{ 0 }
+	, mSharedJobs{ nullptr }
+	, mSharedAllocatedJobCnt{ 0 }
+	, mSharedQueue{ nullptr }
+	, mSharedSyncObject{}
+	, mJobThreads{ nullptr }
+	, mJobThreadCnt{ 0 }
+	, mQueuedJobCnt{ 0 }
+	, mSleepingThreadCnt{ 0 }
+	, mIsQuit{ false }
+	, mSleepMutex{}
+	, mSleepCondition{}
+	, mSharedExecutedJobCnt{ 0 }
+	, mSharedStolenJobCnt{ 0 }
+{
+}
+
+JobSystem::~JobSystem()
+{
+	Destroy();
+}
+
+bool JobSystem::Create(int jobThreadCnt, int helperThreadCnt)
+{
+	if (0 > jobThreadCnt || 0 > helperThreadCnt || 0 == jobThreadCnt + helperThreadCnt)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | JobSystem::Create() | invalid thread count: job[%d] helper[%d]",
+			jobThreadCnt,
+			helperThreadCnt);
+
+		return false;
+	}
+
+	mWorkerCnt = jobThreadCnt + helperThreadCnt;
+	mWorkers = new JobWorker[mWorkerCnt]{};
+
+	for (int i = 0; i < mWorkerCnt; ++i)
+	{
+		mWorkers[i].mJobs = new Job[JOB_POOL_SIZE]{};
+	}
+
+	mSharedJobs = new Job[JOB_POOL_SIZE]{};
+	mSharedQueue = new Queue<Job*>{ JOB_POOL_SIZE };
+
+	mIsQuit.store(false);
+
+#ifdef _WIN32
+	mJobThreads = new HANDLE[jobThreadCnt]{};
+#else
+	mJobThreads = new pthread_t[jobThreadCnt]{};
+#endif
+
+	for (int i = 0; i < jobThreadCnt; ++i)
+	{
+#ifdef _WIN32
+		unsigned int threadID{ 0 };
+
+		mJobThreads[i] = reinterpret_cast<HANDLE>(_beginthreadex(
+			NULL,
+			0,
+			CallJobThread,
+			this,
+			0,
+			&threadID));
+
+		bool isCreated = NULL != mJobThreads[i];
+#else
+		bool isCreated = 0 == pthread_create(&mJobThreads[i], nullptr, CallJobThread, this);
+#endif
+
+		if (false == isCreated)
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | JobSystem::Create() | JobThread 생성 실패: Error(%lu)",
+				GetLastError());
+
+			Destroy();
+			return false;
+		}
+
+		++mJobThreadCnt;
+	}
+
+	return true;
+}
+
+void JobSystem::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock{ mSleepMutex };
+		mIsQuit.store(true);
+	}
+
+	mSleepCondition.notify_all();
+
+	for (int i = 0; i < mJobThreadCnt; ++i)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(mJobThreads[i], INFINITE);
+		CloseHandle(mJobThreads[i]);
+#else
+		pthread_join(mJobThreads[i], nullptr);
+#endif
+	}
+
+	delete[] mJobThreads;
+	mJobThreads = nullptr;
+	mJobThreadCnt = 0;
+
+	for (int i = 0; i < mWorkerCnt; ++i)
+	{
+		delete[] mWorkers[i].mJobs;
+	}
+
+	delete[] mWorkers;
+	mWorkers = nullptr;
+	mWorkerCnt = 0;
+
+	delete[] mSharedJobs;
+	mSharedJobs = nullptr;
+
+	delete mSharedQueue;
+	mSharedQueue = nullptr;
+}
+
+bool JobSystem::RegisterThread()
+{
+	if (this == tJobSystem)
+	{
+		return true;
+	}
+
+	for (int i = 0; i < mWorkerCnt; ++i)
+	{
+		if (0 == InterlockedCompareExchange64(&mWorkers[i].mIsUsed, 1, 0))
+		{
+			tJobSystem = this;
+			tJobWorkerIndex = i;
+			tStealIndex = static_cast<unsigned int>(i);
+
+			return true;
+		}
+	}
+
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | JobSystem::RegisterThread() | no free worker slot: %d",
+		mWorkerCnt);
+
+	return false;
+}
+
+void JobSystem::UnregisterThread()
+{
+	if (this != tJobSystem)
+	{
+		return;
+	}
+
+	// deque에 남은 job은 다른 thread가 훔쳐갈 수 있다.
+	InterlockedExchange64(&mWorkers[tJobWorkerIndex].mIsUsed, 0);
+
+	tJobSystem = nullptr;
+	tJobWorkerIndex = -1;
+}
+
+Job* JobSystem::CreateJob(JobFunction function, const void* pData, int dataSize)
+{
+	if (0 > dataSize || JOB_DATA_SIZE < dataSize)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | JobSystem::CreateJob() | invalid data size: %d",
+			dataSize);
+
+		return nullptr;
+	}
+
+	Job* pJob = AllocateJob();
+	if (nullptr == pJob)
+	{
+		return nullptr;
+	}
+
+	pJob->mFunction = function;
+	pJob->mParent = nullptr;
+	pJob->mUnfinishedJobCnt.store(1, std::memory_order_relaxed);
+
+	if (0 < dataSize)
+	{
+		CopyMemory(pJob->mData, pData, dataSize);
+	}
+
+	return pJob;
+}
+
+Job* JobSystem::CreateChildJob(Job* pParent, JobFunction function, const void* pData, int dataSize)
+{
+	Job* pJob = CreateJob(function, pData, dataSize);
+	if (nullptr == pJob)
+	{
+		return nullptr;
+	}
+
+	// 자식이 끝날 때까지 부모가 끝나지 않도록 먼저 늘려둔다.
+	pParent->mUnfinishedJobCnt.fetch_add(1, std::memory_order_relaxed);
+	pJob->mParent = pParent;
+
+	return pJob;
+}
+
+void JobSystem::Run(Job* pJob)
+{
+	// 잠들려는 job thread가 놓치지 않도록 넣기 전에 센다.
+	mQueuedJobCnt.fetch_add(1);
+
+	JobWorker* pWorker = GetCurrentWorker();
+
+	if (nullptr == pWorker || false == pWorker->mDeque.Push(pJob))
+	{
+		bool isPushed{ false };
+
+		{
+			Monitor::Owner lock{ mSharedSyncObject };
+			isPushed = mSharedQueue->Push(pJob);
+		}
+
+		// 넣을 곳이 없으면 지금 실행한다.
+		if (false == isPushed)
+		{
+			mQueuedJobCnt.fetch_sub(1);
+			Execute(pJob);
+			return;
+		}
+	}
+
+	WakeUpJobThread();
+}
+
+void JobSystem::Wait(Job* pJob)
+{
+	// 기다리는 동안 놀지 않고 다른 job을 실행한다.
+	while (0 < pJob->mUnfinishedJobCnt.load(std::memory_order_acquire))
+	{
+		if (false == RunPendingJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::ParallelFor(int count, int splitCnt, ParallelForFunction function, void* pContext)
+{
+	if (0 >= count)
+	{
+		return;
+	}
+
+	ParallelForData data{ this, function, pContext, 0, count, 0 < splitCnt ? splitCnt : 1 };
+
+	Job* pJob = CreateJob(ParallelForJob, &data, sizeof(data));
+	if (nullptr == pJob)
+	{
+		function(0, count, pContext);
+		return;
+	}
+
+	Run(pJob);
+	Wait(pJob);
+}
+
+bool JobSystem::RunPendingJob()
+{
+	Job* pJob = GetJob();
+	if (nullptr == pJob)
+	{
+		return false;
+	}
+
+	Execute(pJob);
+	return true;
+}
+
+bool JobSystem::IsJobThread()
+{
+	return this == tJobSystem && tIsJobThread;
+}
+
+void JobSystem::JobThread()
+{
+	if (false == RegisterThread())
+	{
+		return;
+	}
+
+	tIsJobThread = true;
+
+	while (false == mIsQuit.load())
+	{
+		if (RunPendingJob())
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{ mSleepMutex };
+
+		// Run()은 mQueuedJobCnt를 늘린 뒤에 mSleepingThreadCnt를 확인하고
+		// 여기서는 mSleepingThreadCnt를 늘린 뒤에 mQueuedJobCnt를 확인하기 때문에
+		// 둘 중 하나는 상대를 보게 되어서 job이 있는데 잠드는 일이 없다.
+		// 그래도 가져가려던 job을 다른 thread가 먼저 가져갈 수 있어서 일정 시간마다 깨어나 확인한다.
+		mSleepingThreadCnt.fetch_add(1);
+		mSleepCondition.wait_for(lock, std::chrono::milliseconds(JOB_IDLE_WAIT_MSEC),
+			[this]() { return mIsQuit.load() || 0 < mQueuedJobCnt.load(); });
+		mSleepingThreadCnt.fetch_sub(1);
+	}
+
+	tIsJobThread = false;
+	UnregisterThread();
+}
+
+LONG64 JobSystem::GetExecutedJobCount()
+{
+	LONG64 executedJobCnt = mSharedExecutedJobCnt;
+	for (int i = 0; i < mWorkerCnt; ++i)
+	{
+		executedJobCnt += mWorkers[i].mExecutedJobCnt.load(std::memory_order_relaxed);
+	}
+
+	return executedJobCnt;
+}
+
+LONG64 JobSystem::GetStolenJobCount()
+{
+	LONG64 stolenJobCnt = mSharedStolenJobCnt;
+	for (int i = 0; i < mWorkerCnt; ++i)
+	{
+		stolenJobCnt += mWorkers[i].mStolenJobCnt.load(std::memory_order_relaxed);
+	}
+
+	return stolenJobCnt;
+}
+
+Job* JobSystem::AllocateJob()
+{
+	JobWorker* pWorker = GetCurrentWorker();
+	if (nullptr != pWorker)
+	{
+		return FindFinishedJob(pWorker->mJobs, pWorker->mAllocatedJobCnt);
+	}
+
+	Monitor::Owner lock{ mSharedSyncObject };
+	return FindFinishedJob(mSharedJobs, mSharedAllocatedJobCnt);
+}
+
+Job* JobSystem::FindFinishedJob(Job* pJobs, unsigned int& allocatedJobCnt)
+{
+	// 보통은 한 바퀴 전에 만든 job이 이미 끝나 있어서 바로 찾는다.
+	// Wait() 안에서 job을 실행하며 중첩되면 끝나지 않은 job이 쌓일 수 있어서 건너뛴다.
+	for (int i = 0; i < JOB_POOL_SIZE; ++i)
+	{
+		Job* pJob = &pJobs[allocatedJobCnt++ & JOB_POOL_MASK];
+		if (0 == pJob->mUnfinishedJobCnt.load(std::memory_order_acquire))
+		{
+			return pJob;
+		}
+	}
+
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | JobSystem::FindFinishedJob() | job pool exhausted: %d",
+		JOB_POOL_SIZE);
+
+	return nullptr;
+}
+
+Job* JobSystem::GetJob()
+{
+	JobWorker* pWorker = GetCurrentWorker();
+	Job* pJob{ nullptr };
+
+	// 자기 deque에서 가장 최근에 넣은 job
+	if (nullptr != pWorker)
+	{
+		pJob = pWorker->mDeque.Pop();
+	}
+
+	// 등록하지 않은 thread가 넣은 job
+	if (nullptr == pJob)
+	{
+		Monitor::Owner lock{ mSharedSyncObject };
+
+		if (false == mSharedQueue->IsEmpty())
+		{
+			pJob = mSharedQueue->Front();
+			mSharedQueue->Pop();
+		}
+	}
+
+	// 다른 thread의 deque에서 가장 오래된 job을 훔쳐온다.
+	if (nullptr == pJob)
+	{
+		unsigned int stealIndex = tStealIndex++;
+
+		for (int i = 0; i < mWorkerCnt && nullptr == pJob; ++i)
+		{
+			JobWorker* pVictim = &mWorkers[(stealIndex + i) % mWorkerCnt];
+			if (pVictim == pWorker)
+			{
+				continue;
+			}
+
+			pJob = pVictim->mDeque.Steal();
+		}
+
+		if (nullptr != pJob)
+		{
+			if (nullptr != pWorker)
+			{
+				pWorker->mStolenJobCnt.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				InterlockedIncrement64(&mSharedStolenJobCnt);
+			}
+		}
+	}
+
+	if (nullptr != pJob)
+	{
+		mQueuedJobCnt.fetch_sub(1);
+	}
+
+	return pJob;
+}
+
+void JobSystem::Execute(Job* pJob)
+{
+	pJob->mFunction(pJob, pJob->mData);
+	Finish(pJob);
+
+	JobWorker* pWorker = GetCurrentWorker();
+	if (nullptr != pWorker)
+	{
+		pWorker->mExecutedJobCnt.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		InterlockedIncrement64(&mSharedExecutedJobCnt);
+	}
+}
+
+void JobSystem::Finish(Job* pJob)
+{
+	// 0이 되는 순간 Wait()하던 thread가 job 자리를 다시 쓸 수 있어서 부모를 먼저 읽어둔다.
+	Job* pParent = pJob->mParent;
+
+	// 마지막으로 끝난 자식이 부모를 끝낸다.
+	if (1 == pJob->mUnfinishedJobCnt.fetch_sub(1, std::memory_order_acq_rel) &&
+		nullptr != pParent)
+	{
+		Finish(pParent);
+	}
+}
+
+JobSystem::JobWorker* JobSystem::GetCurrentWorker()
+{
+	if (this != tJobSystem)
+	{
+		return nullptr;
+	}
+
+	return &mWorkers[tJobWorkerIndex];
+}
+
+void JobSystem::WakeUpJobThread()
+{
+	if (0 < mSleepingThreadCnt.load())
+	{
+		std::lock_guard<std::mutex> lock{ mSleepMutex };
+		mSleepCondition.notify_one();
+	}
+}
@@ -0,0 +1,216 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 길 찾기, AOI 재구성처럼 CPU를 많이 쓰는 game logic 작업을 여러 thread에 나눠서 실행하는 job system
+//
+// job은 실행할 함수와 작은 데이터를 담은 64byte 구조체다.
+// thread마다 Chase-Lev deque를 하나씩 두고
+// 자기가 만든 job은 자기 deque의 아래쪽에 넣고 꺼내서(lock 없음, 최근에 만든 job이라 cache에 남아있다.)
+// 자기 deque가 비면 다른 thread deque의 위쪽에서 훔쳐온다(CAS 한 번).
+// 그래서 job을 만든 thread가 바쁠수록 다른 thread가 나눠서 가져간다.
+//
+// job은 부모 job을 지정해서 만들 수 있고
+// 부모 job은 자기 함수와 모든 자식 job이 끝나야 끝난다.
+// Wait()는 기다리는 동안 다른 job을 대신 실행하기 때문에 job 안에서 Wait()해도 멈추지 않는다.
+// ParallelFor()는 범위를 둘로 나눈 자식 job을 재귀적으로 만들어서 [0, count)를 나눠서 실행한다.
+//
+// job 실행은 job system이 만든 job thread가 맡고
+// IOBackend::SetJobSystem()으로 등록하면 IO worker thread도 완료 통지를 처리한 뒤에 쉬지 않고 job을 돕는다.
+// (job을 실행했다면 다음 GetCompletions()는 기다리지 않고 확인만 한다.)
+// 등록하지 않은 thread(game logic thread 등)도 job을 만들고 기다릴 수 있는데
+// 그 thread의 job은 공용 queue에 넣어서 다른 thread가 가져간다.
+//
+// job은 thread마다 JOB_POOL_SIZE개짜리 원형 배열에서 끝난 job 자리를 찾아서 다시 쓰고 따로 돌려주지 않는다.
+// 한 thread가 끝나지 않은 job을 JOB_POOL_SIZE개 넘게 만들면 CreateJob()이 nullptr을 반환한다.
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "Platform.h"
+#include "Monitor.h"
+#include "Queue.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+struct Job;
+
+// job이 실행할 함수
+// pData는 CreateJob()에 넘긴 데이터의 복사본
+using JobFunction = void (*)(Job* pJob, const void* pData);
+
+// ParallelFor()가 나눈 범위 [begin, end)를 처리할 함수
+using ParallelForFunction = void (*)(int begin, int end, void* pContext);
+
+// job 하나에 담을 수 있는 데이터 크기(job이 cache line 하나를 차지하도록 맞춘 값)
+constexpr int JOB_DATA_SIZE{ 44 };
+
+// thread마다 가지는 job 원형 배열과 deque의 크기(2의 거듭제곱)
+constexpr int JOB_POOL_SIZE{ 4096 };
+
+// job thread가 할 일이 없을 때 다시 확인하기 전까지 잠드는 최대 시간(ms)
+constexpr int JOB_IDLE_WAIT_MSEC{ 10 };
+
+struct alignas(64) Job
+{
+	JobFunction mFunction;
+	Job* mParent;
+
+	// 자기 자신과 끝나지 않은 자식 job의 수, 0이 되면 끝난 job이다.
+	std::atomic<int> mUnfinishedJobCnt;
+
+	char mData[JOB_DATA_SIZE];
+};
+
+// Chase-Lev work-stealing deque
+// 주인 thread만 Push(), Pop()으로 아래쪽(bottom)을 사용하고
+// 다른 thread는 Steal()로 위쪽(top)에서 꺼내간다.
+// 크기가 고정이라 가득 차면 Push()가 false를 반환한다.
+class NETLIB_API JobDeque
+{
+public:
+	JobDeque();
+
+public:
+	bool Push(Job* pJob);
+	Job* Pop();
+	Job* Steal();
+
+public:
+	JobDeque(const JobDeque& rhs) = delete;
+	JobDeque(JobDeque&& rhs) = delete;
+
+	JobDeque& operator=(const JobDeque& rhs) = delete;
+	JobDeque& operator=(JobDeque&& rhs) = delete;
+
+private:
+	// 주인과 도둑이 서로 다른 쪽을 자주 쓰기 때문에 cache line을 나눈다.
+	alignas(64) std::atomic<LONG64> mTop;
+	alignas(64) std::atomic<LONG64> mBottom;
+	alignas(64) std::atomic<Job*> mJobs[JOB_POOL_SIZE];
+};
+
+class NETLIB_API JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+public:
+	// jobThreadCnt개의 job thread를 만든다.
+	// helperThreadCnt는 RegisterThread()로 job을 도울 다른 thread(IO worker thread)의 최대 수
+	bool Create(int jobThreadCnt, int helperThreadCnt = 0);
+
+	// job thread를 종료한다. 남은 job은 실행하지 않는다.
+	void Destroy();
+
+	// 현재 thread에게 deque를 하나 나눠준다.
+	// 등록한 thread는 만든 job을 자기 deque에 넣고 RunPendingJob()으로 job을 도울 수 있다.
+	// 자리가 없으면 false(등록하지 않은 thread처럼 공용 queue를 사용한다.)
+	bool RegisterThread();
+	void UnregisterThread();
+
+public:
+	// job을 만든다. 실행하려면 Run()을 호출한다.
+	// pData의 dataSize byte를 job에 복사해둔다(JOB_DATA_SIZE 이하).
+	// 끝나지 않은 job이 너무 많으면 nullptr
+	Job* CreateJob(JobFunction function, const void* pData = nullptr, int dataSize = 0);
+
+	// pParent의 자식 job을 만든다. pParent는 이 job이 끝나야 끝난다.
+	// pParent를 Run()하기 전이나 pParent의 함수 안에서 만든다.
+	Job* CreateChildJob(Job* pParent, JobFunction function, const void* pData = nullptr, int dataSize = 0);
+
+	// job을 실행 대기 목록에 넣는다.
+	void Run(Job* pJob);
+
+	// pJob이 끝날 때까지 다른 job을 실행하면서 기다린다.
+	void Wait(Job* pJob);
+
+	// [0, count)를 splitCnt 이하의 범위로 나눠서 function을 병렬로 실행하고 모두 끝날 때까지 기다린다.
+	void ParallelFor(int count, int splitCnt, ParallelForFunction function, void* pContext);
+
+	// 실행할 job이 있다면 하나 실행한다.
+	// 반환값은 job을 실행했는지
+	bool RunPendingJob();
+
+	// 현재 thread가 이 job system의 job thread인지
+	bool IsJobThread();
+
+public:
+	// job thread 본체
+	void JobThread();
+
+	LONG64 GetExecutedJobCount();
+
+	// 다른 thread의 deque에서 훔쳐와서 실행한 job 수
+	LONG64 GetStolenJobCount();
+
+public:
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem(JobSystem&& rhs) = delete;
+
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+	JobSystem& operator=(JobSystem&& rhs) = delete;
+
+private:
+	// 등록한 thread마다 가지는 deque와 job 원형 배열
+	struct JobWorker
+	{
+		JobDeque mDeque;
+		Job* mJobs;
+		unsigned int mAllocatedJobCnt;
+
+		// 사용중인 thread가 있으면 1
+		LONG64 mIsUsed;
+
+		// 주인 thread만 갱신한다.
+		std::atomic<LONG64> mExecutedJobCnt;
+		std::atomic<LONG64> mStolenJobCnt;
+	};
+
+private:
+	Job* AllocateJob();
+
+	// 원형 배열에서 끝난 job 자리를 찾는다. 모두 실행중이면 nullptr
+	Job* FindFinishedJob(Job* pJobs, unsigned int& allocatedJobCnt);
+	Job* GetJob();
+	void Execute(Job* pJob);
+	void Finish(Job* pJob);
+
+	// 현재 thread가 등록한 JobWorker(등록하지 않았다면 nullptr)
+	JobWorker* GetCurrentWorker();
+
+	// 잠들어 있는 job thread가 있으면 하나 깨운다.
+	void WakeUpJobThread();
+
+private:
+	JobWorker* mWorkers;
+	int mWorkerCnt;
+
+	// 등록하지 않은 thread가 사용하는 job 원형 배열과 queue
+	Job* mSharedJobs;
+	unsigned int mSharedAllocatedJobCnt;
+	Queue<Job*>* mSharedQueue;
+	Monitor mSharedSyncObject;
+
+#ifdef _WIN32
+	HANDLE* mJobThreads;
+#else
+	pthread_t* mJobThreads;
+#endif
+	int mJobThreadCnt;
+
+	// 넣었지만 아직 꺼내가지 않은 job 수(job thread가 잠들지 판단할 때 사용)
+	std::atomic<LONG64> mQueuedJobCnt;
+	std::atomic<int> mSleepingThreadCnt;
+	std::atomic<bool> mIsQuit;
+	std::mutex mSleepMutex;
+	std::condition_variable mSleepCondition;
+
+	// 등록하지 않은 thread가 실행한 job 수
+	LONG64 mSharedExecutedJobCnt;
+	LONG64 mSharedStolenJobCnt;
+};
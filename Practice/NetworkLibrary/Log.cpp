@@ -1,10 +1,94 @@
 ﻿#include <time.h>
-#include <WinSock2.h>
+
+#include "Log.h"
+
+#ifdef _WIN32
 #include <WS2tcpip.h>
 
 #pragma comment(lib, "ws2_32")
+#else
+#include <cstdarg>
+#include <cwchar>
+#include <sys/stat.h>
 
-#include "Log.h"
+// MSVC의 보안 강화 함수(_s)들을
+// Linux 표준 함수로 대응시켜서 아래 코드를 그대로 사용한다.
+#define swprintf_s swprintf
+#define vswprintf_s vswprintf
+
+static int localtime_s(struct tm* pLocalTime, const time_t* pTime)
+{
+	return nullptr == localtime_r(pTime, pLocalTime) ? EINVAL : 0;
+}
+
+static int strncpy_s(char* pDst, size_t dstSize, const char* pSrc, size_t count)
+{
+	size_t length = strnlen(pSrc, count);
+	if (dstSize <= length)
+	{
+		length = dstSize - 1;
+	}
+
+	memcpy(pDst, pSrc, length);
+	pDst[length] = '\0';
+
+	return 0;
+}
+
+// Linux의 wchar_t는 4바이트(UTF-32)라서
+// 파일이나 터미널에 그대로 쓰면 읽을 수 없다.
+// 출력하기 전에 UTF-8로 변환한다.
+static int ConvertToUTF8(const wchar_t* pSrc, char* pDst, int dstSize)
+{
+	int length{ 0 };
+
+	for (; L'\0' != *pSrc; ++pSrc)
+	{
+		unsigned int code = static_cast<unsigned int>(*pSrc);
+		char encoded[4]{};
+		int encodedLength{ 0 };
+
+		if (0x80 > code)
+		{
+			encoded[0] = static_cast<char>(code);
+			encodedLength = 1;
+		}
+		else if (0x800 > code)
+		{
+			encoded[0] = static_cast<char>(0xC0 | (code >> 6));
+			encoded[1] = static_cast<char>(0x80 | (code & 0x3F));
+			encodedLength = 2;
+		}
+		else if (0x10000 > code)
+		{
+			encoded[0] = static_cast<char>(0xE0 | (code >> 12));
+			encoded[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			encoded[2] = static_cast<char>(0x80 | (code & 0x3F));
+			encodedLength = 3;
+		}
+		else
+		{
+			encoded[0] = static_cast<char>(0xF0 | (code >> 18));
+			encoded[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+			encoded[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			encoded[3] = static_cast<char>(0x80 | (code & 0x3F));
+			encodedLength = 4;
+		}
+
+		// 널문자 자리는 남겨둔다.
+		if (dstSize <= length + encodedLength)
+		{
+			break;
+		}
+
+		memcpy(pDst + length, encoded, encodedLength);
+		length += encodedLength;
+	}
+
+	pDst[length] = '\0';
+	return length;
+}
+#endif
 
 IMPLEMENT_SINGLETON(Log);
 
@@ -15,7 +99,11 @@ IMPLEMENT_SINGLETON(Log);
 // 내부 생성자/소멸자에서 호출해줌
 void Log::Initialize()
 {
-
+	// 처음에는 모든 gLogMsg가 비어있다.
+	for (int i = 0; i < MAX_QUEUECOUNT; ++i)
+	{
+		mFreeMsgQueue.TryPush(&gLogMsg[i]);
+	}
 }
 
 void Log::Finalize()
@@ -42,12 +130,20 @@ bool Log::Init(LogConfig& logConfig)
 		&localTime);
 
 	// 로그를 출력할 디렉토리 생성
+#ifdef _WIN32
 	CreateDirectory(L"./LOG", NULL);
+#else
+	// Linux는 경로의 대소문자를 구분하기 때문에
+	// 아래 로그 파일 경로와 같은 이름으로 생성
+	mkdir("./Log", 0755);
+#endif
 
 	// 로그를 저장할 파일 이름 세팅
+	// wide 문자열 서식에서 %s의 해석이 MSVC와 glibc가 달라서
+	// 양쪽에서 wide 문자열을 의미하는 %ls를 사용
 	swprintf_s(mLogFileName,
-		sizeof(mLogFileName),
-		L"./Log/%s_%s.log",
+		MAX_FILENAME_LENGTH,
+		L"./Log/%ls_%ls.log",
 		logConfig.mLogFileName,
 		strTime);
 
@@ -188,7 +284,7 @@ void Log::LogOutput(eLogInfoType logInfoType, wchar_t* outputString)
 	// 시간 | 정보 형태 | 정보 등급 | 사용자 로그
 	swprintf_s(mOutString,
 		static_cast<size_t>(sizeof(mOutString) * 0.5), // wchar_t는 sizeof를 하면 2바이트로 잡히기 때문에 버퍼 개수는 바이트 크기의 절반이다
-		L"%ws | %ws | %ws | %ws\r\n",
+		L"%ls | %ls | %ls | %ls\r\n",
 		timeStr,
 		static_cast<int>(logInfoType) >> 4 ? L"에러" : L"정보",
 		LogInfoType_StringTable[logInfoTypeIndex],
@@ -231,6 +327,20 @@ void Log::LogOutputLastErrorToMsgBox(wchar_t* outputString)
 		return;
 	}
 
+#ifndef _WIN32
+	// FormatMessage() 대신 strerror()로 에러 설명을 얻어온다.
+	swprintf_s(
+		gOutString,
+		MAX_OUTPUT_LENGTH,
+		L"에러위치: %ls\n에러번호: %u\n설명: %s",
+		outputString,
+		lastError,
+		strerror(static_cast<int>(lastError))
+	);
+
+	printf("%ls\n", gOutString);
+#else
+
 	LPVOID pDump{ nullptr };
 
 	// last error를 설명해주는 문자열을
@@ -270,6 +380,7 @@ void Log::LogOutputLastErrorToMsgBox(wchar_t* outputString)
 	{
 		LocalFree(pDump);
 	}
+#endif
 }
 
 void Log::CloseAllLog()
@@ -293,7 +404,11 @@ void Log::CloseAllLog()
 	// 닫아주자
 	if (mLogFile)
 	{
+#ifdef _WIN32
 		CloseHandle(mLogFile);
+#else
+		fclose(mLogFile);
+#endif
 		mLogFile = NULL;
 	}
 
@@ -320,18 +435,31 @@ void Log::OnProcess()
 	// logMsgQueue에 있는 데이터를 읽어서
 	// log를 출력
 
+	// 출력하는 동안 계속 들어오는 로그 때문에 끝나지 않을 수 있어서
+	// 호출된 시점에 쌓여있던 만큼만 출력한다.
 	int logCount = mLogMsgQueue.GetCurrentSize();
-	for (int i = 0; i < logCount; ++i)
+	LogMsg* logMsgs[LOG_BATCH_COUNT]{};
+
+	while (0 < logCount)
 	{
-		// 가져와서
-		LogMsg* pLogMsg = mLogMsgQueue.Front();
+		// 원소마다 lock을 잡지 않고 한 번에 가져와서
+		int popCount = mLogMsgQueue.PopBatch(logMsgs);
+		if (0 == popCount)
+		{
+			break;
+		}
 
 		// 출력하고
-		LogOutput(pLogMsg->mLogInfoType,
-			pLogMsg->mOutputString);
+		for (int i = 0; i < popCount; ++i)
+		{
+			LogOutput(logMsgs[i]->mLogInfoType,
+				logMsgs[i]->mOutputString);
+		}
+
+		// 다시 사용하도록 돌려준다.
+		mFreeMsgQueue.PushBatch(std::span<LogMsg* const>{ logMsgs, static_cast<size_t>(popCount) });
 
-		// 데이터 빼주고
-		mLogMsgQueue.Pop();
+		logCount -= popCount;
 	}
 }
 
@@ -345,6 +473,23 @@ int Log::GetQueueSize()
 	return mLogMsgQueue.GetCurrentSize();
 }
 
+#ifndef _WIN32
+bool Log::InitFile()
+{
+	char fileName[MAX_FILENAME_LENGTH * 4]{};
+	ConvertToUTF8(mLogFileName, fileName, sizeof(fileName));
+
+	mLogFile = fopen(fileName, "ab");
+	if (NULL == mLogFile)
+	{
+		return false;
+	}
+
+	// Linux에서는 UTF-8로 기록하기 때문에
+	// UTF-16처럼 byte order mark를 넣을 필요가 없다.
+	return true;
+}
+#else
 bool Log::InitFile()
 {
 	mLogFile = CreateFile(
@@ -388,6 +533,7 @@ bool Log::InitFile()
 
 	return true;
 }
+#endif
 
 bool Log::InitDB()
 {
@@ -399,6 +545,10 @@ bool Log::InitDB()
 
 bool Log::InitUDP()
 {
+#ifndef _WIN32
+	// Linux는 socket 사용 전에 초기화가 필요하지 않다.
+	return true;
+#else
 	WSADATA wsaData{};
 
 	int ret = WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -408,18 +558,23 @@ bool Log::InitUDP()
 	}
 
 	return true;
+#endif
 }
 
 bool Log::InitTCP()
 {
+	int ret{ 0 };
+
+#ifdef _WIN32
 	WSADATA wsaData{};
 
 	// 성공하면 반환 값이 0
-	int ret = WSAStartup(MAKEWORD(2, 2), &wsaData);
+	ret = WSAStartup(MAKEWORD(2, 2), &wsaData);
 	if (ret)
 	{
 		return false;
 	}
+#endif
 
 	// 이미 열려있는 소켓
 	if (INVALID_SOCKET != mTCPSocket)
@@ -453,9 +608,76 @@ bool Log::InitTCP()
 
 void Log::InsertMsgToQueue(LogMsg* pLogMsg)
 {
-	mLogMsgQueue.Push(pLogMsg);
+	// 두 queue를 합쳐도 gLogMsg 수를 넘지 않아서 가득 차는 일은 없다.
+	mLogMsgQueue.TryPush(pLogMsg);
 }
 
+LogMsg* Log::AllocateMsg()
+{
+	LogMsg* pLogMsg{ nullptr };
+	if (false == mFreeMsgQueue.TryPop(&pLogMsg))
+	{
+		return nullptr;
+	}
+
+	return pLogMsg;
+}
+
+#ifndef _WIN32
+void Log::OutputFile(wchar_t* outputString)
+{
+	if (NULL == mLogFile)
+	{
+		return;
+	}
+
+	// 파일 크기 제한에 걸렸다면
+	// Windows와 마찬가지로 새로운 시간으로 이름 지은 파일을 연다.
+	long fileSize = ftell(mLogFile);
+	if (static_cast<long>(mFileMaxSize) < fileSize || MAX_LOGFILE_SIZE < fileSize)
+	{
+		wchar_t strTime[100]{};
+		time_t currTime{ time(NULL) };
+		struct tm localTime {};
+
+		localtime_s(&localTime, &currTime);
+
+		wcsftime(strTime,
+			sizeof(strTime) / sizeof(wchar_t),
+			L"%m월%d일%H시%M분",
+			&localTime);
+
+		wchar_t logTitle[MAX_FILENAME_LENGTH]{};
+		int strIndex = 0;
+		while (mLogFileName[strIndex] != L'_' && mLogFileName[strIndex] != L'\0')
+		{
+			logTitle[strIndex] = mLogFileName[strIndex];
+			++strIndex;
+		}
+
+		swprintf_s(
+			mLogFileName,
+			MAX_FILENAME_LENGTH,
+			L"%ls_%ls.log",
+			logTitle,
+			strTime
+		);
+
+		fclose(mLogFile);
+		mLogFile = NULL;
+		if (false == InitFile())
+		{
+			return;
+		}
+	}
+
+	char utf8String[MAX_OUTPUT_LENGTH * 4]{};
+	int length = ConvertToUTF8(outputString, utf8String, sizeof(utf8String));
+
+	fwrite(utf8String, 1, length, mLogFile);
+	fflush(mLogFile);
+}
+#else
 void Log::OutputFile(wchar_t* outputString)
 {
 	if (NULL == mLogFile)
@@ -510,6 +732,7 @@ void Log::OutputFile(wchar_t* outputString)
 		&writtenBytes,
 		NULL);
 }
+#endif
 
 void Log::OutputDB(wchar_t* outputString)
 {
@@ -523,17 +746,27 @@ void Log::OutputWindow(eLogInfoType logInfoType, wchar_t* outputString)
 		return;
 	}
 
+#ifdef _WIN32
 	// 다른 윈도우에게 메시지 전송
 	SendMessage(mHwnd,
 		WM_DEBUGMSG,
 		reinterpret_cast<WPARAM>(outputString),
 		static_cast<LPARAM>(logInfoType));
+#endif
 }
 
 void Log::OutputDebugger(wchar_t* outputString)
 {
+#ifdef _WIN32
 	// visual studio 출력창에 출력
 	OutputDebugString(outputString);
+#else
+	// Linux에는 debugger 출력창이 없어서 표준 에러로 출력
+	char utf8String[MAX_OUTPUT_LENGTH * 4]{};
+	ConvertToUTF8(outputString, utf8String, sizeof(utf8String));
+
+	fputs(utf8String, stderr);
+#endif
 }
 
 void Log::OutputUDP(eLogInfoType logInfoType, wchar_t* outputString)
@@ -583,15 +816,17 @@ bool NETLIB_API INIT_LOG(LogConfig& logConfig)
 
 void NETLIB_API LOG(eLogInfoType logInfoType, const wchar_t* outputString, ...)
 {
-	Monitor::Owner lock{ gLogSyncObject };
-
-	int queueCount = Log::GetInstance()->GetQueueSize();
-	if (MAX_QUEUECOUNT == queueCount)
+	// 여러 thread가 동시에 호출해도
+	// 각자 다른 LogMsg를 가져가기 때문에 lock을 걸지 않는다.
+	LogMsg* pLogMsg = Log::GetInstance()->AllocateMsg();
+	if (nullptr == pLogMsg)
 	{
 		return;
 	}
 
-	va_list argPtr{ nullptr };
+	// va_list가 배열 타입인 플랫폼(x86-64 Linux)이 있어서
+	// nullptr로 초기화하지 않고 va_start()에 맡긴다.
+	va_list argPtr;
 
 	// 문자열의 시작 주소를 세팅
 	va_start(argPtr, outputString);
@@ -602,29 +837,28 @@ void NETLIB_API LOG(eLogInfoType logInfoType, const wchar_t* outputString, ...)
 	// 스택에 쌓여 있기 때문에
 	// 이를 참조해서 문자열을 완성해준다.
 	vswprintf_s(
-		gLogMsg[queueCount].mOutputString,
-		sizeof(gLogMsg[queueCount].mOutputString),
+		pLogMsg->mOutputString,
+		MAX_OUTPUT_LENGTH,
 		outputString,
 		argPtr);
 
 	va_end(argPtr);
 
-	gLogMsg[queueCount].mLogInfoType = logInfoType;
+	pLogMsg->mLogInfoType = logInfoType;
 
 	// gLogMsg가 배열로 선언되어 있고
-	// 큐의 크기를 index로 해서
-	// gLogMsg[index]에 로그 정보를 세팅하고
+	// 비어있는 gLogMsg[index]를 가져와서 로그 정보를 세팅하고
 	// 메모리 주소를 큐에 넣어준다.
 	// 일정 주기마다 OnProcess() 함수가 호출되면,
 	// 큐에서 포인터 변수를 꺼내서
 	// 해당하는 메모리에 저장되어 있는 데이터를
 	// 매체에 출력한다.
-	Log::GetInstance()->InsertMsgToQueue(&gLogMsg[queueCount]);
+	Log::GetInstance()->InsertMsgToQueue(pLogMsg);
 }
 
 void NETLIB_API LOG_LASTERROR(wchar_t* outputString, ...)
 {
-	va_list argPtr{ nullptr };
+	va_list argPtr;
 
 	va_start(argPtr, outputString);
 
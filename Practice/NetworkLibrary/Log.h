@@ -11,21 +11,14 @@
 // 그래서 log를 직접 출력하는 것이 아니라 queue에 넣기만 하고
 // 다른 thread가 일정 시간마다 log를 출력하는 방식으로 동작한다.
 
-#define _WINSOCKAPI_
-#include <Windows.h>
-#include <WinSock2.h>
+#include <cstdio>
 
+#include "Platform.h"
 #include "Thread.h"
 #include "Singleton.h"
-#include "Queue.h"
+#include "MPMCQueue.h"
 #include "Monitor.h"
 
-#ifdef NETWORKLIBRARY_EXPORTS
-#define NETLIB_API __declspec(dllexport)
-#else
-#define NETLIB_API __declspec(dllimport)
-#endif
-
 constexpr int MAX_FILENAME_LENGTH = 100;
 constexpr int MAX_IP_LENGTH = 20;
 constexpr int MAX_DSN_NAME = 100;
@@ -37,6 +30,7 @@ constexpr int DEFAULT_TCPPORT = 1556;
 constexpr int MAX_OUTPUT_LENGTH = 1024 * 4;
 constexpr int MAX_STORAGE_TYPE = 6;
 constexpr int MAX_QUEUECOUNT = 10000;
+constexpr int LOG_BATCH_COUNT = 64;
 constexpr int MAX_LOGFILE_SIZE = 1024 * 200000; // 200MB
 constexpr int WM_DEBUGMSG = WM_USER + 1;
 
@@ -221,6 +215,10 @@ public:
 	// queue를 검사하여 log를 출력하는 방식으로 동작
 	void InsertMsgToQueue(LogMsg* pLogMsg);
 
+	// 로그를 채울 비어있는 LogMsg를 가져온다.
+	// 출력이 밀려서 모두 queue에 들어가 있다면 nullptr 반환
+	LogMsg* AllocateMsg();
+
 private:
 	// 매체에 로그를 출력하기 위한 동작
 	void OutputFile(wchar_t* outputString);
@@ -253,14 +251,24 @@ private:
 	wchar_t mOutString[MAX_OUTPUT_LENGTH];
 	HWND mHwnd;
 
+#ifdef _WIN32
 	HANDLE mLogFile;
+#else
+	FILE* mLogFile;
+#endif
 
 	SOCKET mUDPSocket;
 	SOCKET mTCPSocket;
 
 	// 출력할 로그를 모아 놓은 queue
 	// LogMsg가 실제로 존재하는 곳은 gLogMsg
-	Queue<LogMsg*> mLogMsgQueue;
+	// 여러 thread가 LOG()를 호출하기 때문에 lock 없는 queue를 사용한다.
+	MPMCQueue<LogMsg*> mLogMsgQueue;
+
+	// 출력을 마쳐서 다시 사용할 수 있는 gLogMsg
+	// 예전에는 queue 크기를 gLogMsg의 index로 사용해서
+	// 출력하기 전인 LogMsg를 다른 로그가 덮어쓸 수 있었다.
+	MPMCQueue<LogMsg*> mFreeMsgQueue;
 
 	DWORD mFileMaxSize;
 };
@@ -269,7 +277,6 @@ private:
 // 접근하기 위한 전역 변수
 static wchar_t gOutString[MAX_OUTPUT_LENGTH];
 static LogMsg gLogMsg[MAX_QUEUECOUNT];
-static Monitor gLogSyncObject;
 
 // 로그를 출력하기 위해서 외부에서 사용하는 함수
 
@@ -0,0 +1,400 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 여러 thread가 lock 없이 넣고 꺼내는 크기 고정 queue(multi producer, multi consumer)
+//
+// Queue<T>는 함수마다 Monitor를 잡기 때문에
+// 쌓인 것을 모두 꺼내려면 원소 하나마다 lock을 두 번(Front(), Pop()) 잡아야 하고
+// 그 사이에 다른 thread가 끼어들 수 있어서 호출하는 쪽에서 lock을 한 번 더 잡아야 했다.
+//
+// MPMCQueue는 원형 배열의 칸(cell)마다 순서 번호(sequence)를 두고
+// 넣는 위치(mEnqueuePos)와 꺼내는 위치(mDequeuePos)를 CAS로 차지한다.
+// - 칸의 sequence == pos이면 비어있는 칸이라서 넣을 수 있다.
+// - 칸의 sequence == pos + 1이면 값이 들어있는 칸이라서 꺼낼 수 있다.
+// - 꺼낸 칸은 sequence를 한 바퀴 뒤(pos + capacity)로 바꿔서 다음 바퀴에 넣는 쪽이 사용한다.
+// 위치를 차지한 thread만 그 칸을 쓰기 때문에 값을 쓰고 읽는 동안에는 다른 thread와 경합하지 않는다.
+//
+// PushBatch(), PopBatch()는 연속된 칸 여러 개를 CAS 한 번으로 차지해서
+// 원소 수만큼 반복하던 경합을 한 번으로 줄인다.
+//
+// 비어있을 때 꺼내는 쪽을 재우고 싶다면 WaitPop()을 사용한다.
+// WaitOnAddress()(Linux는 futex)로 대기하고, 넣는 쪽은 대기하는 thread가 있을 때만 깨운다.
+//
+// 크기는 2의 거듭제곱으로 올린다(위치 % 크기를 & 연산으로 하기 위해서).
+// T는 기본 생성과 복사 대입이 가능해야 한다(포인터, IOCompletion 같은 작은 구조체).
+
+#include <atomic>
+#include <chrono>
+#include <span>
+
+#include "Platform.h"
+
+#ifdef _WIN32
+#pragma comment(lib, "Synchronization")
+#endif
+
+constexpr int MAX_MPMC_QUEUESIZE{ 16384 };
+
+template <typename T>
+class MPMCQueue
+{
+public:
+	MPMCQueue(int maxSize = MAX_MPMC_QUEUESIZE);
+	~MPMCQueue();
+
+public:
+	// 가득 찼다면 false 반환
+	bool TryPush(const T& value);
+
+	// 비어있다면 false 반환
+	bool TryPop(T* pValue);
+
+	// values를 앞에서부터 넣을 수 있는 만큼 넣고 넣은 개수를 반환한다.
+	int PushBatch(std::span<const T> values);
+
+	// 최대 values.size()개를 꺼내서 앞에서부터 채우고 꺼낸 개수를 반환한다.
+	int PopBatch(std::span<T> values);
+
+	// 비어있다면 다른 thread가 넣을 때까지 최대 timeoutMsec 동안 기다렸다가 꺼낸다.
+	// 시간이 초과되면 false 반환
+	bool WaitPop(T* pValue, DWORD timeoutMsec = INFINITE);
+
+public:
+	// 다른 thread가 동시에 넣고 꺼내고 있다면 대략적인 값이다.
+	int GetCurrentSize();
+	int GetMaxSize();
+	bool IsEmpty();
+
+public:
+	MPMCQueue(const MPMCQueue& rhs) = delete;
+	MPMCQueue(MPMCQueue&& rhs) = delete;
+
+	MPMCQueue& operator=(const MPMCQueue& rhs) = delete;
+	MPMCQueue& operator=(MPMCQueue&& rhs) = delete;
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> mSequence;
+		T mValue;
+	};
+
+	// 넣은 뒤에 WaitPop()에서 대기하는 thread가 있으면 깨운다.
+	// 여러 개를 넣었다면 대기하는 thread를 모두 깨운다.
+	void WakeUpWaiter(size_t pushCnt);
+
+private:
+	Cell* mCells;
+	size_t mMask;
+
+	// 넣는 쪽과 꺼내는 쪽이 서로 다른 thread이기 때문에
+	// 같은 cache line을 두고 경합하지 않도록 떨어뜨린다.
+	alignas(64) std::atomic<size_t> mEnqueuePos;
+	alignas(64) std::atomic<size_t> mDequeuePos;
+
+	// WaitPop()에서 대기하는 thread 수와
+	// 깨울 때마다 값을 바꿔서 WaitOnAddress()를 빠져나오게 하는 변수
+	alignas(64) std::atomic<int> mWaiterCnt;
+	std::atomic<int> mPushSignal;
+};
+
+template<typename T>
+inline MPMCQueue<T>::MPMCQueue(int maxSize)
+	: mCells{ nullptr }
+	, mMask{ 0 }
+	, mEnqueuePos{ 0 }
+	, mDequeuePos{ 0 }
+	, mWaiterCnt{ 0 }
+	, mPushSignal{ 0 }
+{
+	size_t capacity{ 2 };
+	while (static_cast<size_t>(maxSize) > capacity)
+	{
+		capacity <<= 1;
+	}
+
+	mMask = capacity - 1;
+	mCells = new Cell[capacity]{};
+
+	// 처음에는 모든 칸이 자기 위치를 기다리는 빈 칸이다.
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		mCells[i].mSequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template<typename T>
+inline MPMCQueue<T>::~MPMCQueue()
+{
+	delete[] mCells;
+}
+
+template<typename T>
+inline bool MPMCQueue<T>::TryPush(const T& value)
+{
+	size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+	Cell* pCell{ nullptr };
+
+	while (true)
+	{
+		pCell = &mCells[pos & mMask];
+		size_t sequence = pCell->mSequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+		if (0 == diff)
+		{
+			// 실패하면 pos가 다른 thread가 옮긴 위치로 바뀐다.
+			if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		// 한 바퀴 전에 넣은 값을 아직 꺼내지 않았다.
+		else if (0 > diff)
+		{
+			return false;
+		}
+		// 다른 thread가 먼저 넣었다.
+		else
+		{
+			pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	pCell->mValue = value;
+	pCell->mSequence.store(pos + 1, std::memory_order_release);
+
+	WakeUpWaiter(1);
+
+	return true;
+}
+
+template<typename T>
+inline bool MPMCQueue<T>::TryPop(T* pValue)
+{
+	size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+	Cell* pCell{ nullptr };
+
+	while (true)
+	{
+		pCell = &mCells[pos & mMask];
+		size_t sequence = pCell->mSequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+		if (0 == diff)
+		{
+			if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		// 아직 넣지 않은 칸이다.
+		else if (0 > diff)
+		{
+			return false;
+		}
+		// 다른 thread가 먼저 꺼냈다.
+		else
+		{
+			pos = mDequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	*pValue = pCell->mValue;
+	pCell->mSequence.store(pos + mMask + 1, std::memory_order_release);
+
+	return true;
+}
+
+template<typename T>
+inline int MPMCQueue<T>::PushBatch(std::span<const T> values)
+{
+	size_t maxCnt = values.size();
+	if (0 == maxCnt)
+	{
+		return 0;
+	}
+
+	size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+	size_t pushCnt{ 0 };
+
+	while (true)
+	{
+		// pos부터 연속으로 비어있는 칸을 센다.
+		// 칸은 위치 순서대로 차지하기 때문에
+		// sequence가 자기 위치와 같다면 pos를 옮기기 전까지 다른 thread가 가져갈 수 없다.
+		pushCnt = 0;
+		while (maxCnt > pushCnt &&
+			pos + pushCnt == mCells[(pos + pushCnt) & mMask].mSequence.load(std::memory_order_acquire))
+		{
+			++pushCnt;
+		}
+
+		if (0 == pushCnt)
+		{
+			size_t sequence = mCells[pos & mMask].mSequence.load(std::memory_order_acquire);
+			if (0 > static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos))
+			{
+				return 0;
+			}
+
+			pos = mEnqueuePos.load(std::memory_order_relaxed);
+			continue;
+		}
+
+		if (mEnqueuePos.compare_exchange_weak(pos, pos + pushCnt, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < pushCnt; ++i)
+	{
+		Cell& cell = mCells[(pos + i) & mMask];
+		cell.mValue = values[i];
+		cell.mSequence.store(pos + i + 1, std::memory_order_release);
+	}
+
+	WakeUpWaiter(pushCnt);
+
+	return static_cast<int>(pushCnt);
+}
+
+template<typename T>
+inline int MPMCQueue<T>::PopBatch(std::span<T> values)
+{
+	size_t maxCnt = values.size();
+	if (0 == maxCnt)
+	{
+		return 0;
+	}
+
+	size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+	size_t popCnt{ 0 };
+
+	while (true)
+	{
+		// pos부터 연속으로 값이 들어있는 칸을 센다.
+		// 넣는 thread가 아직 값을 쓰고 있는 칸에서 멈춘다.
+		popCnt = 0;
+		while (maxCnt > popCnt &&
+			pos + popCnt + 1 == mCells[(pos + popCnt) & mMask].mSequence.load(std::memory_order_acquire))
+		{
+			++popCnt;
+		}
+
+		if (0 == popCnt)
+		{
+			size_t sequence = mCells[pos & mMask].mSequence.load(std::memory_order_acquire);
+			if (0 > static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1))
+			{
+				return 0;
+			}
+
+			pos = mDequeuePos.load(std::memory_order_relaxed);
+			continue;
+		}
+
+		if (mDequeuePos.compare_exchange_weak(pos, pos + popCnt, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < popCnt; ++i)
+	{
+		Cell& cell = mCells[(pos + i) & mMask];
+		values[i] = cell.mValue;
+		cell.mSequence.store(pos + i + mMask + 1, std::memory_order_release);
+	}
+
+	return static_cast<int>(popCnt);
+}
+
+template<typename T>
+inline bool MPMCQueue<T>::WaitPop(T* pValue, DWORD timeoutMsec)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMsec);
+
+	while (true)
+	{
+		if (TryPop(pValue))
+		{
+			return true;
+		}
+
+		// 대기하겠다고 알린 뒤에 한 번 더 확인해야
+		// 그 사이에 넣고 대기하는 thread가 없다고 판단한 쪽을 놓치지 않는다.
+		int pushSignal = mPushSignal.load();
+		mWaiterCnt.fetch_add(1);
+
+		if (TryPop(pValue))
+		{
+			mWaiterCnt.fetch_sub(1);
+			return true;
+		}
+
+		DWORD waitMsec{ INFINITE };
+		if (INFINITE != timeoutMsec)
+		{
+			auto remain = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			waitMsec = 0 < remain.count() ? static_cast<DWORD>(remain.count()) : 0;
+		}
+
+		// 그 사이에 넣었다면 mPushSignal이 바뀌어서 바로 반환한다.
+		bool isWoken = 0 < waitMsec && WaitOnAddress(&mPushSignal, &pushSignal, sizeof(pushSignal), waitMsec);
+		mWaiterCnt.fetch_sub(1);
+
+		if (false == isWoken)
+		{
+			return TryPop(pValue);
+		}
+	}
+}
+
+template<typename T>
+inline void MPMCQueue<T>::WakeUpWaiter(size_t pushCnt)
+{
+	// 값을 넣은 것(sequence store)보다 대기 thread 수를 먼저 읽으면
+	// WaitPop()이 비어있는 것을 확인하고 잠드는 것을 놓칠 수 있다.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (0 == mWaiterCnt.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	mPushSignal.fetch_add(1);
+
+	if (1 == pushCnt)
+	{
+		WakeByAddressSingle(&mPushSignal);
+	}
+	else
+	{
+		WakeByAddressAll(&mPushSignal);
+	}
+}
+
+template<typename T>
+inline int MPMCQueue<T>::GetCurrentSize()
+{
+	size_t dequeuePos = mDequeuePos.load(std::memory_order_relaxed);
+	size_t enqueuePos = mEnqueuePos.load(std::memory_order_relaxed);
+
+	intptr_t size = static_cast<intptr_t>(enqueuePos) - static_cast<intptr_t>(dequeuePos);
+	return 0 < size ? static_cast<int>(size) : 0;
+}
+
+template<typename T>
+inline int MPMCQueue<T>::GetMaxSize()
+{
+	return static_cast<int>(mMask + 1);
+}
+
+template<typename T>
+inline bool MPMCQueue<T>::IsEmpty()
+{
+	return 0 == GetCurrentSize();
+}
@@ -1,8 +1,14 @@
-﻿#define _WINSOCKAPI_
-#include <Windows.h>
+﻿#include <thread>
 
 #include "Monitor.h"
 
+#ifdef _WIN32
+#pragma comment(lib, "Synchronization")
+#endif
+
+// core가 하나라면 lock을 잡은 thread가 실행되지 못하고 있으니 spin하지 않는다.
+static const bool gIsMultiCore{ 1 < std::thread::hardware_concurrency() };
+
 Monitor::Owner::Owner(Monitor& crit)
 	: mSyncObject{ crit } // 참조자는 생성과 동시에 초기화
 {
@@ -15,21 +21,90 @@ Monitor::Owner::~Owner()
 }
 
 Monitor::Monitor()
+	: mState{ 0 }
+	, mOwnerThreadId{ 0 }
+	, mRecursionCnt{ 0 }
+	, mSpinCnt{ 0 }
 {
-	InitializeCriticalSection(&mSyncObject);
 }
 
 Monitor::~Monitor()
 {
-	DeleteCriticalSection(&mSyncObject);
 }
 
 void Monitor::Enter()
 {
-	EnterCriticalSection(&mSyncObject);
+	DWORD threadId = GetCurrentThreadId();
+
+	// 자기가 기록한 값만 자기 thread id와 같을 수 있기 때문에 relaxed로 읽어도 된다.
+	if (threadId == mOwnerThreadId.load(std::memory_order_relaxed))
+	{
+		++mRecursionCnt;
+		return;
+	}
+
+	int state{ 0 };
+	if (false == mState.compare_exchange_strong(state, 1, std::memory_order_acquire))
+	{
+		EnterSlow();
+	}
+
+	mOwnerThreadId.store(threadId, std::memory_order_relaxed);
+	mRecursionCnt = 1;
 }
 
 void Monitor::Leave()
 {
-	LeaveCriticalSection(&mSyncObject);
+	if (0 < --mRecursionCnt)
+	{
+		return;
+	}
+
+	mOwnerThreadId.store(0, std::memory_order_relaxed);
+
+	// 잠든 thread가 있을 수 있다면 하나 깨운다.
+	// 깨어난 thread는 다시 2로 바꾸면서 lock을 얻기 때문에 뒤에 잠든 thread도 놓치지 않는다.
+	if (2 == mState.exchange(0, std::memory_order_release))
+	{
+		WakeByAddressSingle(&mState);
+	}
+}
+
+void Monitor::EnterSlow()
+{
+	if (gIsMultiCore)
+	{
+		int averageSpinCnt = mSpinCnt.load(std::memory_order_relaxed);
+		int maxSpinCnt = averageSpinCnt * 2 + MONITOR_MIN_SPIN_CNT;
+		if (MONITOR_MAX_SPIN_CNT < maxSpinCnt)
+		{
+			maxSpinCnt = MONITOR_MAX_SPIN_CNT;
+		}
+
+		for (int spinCnt = 0; spinCnt < maxSpinCnt; ++spinCnt)
+		{
+			YieldProcessor();
+
+			// 풀린 것을 확인한 뒤에 CAS해야 spin하는 동안 cache line을 빼앗지 않는다.
+			int state = mState.load(std::memory_order_relaxed);
+			if (0 == state && mState.compare_exchange_weak(state, 1, std::memory_order_acquire))
+			{
+				// 평균을 한 번에 바꾸지 않고 1/8씩 따라간다.
+				mSpinCnt.store(averageSpinCnt + (spinCnt - averageSpinCnt) / 8, std::memory_order_relaxed);
+				return;
+			}
+		}
+
+		// spin으로 얻지 못했다면 오래 잡는 lock이라서 다음에는 덜 spin한다.
+		mSpinCnt.store(averageSpinCnt - averageSpinCnt / 8, std::memory_order_relaxed);
+	}
+
+	// 2로 바꾸고 잠든다.
+	// 바꾸기 전 값이 0이었다면 그 순간 lock을 얻은 것이다.
+	// (잠든 thread가 없더라도 2로 남기 때문에 Leave()에서 한 번 더 깨울 수 있지만 놓치는 것보다 낫다.)
+	while (0 != mState.exchange(2, std::memory_order_acquire))
+	{
+		int lockedState{ 2 };
+		WaitOnAddress(&mState, &lockedState, sizeof(lockedState), INFINITE);
+	}
 }
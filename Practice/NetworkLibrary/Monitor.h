@@ -4,15 +4,27 @@
 
 // 동기화를 위한 class로
 // 내부적으로 CRITICAL_SECTION을 사용
+// (Linux에서는 재귀적으로 lock을 걸 수 있는 pthread mutex를 사용)
 
-#ifdef NETWORKLIBRARY_EXPORTS
-#define NETLIB_API __declspec(dllexport)
-#else
-#define NETLIB_API __declspec(dllimport)
-#endif
+// (2026 10 18)
+// CRITICAL_SECTION, pthread mutex 대신 양쪽 플랫폼에서 같은 코드로 동작하는 lock을 직접 구현했다.
+// library의 lock은 대부분 짧게 잡았다가 바로 풀기 때문에
+// 먼저 잠깐 spin하면서 기다리고 그래도 풀리지 않으면 WaitOnAddress()(Linux는 futex)로 잠든다.
+// spin 횟수는 최근에 spin으로 lock을 얻기까지 걸린 횟수의 평균을 따라 늘리고 줄인다(adaptive).
+// 오래 잡는 lock은 spin이 줄어서 CPU를 낭비하지 않고, 짧게 잡는 lock은 잠들고 깨우는 시스템 콜을 피한다.
+// 잠든 thread가 있을 때만 Leave()에서 깨우기 때문에 경합이 없으면 시스템 콜을 하지 않는다.
+//
+// 같은 thread가 여러 번 Enter()해도 막히지 않는 것은 CRITICAL_SECTION과 같다.
+// 읽기가 대부분인 데이터는 여러 thread가 동시에 읽을 수 있는 SharedMonitor(SharedMonitor.h)를 사용한다.
 
-#define _WINSOCKAPI_
-#include <Windows.h>
+#include <atomic>
+
+#include "Platform.h"
+
+// spin으로 lock을 기다리는 최소, 최대 횟수
+// 평균의 2배 + 최소 횟수만큼 spin한다.
+constexpr int MONITOR_MIN_SPIN_CNT{ 16 };
+constexpr int MONITOR_MAX_SPIN_CNT{ 256 };
 
 // 하나의 객체를 여러 thread에서 병렬적으로 사용할 때
 // 멤버 변수에 동기화가 필요하다.
@@ -71,5 +83,20 @@ public:
 	Monitor& operator=(Monitor&& rhs) noexcept = delete;
 
 private:
-	CRITICAL_SECTION mSyncObject;
+	// 바로 lock을 얻지 못했을 때 spin하고, 그래도 안 되면 잠든다.
+	void EnterSlow();
+
+private:
+	// 0: 풀림, 1: 잠김, 2: 잠김 + 잠든 thread가 있을 수 있음
+	// 2일 때만 Leave()에서 잠든 thread를 깨운다.
+	std::atomic<int> mState;
+
+	// CRITICAL_SECTION은 같은 thread가 여러 번 Enter()해도 막히지 않는데
+	// Queue처럼 lock을 건 상태에서 다시 lock을 거는 코드가 있어서
+	// lock을 잡은 thread와 다시 들어온 횟수를 기억한다.
+	std::atomic<DWORD> mOwnerThreadId;
+	int mRecursionCnt;
+
+	// 최근에 spin으로 lock을 얻기까지 걸린 횟수의 평균
+	std::atomic<int> mSpinCnt;
 };
\ No newline at end of file
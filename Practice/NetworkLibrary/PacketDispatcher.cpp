@@ -0,0 +1,38 @@
+﻿#include "Log.h"
+#include "PacketDispatcher.h"
+
+static unsigned int GetPacketId(char* pPacket, DWORD size)
+{
+	unsigned short packetId{ 0 };
+	if (PACKET_HEADER_LENGTH <= size)
+	{
+		CopyMemory(&packetId, pPacket + PACKET_SIZE_LENGTH, PACKET_ID_LENGTH);
+	}
+
+	return packetId;
+}
+
+bool ReportUnknownPacket(Connection* pConnection, char* pPacket, DWORD size)
+{
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | PacketDispatcher::Dispatch() | unknown packet id: %u, size: %u, connection index: %d",
+		GetPacketId(pPacket, size), size, nullptr != pConnection ? pConnection->GetIndex() : -1);
+
+	return false;
+}
+
+bool ReportInvalidPacketSize(Connection* pConnection, char* pPacket, DWORD size, DWORD expectedSize)
+{
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | PacketDispatcher::Dispatch() | invalid packet size, packet id: %u, size: %u, expected: %u, connection index: %d",
+		GetPacketId(pPacket, size), size, expectedSize, nullptr != pConnection ? pConnection->GetIndex() : -1);
+
+	return false;
+}
+
+void ReportDuplicatePacketHandler(unsigned int packetId)
+{
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | PacketDispatcher::Register() | packet id %u is already registered",
+		packetId);
+}
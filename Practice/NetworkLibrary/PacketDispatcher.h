@@ -0,0 +1,214 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 패킷 번호로 handler를 찾아서 호출하는 dispatcher
+//
+// 패킷은 크기(4byte) 뒤에 패킷 번호(2byte)가 오고 그 뒤가 내용이다.
+// OnRecv()에서 패킷 번호를 꺼내 switch로 분기하거나 map에서 handler를 찾던 것을
+// 패킷 번호를 index로 하는 함수 포인터 배열(jump table)로 바꾼다.
+//
+// handler는 compile time에 등록한다.
+// 등록할 때 handler의 인자 형태에서 패킷 struct를 알아내서
+// 크기 검사와 형 변환을 해주는 함수(thunk)를 만들어 table에 넣는다.
+// 그래서 Dispatch()는 범위 검사 후 table을 한 번 간접 호출하는 것으로 끝나고
+// 크기 검사는 그 안에서 상수와 비교 한 번으로 끝난다.
+//
+// 사용 예)
+//	enum class PacketId : unsigned short { Move, Chat, MAX };
+//
+//	#pragma pack(push, 1)
+//	struct MovePacket { PacketHeader mHeader; float mX; float mY; };
+//	struct ChatPacket { PacketHeader mHeader; wchar_t mMessage[1]; };
+//	#pragma pack(pop)
+//
+//	// 고정 길이 패킷: 받은 크기가 sizeof(MovePacket)과 같아야 호출된다.
+//	bool OnMove(Connection* pConnection, const MovePacket& packet);
+//
+//	// 가변 길이 패킷: 받은 크기가 sizeof(ChatPacket) 이상이면 호출되고 실제 크기를 같이 받는다.
+//	bool OnChat(Connection* pConnection, const ChatPacket& packet, DWORD size);
+//
+//	constexpr auto gPacketDispatcher = PacketDispatcher<PacketId, PacketId::MAX>{}
+//		.Register<PacketId::Move, &OnMove>()
+//		.Register<PacketId::Chat, &OnChat>();
+//
+//	bool GameServer::OnRecv(Connection* pConnection, DWORD size, char* pPacket)
+//	{
+//		return gPacketDispatcher.Dispatch(pConnection, pPacket, size);
+//	}
+//
+// constexpr 변수로 만들면 같은 번호에 handler를 두 번 등록했을 때 compile error가 난다.
+// 반환값이 false면 잘못된 패킷이므로 OnRecv()에서 그대로 반환해서 연결을 끊는다.
+
+#include <array>
+#include <type_traits>
+
+#include "Platform.h"
+#include "Connection.h"
+
+// 패킷 번호의 길이
+constexpr int PACKET_ID_LENGTH{ 2 };
+constexpr int PACKET_HEADER_LENGTH{ PACKET_SIZE_LENGTH + PACKET_ID_LENGTH };
+
+// 모든 패킷 struct의 맨 앞에 둔다.
+#pragma pack(push, 1)
+struct PacketHeader
+{
+	int mSize;
+	unsigned short mId;
+};
+#pragma pack(pop)
+
+static_assert(PACKET_HEADER_LENGTH == sizeof(PacketHeader));
+
+// table에 들어가는 함수
+// pPacket은 패킷 크기부터 시작하고 size는 패킷 전체 크기(OnRecv()와 같다)
+using PacketDispatchFunc = bool (*)(Connection* pConnection, char* pPacket, DWORD size);
+
+// 잘못된 패킷을 log로 남기고 false를 반환한다.
+// header에서 Log.h를 include하지 않으려고 PacketDispatcher.cpp에 정의한다.
+bool NETLIB_API ReportUnknownPacket(Connection* pConnection, char* pPacket, DWORD size);
+bool NETLIB_API ReportInvalidPacketSize(Connection* pConnection, char* pPacket, DWORD size, DWORD expectedSize);
+
+// 같은 번호에 handler를 두 번 등록했을 때 호출된다.
+// constexpr 함수가 아니라서 compile time에 평가하는 중에 호출되면 compile error가 된다.
+void NETLIB_API ReportDuplicatePacketHandler(unsigned int packetId);
+
+// 등록하지 않은 번호의 table 자리
+// dll에서 가져온 함수의 주소는 상수가 아니라서 inline 함수로 한 번 감싼다.
+inline bool DispatchUnknownPacket(Connection* pConnection, char* pPacket, DWORD size)
+{
+	return ReportUnknownPacket(pConnection, pPacket, size);
+}
+
+// 수신 buffer의 패킷은 정렬되어 있지 않기 때문에
+// 패킷 struct는 #pragma pack(1)로 정렬을 1로 맞춰야 그대로 참조할 수 있다.
+template <typename T>
+constexpr void CheckPacketType()
+{
+	static_assert(std::is_trivially_copyable_v<T>, "packet struct must be trivially copyable");
+	static_assert(1 == alignof(T), "packet struct must be declared in #pragma pack(1)");
+	static_assert(PACKET_HEADER_LENGTH <= sizeof(T), "packet struct must begin with PacketHeader");
+}
+
+// 고정 길이 패킷 thunk
+template <typename T, auto Handler>
+bool DispatchFixedSizePacket(Connection* pConnection, char* pPacket, DWORD size)
+{
+	if (sizeof(T) != size)
+	{
+		return ReportInvalidPacketSize(pConnection, pPacket, size, sizeof(T));
+	}
+
+	return Handler(pConnection, *reinterpret_cast<const T*>(pPacket));
+}
+
+// 가변 길이 패킷 thunk
+template <typename T, auto Handler>
+bool DispatchVariableSizePacket(Connection* pConnection, char* pPacket, DWORD size)
+{
+	if (sizeof(T) > size)
+	{
+		return ReportInvalidPacketSize(pConnection, pPacket, size, sizeof(T));
+	}
+
+	return Handler(pConnection, *reinterpret_cast<const T*>(pPacket), size);
+}
+
+// handler의 인자 형태로 어떤 thunk를 사용할지 고른다.
+// 인자로 넘긴 handler는 형을 알아내는 데만 사용한다.
+template <auto Handler, typename T>
+constexpr PacketDispatchFunc MakePacketDispatchFunc(bool (*)(Connection*, const T&))
+{
+	CheckPacketType<T>();
+	return &DispatchFixedSizePacket<T, Handler>;
+}
+
+template <auto Handler, typename T>
+constexpr PacketDispatchFunc MakePacketDispatchFunc(bool (*)(Connection*, const T&, DWORD))
+{
+	CheckPacketType<T>();
+	return &DispatchVariableSizePacket<T, Handler>;
+}
+
+// IdType: 패킷 번호 enum(2byte), MaxId: 가장 큰 번호 + 1(table 크기)
+template <typename IdType, IdType MaxId>
+class PacketDispatcher
+{
+public:
+	static_assert(PACKET_ID_LENGTH == sizeof(IdType), "packet id must be 2 bytes");
+
+	static constexpr size_t TABLE_SIZE{ static_cast<size_t>(MaxId) };
+
+public:
+	constexpr PacketDispatcher();
+
+public:
+	// handler를 등록한 dispatcher를 새로 만들어 반환한다.
+	// 이어서 호출해서 constexpr 변수 하나로 table을 완성한다.
+	template <IdType Id, auto Handler>
+	constexpr PacketDispatcher Register() const;
+
+	constexpr bool IsRegistered(IdType id) const;
+
+	// 패킷 번호에 맞는 handler를 호출하고 그 결과를 반환한다.
+	// 패킷이 너무 짧거나 등록하지 않은 번호, 크기가 맞지 않으면 false
+	bool Dispatch(Connection* pConnection, char* pPacket, DWORD size) const;
+
+private:
+	std::array<PacketDispatchFunc, TABLE_SIZE> mTable;
+};
+
+template<typename IdType, IdType MaxId>
+inline constexpr PacketDispatcher<IdType, MaxId>::PacketDispatcher()
+	: mTable{}
+{
+	for (PacketDispatchFunc& dispatchFunc : mTable)
+	{
+		dispatchFunc = &DispatchUnknownPacket;
+	}
+}
+
+template<typename IdType, IdType MaxId>
+template<IdType Id, auto Handler>
+inline constexpr PacketDispatcher<IdType, MaxId> PacketDispatcher<IdType, MaxId>::Register() const
+{
+	constexpr size_t index{ static_cast<size_t>(Id) };
+	static_assert(TABLE_SIZE > index, "packet id is out of range");
+
+	PacketDispatcher dispatcher{ *this };
+	if (&DispatchUnknownPacket != dispatcher.mTable[index])
+	{
+		ReportDuplicatePacketHandler(static_cast<unsigned int>(index));
+	}
+
+	dispatcher.mTable[index] = MakePacketDispatchFunc<Handler>(Handler);
+	return dispatcher;
+}
+
+template<typename IdType, IdType MaxId>
+inline constexpr bool PacketDispatcher<IdType, MaxId>::IsRegistered(IdType id) const
+{
+	size_t index{ static_cast<size_t>(id) };
+	return TABLE_SIZE > index && &DispatchUnknownPacket != mTable[index];
+}
+
+template<typename IdType, IdType MaxId>
+inline bool PacketDispatcher<IdType, MaxId>::Dispatch(Connection* pConnection, char* pPacket, DWORD size) const
+{
+	// OnRecv()는 패킷 크기(4byte)까지만 확인하고 넘겨준다.
+	if (PACKET_HEADER_LENGTH > size)
+	{
+		return ReportInvalidPacketSize(pConnection, pPacket, size, PACKET_HEADER_LENGTH);
+	}
+
+	unsigned short packetId{ 0 };
+	CopyMemory(&packetId, pPacket + PACKET_SIZE_LENGTH, PACKET_ID_LENGTH);
+
+	if (TABLE_SIZE <= packetId)
+	{
+		return ReportUnknownPacket(pConnection, pPacket, size);
+	}
+
+	return mTable[packetId](pConnection, pPacket, size);
+}
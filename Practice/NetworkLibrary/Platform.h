@@ -0,0 +1,210 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// network library를 Windows와 Linux 양쪽에서 빌드하기 위한 공통 header
+//
+// Windows에서는 지금까지처럼 Windows.h와 WinSock2.h를 그대로 사용하고
+// Linux에서는 library 코드가 사용하고 있는 Win32 자료형, 상수, 함수 이름을
+// POSIX 대응 함수로 맞춰준다.
+// 이렇게 하면 Connection, RingBuffer 같은 코드를 플랫폼마다 따로 작성하지 않아도 되고
+// 정말로 운영체제마다 달라야 하는 부분(비동기 IO, 동기화 객체, thread)만
+// #ifdef _WIN32로 나누면 된다.
+
+#ifdef _WIN32
+
+#ifdef NETWORKLIBRARY_EXPORTS
+#define NETLIB_API __declspec(dllexport)
+#else
+#define NETLIB_API __declspec(dllimport)
+#endif
+
+// Windows.h가 예전 버전인 winsock.h를 포함하지 않도록 막고
+// WinSock2.h를 사용한다.
+#define _WINSOCKAPI_
+#include <Windows.h>
+#include <WinSock2.h>
+
+#else
+
+// Linux에서는 shared object의 심볼이 기본으로 공개되지만
+// -fvisibility=hidden으로 빌드할 때를 위해 명시적으로 공개한다.
+#define NETLIB_API __attribute__((visibility("default")))
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <climits>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+using SOCKET = int;
+using DWORD = unsigned int;
+using LONG64 = long long;
+using DWORD64 = unsigned long long;
+using HANDLE = void*;
+using HWND = void*;
+using WPARAM = uintptr_t;
+using LPARAM = intptr_t;
+
+using SOCKADDR = sockaddr;
+using SOCKADDR_IN = sockaddr_in;
+
+constexpr SOCKET INVALID_SOCKET{ -1 };
+constexpr int SOCKET_ERROR{ -1 };
+constexpr DWORD INFINITE{ 0xFFFFFFFF };
+constexpr int SD_BOTH{ SHUT_RDWR };
+constexpr unsigned int WM_USER{ 0x0400 };
+
+// WSASend(), WSARecv()에 넘기던 WSABUF와 같은 모양.
+// Linux backend는 이 값을 iovec으로 옮겨서 사용한다.
+struct WSABUF
+{
+	unsigned long len;
+	char* buf;
+};
+
+// Linux에는 overlapped IO 구조체가 없지만
+// OVERLAPPED_EX의 선두에 위치하는 구조를 그대로 유지하기 위해 자리만 잡아둔다.
+// (Windows OVERLAPPED와 같은 크기)
+struct WSAOVERLAPPED
+{
+	uintptr_t mInternal;
+	uintptr_t mInternalHigh;
+	DWORD mOffset;
+	DWORD mOffsetHigh;
+	HANDLE mEvent;
+};
+
+#define ZeroMemory(dst, length) memset((dst), 0, (length))
+#define CopyMemory(dst, src, length) memcpy((dst), (src), (length))
+#define MoveMemory(dst, src, length) memmove((dst), (src), (length))
+
+inline int closesocket(SOCKET socket)
+{
+	return close(socket);
+}
+
+inline int WSAGetLastError()
+{
+	return errno;
+}
+
+inline DWORD GetLastError()
+{
+	return static_cast<DWORD>(errno);
+}
+
+// Interlocked 계열 함수는 gcc의 __atomic 내장 함수로 대응한다.
+// 둘 다 하드웨어의 지원을 받는 원자적 연산이고
+// 순서 보장은 Windows와 같게 sequentially consistent로 맞췄다.
+inline LONG64 InterlockedIncrement64(LONG64 volatile* pAddend)
+{
+	return __atomic_add_fetch(pAddend, 1, __ATOMIC_SEQ_CST);
+}
+
+inline LONG64 InterlockedDecrement64(LONG64 volatile* pAddend)
+{
+	return __atomic_sub_fetch(pAddend, 1, __ATOMIC_SEQ_CST);
+}
+
+// 반환값은 Windows와 마찬가지로 더한 뒤의 값
+inline LONG64 InterlockedAdd64(LONG64 volatile* pAddend, LONG64 value)
+{
+	return __atomic_add_fetch(pAddend, value, __ATOMIC_SEQ_CST);
+}
+
+inline LONG64 InterlockedExchange64(LONG64 volatile* pTarget, LONG64 value)
+{
+	return __atomic_exchange_n(pTarget, value, __ATOMIC_SEQ_CST);
+}
+
+// 반환값은 Windows와 마찬가지로 교환하기 전의 원래 값
+inline LONG64 InterlockedCompareExchange64(LONG64 volatile* pDestination, LONG64 exchange, LONG64 comparand)
+{
+	__atomic_compare_exchange_n(pDestination,
+		&comparand,
+		exchange,
+		false,
+		__ATOMIC_SEQ_CST,
+		__ATOMIC_SEQ_CST);
+
+	return comparand;
+}
+
+// WaitOnAddress(), WakeByAddress*()는 futex로 대응한다.
+// 값이 바뀌기를 kernel에서 기다리기 때문에 event 객체 없이 변수 하나로 thread를 재우고 깨울 수 있다.
+// futex는 4byte 값만 비교할 수 있어서 addressSize는 4만 지원한다.
+// 반환값은 Windows와 마찬가지로 시간이 초과되면 false(errno: ETIMEDOUT)
+// 값이 이미 달랐거나 signal로 깨어난 것은 true로 반환하기 때문에 호출한 쪽에서 값을 다시 확인해야 한다.
+inline bool WaitOnAddress(volatile void* address, void* compareAddress, size_t addressSize, DWORD milliseconds)
+{
+	if (sizeof(int) != addressSize)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	int compareValue{ 0 };
+	memcpy(&compareValue, compareAddress, sizeof(compareValue));
+
+	timespec timeout{};
+	timeout.tv_sec = milliseconds / 1000;
+	timeout.tv_nsec = static_cast<long>(milliseconds % 1000) * 1000000;
+
+	long ret = syscall(SYS_futex,
+		const_cast<void*>(address),
+		FUTEX_WAIT_PRIVATE,
+		compareValue,
+		INFINITE == milliseconds ? nullptr : &timeout,
+		nullptr,
+		0);
+
+	return 0 == ret || ETIMEDOUT != errno;
+}
+
+inline void WakeByAddressSingle(void* address)
+{
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+inline void WakeByAddressAll(void* address)
+{
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// lock을 누가 잡았는지 기록할 때 사용한다.
+// gettid()는 시스템 콜이라서 thread마다 한 번만 호출하고 기억해둔다.
+// (thread_local을 gettid()로 바로 초기화하면 읽을 때마다 초기화 여부를 확인하는 함수를 거친다.)
+inline DWORD GetCurrentThreadId()
+{
+	static thread_local DWORD tThreadId{ 0 };
+	if (0 == tThreadId)
+	{
+		tThreadId = static_cast<DWORD>(syscall(SYS_gettid));
+	}
+
+	return tThreadId;
+}
+
+// spin하면서 기다릴 때 CPU에게 알려준다.
+// 같은 core의 다른 hardware thread에게 자원을 양보하고 spin을 빠져나올 때 pipeline 비용을 줄인다.
+inline void YieldProcessor()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+#endif
\ No newline at end of file
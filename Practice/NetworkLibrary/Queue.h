@@ -32,8 +32,8 @@ template <typename T>
 class Queue
 {
 public:
-	Queue<T>(int maxSize = MAX_QUEUESIZE);
-	~Queue<T>();
+	Queue(int maxSize = MAX_QUEUESIZE);
+	~Queue();
 
 public:
 	bool Push(T value);
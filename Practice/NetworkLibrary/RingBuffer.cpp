@@ -1,5 +1,10 @@
 ﻿#include <new> // bad_alloc
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "Log.h"
 #include "RingBuffer.h"
 #include "Monitor.h"
 
@@ -9,20 +14,48 @@ RingBuffer::RingBuffer()
 	, mCurrentMark{ nullptr }
 	, mGetBufferMark{ nullptr }
 	, mLastMoveMark{ nullptr }
+	, mReleaseMark{ nullptr }
+	, mReleaseWrapMark{ nullptr }
 	, mBufferSize{ 0 }
+	, mIsMirrored{ false }
 	, mUsedBufferSize{ 0 }
+	, mHoldBufferSize{ 0 }
+	, mDeferredReleaseSize{ 0 }
 	, mTotalUsedBufferSize{ 0 }
+	, mReservedSize{ 0 }
 	, mSyncObject{}
+	, mIsSPSC{ false }
+	, mSPSCTail{ 0 }
+	, mSPSCCachedHead{ 0 }
+	, mSPSCHead{ 0 }
+	, mSPSCCachedTail{ 0 }
 {
 }
 
 RingBuffer::~RingBuffer()
 {
+#ifndef _WIN32
+	if (mIsMirrored)
+	{
+		munmap(mBeginMark, static_cast<size_t>(mBufferSize) * 2);
+		return;
+	}
+#endif
+
 	delete[] mBeginMark;
 }
 
-bool RingBuffer::Create(int bufferSize)
+bool RingBuffer::Create(int bufferSize, bool isMirrored)
 {
+	if (isMirrored && CreateMirroredMemory(bufferSize))
+	{
+		mEndMark = mBeginMark + mBufferSize;
+
+		Initialize();
+
+		return true;
+	}
+
 	try
 	{
 		mBeginMark = new char[bufferSize];
@@ -73,9 +106,38 @@ bool RingBuffer::Initialize()
 	mCurrentMark = mBeginMark;
 	mGetBufferMark = mBeginMark;
 	mLastMoveMark = mEndMark;
+	mReleaseMark = mBeginMark;
+	mReleaseWrapMark = mEndMark;
 
 	mUsedBufferSize = 0;
+	mHoldBufferSize = 0;
+	mDeferredReleaseSize = 0;
 	mTotalUsedBufferSize = 0;
+	mReservedSize = 0;
+
+	mSPSCTail.store(0, std::memory_order_relaxed);
+	mSPSCCachedHead = 0;
+	mSPSCHead.store(0, std::memory_order_relaxed);
+	mSPSCCachedTail = 0;
+
+	return true;
+}
+
+bool RingBuffer::CreateSPSC(int bufferSize)
+{
+	// 쓰는 위치와 읽는 위치 사이가 끝에서 잘리지 않아야 해서 mirrored 메모리가 필요하다.
+	if (false == CreateMirroredMemory(bufferSize))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | RingBuffer::CreateSPSC() | mirrored memory is required");
+
+		return false;
+	}
+
+	mEndMark = mBeginMark + mBufferSize;
+	mIsSPSC = true;
+
+	Initialize();
 
 	return true;
 }
@@ -97,19 +159,59 @@ char* RingBuffer::MoveMark(int moveLength)
 		return nullptr;
 	}
 
+	// mirrored 버퍼는 끝을 넘어도 이어지기 때문에 사용량만 확인하면 된다.
+	if (mIsMirrored)
+	{
+		pPrevCurrentMark = mCurrentMark;
+		mCurrentMark = WrapMirroredMark(mCurrentMark + moveLength);
+
+		mUsedBufferSize += moveLength;
+		mTotalUsedBufferSize += moveLength;
+		mReservedSize += moveLength;
+
+		return pPrevCurrentMark;
+	}
+
+	// 사용중인 데이터가 없다면 CurrentMark부터 비어있다.
+	if (0 == mUsedBufferSize)
+	{
+		mReleaseMark = mCurrentMark;
+		mReleaseWrapMark = mEndMark;
+	}
+
+	// 뒤쪽 공간을 남겨두고 앞으로 이동했다면 남긴 공간은 사용량에 포함되지 않아서
+	// 사용량만으로는 해제되지 않은 데이터를 덮어쓰는지 알 수 없다.
+	// 해제되지 않은 데이터가 버퍼의 끝에서 처음으로 이어져 있다면
+	// CurrentMark부터 ReleaseMark 앞까지만 사용할 수 있다.
+	if (mReleaseMark > mCurrentMark ||
+		(mReleaseMark == mCurrentMark && 0 < mUsedBufferSize))
+	{
+		if (mReleaseMark - mCurrentMark < moveLength)
+		{
+			return nullptr;
+		}
+
+		pPrevCurrentMark = mCurrentMark;
+		mCurrentMark += moveLength;
+	}
 	// EndMark와 CurrentMark 사이에 충분한 공간이 있어서
 	// 추가적인 작업 없이 바로 공간을 마련할 수 있다.
-	if (mEndMark - mCurrentMark >= moveLength)
+	else if (mEndMark - mCurrentMark >= moveLength)
 	{
 		pPrevCurrentMark = mCurrentMark;
 		mCurrentMark += moveLength;
 	}
 	// 이번에는 충분한 공간이 없어서
 	// 버퍼의 앞으로 이동해서 공간을 마련해준다.
-	// 앞쪽 데이터는 오래 전에 처리되었기 때문에
+	// 앞쪽 데이터는 ReleaseMark 앞까지 처리되었기 때문에
 	// 덮어 씌워도 문제가 없다.
 	else
 	{
+		if (mReleaseMark - mBeginMark < moveLength)
+		{
+			return nullptr;
+		}
+
 		// 배열의 앞 쪽으로 포인터를 옮기기 전에
 		// 데이터를 어디까지 썼는지 위치를 기록
 		mLastMoveMark = mCurrentMark;
@@ -120,6 +222,7 @@ char* RingBuffer::MoveMark(int moveLength)
 
 	mUsedBufferSize += moveLength;
 	mTotalUsedBufferSize += moveLength;
+	mReservedSize += moveLength;
 
 	// 송신할 데이터를 위한 공간은 이 위치부터 시작
 	return pPrevCurrentMark;
@@ -138,6 +241,23 @@ char* RingBuffer::MoveMark(int moveLength, int maxRecvLength, DWORD numOfBytesRe
 		return nullptr;
 	}
 
+	// mirrored 버퍼는 잘린 패킷을 앞으로 복사하지 않고 그 뒤에서 이어서 받는다.
+	// 잘린 패킷의 시작 위치가 mEndMark를 넘어갔을 때만 앞쪽의 같은 위치로 되돌린다.
+	// (잘린 패킷 + maxRecvLength가 버퍼 크기 이하라서 두 번째 매핑을 벗어나지 않는다.)
+	if (mIsMirrored)
+	{
+		mCurrentMark += moveLength;
+		if (mCurrentMark - static_cast<long long>(numOfBytesRecv) >= mEndMark)
+		{
+			mCurrentMark -= mBufferSize;
+		}
+
+		mUsedBufferSize += moveLength;
+		mTotalUsedBufferSize += moveLength;
+
+		return mCurrentMark;
+	}
+
 	// 버퍼의 끝 위치를 가리키는 EndMark에서
 	// 지금까지 마련해준 공간의 마지막 공간의 다음 공간을 가리키고 있는 CurrentMark를 빼준 값이
 	// 앞으로 수신할 버퍼의 크기(moveLength + maxRecvLength)보다 크면
@@ -158,14 +278,17 @@ char* RingBuffer::MoveMark(int moveLength, int maxRecvLength, DWORD numOfBytesRe
 		// 일부만 받은 패킷을 BeginMark위치로 복사해서
 		// 앞쪽 공간에서 받도록 함.
 		// (앞쪽 공간은 이미 처리되었기 때문에 덮어 써도 문제가 없다.)
-		CopyMemory(mBeginMark,
+		// 잘린 패킷이 길면 복사할 위치와 겹칠 수 있어서 MoveMemory()로 복사
+		MoveMemory(mBeginMark,
 			// 만약에 총 패킷의 길이가 6바이트인데 내가 4바이트만 수신한 상태라면,
 			// moveLength = -2
 			// (현재까지 수신한 바이트 - (할당 받은 버퍼의 끝 위치(CurrentMark) - 할당 받은 버퍼의 시작 위치(pBuf)))
 			// numOfBytesRecv = 4가 되어서
 			// mCurrentMark에서 6바이트 이동한 부분부터
 			// 현재까지 수신한 패킷 길이(numOfBytesRecv)만큼 복사하면 된다.
-			mCurrentMark - (numOfBytesRecv - moveLength),
+			// numOfBytesRecv가 DWORD라서 (numOfBytesRecv - moveLength)로 계산하면
+			// moveLength가 더 클 때 unsigned로 넘쳐서 엉뚱한 위치를 가리키기 때문에 signed로 계산
+			mCurrentMark + moveLength - static_cast<long long>(numOfBytesRecv),
 			numOfBytesRecv);
 
 		mCurrentMark = mBeginMark + numOfBytesRecv;
@@ -182,7 +305,68 @@ void RingBuffer::ReleaseBuffer(int releaseSize)
 {
 	Monitor::Owner lock{ mSyncObject };
 
+	// 앞쪽에 잡아둔 버퍼가 있다면 같이 해제될 때까지 미룬다.
+	if (0 < mHoldBufferSize)
+	{
+		mDeferredReleaseSize += releaseSize;
+		return;
+	}
+
+	mUsedBufferSize -= releaseSize;
+	MoveReleaseMark(releaseSize);
+}
+
+void RingBuffer::HoldBuffer(int holdSize)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	mHoldBufferSize += holdSize;
+}
+
+void RingBuffer::ReleaseHoldBuffer(int releaseSize)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	mHoldBufferSize -= releaseSize;
 	mUsedBufferSize -= releaseSize;
+	MoveReleaseMark(releaseSize);
+
+	if (0 == mHoldBufferSize && 0 < mDeferredReleaseSize)
+	{
+		mUsedBufferSize -= mDeferredReleaseSize;
+		MoveReleaseMark(mDeferredReleaseSize);
+
+		mDeferredReleaseSize = 0;
+	}
+}
+
+void RingBuffer::MoveReleaseMark(int releaseSize)
+{
+	if (mIsMirrored)
+	{
+		mReleaseMark = WrapMirroredMark(mReleaseMark + releaseSize);
+		return;
+	}
+
+	while (0 < releaseSize)
+	{
+		// 송신할 데이터가 버퍼의 앞으로 이어졌던 위치까지 해제했다면
+		// 해제할 나머지는 버퍼의 앞에서 시작한다.
+		if (mReleaseMark == mReleaseWrapMark)
+		{
+			mReleaseMark = mBeginMark;
+			mReleaseWrapMark = mEndMark;
+		}
+
+		int moveSize = static_cast<int>(mReleaseWrapMark - mReleaseMark);
+		if (moveSize > releaseSize)
+		{
+			moveSize = releaseSize;
+		}
+
+		mReleaseMark += moveSize;
+		releaseSize -= moveSize;
+	}
 }
 
 char* RingBuffer::GetBuffer(int requestSendSize, int* realSendSize)
@@ -192,18 +376,39 @@ char* RingBuffer::GetBuffer(int requestSendSize, int* realSendSize)
 
 	Monitor::Owner lock{ mSyncObject };
 
+	// 잡아두거나 해제를 미룬 크기는 이미 송신한 데이터라서 빼고 계산
+	int pendingSize = mUsedBufferSize - mHoldBufferSize - mDeferredReleaseSize;
+
+	// mirrored 버퍼는 송신할 데이터가 항상 이어져 있다.
+	if (mIsMirrored)
+	{
+		*realSendSize = pendingSize > requestSendSize ? requestSendSize : pendingSize;
+		if (0 >= *realSendSize)
+		{
+			*realSendSize = 0;
+			return nullptr;
+		}
+
+		pSendStartPosition = mGetBufferMark;
+		mGetBufferMark = WrapMirroredMark(mGetBufferMark + *realSendSize);
+
+		return pSendStartPosition;
+	}
+
 	// GetBufferMark가 의미하는 것이 어디까지 송신이 완료되었나? 인데
 	// 마지막 위치까지 송신이 완료되었으니
 	// 버퍼의 앞으로 이동해서 송신 가능한 공간을 지정해줘야함
+	// 해제도 이 위치에서 앞으로 이동해야 하니 기억해둔다.
 	if (mLastMoveMark == mGetBufferMark)
 	{
+		mReleaseWrapMark = mLastMoveMark;
 		mLastMoveMark = mEndMark;
 		mGetBufferMark = mBeginMark;
 	}
 
 	// 송신하기 위해 준비중인 데이터의 양이
 	// 최대 송신 요청량보다 많다면
-	if (mUsedBufferSize > requestSendSize)
+	if (pendingSize > requestSendSize)
 	{
 		// mLastMoveMark: 송신할 데이터가 존재하는 마지막 위치의 다음 위치
 		// mGetBufferMark: 현재까지 전송한 데이터 위치의 다음 위치
@@ -232,16 +437,16 @@ char* RingBuffer::GetBuffer(int requestSendSize, int* realSendSize)
 	// 송신하기 위해 준비중인 데이터의 양이
 	// 최대 송신 요청량보다 적지만,
 	// 보낼 데이터가 있다면
-	else if(mUsedBufferSize > 0)
+	else if(pendingSize > 0)
 	{
 		// LastMoveMark와 GetBufferMark 사이에 송신할 데이터가 모두 존재하면
-		if (mLastMoveMark - mGetBufferMark >= mUsedBufferSize)
+		if (mLastMoveMark - mGetBufferMark >= pendingSize)
 		{
-			*realSendSize = mUsedBufferSize;
+			*realSendSize = pendingSize;
 
 			pSendStartPosition = mGetBufferMark;
 
-			mGetBufferMark += mUsedBufferSize;
+			mGetBufferMark += pendingSize;
 		}
 		// 사이에 데이터가 모두 존재하지 않으면,
 		else
@@ -257,6 +462,116 @@ char* RingBuffer::GetBuffer(int requestSendSize, int* realSendSize)
 	return pSendStartPosition;
 }
 
+int RingBuffer::GetBuffers(int requestSendSize, WSABUF* pBufs, int maxBufCnt, int* realSendSize)
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	// 송신할 데이터의 양과 최대 송신 요청량 중 작은 값만큼 보낸다.
+	// 잡아두거나 해제를 미룬 크기는 이미 송신한 데이터라서 뺀다.
+	int pendingSize = mUsedBufferSize - mHoldBufferSize - mDeferredReleaseSize;
+	int remainSize = pendingSize > requestSendSize ? requestSendSize : pendingSize;
+	int bufCnt{ 0 };
+
+	*realSendSize = 0;
+
+	// mirrored 버퍼는 송신할 데이터가 끝을 넘어도 한 조각으로 이어져 있다.
+	if (mIsMirrored)
+	{
+		if (0 >= remainSize || 0 >= maxBufCnt)
+		{
+			return 0;
+		}
+
+		pBufs[0].buf = mGetBufferMark;
+		pBufs[0].len = remainSize;
+
+		mGetBufferMark = WrapMirroredMark(mGetBufferMark + remainSize);
+		*realSendSize = remainSize;
+
+		return 1;
+	}
+
+	while (0 < remainSize && maxBufCnt > bufCnt)
+	{
+		// 마지막 위치까지 송신할 데이터를 담았다면
+		// 버퍼의 앞으로 이동해서 이어지는 데이터를 담는다.
+		if (mLastMoveMark == mGetBufferMark)
+		{
+			mReleaseWrapMark = mLastMoveMark;
+			mLastMoveMark = mEndMark;
+			mGetBufferMark = mBeginMark;
+		}
+
+		// LastMoveMark와 GetBufferMark 사이에 있는 만큼만 한 조각으로 담을 수 있다.
+		int sendSize = static_cast<int>(mLastMoveMark - mGetBufferMark);
+		if (sendSize > remainSize)
+		{
+			sendSize = remainSize;
+		}
+
+		pBufs[bufCnt].buf = mGetBufferMark;
+		pBufs[bufCnt].len = sendSize;
+		++bufCnt;
+
+		mGetBufferMark += sendSize;
+		remainSize -= sendSize;
+		*realSendSize += sendSize;
+	}
+
+	return bufCnt;
+}
+
+char* RingBuffer::ReserveSPSC(int reserveSize)
+{
+	// 자기 위치는 자기만 바꾸니 relaxed로 읽어도 된다.
+	LONG64 tail = mSPSCTail.load(std::memory_order_relaxed);
+
+	// 기억해둔 읽은 위치로 모자랄 때만 읽는 쪽의 cache line을 읽는다.
+	// acquire: 읽는 쪽이 해제하기 전에 끝낸 읽기가 이 뒤의 쓰기보다 먼저 일어난다.
+	if (tail + reserveSize - mSPSCCachedHead > mBufferSize)
+	{
+		mSPSCCachedHead = mSPSCHead.load(std::memory_order_acquire);
+		if (tail + reserveSize - mSPSCCachedHead > mBufferSize)
+		{
+			return nullptr;
+		}
+	}
+
+	return mBeginMark + tail % mBufferSize;
+}
+
+void RingBuffer::CommitSPSC(int commitSize)
+{
+	// release: 채운 내용이 위치보다 먼저 읽는 쪽에 보인다.
+	LONG64 tail = mSPSCTail.load(std::memory_order_relaxed);
+	mSPSCTail.store(tail + commitSize, std::memory_order_release);
+}
+
+char* RingBuffer::PeekSPSC(int* readableSize)
+{
+	LONG64 head = mSPSCHead.load(std::memory_order_relaxed);
+
+	// 기억해둔 commit 위치까지 다 읽었을 때만 쓰는 쪽의 cache line을 읽는다.
+	if (head == mSPSCCachedTail)
+	{
+		mSPSCCachedTail = mSPSCTail.load(std::memory_order_acquire);
+	}
+
+	*readableSize = static_cast<int>(mSPSCCachedTail - head);
+	if (0 == *readableSize)
+	{
+		return nullptr;
+	}
+
+	return mBeginMark + head % mBufferSize;
+}
+
+void RingBuffer::ReleaseSPSC(int releaseSize)
+{
+	LONG64 head = mSPSCHead.load(std::memory_order_relaxed);
+	mSPSCHead.store(head + releaseSize, std::memory_order_release);
+}
+
 int RingBuffer::GetBufferSize()
 {
 	return mBufferSize;
@@ -267,6 +582,20 @@ int RingBuffer::GetUsedBufferSize()
 	return mUsedBufferSize;
 }
 
+int RingBuffer::GetPendingSendSize()
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	return mUsedBufferSize - mHoldBufferSize - mDeferredReleaseSize;
+}
+
+LONG64 RingBuffer::GetReservedSize()
+{
+	Monitor::Owner lock{ mSyncObject };
+
+	return mReservedSize;
+}
+
 int RingBuffer::GetTotalUsedBufferSize()
 {
 	return mTotalUsedBufferSize;
@@ -286,3 +615,87 @@ char* RingBuffer::GetEndMark()
 {
 	return mEndMark;
 }
+
+bool RingBuffer::IsMirrored()
+{
+	return mIsMirrored;
+}
+
+bool RingBuffer::IsSPSC()
+{
+	return mIsSPSC;
+}
+
+bool RingBuffer::CreateMirroredMemory(int bufferSize)
+{
+#ifdef _WIN32
+	LOG(eLogInfoType::LOG_ERROR_NORMAL,
+		L"SYSTEM | RingBuffer::CreateMirroredMemory() | mirrored ring buffer is not supported");
+
+	return false;
+#else
+	// 두 번째 매핑이 첫 번째 매핑 바로 뒤에 붙으려면 page 단위여야 한다.
+	long pageSize = sysconf(_SC_PAGESIZE);
+	size_t mapSize = (static_cast<size_t>(bufferSize) + pageSize - 1) / pageSize * pageSize;
+
+	int memoryFd = memfd_create("RingBuffer", MFD_CLOEXEC);
+	if (0 > memoryFd)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | RingBuffer::CreateMirroredMemory() | memfd_create() failed: %d",
+			errno);
+
+		return false;
+	}
+
+	if (0 != ftruncate(memoryFd, static_cast<off_t>(mapSize)))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | RingBuffer::CreateMirroredMemory() | ftruncate() failed: %d",
+			errno);
+
+		close(memoryFd);
+		return false;
+	}
+
+	// 두 배 크기의 주소 공간을 먼저 잡아두고 그 위에 같은 memfd를 두 번 덮어서 매핑한다.
+	char* pBase = reinterpret_cast<char*>(mmap(nullptr, mapSize * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (MAP_FAILED == pBase)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | RingBuffer::CreateMirroredMemory() | mmap() reserve failed: %d",
+			errno);
+
+		close(memoryFd);
+		return false;
+	}
+
+	bool isMapped =
+		MAP_FAILED != mmap(pBase, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memoryFd, 0) &&
+		MAP_FAILED != mmap(pBase + mapSize, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memoryFd, 0);
+
+	// 매핑이 memfd를 참조하고 있어서 fd는 닫아도 된다.
+	close(memoryFd);
+
+	if (false == isMapped)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | RingBuffer::CreateMirroredMemory() | mmap() mirror failed: %d",
+			errno);
+
+		munmap(pBase, mapSize * 2);
+		return false;
+	}
+
+	mBeginMark = pBase;
+	mBufferSize = static_cast<int>(mapSize);
+	mIsMirrored = true;
+
+	return true;
+#endif
+}
+
+char* RingBuffer::WrapMirroredMark(char* pMark)
+{
+	return pMark >= mEndMark ? pMark - mBufferSize : pMark;
+}
@@ -23,35 +23,59 @@
 // 버퍼가 원형으로 이어져있기 때문에
 // 이미 사용한 공간 위에 새로운 데이터를 덮어 씌움으로써
 // 과거 데이터에 대한 처리를 신경 쓰지 않아도 된다.
-
-#ifdef NETWORKLIBRARY_EXPORTS
-#define NETLIB_API __declspec(dllexport)
-#else
-#define NETLIB_API __declspec(dllimport)
-#endif
-
-#define _WINSOCKAPI_
-#include <Windows.h>
-
+//
+// (2026 10 18 send buffer로 사용할 때는 SendBuffer interface로 사용한다.)
+//
+// (2026 10 18 mirrored ring buffer)
+// 버퍼의 끝에서 잘린 수신 패킷은 앞으로 복사해야 하고
+// 송신할 공간이 끝에 모자라면 남은 뒷 공간을 버리고 앞으로 가야 했다.
+// Create()에서 isMirrored를 주면 memfd로 만든 같은 메모리를 가상 주소에 두 번 이어서 매핑한다.
+// [mBeginMark, mEndMark) 뒤의 [mEndMark, mEndMark + 크기)는 같은 물리 메모리라서
+// 버퍼 크기 이하의 어떤 구간도 끝을 넘어 연속된 주소로 읽고 쓸 수 있다.
+// 그래서 잘린 패킷의 복사와 뒷 공간의 낭비가 없어지고 GetBuffers()는 항상 한 조각을 돌려준다.
+// 위치가 mEndMark를 넘어가면 크기만큼 빼서 앞쪽 주소로 되돌린다.
+// 크기는 page 단위로 올림하고, 버퍼마다 매핑이 두 개 생기기 때문에
+// connection이 많다면 vm.max_map_count를 확인해야 한다(Linux만 지원).
+//
+// (2026 10 18 SPSC mode)
+// 모든 함수가 mSyncObject를 잡지만
+// 쓰는 thread(수신 완료)와 읽는 thread(패킷 처리)가 하나씩이라면 lock이 필요 없다.
+// CreateSPSC()로 만들면 쓰는 쪽은 ReserveSPSC(), CommitSPSC()로 쓰고
+// 읽는 쪽은 PeekSPSC(), ReleaseSPSC()로 읽는다.
+// 쓴 위치(tail)와 읽은 위치(head)는 계속 증가하는 byte 위치이고
+// 각자 자기 위치만 바꾸기 때문에 acquire/release atomic만으로 동기화된다.
+// 두 위치는 서로 다른 cache line에 두어서 한쪽이 쓸 때 다른 쪽의 cache line이 무효화되지 않게 하고
+// 상대 위치는 지역 사본을 먼저 보고 공간이 모자랄 때만 다시 읽는다.
+// 버퍼 끝에서 잘리지 않도록 mirrored 메모리를 사용하기 때문에 mirrored를 지원하지 않으면 만들 수 없다.
+// SPSC mode에서는 위의 네 함수만 사용한다.
+
+#include <atomic>
+
+#include "Platform.h"
 #include "Monitor.h"
+#include "SendBuffer.h"
 
 constexpr int MAX_RINGBUFSIZE{ 1024 * 100 };
 
-class NETLIB_API RingBuffer
+class NETLIB_API RingBuffer : public SendBuffer
 {
 public:
 	RingBuffer();
-	~RingBuffer();
+	~RingBuffer() override;
 
 public:
 	// 링 버퍼 메모리 동적 할당
-	bool Create(int bufferSize = MAX_RINGBUFSIZE);
-	bool Initialize();
+	// isMirrored: 같은 메모리를 두 번 이어서 매핑한다. 지원하지 않거나 실패하면 일반 버퍼로 만든다.
+	bool Create(int bufferSize = MAX_RINGBUFSIZE, bool isMirrored = false);
+	bool Initialize() override;
+
+	// lock 없는 single producer, single consumer 버퍼로 만든다(mirrored 메모리 사용).
+	bool CreateSPSC(int bufferSize = MAX_RINGBUFSIZE);
 
 public:
 	// 송신할 데이터를 저장하기 위한 공간 마련.
 	// 마련된 공간만큼 currentMark가 이동
-	char* MoveMark(int moveLength);
+	char* MoveMark(int moveLength) override;
 
 	// 수신할 데이터를 저장하기 위한 공간을 마련하는 것으로
 	// 수신 같은 경우는 TCP 특성 상
@@ -66,7 +90,16 @@ public:
 	// 해당 공간에 데이터를 받아서 작업을 완료했다면,
 	// 총 사용중인 바이트에서 완료된 송수신에 사용된 바이트를 빼준다.
 	// 사용이 완료되었으니 해당 공간은 다른 데이터로 덮어 써도 되기 떄문
-	void ReleaseBuffer(int releaseSize);
+	void ReleaseBuffer(int releaseSize) override;
+
+	// zero-copy 송신은 송신 작업이 완료되어도
+	// kernel이 완료 알림을 줄 때까지 버퍼를 계속 참조하기 때문에 덮어쓰면 안 된다.
+	// 송신이 끝난 크기를 ReleaseBuffer() 대신 HoldBuffer()로 잡아두고
+	// 완료 알림을 받으면 ReleaseHoldBuffer()로 해제한다.
+	// 잡아둔 버퍼가 있을 때 ReleaseBuffer()로 해제한 크기는
+	// 잡아둔 버퍼 뒤에 있어서 잡아둔 버퍼가 모두 해제될 때 같이 해제한다.
+	void HoldBuffer(int holdSize) override;
+	void ReleaseHoldBuffer(int releaseSize) override;
 
 public:
 	// 송신할 데이터를 버퍼에 넣었고
@@ -75,12 +108,42 @@ public:
 	// 실제로 송신 가능한 크기는 realSendSize에 넣어준다.
 	char* GetBuffer(int requestSendSize, int* realSendSize);
 
+	// GetBuffer()는 버퍼의 끝(mLastMoveMark)에서 멈추기 때문에
+	// 송신할 데이터가 끝에서 처음으로 이어져 있으면 WSASend()를 두 번 호출해야 한다.
+	// 최대 requestSendSize만큼의 송신할 데이터를 최대 maxBufCnt개의 조각으로 pBufs에 담아서
+	// 한 번의 WSASend()(writev())로 보낼 수 있게 한다.
+	// 반환값은 담은 조각의 개수이고, 실제로 송신 가능한 크기는 realSendSize에 넣어준다.
+	int GetBuffers(int requestSendSize, WSABUF* pBufs, int maxBufCnt, int* realSendSize) override;
+
+public:
+	// SPSC mode의 쓰는 thread만 호출
+	// 쓸 수 있는 연속된 reserveSize 크기의 공간(모자라면 nullptr)
+	// CommitSPSC()를 호출하기 전까지는 읽는 쪽에 보이지 않고, 다시 호출하면 같은 위치를 준다.
+	char* ReserveSPSC(int reserveSize);
+
+	// ReserveSPSC()로 받은 공간 중 앞의 commitSize만큼을 읽는 쪽에 넘긴다.
+	void CommitSPSC(int commitSize);
+
+	// SPSC mode의 읽는 thread만 호출
+	// 읽을 수 있는 연속된 구간(없으면 nullptr), 크기는 readableSize에 넣어준다.
+	char* PeekSPSC(int* readableSize);
+
+	// PeekSPSC()로 받은 구간 중 앞의 releaseSize만큼을 다 읽었다.
+	void ReleaseSPSC(int releaseSize);
+
 public:
 	// ring buffer 크기
-	int GetBufferSize();
+	int GetBufferSize() override;
 
 	// 현재 사용중인 버퍼의 크기
-	int GetUsedBufferSize();
+	int GetUsedBufferSize() override;
+
+	// 아직 송신하지 않은 데이터의 크기
+	// (사용중인 버퍼 중에서 이미 송신해서 해제를 기다리는 크기를 뺀 값)
+	int GetPendingSendSize() override;
+
+	// 송신할 공간을 마련한 크기의 합(Initialize()하면 0)
+	LONG64 GetReservedSize() override;
 
 	// 송신 및 수신을 위해 할당해준,
 	// 총 사용된 버퍼 크기
@@ -90,6 +153,9 @@ public:
 	char* GetCurrentMark();
 	char* GetEndMark();
 
+	bool IsMirrored();
+	bool IsSPSC();
+
 public:
 	// client와 데이터를 송수신하기 위한 버퍼로
 	// 하나를 만들어두면,
@@ -101,6 +167,16 @@ public:
 	RingBuffer& operator=(const RingBuffer& rhs) = delete;
 	RingBuffer& operator=(RingBuffer&& rhs) = delete;
 
+private:
+	// 해제한 크기만큼 mReleaseMark를 옮긴다. lock을 잡고 호출
+	void MoveReleaseMark(int releaseSize);
+
+	// memfd를 두 번 이어서 매핑한다. 성공하면 mBeginMark, mBufferSize를 채운다.
+	bool CreateMirroredMemory(int bufferSize);
+
+	// mirrored 버퍼에서 mEndMark를 넘어간 위치를 앞쪽의 같은 위치로 되돌린다.
+	char* WrapMirroredMark(char* pMark);
+
 private:
 	// 버퍼의 시작 위치
 	char* mBeginMark;
@@ -121,19 +197,56 @@ private:
 	// 어느 위치까지 사용했나?
 	char* mLastMoveMark;
 
+	// 아직 해제되지 않은 데이터의 시작 위치
+	// 송신이 끝나도 해제가 늦어질 수 있기 때문에(zero-copy)
+	// 송신할 공간을 마련할 때 이 위치를 넘어서 덮어쓰지 않는다.
+	char* mReleaseMark;
+
+	// mReleaseMark가 이 위치에 도달하면 버퍼의 앞으로 이동한다.
+	// mGetBufferMark가 버퍼의 앞으로 이동할 때 mLastMoveMark를 기억해둔다.
+	char* mReleaseWrapMark;
+
 	// 총 버퍼 크기
 	int mBufferSize;
 
+	// 같은 메모리를 두 번 이어서 매핑했는지
+	// mLastMoveMark, mReleaseWrapMark는 사용하지 않고 mUsedBufferSize가 정확한 사용량이 된다.
+	bool mIsMirrored;
+
 	// 현재 사용중인 버퍼 크기
 	int mUsedBufferSize;
 
+	// 송신은 끝났지만 kernel이 참조하고 있어서 해제하지 못한 크기(zero-copy)
+	// mUsedBufferSize에 포함되어 있다.
+	// 완료 알림이 송신 완료 통지보다 먼저 처리되면 잠깐 음수가 될 수 있다.
+	int mHoldBufferSize;
+
+	// 잡아둔 버퍼가 있어서 해제를 미룬 크기
+	// mUsedBufferSize에 포함되어 있다.
+	int mDeferredReleaseSize;
+
 	// 모든 송수신에 사용된 버퍼 크기
 	int mTotalUsedBufferSize;
 
+	// 송신할 공간을 마련한 크기의 합
+	// int인 mTotalUsedBufferSize는 오래 연결된 client에서 넘칠 수 있어서 따로 센다.
+	LONG64 mReservedSize;
+
 	// 버퍼 공간을 할당하기 위해
 	// 포인터들을 변경할건데
 	// send(), recv() 처리가
 	// thread를 통해 병렬적으로 이루어지기 때문에
 	// lock을 걸어야한다.
 	Monitor mSyncObject;
+
+	// SPSC mode인지
+	bool mIsSPSC;
+
+	// 쓰는 쪽이 commit한 위치와 쓰는 쪽이 기억하는 읽은 위치
+	alignas(64) std::atomic<LONG64> mSPSCTail;
+	LONG64 mSPSCCachedHead;
+
+	// 읽는 쪽이 해제한 위치와 읽는 쪽이 기억하는 commit된 위치
+	alignas(64) std::atomic<LONG64> mSPSCHead;
+	LONG64 mSPSCCachedTail;
 };
\ No newline at end of file
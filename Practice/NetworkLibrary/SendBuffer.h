@@ -0,0 +1,51 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// Connection이 송신할 데이터를 모아두는 버퍼의 interface
+//
+// 하나의 연속된 공간을 CreateConnection()에서 미리 잡아두는 RingBuffer와
+// 필요할 때마다 pool에서 slab을 가져와 이어 붙이는 ChainBuffer,
+// 여러 thread가 lock 없이 넣는 SendQueue가 구현한다.
+// Connection의 송신 흐름(PrepareSendPacket() - SendPost() - DoSend())은 이 interface만 사용한다.
+
+#include "Platform.h"
+
+class NETLIB_API SendBuffer
+{
+public:
+	virtual ~SendBuffer() = default;
+
+public:
+	// 사용하던 공간을 모두 비운다.
+	virtual bool Initialize() = 0;
+
+	// 송신할 데이터를 저장하기 위한 moveLength 크기의 연속된 공간 마련
+	// 공간이 없으면 nullptr 반환
+	virtual char* MoveMark(int moveLength) = 0;
+
+	// 아직 송신하지 않은 데이터를 최대 requestSendSize만큼, 최대 maxBufCnt개의 조각으로 pBufs에 담는다.
+	// 반환값은 담은 조각의 개수이고, 실제로 송신 가능한 크기는 realSendSize에 넣어준다.
+	virtual int GetBuffers(int requestSendSize, WSABUF* pBufs, int maxBufCnt, int* realSendSize) = 0;
+
+	// 송신이 끝난 공간을 해제한다.
+	virtual void ReleaseBuffer(int releaseSize) = 0;
+
+	// zero-copy 송신이 끝난 공간을 kernel의 완료 알림까지 잡아두고 해제한다.
+	virtual void HoldBuffer(int holdSize) = 0;
+	virtual void ReleaseHoldBuffer(int releaseSize) = 0;
+
+public:
+	// 사용할 수 있는 최대 크기
+	virtual int GetBufferSize() = 0;
+
+	// 현재 사용중인 크기(아직 해제하지 못한 송신 데이터)
+	virtual int GetUsedBufferSize() = 0;
+
+	// 아직 송신하지 않은 데이터의 크기
+	virtual int GetPendingSendSize() = 0;
+
+	// Initialize() 이후 MoveMark()로 마련한 크기의 합
+	// Connection::SendShared()가 공유 패킷을 끼워 넣을 위치로 사용한다.
+	virtual LONG64 GetReservedSize() = 0;
+};
@@ -0,0 +1,537 @@
+﻿#include <vector>
+
+#include "Log.h"
+#include "SendQueue.h"
+#include "SlabPool.h"
+#include "SharedPacket.h"
+
+struct SendQueueNode
+{
+	// 대기 목록, 공유 목록, 꺼낸 목록에서 다음 node
+	SendQueueNode* mNext;
+
+	// 송신할 내용(node 바로 뒤, 공유 패킷이라면 패킷의 버퍼)
+	char* mData;
+	int mSize;
+
+	// node를 잘라낸 slab
+	Slab* mSlab;
+
+	// 공유 패킷 node라면 그 패킷(송신이 끝나면 참조를 해제한다.)
+	SharedPacket* mPacket;
+};
+
+// 호출한 thread가 아직 Commit()하지 않은 node들(넣은 순서)
+struct PendingNodes
+{
+	SendQueue* mQueue;
+	LONG64 mGeneration;
+	SendQueueNode* mFirst;
+	SendQueueNode* mLast;
+	LONG64 mSize;
+};
+
+// thread마다 잘라 쓰는 slab과 SendQueue별 대기 목록
+struct SendQueueThreadCache
+{
+	Slab* mSlab{ nullptr };
+
+	// mSlab에서 다음에 잘라 쓸 위치
+	int mOffset{ 0 };
+
+	// 한 thread가 동시에 넣는 connection은 많지 않아서 vector로 찾는다.
+	std::vector<PendingNodes> mPendings;
+
+	~SendQueueThreadCache();
+};
+
+static thread_local SendQueueThreadCache tSendQueueCache;
+
+static void ReleaseSlab(Slab* pSlab)
+{
+	if (0 == InterlockedDecrement64(&pSlab->mRefCnt))
+	{
+		SlabPool::GetInstance()->Free(pSlab);
+	}
+}
+
+static void FreeNode(SendQueueNode* pNode)
+{
+	if (nullptr != pNode->mPacket)
+	{
+		pNode->mPacket->Release();
+	}
+
+	ReleaseSlab(pNode->mSlab);
+}
+
+// pNode부터 이어진 node를 모두 해제하고 내용 크기의 합을 반환한다.
+static LONG64 FreeNodes(SendQueueNode* pNode)
+{
+	LONG64 freeSize{ 0 };
+
+	while (nullptr != pNode)
+	{
+		SendQueueNode* pNext = pNode->mNext;
+		freeSize += pNode->mSize;
+		FreeNode(pNode);
+		pNode = pNext;
+	}
+
+	return freeSize;
+}
+
+// 호출한 thread의 slab에서 내용 dataSize만큼을 붙인 node를 잘라낸다.
+static SendQueueNode* AllocNode(int dataSize)
+{
+	SendQueueThreadCache& cache = tSendQueueCache;
+
+	// node는 8byte 단위로 정렬한다.
+	int nodeOffset = (cache.mOffset + 7) & ~7;
+	int nodeSize = static_cast<int>(sizeof(SendQueueNode)) + dataSize;
+
+	if (SEND_SLAB_SIZE < nodeSize)
+	{
+		return nullptr;
+	}
+
+	if (nullptr == cache.mSlab || SEND_SLAB_SIZE - nodeOffset < nodeSize)
+	{
+		Slab* pSlab = SlabPool::GetInstance()->Alloc();
+		if (nullptr == pSlab)
+		{
+			return nullptr;
+		}
+
+		// 잘라 쓰는 thread의 참조 1
+		pSlab->mRefCnt = 1;
+
+		if (nullptr != cache.mSlab)
+		{
+			ReleaseSlab(cache.mSlab);
+		}
+
+		cache.mSlab = pSlab;
+		nodeOffset = 0;
+	}
+
+	InterlockedIncrement64(&cache.mSlab->mRefCnt);
+
+	SendQueueNode* pNode = reinterpret_cast<SendQueueNode*>(cache.mSlab->mData + nodeOffset);
+	pNode->mNext = nullptr;
+	pNode->mData = reinterpret_cast<char*>(pNode + 1);
+	pNode->mSize = dataSize;
+	pNode->mSlab = cache.mSlab;
+	pNode->mPacket = nullptr;
+
+	cache.mOffset = nodeOffset + nodeSize;
+
+	return pNode;
+}
+
+SendQueueThreadCache::~SendQueueThreadCache()
+{
+	// main thread처럼 Singleton::ReleaseAll() 뒤에 끝나는 thread라면
+	// node를 잘라낸 slab 메모리가 이미 해제되었기 때문에 아무것도 만지지 않는다.
+	// (GetInstance()를 호출하면 빈 pool을 새로 만들어 버린다.)
+	if (false == SlabPool::IsCreated())
+	{
+		return;
+	}
+
+	// thread가 끝날 때 Commit()하지 않은 node는 송신하지 않고 버린다.
+	// SendQueue는 넣는 thread들보다 오래 살아있어야 한다(Connection은 server가 종료될 때 삭제된다).
+	for (PendingNodes& pending : mPendings)
+	{
+		pending.mQueue->DiscardPending(&pending);
+	}
+
+	if (nullptr != mSlab)
+	{
+		ReleaseSlab(mSlab);
+	}
+}
+
+SendQueue::SendQueue()
+	: mMaxBufferSize{ 0 }
+	, mGeneration{ 0 }
+	, mPushHead{ nullptr }
+	, mUsedBufferSize{ 0 }
+	, mReservedSize{ 0 }
+	, mHead{ nullptr }
+	, mTail{ nullptr }
+	, mReleaseOffset{ 0 }
+	, mSendNode{ nullptr }
+	, mSendOffset{ 0 }
+	, mGatheredSize{ 0 }
+{
+}
+
+SendQueue::~SendQueue()
+{
+	FreeNodes(mPushHead.exchange(nullptr));
+	FreeNodes(mHead);
+}
+
+bool SendQueue::Create(int maxBufferSize)
+{
+	if (0 >= maxBufferSize)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | SendQueue::Create() | invalid size[%d]",
+			maxBufferSize);
+
+		return false;
+	}
+
+	mMaxBufferSize = maxBufferSize;
+
+	// 여러 thread가 동시에 처음 접근하기 전에 만들어둔다.
+	SlabPool::GetInstance();
+
+	return Initialize();
+}
+
+bool SendQueue::Initialize()
+{
+	// 연결이 끊겨서 송신중인 데이터가 없을 때 호출된다.
+	mGeneration.fetch_add(1);
+
+	// 0으로 덮어쓰지 않고 해제한 만큼만 뺀다.
+	// 다른 thread가 이전 client일 때 마련한 대기 목록은 그 thread가 버릴 때(DiscardPending()) 돌려준다.
+	// mHead에서 mReleaseOffset만큼은 ReleaseBuffer()에서 이미 뺐다.
+	LONG64 freeSize = FreeNodes(mPushHead.exchange(nullptr, std::memory_order_acquire));
+	freeSize += FreeNodes(mHead) - mReleaseOffset;
+
+	mHead = nullptr;
+	mTail = nullptr;
+	mReleaseOffset = 0;
+	mSendNode = nullptr;
+	mSendOffset = 0;
+
+	mUsedBufferSize.fetch_sub(freeSize);
+	mReservedSize.store(0);
+	mGatheredSize.store(0);
+
+	return true;
+}
+
+char* SendQueue::MoveMark(int moveLength)
+{
+	if (0 >= moveLength)
+	{
+		return nullptr;
+	}
+
+	// 확인과 증가를 한 번에 해야 여러 thread가 동시에 확인하고 모두 통과해서 최대 크기를 넘지 않는다.
+	// 넘쳤다면 잡은 만큼 되돌린다.
+	if (mMaxBufferSize < mUsedBufferSize.fetch_add(moveLength) + moveLength)
+	{
+		mUsedBufferSize.fetch_sub(moveLength);
+		return nullptr;
+	}
+
+	PendingNodes* pPending = FindPending(mGeneration.load(std::memory_order_relaxed), true);
+	SendQueueThreadCache& cache = tSendQueueCache;
+	char* pMark{ nullptr };
+
+	// 바로 앞에 마련한 node의 내용 뒤가 slab에서 다음에 잘라 쓸 위치라면 이어 붙인다.
+	SendQueueNode* pLast = pPending->mLast;
+	if (nullptr != pLast && nullptr == pLast->mPacket && cache.mSlab == pLast->mSlab &&
+		pLast->mData + pLast->mSize == cache.mSlab->mData + cache.mOffset &&
+		SEND_SLAB_SIZE - cache.mOffset >= moveLength)
+	{
+		pMark = pLast->mData + pLast->mSize;
+		pLast->mSize += moveLength;
+		cache.mOffset += moveLength;
+	}
+	else
+	{
+		SendQueueNode* pNode = AllocNode(moveLength);
+		if (nullptr == pNode)
+		{
+			mUsedBufferSize.fetch_sub(moveLength);
+			return nullptr;
+		}
+
+		if (nullptr == pLast)
+		{
+			pPending->mFirst = pNode;
+		}
+		else
+		{
+			pLast->mNext = pNode;
+		}
+
+		pPending->mLast = pNode;
+		pMark = pNode->mData;
+	}
+
+	pPending->mSize += moveLength;
+
+	return pMark;
+}
+
+bool SendQueue::PushShared(SharedPacket* pPacket)
+{
+	int packetSize = pPacket->GetPacketSize();
+	if (mMaxBufferSize < mUsedBufferSize.fetch_add(packetSize) + packetSize)
+	{
+		mUsedBufferSize.fetch_sub(packetSize);
+		return false;
+	}
+
+	PendingNodes* pPending = FindPending(mGeneration.load(std::memory_order_relaxed), true);
+
+	// 내용은 복사하지 않고 node에는 패킷의 버퍼를 가리키게 한다.
+	SendQueueNode* pNode = AllocNode(0);
+	if (nullptr == pNode)
+	{
+		mUsedBufferSize.fetch_sub(packetSize);
+		return false;
+	}
+
+	pPacket->AddRef();
+	pNode->mData = pPacket->GetBuffer();
+	pNode->mSize = packetSize;
+	pNode->mPacket = pPacket;
+
+	if (nullptr == pPending->mLast)
+	{
+		pPending->mFirst = pNode;
+	}
+	else
+	{
+		pPending->mLast->mNext = pNode;
+	}
+
+	pPending->mLast = pNode;
+	pPending->mSize += packetSize;
+
+	Commit();
+
+	return true;
+}
+
+void SendQueue::Commit()
+{
+	std::vector<PendingNodes>& pendings = tSendQueueCache.mPendings;
+
+	PendingNodes* pPending = FindPending(mGeneration.load(std::memory_order_relaxed), false);
+	if (nullptr == pPending)
+	{
+		return;
+	}
+
+	SendQueueNode* pFirst = pPending->mFirst;
+	SendQueueNode* pLast = pPending->mLast;
+	LONG64 commitSize = pPending->mSize;
+
+	// 목록에서 빼고(마지막 원소와 바꿔서) 붙인다.
+	*pPending = pendings.back();
+	pendings.pop_back();
+
+	if (nullptr == pFirst)
+	{
+		return;
+	}
+
+	// 공유 목록은 최근에 넣은 node가 앞이라서 대기 목록을 뒤집어서 붙인다.
+	SendQueueNode* pPrev{ nullptr };
+	SendQueueNode* pNode = pFirst;
+	while (nullptr != pNode)
+	{
+		SendQueueNode* pNext = pNode->mNext;
+		pNode->mNext = pPrev;
+		pPrev = pNode;
+		pNode = pNext;
+	}
+
+	// release: 채운 내용과 node가 CAS보다 먼저 꺼내는 쪽에 보인다.
+	SendQueueNode* pOldHead = mPushHead.load(std::memory_order_relaxed);
+	do
+	{
+		pFirst->mNext = pOldHead;
+	} while (false == mPushHead.compare_exchange_weak(pOldHead, pLast,
+		std::memory_order_release, std::memory_order_relaxed));
+
+	// 붙인 뒤에 늘려야 꺼내는 쪽이 늘어난 크기만큼의 node를 항상 찾을 수 있다.
+	// 송신을 마친 thread가 mIsSending을 true로 바꾼 뒤 이 크기로 남은 데이터를 확인하기 때문에
+	// 뒤따르는 Connection::SendPost()의 CAS와 함께 둘 중 하나는 반드시 상대를 본다.
+	mReservedSize.fetch_add(commitSize);
+}
+
+int SendQueue::GetBuffers(int requestSendSize, WSABUF* pBufs, int maxBufCnt, int* realSendSize)
+{
+	*realSendSize = 0;
+
+	if (nullptr != mPushHead.load(std::memory_order_relaxed))
+	{
+		TakePushedNodes();
+	}
+
+	SendQueueNode* pNode = mSendNode;
+	int offset = mSendOffset;
+	int bufCnt{ 0 };
+
+	while (nullptr != pNode && maxBufCnt > bufCnt && requestSendSize > *realSendSize)
+	{
+		int sendSize = pNode->mSize - offset;
+		if (requestSendSize - *realSendSize < sendSize)
+		{
+			sendSize = requestSendSize - *realSendSize;
+		}
+
+		pBufs[bufCnt].buf = pNode->mData + offset;
+		pBufs[bufCnt].len = sendSize;
+		++bufCnt;
+
+		*realSendSize += sendSize;
+		offset += sendSize;
+
+		// 다 담은 node는 넘어가고, 다음 node가 아직 없다면 TakePushedNodes()가 채워준다.
+		if (pNode->mSize == offset)
+		{
+			pNode = pNode->mNext;
+			offset = 0;
+		}
+	}
+
+	mSendNode = pNode;
+	mSendOffset = offset;
+	mGatheredSize.fetch_add(*realSendSize);
+
+	return bufCnt;
+}
+
+void SendQueue::ReleaseBuffer(int releaseSize)
+{
+	mReleaseOffset += releaseSize;
+
+	// 다 송신한 node만 해제한다(송신할 위치는 항상 해제한 위치보다 뒤다).
+	while (nullptr != mHead && mReleaseOffset >= mHead->mSize)
+	{
+		SendQueueNode* pNode = mHead;
+		mReleaseOffset -= pNode->mSize;
+
+		mHead = pNode->mNext;
+		if (nullptr == mHead)
+		{
+			mTail = nullptr;
+		}
+
+		FreeNode(pNode);
+	}
+
+	mUsedBufferSize.fetch_sub(releaseSize);
+}
+
+void SendQueue::HoldBuffer(int holdSize)
+{
+	ReleaseBuffer(holdSize);
+}
+
+void SendQueue::ReleaseHoldBuffer(int)
+{
+}
+
+int SendQueue::GetBufferSize()
+{
+	return mMaxBufferSize;
+}
+
+int SendQueue::GetUsedBufferSize()
+{
+	return static_cast<int>(mUsedBufferSize.load(std::memory_order_relaxed));
+}
+
+int SendQueue::GetPendingSendSize()
+{
+	return static_cast<int>(mReservedSize.load() - mGatheredSize.load());
+}
+
+LONG64 SendQueue::GetReservedSize()
+{
+	return mReservedSize.load();
+}
+
+PendingNodes* SendQueue::FindPending(LONG64 generation, bool isCreate)
+{
+	std::vector<PendingNodes>& pendings = tSendQueueCache.mPendings;
+
+	for (PendingNodes& pending : pendings)
+	{
+		if (this != pending.mQueue)
+		{
+			continue;
+		}
+
+		if (generation != pending.mGeneration)
+		{
+			DiscardPending(&pending);
+
+			pending = PendingNodes{ this, generation, nullptr, nullptr, 0 };
+		}
+
+		return &pending;
+	}
+
+	if (false == isCreate)
+	{
+		return nullptr;
+	}
+
+	pendings.push_back(PendingNodes{ this, generation, nullptr, nullptr, 0 });
+	return &pendings.back();
+}
+
+void SendQueue::DiscardPending(PendingNodes* pPending)
+{
+	FreeNodes(pPending->mFirst);
+
+	// MoveMark(), PushShared()에서 잡아둔 크기(Initialize()는 대기 목록을 볼 수 없어서 빼지 않았다.)
+	mUsedBufferSize.fetch_sub(pPending->mSize);
+
+	pPending->mFirst = nullptr;
+	pPending->mLast = nullptr;
+	pPending->mSize = 0;
+}
+
+void SendQueue::TakePushedNodes()
+{
+	SendQueueNode* pNode = mPushHead.exchange(nullptr, std::memory_order_acquire);
+
+	// 넣은 순서로 뒤집는다.
+	SendQueueNode* pFirst{ nullptr };
+	SendQueueNode* pLast = pNode;
+	while (nullptr != pNode)
+	{
+		SendQueueNode* pNext = pNode->mNext;
+		pNode->mNext = pFirst;
+		pFirst = pNode;
+		pNode = pNext;
+	}
+
+	if (nullptr == pFirst)
+	{
+		return;
+	}
+
+	if (nullptr == mTail)
+	{
+		mHead = pFirst;
+	}
+	else
+	{
+		mTail->mNext = pFirst;
+	}
+
+	mTail = pLast;
+
+	// 앞의 node를 모두 담았다면 새로 붙인 node부터 송신한다.
+	if (nullptr == mSendNode)
+	{
+		mSendNode = pFirst;
+		mSendOffset = 0;
+	}
+}
@@ -0,0 +1,126 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 여러 thread가 넣고 송신하는 thread 하나가 꺼내는(MPSC) lock 없는 send buffer
+//
+// zone logic, 채팅, broadcast처럼 여러 thread가 같은 connection에 PrepareSendPacket()을 호출하면
+// RingBuffer, ChainBuffer는 lock을 잡기 때문에 인기 있는 client에게 보내는 thread들이 서로 기다린다.
+// SendQueue는 패킷마다 node를 만들고 넣는 thread는 node 목록에 CAS로 붙이기만 한다.
+// 송신 권한(Connection::mIsSending)을 가져온 thread 하나만 node를 꺼내서 송신한다.
+//
+// 넣는 쪽(아무 thread)
+// - MoveMark()는 호출한 thread가 잘라 쓰는 slab에서 node를 만들어 그 thread의 대기 목록에만 둔다.
+//   내용을 채우기 전에는 송신하는 thread에게 보이지 않는다.
+//   같은 thread가 같은 connection에 연달아 넣으면 node 하나로 이어 붙여서 한 조각으로 송신한다.
+// - Commit()은 호출한 thread의 대기 목록을 한 번의 CAS로 공유 목록(mPushHead)에 붙인다.
+//   Connection::SendPost(), SendPostCorked(), SendShared()가 호출한다.
+// - 공유 목록은 최근에 넣은 node가 앞에 오는 stack이고 꺼내는 쪽이 통째로 떼어가서 뒤집는다.
+//   Vyukov queue는 tail을 바꾼 뒤 이전 node에 이어 붙이기 전까지 뒤의 node들이 보이지 않아서
+//   송신을 마친 thread가 남은 데이터를 다시 확인할 때(Connection::SendPost()) 그 사이를 기다려야 하지만
+//   stack은 CAS가 성공하면 붙인 node가 모두 보인다.
+//
+// 꺼내는 쪽(송신 권한을 가진 thread만)
+// - GetBuffers(), ReleaseBuffer(), Initialize()
+//
+// node를 잘라낸 slab은 slab의 node가 모두 해제되면 SlabPool에 돌려준다.
+// 그래서 SEND_SLAB_SIZE보다 큰 패킷은 넣을 수 없다.
+// zero-copy 송신은 지원하지 않는다(완료 알림을 처리하는 thread가 해제하면 꺼내는 쪽이 둘이 된다).
+
+#include <atomic>
+
+#include "Platform.h"
+#include "SendBuffer.h"
+
+class SharedPacket;
+struct SendQueueNode;
+struct PendingNodes;
+
+class NETLIB_API SendQueue : public SendBuffer
+{
+public:
+	SendQueue();
+	~SendQueue() override;
+
+public:
+	// maxBufferSize: 송신하지 못하고 쌓아둘 수 있는 최대 크기
+	bool Create(int maxBufferSize);
+	bool Initialize() override;
+
+public:
+	// 호출한 thread의 대기 목록에 moveLength 크기의 공간을 마련한다.
+	// 공간이 없거나 slab보다 크면 nullptr
+	char* MoveMark(int moveLength) override;
+
+	// 공유 패킷을 복사하지 않고 호출한 thread의 대기 목록 뒤에 넣고 Commit()한다(참조 1 증가).
+	// 공간이 없으면 false
+	bool PushShared(SharedPacket* pPacket);
+
+	// 호출한 thread의 대기 목록을 송신할 수 있게 넘긴다.
+	void Commit();
+
+	int GetBuffers(int requestSendSize, WSABUF* pBufs, int maxBufCnt, int* realSendSize) override;
+	void ReleaseBuffer(int releaseSize) override;
+
+	// zero-copy를 사용하지 않기 때문에 바로 해제한다.
+	void HoldBuffer(int holdSize) override;
+	void ReleaseHoldBuffer(int releaseSize) override;
+
+public:
+	int GetBufferSize() override;
+	int GetUsedBufferSize() override;
+	int GetPendingSendSize() override;
+
+	// Commit()으로 넘긴 크기의 합
+	LONG64 GetReservedSize() override;
+
+public:
+	SendQueue(const SendQueue& rhs) = delete;
+	SendQueue(SendQueue&& rhs) = delete;
+
+	SendQueue& operator=(const SendQueue& rhs) = delete;
+	SendQueue& operator=(SendQueue&& rhs) = delete;
+
+private:
+	// thread가 끝날 때 남은 대기 목록을 DiscardPending()으로 버린다.
+	friend struct SendQueueThreadCache;
+
+	// 공유 목록을 떼어와서 넣은 순서로 뒤집은 뒤 mTail 뒤에 붙인다.
+	void TakePushedNodes();
+
+	// 호출한 thread의 이 SendQueue에 대한 대기 목록
+	// 다른 client일 때 마련한 목록이라면 버리고 새로 시작한다.
+	PendingNodes* FindPending(LONG64 generation, bool isCreate);
+
+	// Commit()하지 않고 버리는 대기 목록의 node를 해제하고 잡아둔 크기를 mUsedBufferSize에 돌려준다.
+	void DiscardPending(PendingNodes* pPending);
+
+private:
+	int mMaxBufferSize;
+
+	// Initialize()마다 1 증가
+	// 이전 client일 때 마련하고 아직 Commit()하지 않은 대기 목록은 버린다.
+	std::atomic<LONG64> mGeneration;
+
+	// 넣는 thread들이 CAS로 붙이는 공유 목록(최근에 넣은 node가 앞)
+	alignas(64) std::atomic<SendQueueNode*> mPushHead;
+
+	// 넣는 thread들과 꺼내는 thread가 같이 바꾸는 크기
+	// mUsedBufferSize는 MoveMark(), PushShared()에서 한 번의 fetch_add로 먼저 잡고(넘치면 되돌린다.)
+	// ReleaseBuffer(), Initialize(), DiscardPending()에서 해제한 node만큼 줄어든다.
+	alignas(64) std::atomic<LONG64> mUsedBufferSize;
+	std::atomic<LONG64> mReservedSize;
+
+	// 여기부터는 꺼내는 thread만 바꾼다.
+	// 가장 오래된(아직 해제하지 않은) node, 마지막 node, mHead에서 해제한 크기
+	alignas(64) SendQueueNode* mHead;
+	SendQueueNode* mTail;
+	int mReleaseOffset;
+
+	// 다음에 송신할 node와 그 안의 위치
+	SendQueueNode* mSendNode;
+	int mSendOffset;
+
+	// 지금까지 송신할 데이터로 꺼낸 크기(다른 thread도 GetPendingSendSize()로 읽는다.)
+	std::atomic<LONG64> mGatheredSize;
+};
@@ -0,0 +1,245 @@
+﻿#include "Log.h"
+#include "Connection.h"
+#include "ShardedAcceptor.h"
+
+// kernel이 접속을 shard들에게 고르게 나눠주지 않기 때문에
+// 한 shard에 자기 connection 수보다 많은 접속이 몰려도
+// backend가 accept한 socket을 들고 기다릴 수 있게 shard마다 조금 더 잡는다.
+constexpr int SHARD_CONNECTION_SLACK{ 64 };
+
+ShardedAcceptor::ShardedAcceptor()
+	: mShards{ nullptr }
+	, mShardCnt{ 0 }
+	, mSharedRecvBufSize{ 0 }
+	, mSharedRecvBufCnt{ 0 }
+{
+}
+
+ShardedAcceptor::~ShardedAcceptor()
+{
+	Destroy();
+}
+
+bool ShardedAcceptor::Create(eIOBackendType backendType, int shardCnt, unsigned short port, int maxConnectionCnt)
+{
+	if (0 >= shardCnt)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | ShardedAcceptor::Create() | invalid shard count: %d",
+			shardCnt);
+
+		return false;
+	}
+
+#ifdef _WIN32
+	if (1 < shardCnt)
+	{
+		LOG(eLogInfoType::LOG_INFO_NORMAL,
+			L"SYSTEM | ShardedAcceptor::Create() | SO_REUSEPORT is not supported. use 1 shard instead of %d",
+			shardCnt);
+
+		shardCnt = 1;
+	}
+#endif
+
+	mShardCnt = shardCnt;
+	mShards = new AcceptorShard[mShardCnt];
+	for (int i = 0; i < mShardCnt; ++i)
+	{
+		mShards[i].mListenSocket = INVALID_SOCKET;
+		mShards[i].mIOBackend = nullptr;
+	}
+
+	// SetupConfig()가 connection index를 shard 수로 나눈 나머지로 shard를 정하기 때문에
+	// shard i는 i, i + shardCnt, i + shardCnt * 2, ...번 connection만 맡는다.
+	int shardConnectionCnt = (maxConnectionCnt + mShardCnt - 1) / mShardCnt;
+
+	int shardRecvBufCnt{ 0 };
+	if (0 < mSharedRecvBufCnt)
+	{
+		shardRecvBufCnt = (mSharedRecvBufCnt + mShardCnt - 1) / mShardCnt;
+	}
+
+	for (int i = 0; i < mShardCnt; ++i)
+	{
+		AcceptorShard& shard = mShards[i];
+
+		shard.mListenSocket = CreateListenSocket(port);
+		if (INVALID_SOCKET == shard.mListenSocket)
+		{
+			Destroy();
+			return false;
+		}
+
+		shard.mIOBackend = IOBackend::CreateIOBackend(backendType);
+		if (nullptr != shard.mIOBackend)
+		{
+			shard.mIOBackend->SetConnectionIndexMapping(i, mShardCnt);
+			shard.mIOBackend->SetSharedRecvBuffer(mSharedRecvBufSize, shardRecvBufCnt);
+		}
+
+		if (nullptr == shard.mIOBackend ||
+			false == shard.mIOBackend->Create(shardConnectionCnt + SHARD_CONNECTION_SLACK) ||
+			false == shard.mIOBackend->BindListenSocket(shard.mListenSocket))
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | ShardedAcceptor::Create() | shard[%d] backend create failed",
+				i);
+
+			Destroy();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ShardedAcceptor::Start(int completionBatchSize)
+{
+	for (int i = 0; i < mShardCnt; ++i)
+	{
+		IOBackend* pIOBackend = mShards[i].mIOBackend;
+
+		pIOBackend->SetWorkerThreadAffinity(i);
+		if (false == pIOBackend->CreateWorkerThread(1, completionBatchSize))
+		{
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | ShardedAcceptor::Start() | shard[%d] worker thread create failed",
+				i);
+
+			// 이미 시작한 shard의 worker thread는 Destroy()에서 정리한다.
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ShardedAcceptor::Destroy()
+{
+	if (nullptr == mShards)
+	{
+		return;
+	}
+
+	for (int i = 0; i < mShardCnt; ++i)
+	{
+		AcceptorShard& shard = mShards[i];
+
+		if (nullptr != shard.mIOBackend)
+		{
+			shard.mIOBackend->DestroyWorkerThread();
+			delete shard.mIOBackend;
+			shard.mIOBackend = nullptr;
+		}
+
+		if (INVALID_SOCKET != shard.mListenSocket)
+		{
+			closesocket(shard.mListenSocket);
+			shard.mListenSocket = INVALID_SOCKET;
+		}
+	}
+
+	delete[] mShards;
+	mShards = nullptr;
+	mShardCnt = 0;
+}
+
+void ShardedAcceptor::SetSharedRecvBuffer(int bufSize, int bufCnt)
+{
+	mSharedRecvBufSize = bufSize;
+	mSharedRecvBufCnt = bufCnt;
+}
+
+void ShardedAcceptor::SetupConfig(InitConfig& initConfig)
+{
+	// connection pool의 index를 shard 수로 나눠서
+	// 연속된 connection들이 shard들에 고르게 퍼지게 한다.
+	AcceptorShard& shard = mShards[initConfig.mIndex % mShardCnt];
+
+	initConfig.mListenSocket = shard.mListenSocket;
+	initConfig.mIOBackend = shard.mIOBackend;
+}
+
+int ShardedAcceptor::GetShardCnt()
+{
+	return mShardCnt;
+}
+
+IOBackend* ShardedAcceptor::GetIOBackend(int shardIndex)
+{
+	return mShards[shardIndex].mIOBackend;
+}
+
+SOCKET ShardedAcceptor::GetListenSocket(int shardIndex)
+{
+	return mShards[shardIndex].mListenSocket;
+}
+
+LONG64 ShardedAcceptor::GetSyscallCount()
+{
+	LONG64 syscallCnt{ 0 };
+	for (int i = 0; i < mShardCnt; ++i)
+	{
+		syscallCnt += mShards[i].mIOBackend->GetSyscallCount();
+	}
+
+	return syscallCnt;
+}
+
+SOCKET ShardedAcceptor::CreateListenSocket(unsigned short port)
+{
+#ifdef _WIN32
+	// IOCP에 등록하기 위해 overlapped 속성으로 만든다.
+	SOCKET listenSocket = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
+#else
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#endif
+	if (INVALID_SOCKET == listenSocket)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | ShardedAcceptor::CreateListenSocket() | socket() failed: %d",
+			WSAGetLastError());
+
+		return INVALID_SOCKET;
+	}
+
+	int option{ 1 };
+#ifndef _WIN32
+	// 같은 port에 listen socket 여러 개를 bind하고
+	// kernel이 접속 요청을 listen socket들에게 나눠주게 한다.
+	if (SOCKET_ERROR == setsockopt(listenSocket, SOL_SOCKET, SO_REUSEPORT,
+		reinterpret_cast<const char*>(&option), sizeof(option)))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | ShardedAcceptor::CreateListenSocket() | setsockopt(SO_REUSEPORT) failed: %d",
+			WSAGetLastError());
+
+		closesocket(listenSocket);
+		return INVALID_SOCKET;
+	}
+
+	// server를 재시작할 때 TIME_WAIT 상태인 연결 때문에 bind가 실패하지 않게 한다.
+	// (Windows의 SO_REUSEADDR은 다른 프로세스가 사용중인 port도 가로채기 때문에 설정하지 않는다.)
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR,
+		reinterpret_cast<const char*>(&option), sizeof(option));
+#endif
+
+	SOCKADDR_IN serverAddr{};
+	serverAddr.sin_family = AF_INET;
+	serverAddr.sin_port = htons(port);
+	serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (SOCKET_ERROR == bind(listenSocket, reinterpret_cast<SOCKADDR*>(&serverAddr), sizeof(serverAddr)) ||
+		SOCKET_ERROR == listen(listenSocket, SOMAXCONN))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | ShardedAcceptor::CreateListenSocket() | bind(), listen() failed: %d",
+			WSAGetLastError());
+
+		closesocket(listenSocket);
+		return INVALID_SOCKET;
+	}
+
+	return listenSocket;
+}
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// worker thread마다 listen socket을 하나씩 여는 acceptor
+//
+// 지금까지는 listen socket 하나와 backend 하나를 모든 Connection과 worker thread가 같이 사용했다.
+// 이러면 점검이 끝나고 수천 명이 한꺼번에 접속할 때
+// 모든 worker thread가 같은 listen socket의 접속 통지를 두고 경쟁하고
+// 한 connection의 작업 완료 통지를 매번 다른 core가 처리하면서 connection의 메모리가 core 사이를 오간다.
+//
+// ShardedAcceptor는 shard마다 listen socket 하나와 worker thread가 하나뿐인 backend를 만든다.
+// listen socket들은 SO_REUSEPORT로 같은 port에 bind하기 때문에
+// kernel이 접속 요청을 listen socket들에게 나눠준다.
+// Connection은 index로 shard 하나에 속해서(SetupConfig())
+// 그 shard의 listen socket으로 접속을 받고
+// 연결이 끝날 때까지 그 shard의 worker thread만 작업 완료 통지를 처리한다.
+//
+// kernel은 접속 요청을 주소로 나누기 때문에 shard마다 접속 수가 정확히 같지는 않다.
+// 한 shard의 Connection이 모두 사용중이면 그 shard로 온 접속은 Connection이 반환될 때까지 기다린다.
+//
+// Create()는 shard의 listen socket과 backend만 만들고 Start()에서 worker thread를 만든다.
+// 그 사이에 GetIOBackend()로 SetTimingWheel(), SetJobSystem()을 설정한다.
+// shard의 worker thread는 shard 번호와 같은 CPU에 고정해서
+// 한 connection의 메모리가 한 core의 cache에만 머물게 한다.
+//
+// Windows는 SO_REUSEPORT가 없어서 shard를 하나만 만든다.
+
+#include "IOBackend.h"
+
+struct InitConfig;
+
+class NETLIB_API ShardedAcceptor
+{
+public:
+	ShardedAcceptor();
+	~ShardedAcceptor();
+
+public:
+	// shard마다 listen socket과 backend를 만든다(worker thread는 Start()에서 만든다).
+	// maxConnectionCnt는 전체 connection 수를 넘기고
+	// shard의 backend는 SetupConfig()가 그 shard에 나눠주는 connection 수만큼만 자원을 잡는다.
+	bool Create(eIOBackendType backendType, int shardCnt, unsigned short port, int maxConnectionCnt);
+
+	// shard마다 worker thread를 하나씩 만들어서 shard 번호의 CPU에 고정한다.
+	// completionBatchSize는 IOBackend::CreateWorkerThread()에 넘긴다(InitConfig::mCompletionBatchSize).
+	bool Start(int completionBatchSize = DEFAULT_COMPLETION_BATCH);
+	void Destroy();
+
+	// 모든 shard가 나눠 사용할 공유 recv 버퍼(InitConfig::mSharedRecvBufSize, mSharedRecvBufCnt)
+	// bufCnt는 전체 개수이고 shard마다 shard 수로 나눈 만큼 잡는다.
+	// Create() 전에 호출한다.
+	void SetSharedRecvBuffer(int bufSize, int bufCnt);
+
+	// initConfig.mIndex로 속할 shard를 정해서
+	// mListenSocket, mIOBackend를 채운다.
+	void SetupConfig(InitConfig& initConfig);
+
+	int GetShardCnt();
+	IOBackend* GetIOBackend(int shardIndex);
+	SOCKET GetListenSocket(int shardIndex);
+
+	// 모든 shard의 backend가 호출한 시스템 콜 횟수의 합
+	LONG64 GetSyscallCount();
+
+public:
+	ShardedAcceptor(const ShardedAcceptor& rhs) = delete;
+	ShardedAcceptor(ShardedAcceptor&& rhs) = delete;
+
+	ShardedAcceptor& operator=(const ShardedAcceptor& rhs) = delete;
+	ShardedAcceptor& operator=(ShardedAcceptor&& rhs) = delete;
+
+private:
+	// SO_REUSEPORT를 설정하고 port에 bind, listen한 socket
+	SOCKET CreateListenSocket(unsigned short port);
+
+private:
+	struct AcceptorShard
+	{
+		SOCKET mListenSocket;
+		IOBackend* mIOBackend;
+	};
+
+	AcceptorShard* mShards;
+	int mShardCnt;
+
+	int mSharedRecvBufSize;
+	int mSharedRecvBufCnt;
+};
@@ -0,0 +1,194 @@
+﻿#include <thread>
+
+#include "SharedMonitor.h"
+
+#ifdef _WIN32
+#pragma comment(lib, "Synchronization")
+#endif
+
+constexpr int SHARED_MONITOR_WRITER_LOCKED{ -1 };
+
+// core가 하나라면 lock을 잡은 thread가 실행되지 못하고 있으니 spin하지 않는다.
+static const bool gIsMultiCore{ 1 < std::thread::hardware_concurrency() };
+
+SharedMonitor::SharedOwner::SharedOwner(SharedMonitor& syncObject)
+	: mSyncObject{ syncObject }
+{
+	mSyncObject.EnterShared();
+}
+
+SharedMonitor::SharedOwner::~SharedOwner()
+{
+	mSyncObject.LeaveShared();
+}
+
+SharedMonitor::Owner::Owner(SharedMonitor& syncObject)
+	: mSyncObject{ syncObject }
+{
+	mSyncObject.Enter();
+}
+
+SharedMonitor::Owner::~Owner()
+{
+	mSyncObject.Leave();
+}
+
+SharedMonitor::SharedMonitor()
+	: mState{ 0 }
+	, mWaitingWriterCnt{ 0 }
+	, mWaiterCnt{ 0 }
+	, mWakeSignal{ 0 }
+	, mOwnerThreadId{ 0 }
+	, mRecursionCnt{ 0 }
+{
+}
+
+SharedMonitor::~SharedMonitor()
+{
+}
+
+void SharedMonitor::EnterShared()
+{
+	// 쓰기로 잡은 thread가 읽으려고 하면 쓰기를 한 번 더 잡은 것으로 센다.
+	if (GetCurrentThreadId() == mOwnerThreadId.load(std::memory_order_relaxed))
+	{
+		++mRecursionCnt;
+		return;
+	}
+
+	if (false == TryEnterShared())
+	{
+		EnterSlow(false);
+	}
+}
+
+void SharedMonitor::LeaveShared()
+{
+	if (GetCurrentThreadId() == mOwnerThreadId.load(std::memory_order_relaxed))
+	{
+		Leave();
+		return;
+	}
+
+	// 마지막으로 나가는 읽기만 쓰기를 기다리는 thread를 깨운다.
+	if (1 == mState.fetch_sub(1))
+	{
+		WakeUpWaiters();
+	}
+}
+
+void SharedMonitor::Enter()
+{
+	DWORD threadId = GetCurrentThreadId();
+
+	if (threadId == mOwnerThreadId.load(std::memory_order_relaxed))
+	{
+		++mRecursionCnt;
+		return;
+	}
+
+	if (false == TryEnter())
+	{
+		// 기다리는 동안 새로운 읽기가 들어오지 못하게 한다.
+		mWaitingWriterCnt.fetch_add(1);
+		EnterSlow(true);
+		mWaitingWriterCnt.fetch_sub(1);
+	}
+
+	mOwnerThreadId.store(threadId, std::memory_order_relaxed);
+	mRecursionCnt = 1;
+}
+
+void SharedMonitor::Leave()
+{
+	if (0 < --mRecursionCnt)
+	{
+		return;
+	}
+
+	mOwnerThreadId.store(0, std::memory_order_relaxed);
+	mState.store(0);
+
+	WakeUpWaiters();
+}
+
+bool SharedMonitor::TryEnterShared()
+{
+	int state = mState.load(std::memory_order_relaxed);
+
+	while (SHARED_MONITOR_WRITER_LOCKED != state && 0 == mWaitingWriterCnt.load(std::memory_order_relaxed))
+	{
+		// 실패하면 state가 다른 thread가 바꾼 값으로 바뀐다.
+		if (mState.compare_exchange_weak(state, state + 1, std::memory_order_acquire))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SharedMonitor::TryEnter()
+{
+	int state{ 0 };
+	return mState.compare_exchange_strong(state, SHARED_MONITOR_WRITER_LOCKED, std::memory_order_acquire);
+}
+
+void SharedMonitor::EnterSlow(bool isExclusive)
+{
+	auto tryEnter = [this, isExclusive]()
+		{
+			return isExclusive ? TryEnter() : TryEnterShared();
+		};
+
+	if (gIsMultiCore)
+	{
+		for (int spinCnt = 0; spinCnt < SHARED_MONITOR_SPIN_CNT; ++spinCnt)
+		{
+			YieldProcessor();
+
+			if (tryEnter())
+			{
+				return;
+			}
+		}
+	}
+
+	while (true)
+	{
+		// 잠들겠다고 알린 뒤에 한 번 더 확인해야
+		// 그 사이에 lock을 풀고 잠든 thread가 없다고 판단한 쪽을 놓치지 않는다.
+		int wakeSignal = mWakeSignal.load();
+		mWaiterCnt.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (tryEnter())
+		{
+			mWaiterCnt.fetch_sub(1);
+			return;
+		}
+
+		// 그 사이에 lock이 풀렸다면 mWakeSignal이 바뀌어서 바로 반환한다.
+		WaitOnAddress(&mWakeSignal, &wakeSignal, sizeof(wakeSignal), INFINITE);
+		mWaiterCnt.fetch_sub(1);
+
+		if (tryEnter())
+		{
+			return;
+		}
+	}
+}
+
+void SharedMonitor::WakeUpWaiters()
+{
+	// lock을 푼 것(mState)보다 잠든 thread 수를 먼저 읽으면
+	// 잠들기 직전의 thread를 놓칠 수 있어서 둘 다 seq_cst로 한다.
+	// (fence를 따로 두면 경합이 없을 때도 Leave()마다 barrier를 두 번 하게 된다.)
+	if (0 == mWaiterCnt.load())
+	{
+		return;
+	}
+
+	mWakeSignal.fetch_add(1);
+	WakeByAddressAll(&mWakeSignal);
+}
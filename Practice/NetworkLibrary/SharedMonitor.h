@@ -0,0 +1,117 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 여러 thread가 동시에 읽고, 쓸 때만 혼자 잡는 lock(reader/writer lock)
+//
+// Monitor는 읽기만 하는 thread끼리도 한 줄로 세우기 때문에
+// 여러 thread가 자주 읽고 가끔 쓰는 데이터에서는 읽는 쪽이 서로를 기다리게 된다.
+// (ConnectionManager::WithConnection()은 SendQueue를 사용하는 Connection이라면 lock을 읽기로 잡고
+//  CloseConnection()만 쓰기로 잡는다.)
+// 읽기와 쓰기가 비슷하게 섞인 곳(send buffer 같은)에서는 상태를 하나 더 확인하는 만큼 Monitor보다 느리다.
+// SharedMonitor는 읽을 때 SharedOwner, 쓸 때 Owner로 잡는다.
+// - 읽기(SharedOwner): 쓰는 thread가 없으면 읽는 thread 수만 올리고 바로 들어간다.
+// - 쓰기(Owner): 읽는 thread와 쓰는 thread가 모두 나갈 때까지 기다린다.
+// 쓰기를 기다리는 thread가 있으면 새로 들어오는 읽기도 기다려서 쓰기가 굶지 않게 한다.
+//
+// Monitor처럼 잠깐 spin한 뒤에 WaitOnAddress()(Linux는 futex)로 잠들고
+// 잠든 thread가 있을 때만 깨운다.
+//
+// 쓰기로 잡은 thread는 다시 쓰기나 읽기로 잡을 수 있다(Monitor와 같이 재귀로 센다).
+// 읽기로 잡은 thread는 다시 잡으면 안 된다(읽기 수만 세고 누가 잡았는지는 기억하지 않는다).
+// - 다시 읽기로 잡기: 사이에 쓰기를 기다리는 thread가 있으면 새로 들어오는 읽기를 막기 때문에
+//   자기가 잡은 읽기가 풀리기를 기다리는 쓰기를 다시 기다리게 되어 deadlock이다.
+// - 쓰기로 바꾸기: 자기가 잡은 읽기가 풀리기를 기다리기 때문에 항상 deadlock이다.
+
+#include <atomic>
+
+#include "Platform.h"
+
+// spin으로 lock을 기다리는 횟수
+constexpr int SHARED_MONITOR_SPIN_CNT{ 64 };
+
+class NETLIB_API SharedMonitor
+{
+public:
+	// 생성할 때 읽기로 잡고 소멸할 때 푼다.
+	class NETLIB_API SharedOwner
+	{
+	public:
+		SharedOwner(SharedMonitor& syncObject);
+		~SharedOwner();
+
+	public:
+		SharedOwner(const SharedOwner& rhs) = delete;
+		SharedOwner(SharedOwner&& rhs) = delete;
+
+		SharedOwner& operator=(const SharedOwner& rhs) = delete;
+		SharedOwner& operator=(SharedOwner&& rhs) = delete;
+
+	private:
+		SharedMonitor& mSyncObject;
+	};
+
+	// 생성할 때 쓰기로 잡고 소멸할 때 푼다.
+	class NETLIB_API Owner
+	{
+	public:
+		Owner(SharedMonitor& syncObject);
+		~Owner();
+
+	public:
+		Owner(const Owner& rhs) = delete;
+		Owner(Owner&& rhs) = delete;
+
+		Owner& operator=(const Owner& rhs) = delete;
+		Owner& operator=(Owner&& rhs) = delete;
+
+	private:
+		SharedMonitor& mSyncObject;
+	};
+
+public:
+	SharedMonitor();
+	~SharedMonitor();
+
+public:
+	void EnterShared();
+	void LeaveShared();
+
+	void Enter();
+	void Leave();
+
+public:
+	SharedMonitor(const SharedMonitor& rhs) = delete;
+	SharedMonitor(SharedMonitor&& rhs) = delete;
+
+	SharedMonitor& operator=(const SharedMonitor& rhs) = delete;
+	SharedMonitor& operator=(SharedMonitor&& rhs) = delete;
+
+private:
+	bool TryEnterShared();
+	bool TryEnter();
+
+	// 바로 lock을 얻지 못했을 때 spin하고, 그래도 안 되면 잠든다.
+	void EnterSlow(bool isExclusive);
+
+	// lock을 풀고 잠든 thread가 있으면 모두 깨운다.
+	// 읽기를 기다리던 thread는 모두 같이 들어갈 수 있기 때문에 하나만 깨우지 않는다.
+	void WakeUpWaiters();
+
+private:
+	// 0 이상: 읽기로 잡은 thread 수, SHARED_MONITOR_WRITER_LOCKED: 쓰기로 잡음
+	std::atomic<int> mState;
+
+	// 쓰기로 잡으려고 기다리는 thread 수
+	// 0이 아니면 새로 들어오는 읽기는 기다린다.
+	std::atomic<int> mWaitingWriterCnt;
+
+	// 잠든 thread 수와
+	// 깨울 때마다 값을 바꿔서 WaitOnAddress()를 빠져나오게 하는 변수
+	std::atomic<int> mWaiterCnt;
+	std::atomic<int> mWakeSignal;
+
+	// 쓰기로 잡은 thread와 다시 들어온 횟수
+	std::atomic<DWORD> mOwnerThreadId;
+	int mRecursionCnt;
+};
@@ -0,0 +1,73 @@
+﻿#include <new>
+
+#include "Log.h"
+#include "Connection.h"
+#include "SharedPacket.h"
+
+SharedPacket* SharedPacket::Create(int packetSize)
+{
+	if (PACKET_SIZE_LENGTH > packetSize)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | SharedPacket::Create() | invalid packet size: %d",
+			packetSize);
+
+		return nullptr;
+	}
+
+	// 객체와 패킷 내용을 한 번에 할당한다.
+	void* pMemory = ::operator new(sizeof(SharedPacket) + packetSize, std::nothrow);
+	if (nullptr == pMemory)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | SharedPacket::Create() | allocation failed: %d",
+			packetSize);
+
+		return nullptr;
+	}
+
+	SharedPacket* pPacket = new (pMemory) SharedPacket{ packetSize };
+
+	char* pBuffer = pPacket->GetBuffer();
+	ZeroMemory(pBuffer, packetSize);
+	CopyMemory(pBuffer, &packetSize, PACKET_SIZE_LENGTH);
+
+	return pPacket;
+}
+
+SharedPacket::SharedPacket(int packetSize)
+	: mRefCount{ 1 }
+	, mPacketSize{ packetSize }
+{
+}
+
+void SharedPacket::AddRef()
+{
+	InterlockedIncrement64(&mRefCount);
+}
+
+void SharedPacket::Release()
+{
+	if (0 < InterlockedDecrement64(&mRefCount))
+	{
+		return;
+	}
+
+	this->~SharedPacket();
+	::operator delete(this);
+}
+
+char* SharedPacket::GetBuffer()
+{
+	return reinterpret_cast<char*>(this + 1);
+}
+
+int SharedPacket::GetPacketSize()
+{
+	return mPacketSize;
+}
+
+LONG64 SharedPacket::GetRefCount()
+{
+	return mRefCount;
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 여러 connection에게 같은 내용으로 보내는 패킷(broadcast)
+//
+// 지금까지는 주변 client 수만큼 PrepareSendPacket()으로 공간을 마련하고
+// VBuffer::CopyBuffer()로 같은 내용을 각자의 send ring buffer에 복사했다.
+// SharedPacket은 한 번 만들어서 내용을 채운 뒤에는 바꾸지 않고
+// Connection::SendShared()는 복사하지 않고 참조만 송신 대기 목록에 넣는다.
+// 송신할 때 send ring buffer의 조각들 사이에 끼워서 한 번의 WSASend()(writev())로 보낸다.
+//
+// 참조 횟수로 수명을 관리한다.
+// Create()로 만들면 참조 횟수가 1이고 SendShared()가 connection마다 1 증가시킨다.
+// 송신이 끝나거나 연결이 끊기면 1 감소하고 0이 되면 해제된다.
+//
+// 사용 예)
+//	SharedPacket* pPacket = SharedPacket::Create(packetSize);
+//	// pPacket->GetBuffer()에 내용을 채운다(앞 4byte에는 패킷 크기가 채워져 있다).
+//	for (Connection* pConnection : nearConnections)
+//	{
+//		pConnection->SendShared(pPacket);
+//		pConnection->SendPost();
+//	}
+//	pPacket->Release();
+
+#include "Platform.h"
+
+class NETLIB_API SharedPacket
+{
+public:
+	// packetSize 크기의 패킷을 만든다.
+	// 앞 4byte(PACKET_SIZE_LENGTH)에 패킷 크기를 채워두고 참조 횟수는 1
+	// 할당할 수 없거나 크기가 잘못되었으면 nullptr
+	static SharedPacket* Create(int packetSize);
+
+public:
+	void AddRef();
+
+	// 참조 횟수가 0이 되면 해제한다. 호출한 뒤에는 사용하면 안 된다.
+	void Release();
+
+public:
+	// 내용을 채울 버퍼
+	// SendShared()를 호출한 뒤에는 다른 thread가 송신중일 수 있으니 고치면 안 된다.
+	char* GetBuffer();
+
+	int GetPacketSize();
+	LONG64 GetRefCount();
+
+public:
+	SharedPacket(const SharedPacket& rhs) = delete;
+	SharedPacket(SharedPacket&& rhs) = delete;
+
+	SharedPacket& operator=(const SharedPacket& rhs) = delete;
+	SharedPacket& operator=(SharedPacket&& rhs) = delete;
+
+private:
+	// 패킷 내용은 객체 바로 뒤에 같이 할당한다.
+	SharedPacket(int packetSize);
+	~SharedPacket() = default;
+
+private:
+	LONG64 mRefCount;
+	int mPacketSize;
+};
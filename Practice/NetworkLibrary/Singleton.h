@@ -5,17 +5,19 @@
 // 오직 하나의 객체만 생성되어야 하며,
 // 여기저기서 쉽게 접근할 수 있어야 하는 class
 
+#include "Platform.h"
+
+#ifdef _WIN32
 // 템플릿을 export할 때 발생하는 경고로
 // 템플릿을 dll 내부에서만 사용한다면, 문제가 없다고 한다.
 #pragma warning(disable:4251)
 
 #ifdef NETWORKLIBRARY_EXPORTS
-#define NETLIB_API __declspec(dllexport)
 #define NETLIB_TEMPLATE
 #else
-#define NETLIB_API __declspec(dllimport)
 #define NETLIB_TEMPLATE extern
 #endif
+#endif
 
 // mSingletonList에서 중간에 위치한
 // singleton 객체가 삭제되는 경우도 있기 때문에 list 사용
@@ -159,7 +161,9 @@ private:
 	static std::list<Singleton*> mSingletonList;
 };
 
+#ifdef _WIN32
 NETLIB_TEMPLATE template class NETLIB_API std::list<Singleton*>;
+#endif
 
 // C4251 warning
 // dll에서 class를 export할 때
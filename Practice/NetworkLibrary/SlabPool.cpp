@@ -0,0 +1,155 @@
+﻿#include "Log.h"
+#include "SlabPool.h"
+
+IMPLEMENT_SINGLETON(SlabPool);
+
+// free list head의 하위 32비트(번호 + 1)와 상위 32비트(tag)
+constexpr unsigned long long SLAB_INDEX_MASK{ 0xFFFFFFFF };
+
+static LONG64 MakeFreeHead(unsigned long long tag, int index)
+{
+	return static_cast<LONG64>((tag << 32) | static_cast<unsigned int>(index + 1));
+}
+
+void SlabPool::Initialize()
+{
+	ZeroMemory(mChunks, sizeof(mChunks));
+	mChunkCnt = 0;
+	mFreeHead = 0;
+	mFreeSlabCnt = 0;
+}
+
+void SlabPool::Finalize()
+{
+	for (LONG64 i = 0; i < mChunkCnt; ++i)
+	{
+		delete[] mChunks[i];
+	}
+}
+
+bool SlabPool::Reserve(int slabCnt)
+{
+	while (GetSlabCount() < slabCnt)
+	{
+		Monitor::Owner lock{ mGrowSyncObject };
+
+		if (GetSlabCount() >= slabCnt)
+		{
+			break;
+		}
+
+		if (false == Grow())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Slab* SlabPool::Alloc()
+{
+	while (true)
+	{
+		LONG64 head = mFreeHead;
+		int index = static_cast<int>(static_cast<unsigned long long>(head) & SLAB_INDEX_MASK) - 1;
+
+		if (-1 == index)
+		{
+			// 다른 thread가 먼저 chunk를 할당했다면 다시 꺼내본다.
+			Monitor::Owner lock{ mGrowSyncObject };
+
+			if (0 == (static_cast<unsigned long long>(mFreeHead) & SLAB_INDEX_MASK) &&
+				false == Grow())
+			{
+				return nullptr;
+			}
+
+			continue;
+		}
+
+		// 꺼낸 직후에 다른 thread가 mNextFree를 바꿨을 수 있지만
+		// 그렇다면 head의 tag도 바뀌어서 아래 CAS가 실패한다.
+		// slab은 해제하지 않기 때문에 읽는 것 자체는 안전하다.
+		Slab* pSlab = GetSlab(index);
+		unsigned long long tag = static_cast<unsigned long long>(head) >> 32;
+
+		if (InterlockedCompareExchange64(&mFreeHead, MakeFreeHead(tag + 1, pSlab->mNextFree), head) == head)
+		{
+			InterlockedDecrement64(&mFreeSlabCnt);
+
+			pSlab->mNext = nullptr;
+			pSlab->mWriteEnd = 0;
+			return pSlab;
+		}
+	}
+}
+
+void SlabPool::Free(Slab* pSlab)
+{
+	while (true)
+	{
+		LONG64 head = mFreeHead;
+		unsigned long long tag = static_cast<unsigned long long>(head) >> 32;
+
+		pSlab->mNextFree = static_cast<int>(static_cast<unsigned long long>(head) & SLAB_INDEX_MASK) - 1;
+
+		if (InterlockedCompareExchange64(&mFreeHead, MakeFreeHead(tag + 1, pSlab->mIndex), head) == head)
+		{
+			InterlockedIncrement64(&mFreeSlabCnt);
+			return;
+		}
+	}
+}
+
+int SlabPool::GetSlabCount()
+{
+	return static_cast<int>(mChunkCnt * SLABS_PER_CHUNK);
+}
+
+int SlabPool::GetFreeSlabCount()
+{
+	return static_cast<int>(mFreeSlabCnt);
+}
+
+bool SlabPool::IsCreated()
+{
+	return nullptr != mInstance;
+}
+
+bool SlabPool::Grow()
+{
+	if (MAX_SLAB_CHUNK_CNT <= mChunkCnt)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | SlabPool::Grow() | slab pool is full: %d slabs",
+			GetSlabCount());
+
+		return false;
+	}
+
+	Slab* pChunk = new Slab[SLABS_PER_CHUNK];
+	int firstIndex = static_cast<int>(mChunkCnt * SLABS_PER_CHUNK);
+
+	// chunk를 먼저 등록해야 free list에서 꺼낸 번호로 slab을 찾을 수 있다.
+	// Interlocked 함수가 메모리 순서를 보장하기 때문에
+	// 다른 thread가 새 번호를 꺼냈다면 mChunks에 기록된 chunk도 보인다.
+	mChunks[mChunkCnt] = pChunk;
+	InterlockedIncrement64(&mChunkCnt);
+
+	for (int i = 0; i < SLABS_PER_CHUNK; ++i)
+	{
+		pChunk[i].mNext = nullptr;
+		pChunk[i].mWriteEnd = 0;
+		pChunk[i].mIndex = firstIndex + i;
+
+		Free(&pChunk[i]);
+	}
+
+	return true;
+}
+
+Slab* SlabPool::GetSlab(int index)
+{
+	return &mChunks[index / SLABS_PER_CHUNK][index % SLABS_PER_CHUNK];
+}
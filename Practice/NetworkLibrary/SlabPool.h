@@ -0,0 +1,91 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// ChainBuffer가 사용하는 고정 크기 slab을 모든 connection이 같이 사용하는 pool
+//
+// slab은 한 번 할당하면 프로세스가 끝날 때까지 해제하지 않고 free list로 재사용한다.
+// free list는 lock 없이 Interlocked 함수로 꺼내고 넣는다(Treiber stack).
+// slab 주소 대신 번호를 사용해서 head를 번호(하위 32비트)와 tag(상위 32비트)로 만들고
+// 한 번의 64비트 CAS로 바꾼다.
+// 꺼내는 사이에 다른 thread가 같은 slab을 꺼냈다가 다시 넣어도 tag가 달라서 CAS가 실패한다(ABA 방지).
+// free list가 비었을 때만 lock을 잡고 slab 묶음(chunk)을 새로 할당한다.
+
+#include "Platform.h"
+#include "Monitor.h"
+#include "Singleton.h"
+
+// slab 하나의 크기
+// ChainBuffer는 패킷을 slab 하나 안에 연속으로 담기 때문에 패킷의 최대 크기이기도 하다.
+constexpr int SEND_SLAB_SIZE{ 16 * 1024 };
+
+// 한 번에 할당하는 slab 수와 chunk의 최대 개수
+constexpr int SLABS_PER_CHUNK{ 64 };
+constexpr int MAX_SLAB_CHUNK_CNT{ 4096 };
+
+struct Slab
+{
+	// ChainBuffer 안에서 다음 slab
+	Slab* mNext;
+
+	// ChainBuffer가 데이터를 쓴 위치
+	int mWriteEnd;
+
+	// pool 안에서의 번호
+	int mIndex;
+
+	// free list에서 다음 slab의 번호(-1이면 끝)
+	int mNextFree;
+
+	// SendQueue가 slab 하나를 여러 node로 잘라 쓸 때 아직 해제하지 않은 node 수(+ 잘라 쓰는 thread)
+	LONG64 mRefCnt;
+
+	char mData[SEND_SLAB_SIZE];
+};
+
+class NETLIB_API SlabPool : public Singleton
+{
+	DECLEAR_SINGLETON(SlabPool);
+
+public:
+	// server 시작 시 slab을 slabCnt개 이상 미리 할당해둔다.
+	bool Reserve(int slabCnt);
+
+	// free list에서 slab을 하나 꺼낸다. 할당할 수 없으면 nullptr
+	Slab* Alloc();
+
+	// 다 사용한 slab을 free list에 돌려준다.
+	void Free(Slab* pSlab);
+
+public:
+	// 할당한 전체 slab 수, free list에 있는 slab 수
+	int GetSlabCount();
+	int GetFreeSlabCount();
+
+	// 아직 해제되지 않았는지(Singleton::ReleaseAll() 이후에는 false)
+	// GetInstance()는 없으면 새로 만들기 때문에 종료 중에 slab을 돌려주려는 쪽이 먼저 확인한다.
+	static bool IsCreated();
+
+private:
+	// free list가 비었을 때 chunk를 하나 더 할당한다.
+	bool Grow();
+
+	Slab* GetSlab(int index);
+
+private:
+	Slab* mChunks[MAX_SLAB_CHUNK_CNT];
+	LONG64 mChunkCnt;
+
+	// free list head(tag << 32 | (번호 + 1)), 하위 32비트가 0이면 비어있다.
+	LONG64 mFreeHead;
+	LONG64 mFreeSlabCnt;
+
+	Monitor mGrowSyncObject;
+
+private:
+	SlabPool(const SlabPool& rhs) = delete;
+	SlabPool(SlabPool&& rhs) = delete;
+
+	SlabPool& operator=(const SlabPool& rhs) = delete;
+	SlabPool& operator=(SlabPool&& rhs) = delete;
+};
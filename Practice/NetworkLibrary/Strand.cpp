@@ -0,0 +1,141 @@
+﻿#include "Log.h"
+#include "Connection.h"
+#include "IOBackend.h"
+#include "Strand.h"
+
+// 현재 thread가 실행하고 있는 strand
+static thread_local Strand* tCurrentStrand{ nullptr };
+
+StrandTask::StrandTask()
+	: mNextTask{ nullptr }
+{
+}
+
+Strand::Strand()
+	: mIOBackend{ nullptr }
+	, mOverlappedEx{ nullptr }
+	, mHead{ nullptr }
+	, mTail{ nullptr }
+	, mIsScheduled{ false }
+	, mSyncObject{}
+{
+}
+
+Strand::~Strand()
+{
+	delete mOverlappedEx;
+}
+
+bool Strand::Create(IOBackend* pIOBackend)
+{
+	if (nullptr == pIOBackend)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Strand::Create() | IOBackend is nullptr");
+
+		return false;
+	}
+
+	mIOBackend = pIOBackend;
+
+	mOverlappedEx = new OVERLAPPED_EX{ this };
+	mOverlappedEx->mOperation = eOperationType::OP_STRAND;
+
+	return true;
+}
+
+void Strand::Post(StrandTask* pTask)
+{
+	pTask->mNextTask = nullptr;
+
+	bool isScheduled{ false };
+
+	{
+		Monitor::Owner lock{ mSyncObject };
+
+		if (nullptr == mTail)
+		{
+			mHead = pTask;
+		}
+		else
+		{
+			mTail->mNextTask = pTask;
+		}
+
+		mTail = pTask;
+
+		isScheduled = mIsScheduled;
+		mIsScheduled = true;
+	}
+
+	// 이미 다른 worker thread가 실행중이거나 완료 통지를 넣어두었다면 그 thread가 이어서 실행한다.
+	if (isScheduled)
+	{
+		return;
+	}
+
+	if (false == mIOBackend->PostCompletion(mOverlappedEx))
+	{
+		// 완료 통지를 넣지 못했지만 strand는 이미 실행중 상태라서
+		// 다른 thread가 끼어들지 않으니 여기서 실행해도 순서가 지켜진다.
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Strand::Post() | PostCompletion() failed, run in caller thread");
+
+		while (RunBatch())
+		{
+		}
+	}
+}
+
+void Strand::Run()
+{
+	while (RunBatch())
+	{
+		// 다른 strand와 IO 완료 통지가 기다리지 않도록 양보한다.
+		if (mIOBackend->PostCompletion(mOverlappedEx))
+		{
+			return;
+		}
+	}
+}
+
+bool Strand::IsRunningInThisThread()
+{
+	return this == tCurrentStrand;
+}
+
+bool Strand::RunBatch()
+{
+	// 작업 안에서 완료 통지를 넣지 못한 다른 strand를 직접 실행할 수도 있어서 되돌려둔다.
+	Strand* pPrevStrand = tCurrentStrand;
+	tCurrentStrand = this;
+
+	for (int i = 0; i < STRAND_BATCH_CNT; ++i)
+	{
+		StrandTask* pTask{ nullptr };
+
+		{
+			Monitor::Owner lock{ mSyncObject };
+
+			pTask = mHead;
+			if (nullptr == pTask)
+			{
+				// 이 뒤로는 다른 thread가 Post()해서 실행을 시작할 수 있다.
+				mIsScheduled = false;
+				tCurrentStrand = pPrevStrand;
+				return false;
+			}
+
+			mHead = pTask->mNextTask;
+			if (nullptr == mHead)
+			{
+				mTail = nullptr;
+			}
+		}
+
+		pTask->Execute();
+	}
+
+	tCurrentStrand = pPrevStrand;
+	return true;
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// 넘겨받은 작업을 넣은 순서대로 하나씩 실행하는 직렬 실행기(strand)
+//
+// 지금까지 순서가 중요한 작업(연결 종료, game logic)은 process IOCP queue에 넣고
+// process thread 하나(InitConfig::mProcessThreadCnt)가 모두 처리했기 때문에
+// game logic은 core 하나 이상을 사용할 수 없었다.
+//
+// 실제로 순서가 필요한 것은 모든 작업이 아니라
+// 한 client(Connection)의 작업끼리, 한 zone의 작업끼리의 순서다.
+// Strand는 그 단위마다 하나씩 두고 작업 queue를 따로 가진다.
+// 작업이 들어와서 strand가 쉬고 있었다면 IOBackend에 strand를 실행하라는 완료 통지를 넣고
+// 그 통지를 꺼낸 worker thread가 queue의 작업을 순서대로 실행한다.
+// 한 strand는 동시에 한 worker thread에서만 실행되기 때문에 strand 안의 작업은 lock 없이 순서대로 실행되고
+// 서로 다른 strand는 여러 worker thread에서 동시에 실행된다.
+//
+// 한 strand가 worker thread를 오래 잡고 있지 않도록
+// STRAND_BATCH_CNT개를 실행한 뒤에도 작업이 남았다면 완료 통지를 다시 넣고 양보한다.
+//
+// Connection은 strand를 하나씩 가지고 있다(Connection::GetStrand()).
+// Connection은 재사용되기 때문에 작업은 만들 때의 ConnectionHandle을 기억했다가
+// 실행할 때 ConnectionManager::WithConnection()으로 같은 client인지 확인하고 실행해야 한다.
+
+#include "Platform.h"
+#include "Monitor.h"
+
+class IOBackend;
+struct OVERLAPPED_EX;
+
+// strand가 양보하기 전에 한 번에 실행하는 작업의 최대 수
+constexpr int STRAND_BATCH_CNT{ 64 };
+
+// strand에서 실행할 작업
+// Post()한 뒤로 Execute()가 호출될 때까지 strand가 들고 있고
+// Execute()가 반환된 뒤에는 strand가 다시 건드리지 않기 때문에 Execute() 안에서 delete해도 된다.
+class NETLIB_API StrandTask
+{
+public:
+	StrandTask();
+	virtual ~StrandTask() = default;
+
+	virtual void Execute() = 0;
+
+private:
+	friend class Strand;
+
+	// strand 작업 queue의 다음 작업
+	StrandTask* mNextTask;
+};
+
+class NETLIB_API Strand
+{
+public:
+	Strand();
+	~Strand();
+
+public:
+	// pIOBackend의 worker thread에서 작업을 실행한다.
+	bool Create(IOBackend* pIOBackend);
+
+	// 작업을 queue 끝에 넣는다.
+	// strand가 쉬고 있었다면 worker thread에게 실행을 맡긴다.
+	// 어느 thread에서 호출해도 되고 strand 안의 작업에서 호출해도 된다.
+	void Post(StrandTask* pTask);
+
+	// worker thread가 strand 실행 완료 통지(OP_STRAND)를 꺼내면 호출한다.
+	void Run();
+
+	// 현재 thread가 이 strand의 작업을 실행하고 있는지
+	bool IsRunningInThisThread();
+
+public:
+	Strand(const Strand& rhs) = delete;
+	Strand(Strand&& rhs) = delete;
+
+	Strand& operator=(const Strand& rhs) = delete;
+	Strand& operator=(Strand&& rhs) = delete;
+
+private:
+	// 작업을 최대 STRAND_BATCH_CNT개 실행한다.
+	// 반환값은 작업이 남았는지(false면 strand가 쉬는 상태가 되었다.)
+	bool RunBatch();
+
+private:
+	IOBackend* mIOBackend;
+
+	// worker thread에게 strand 실행을 맡길 때 사용하는 완료 통지
+	// (mConnection에 Strand, mOperation에 OP_STRAND)
+	OVERLAPPED_EX* mOverlappedEx;
+
+	// 작업 queue(mNextTask로 이어진 list)
+	StrandTask* mHead;
+	StrandTask* mTail;
+
+	// 완료 통지를 넣었거나 실행중이면 true
+	// true인 동안에는 Post()가 완료 통지를 다시 넣지 않아서 한 worker thread만 실행한다.
+	bool mIsScheduled;
+
+	Monitor mSyncObject;
+};
@@ -1,11 +1,11 @@
-﻿#define _WINSOCKAPI_
-#include <Windows.h>
-#include <cassert>
-#include <process.h>
+﻿#include <cassert>
 
 #include "Thread.h"
 #include "Log.h"
 
+#ifdef _WIN32
+#include <process.h>
+
 Thread::Thread()
 	: mThread{ NULL }
 	, mIsRunning{ false }
@@ -96,6 +96,81 @@ void Thread::DestroyThread()
 
 	WaitForSingleObject(mThread, INFINITE);
 }
+#else
+Thread::Thread()
+	: mThread{}
+	, mIsQuit{ false }
+	, mIsCreated{ false }
+	, mIsRunning{ false }
+	, mWaitTick{ 0 }
+	, mTickCount{ 0 }
+{
+	pthread_mutex_init(&mQuitLock, nullptr);
+
+	// pthread_cond_timedwait()에 넘기는 시간이
+	// 시스템 시간 변경에 영향을 받지 않도록 monotonic clock 사용
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	pthread_cond_init(&mQuitCondition, &attr);
+
+	pthread_condattr_destroy(&attr);
+}
+
+Thread::~Thread()
+{
+	pthread_cond_destroy(&mQuitCondition);
+	pthread_mutex_destroy(&mQuitLock);
+}
+
+void* CallTickThread(void* p)
+{
+	Thread* pThread = reinterpret_cast<Thread*>(p);
+
+	pThread->TickThread();
+
+	return nullptr;
+}
+
+bool Thread::CreateThread(DWORD waitTick)
+{
+	// TickThread()가 시작하자마자 mWaitTick을 참조하기 때문에
+	// thread를 생성하기 전에 세팅해둔다.
+	mWaitTick = waitTick;
+
+	int ret = pthread_create(&mThread, nullptr, CallTickThread, this);
+	if (0 != ret)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | Thread::CreateThread() | TickThread 생성 실패: Error(%d)",
+			ret);
+
+		return false;
+	}
+
+	mIsCreated = true;
+	return true;
+}
+
+void Thread::DestroyThread()
+{
+	Run();
+
+	// SetEvent(mQuitEvent) 대신
+	// 종료 flag를 세우고 대기중인 thread를 깨운다.
+	pthread_mutex_lock(&mQuitLock);
+	mIsQuit = true;
+	pthread_cond_signal(&mQuitCondition);
+	pthread_mutex_unlock(&mQuitLock);
+
+	if (mIsCreated)
+	{
+		pthread_join(mThread, nullptr);
+		mIsCreated = false;
+	}
+}
+#endif
 
 void Thread::Run()
 {
@@ -131,6 +206,7 @@ void Thread::Stop()
 	}
 }
 
+#ifdef _WIN32
 void Thread::TickThread()
 {
 	while (true)
@@ -151,6 +227,49 @@ void Thread::TickThread()
 		}
 	}
 }
+#else
+void Thread::TickThread()
+{
+	while (true)
+	{
+		timespec deadline{};
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+		deadline.tv_sec += mWaitTick / 1000;
+		deadline.tv_nsec += static_cast<long>(mWaitTick % 1000) * 1000000;
+		if (1000000000 <= deadline.tv_nsec)
+		{
+			deadline.tv_sec += 1;
+			deadline.tv_nsec -= 1000000000;
+		}
+
+		bool isQuit{ false };
+
+		pthread_mutex_lock(&mQuitLock);
+
+		// 종료 요청이 없는 동안 tick 만큼 기다린다.
+		// spurious wakeup이 있을 수 있어서 timeout이 될 때까지 반복
+		int ret{ 0 };
+		while (false == mIsQuit && ETIMEDOUT != ret)
+		{
+			ret = pthread_cond_timedwait(&mQuitCondition, &mQuitLock, &deadline);
+		}
+		isQuit = mIsQuit;
+
+		pthread_mutex_unlock(&mQuitLock);
+
+		// WAIT_OBJECT_0에 해당
+		if (isQuit)
+		{
+			break;
+		}
+
+		// WAIT_TIMEOUT에 해당
+		++mTickCount;
+		OnProcess();
+	}
+}
+#endif
 
 DWORD Thread::GetTickCount()
 {
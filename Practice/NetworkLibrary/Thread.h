@@ -10,14 +10,11 @@
 // 온라인 게임 서버 동기화는 서버 시간을 기준으로 하는데
 // server tick이란 단위를 만들어서 처리할 수도 있다.
 
-#ifdef NETWORKLIBRARY_EXPORTS
-#define NETLIB_API __declspec(dllexport)
-#else
-#define NETLIB_API __declspec(dllimport)
-#endif
+#include "Platform.h"
 
-#define _WINSOCKAPI_
-#include <Windows.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 class NETLIB_API Thread
 {
@@ -51,8 +48,20 @@ public:
 
 	// 자식 class에서 사용할 필요가 있을 수도 있기에 protected
 protected:
+#ifdef _WIN32
 	HANDLE mThread;
 	HANDLE mQuitEvent;
+#else
+	// Linux에는 event 객체가 없어서
+	// 종료 요청 여부(mIsQuit)를 condition variable로 기다린다.
+	// WaitForSingleObject(mQuitEvent, mWaitTick)의 timeout은
+	// pthread_cond_timedwait()의 timeout으로 대신한다.
+	pthread_t mThread;
+	pthread_mutex_t mQuitLock;
+	pthread_cond_t mQuitCondition;
+	bool mIsQuit;
+	bool mIsCreated;
+#endif
 
 	bool mIsRunning;
 	
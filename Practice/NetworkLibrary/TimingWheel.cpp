@@ -0,0 +1,377 @@
+﻿#include <chrono>
+
+#include "Log.h"
+#include "ConnectionManager.h"
+#include "TimingWheel.h"
+#include "Coroutine.h"
+
+// handle의 하위 32비트(노드 index)와 상위 32비트(세대)
+constexpr unsigned long long TIMER_INDEX_MASK{ 0xFFFFFFFF };
+
+// wheel 전체가 담을 수 있는 tick 수(2^26)
+constexpr unsigned long long TIMER_MAX_DELAY_TICK{ 1ULL << (TIMER_ROOT_BITS + TIMER_LEVEL_BITS * (TIMER_LEVEL_CNT - 1)) };
+
+static LONG64 GetNowMsec()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TimingWheel::TimingWheel()
+	: mNodes{ nullptr }
+	, mMaxTimerCnt{ 0 }
+	, mFreeHead{ -1 }
+	, mTimerCnt{ 0 }
+	, mSlotHeads{}
+	, mCurrentTick{ 0 }
+	, mBeginMsec{ 0 }
+	, mConnectionManager{ nullptr }
+	, mSyncObject{}
+	, mIsAdvancing{ 0 }
+	, mExpiredTimers{}
+	, mFiredCnt{ 0 }
+	, mStaleCnt{ 0 }
+{
+}
+
+TimingWheel::~TimingWheel()
+{
+	delete[] mNodes;
+}
+
+bool TimingWheel::Create(int maxTimerCnt, ConnectionManager* pConnectionManager)
+{
+	if (0 >= maxTimerCnt)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | TimingWheel::Create() | invalid timer count: %d",
+			maxTimerCnt);
+
+		return false;
+	}
+
+	mNodes = new TimerNode[maxTimerCnt]{};
+	mMaxTimerCnt = maxTimerCnt;
+
+	for (int i = 0; i < maxTimerCnt; ++i)
+	{
+		mNodes[i].mSlot = -1;
+		mNodes[i].mGeneration = 1;
+		mNodes[i].mNext = i + 1 < maxTimerCnt ? i + 1 : -1;
+	}
+
+	mFreeHead = 0;
+
+	for (int i = 0; i < TIMER_SLOT_CNT; ++i)
+	{
+		mSlotHeads[i] = -1;
+	}
+
+	// Advance()가 한 번에 꺼내는 timer를 담을 공간을 미리 잡아둔다.
+	mExpiredTimers.reserve(TIMER_ROOT_SLOT_CNT);
+
+	mConnectionManager = pConnectionManager;
+	mBeginMsec = GetNowMsec();
+
+	return true;
+}
+
+TimerHandle TimingWheel::AddTimer(DWORD delayMsec, TimerListener* pListener, int timerType, LONG64 param,
+	ConnectionHandle connectionHandle)
+{
+	if (nullptr == pListener)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | TimingWheel::AddTimer() | listener is nullptr: type[%d]",
+			timerType);
+
+		return INVALID_TIMER_HANDLE;
+	}
+
+	if (INVALID_CONNECTION_HANDLE != connectionHandle && nullptr == mConnectionManager)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | TimingWheel::AddTimer() | connection timer without ConnectionManager: type[%d]",
+			timerType);
+
+		return INVALID_TIMER_HANDLE;
+	}
+
+	// delayMsec이 지나기 전에 실행되지 않도록 올림한다.
+	unsigned long long expireTick = (static_cast<unsigned long long>(GetNowMsec() - mBeginMsec) + delayMsec + TIMER_TICK_MSEC - 1) / TIMER_TICK_MSEC;
+
+	Monitor::Owner lock{ mSyncObject };
+
+	if (-1 == mFreeHead)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | TimingWheel::AddTimer() | timer node exhausted: max[%d] type[%d]",
+			mMaxTimerCnt,
+			timerType);
+
+		return INVALID_TIMER_HANDLE;
+	}
+
+	int index = mFreeHead;
+	TimerNode& node = mNodes[index];
+	mFreeHead = node.mNext;
+
+	node.mExpireTick = expireTick;
+	node.mListener = pListener;
+	node.mTimerType = timerType;
+	node.mParam = param;
+	node.mConnectionHandle = connectionHandle;
+
+	InsertNode(index);
+	++mTimerCnt;
+
+	return (static_cast<TimerHandle>(node.mGeneration) << 32) | static_cast<unsigned int>(index);
+}
+
+bool TimingWheel::CancelTimer(TimerHandle timerHandle)
+{
+	unsigned long long index = timerHandle & TIMER_INDEX_MASK;
+	unsigned int generation = static_cast<unsigned int>(timerHandle >> 32);
+
+	if (static_cast<unsigned long long>(mMaxTimerCnt) <= index)
+	{
+		return false;
+	}
+
+	Monitor::Owner lock{ mSyncObject };
+
+	TimerNode& node = mNodes[index];
+	if (-1 == node.mSlot || node.mGeneration != generation)
+	{
+		return false;
+	}
+
+	UnlinkNode(static_cast<int>(index));
+	FreeNode(static_cast<int>(index));
+
+	return true;
+}
+
+SleepAwaiter TimingWheel::Sleep(DWORD delayMsec)
+{
+	return SleepAwaiter{ this, delayMsec };
+}
+
+int TimingWheel::Advance()
+{
+	// worker thread 여럿이 동시에 호출하면 한 thread만 진행시키고 나머지는 IO 처리로 돌아간다.
+	if (0 != InterlockedCompareExchange64(&mIsAdvancing, 1, 0))
+	{
+		return 0;
+	}
+
+	unsigned long long elapsedTick = GetElapsedTick();
+
+	{
+		Monitor::Owner lock{ mSyncObject };
+
+		// 걸린 timer가 없으면 지나간 tick을 하나씩 돌 필요가 없다.
+		if (0 == mTimerCnt && mCurrentTick <= elapsedTick)
+		{
+			mCurrentTick = elapsedTick + 1;
+		}
+
+		while (mCurrentTick <= elapsedTick)
+		{
+			// 첫 번째 wheel이 한 바퀴 돌 때마다 상위 wheel의 다음 slot을 내려받는다.
+			if (0 == (mCurrentTick & (TIMER_ROOT_SLOT_CNT - 1)))
+			{
+				for (int level = 1; level < TIMER_LEVEL_CNT; ++level)
+				{
+					if (0 != Cascade(level))
+					{
+						break;
+					}
+				}
+			}
+
+			int slot = static_cast<int>(mCurrentTick & (TIMER_ROOT_SLOT_CNT - 1));
+			int index = mSlotHeads[slot];
+			mSlotHeads[slot] = -1;
+
+			while (-1 != index)
+			{
+				TimerNode& node = mNodes[index];
+				int next = node.mNext;
+
+				mExpiredTimers.push_back(ExpiredTimer{ node.mListener, node.mTimerType, node.mParam, node.mConnectionHandle });
+				FreeNode(index);
+
+				index = next;
+			}
+
+			++mCurrentTick;
+		}
+	}
+
+	// lock을 풀고 실행해야 OnTimer() 안에서 timer를 다시 걸 수 있다.
+	int firedCnt{ 0 };
+
+	for (ExpiredTimer& expiredTimer : mExpiredTimers)
+	{
+		if (INVALID_CONNECTION_HANDLE == expiredTimer.mConnectionHandle)
+		{
+			expiredTimer.mListener->OnTimer(nullptr, expiredTimer.mTimerType, expiredTimer.mParam);
+			++firedCnt;
+			continue;
+		}
+
+		// OnTimer()가 끝날 때까지 연결이 끊기지 않도록 Connection의 lock을 잡고 실행한다.
+		bool isFired = mConnectionManager->WithConnection(expiredTimer.mConnectionHandle, [&](Connection* pConnection)
+			{
+				expiredTimer.mListener->OnTimer(pConnection, expiredTimer.mTimerType, expiredTimer.mParam);
+			});
+
+		if (false == isFired)
+		{
+			InterlockedIncrement64(&mStaleCnt);
+			continue;
+		}
+
+		++firedCnt;
+	}
+
+	mExpiredTimers.clear();
+	InterlockedAdd64(&mFiredCnt, firedCnt);
+
+	InterlockedExchange64(&mIsAdvancing, 0);
+
+	return firedCnt;
+}
+
+int TimingWheel::GetTimerCount()
+{
+	return mTimerCnt;
+}
+
+LONG64 TimingWheel::GetFiredCount()
+{
+	return mFiredCnt;
+}
+
+LONG64 TimingWheel::GetStaleCount()
+{
+	return mStaleCnt;
+}
+
+void TimingWheel::InsertNode(int index)
+{
+	TimerNode& node = mNodes[index];
+
+	// 이미 지나간 tick이면 다음에 처리할 tick에 실행한다.
+	if (mCurrentTick > node.mExpireTick)
+	{
+		node.mExpireTick = mCurrentTick;
+	}
+
+	// wheel이 담을 수 있는 것보다 먼 timer는 마지막 slot에 두고
+	// 그 slot이 cascade될 때 남은 tick으로 다시 자리를 찾는다.
+	unsigned long long slotTick = node.mExpireTick;
+	unsigned long long delta = slotTick - mCurrentTick;
+	if (TIMER_MAX_DELAY_TICK <= delta)
+	{
+		delta = TIMER_MAX_DELAY_TICK - 1;
+		slotTick = mCurrentTick + delta;
+	}
+
+	int slot{ 0 };
+
+	if (TIMER_ROOT_SLOT_CNT > delta)
+	{
+		slot = static_cast<int>(slotTick & (TIMER_ROOT_SLOT_CNT - 1));
+	}
+	else
+	{
+		// 남은 tick 수가 들어가는 가장 작은 wheel을 찾는다.
+		int level{ 1 };
+		while (TIMER_LEVEL_CNT - 1 > level &&
+			(1ULL << (TIMER_ROOT_BITS + TIMER_LEVEL_BITS * level)) <= delta)
+		{
+			++level;
+		}
+
+		int shift = TIMER_ROOT_BITS + TIMER_LEVEL_BITS * (level - 1);
+		slot = TIMER_ROOT_SLOT_CNT + TIMER_LEVEL_SLOT_CNT * (level - 1) +
+			static_cast<int>((slotTick >> shift) & (TIMER_LEVEL_SLOT_CNT - 1));
+	}
+
+	node.mSlot = slot;
+	node.mPrev = -1;
+	node.mNext = mSlotHeads[slot];
+
+	if (-1 != node.mNext)
+	{
+		mNodes[node.mNext].mPrev = index;
+	}
+
+	mSlotHeads[slot] = index;
+}
+
+void TimingWheel::UnlinkNode(int index)
+{
+	TimerNode& node = mNodes[index];
+
+	if (-1 != node.mPrev)
+	{
+		mNodes[node.mPrev].mNext = node.mNext;
+	}
+	else
+	{
+		mSlotHeads[node.mSlot] = node.mNext;
+	}
+
+	if (-1 != node.mNext)
+	{
+		mNodes[node.mNext].mPrev = node.mPrev;
+	}
+}
+
+void TimingWheel::FreeNode(int index)
+{
+	TimerNode& node = mNodes[index];
+
+	// 세대가 바뀌어서 이전 handle로는 더 이상 취소할 수 없다.
+	// 0이 되면 handle이 INVALID_TIMER_HANDLE과 같아질 수 있어서 건너뛴다.
+	if (0 == ++node.mGeneration)
+	{
+		node.mGeneration = 1;
+	}
+
+	node.mSlot = -1;
+	node.mListener = nullptr;
+	node.mNext = mFreeHead;
+	mFreeHead = index;
+
+	--mTimerCnt;
+}
+
+int TimingWheel::Cascade(int level)
+{
+	int shift = TIMER_ROOT_BITS + TIMER_LEVEL_BITS * (level - 1);
+	int slotIndex = static_cast<int>((mCurrentTick >> shift) & (TIMER_LEVEL_SLOT_CNT - 1));
+	int slot = TIMER_ROOT_SLOT_CNT + TIMER_LEVEL_SLOT_CNT * (level - 1) + slotIndex;
+
+	int index = mSlotHeads[slot];
+	mSlotHeads[slot] = -1;
+
+	// 이 slot의 timer는 모두 지금부터 이 wheel의 slot 하나 크기 안에 만료되기 때문에
+	// 아래 wheel 어딘가로 들어간다.
+	while (-1 != index)
+	{
+		int next = mNodes[index].mNext;
+		InsertNode(index);
+		index = next;
+	}
+
+	return slotIndex;
+}
+
+unsigned long long TimingWheel::GetElapsedTick()
+{
+	return static_cast<unsigned long long>(GetNowMsec() - mBeginMsec) / TIMER_TICK_MSEC;
+}
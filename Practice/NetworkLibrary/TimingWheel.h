@@ -0,0 +1,178 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// connection timeout(idle, heartbeat, login)과 server timer를 관리하는 계층형 timing wheel
+//
+// 지금까지 timer는 Thread::TickThread()가 일정 간격으로 깨어나서 OnProcess()를 부르는 것 뿐이라
+// 5만 개 session의 timeout을 처리하려면 매번 모든 session을 훑어봐야 했다.
+//
+// timing wheel은 시간을 tick(TIMER_TICK_MSEC) 단위로 나누고 tick마다 slot 하나를 둔다.
+// timer는 만료될 tick의 slot 목록(이중 연결 list)에 넣기 때문에 등록과 취소가 O(1)이고
+// 시간이 흐르면 지나간 slot의 timer만 꺼내서 실행한다.
+// 가까운 timer는 첫 번째 wheel(256 slot = 2.56초)에 두고
+// 먼 timer는 더 큰 단위의 상위 wheel(64 slot씩)에 두었다가
+// 상위 wheel의 slot 차례가 오면 아래 wheel로 다시 나눠 넣는다(cascade).
+// 4단계로 2^26 tick(약 7.7일)까지 담을 수 있고
+// 그보다 먼 timer는 마지막 slot에 두었다가 cascade될 때 다시 자리를 찾는다.
+//
+// timer 노드는 Create()에서 미리 만들어둔 배열을 free list로 빌려주고
+// 노드의 index와 세대를 합친 64비트 handle(TimerHandle)로 취소한다.
+// 이미 실행되었거나 취소된 timer의 handle은 세대가 달라서 CancelTimer()가 false를 반환한다.
+//
+// timer는 ConnectionHandle을 대상으로 걸 수 있다.
+// 실행할 때 ConnectionManager::WithConnection()으로 Connection의 lock을 잡고 넘겨주고
+// 그 사이에 연결이 끊겼거나 다른 client가 사용중이면 실행하지 않는다.
+//
+// IOBackend::SetTimingWheel()로 등록하면 worker thread가 완료 통지를 처리한 뒤마다 Advance()를 호출한다.
+// 동시에 한 thread만 시간을 진행시키고 timer 실행은 lock 밖에서 하기 때문에
+// OnTimer() 안에서 AddTimer(), CancelTimer()를 호출해도 된다.
+
+#include <vector>
+
+#include "Platform.h"
+#include "Monitor.h"
+#include "Connection.h"
+
+class ConnectionManager;
+class SleepAwaiter;
+
+// timing wheel이 시간을 재는 단위(ms)
+constexpr int TIMER_TICK_MSEC{ 10 };
+
+// 첫 번째 wheel은 2^8 slot, 상위 wheel은 2^6 slot
+constexpr int TIMER_ROOT_BITS{ 8 };
+constexpr int TIMER_LEVEL_BITS{ 6 };
+constexpr int TIMER_ROOT_SLOT_CNT{ 1 << TIMER_ROOT_BITS };
+constexpr int TIMER_LEVEL_SLOT_CNT{ 1 << TIMER_LEVEL_BITS };
+constexpr int TIMER_LEVEL_CNT{ 4 };
+constexpr int TIMER_SLOT_CNT{ TIMER_ROOT_SLOT_CNT + TIMER_LEVEL_SLOT_CNT * (TIMER_LEVEL_CNT - 1) };
+
+// 0은 어떤 timer도 가리키지 않는다.
+using TimerHandle = unsigned long long;
+constexpr TimerHandle INVALID_TIMER_HANDLE{ 0 };
+
+// timer가 만료되면 호출되는 interface
+class NETLIB_API TimerListener
+{
+public:
+	virtual ~TimerListener() = default;
+
+	// pConnection: AddTimer()에 넘긴 ConnectionHandle의 Connection(connection timer가 아니면 nullptr)
+	// timerType, param: AddTimer()에 넘긴 값
+	virtual void OnTimer(Connection* pConnection, int timerType, LONG64 param) = 0;
+};
+
+class NETLIB_API TimingWheel
+{
+public:
+	TimingWheel();
+	~TimingWheel();
+
+public:
+	// maxTimerCnt: 동시에 걸어둘 수 있는 timer의 최대 개수
+	// pConnectionManager: ConnectionHandle로 Connection을 찾을 때 사용(connection timer를 쓰지 않으면 nullptr)
+	bool Create(int maxTimerCnt, ConnectionManager* pConnectionManager = nullptr);
+
+	// delayMsec 뒤에 pListener->OnTimer()를 호출한다.
+	// connectionHandle을 넘기면 그 client가 아직 연결되어 있을 때만 호출한다.
+	// timer 노드가 모자라면 INVALID_TIMER_HANDLE 반환
+	TimerHandle AddTimer(DWORD delayMsec, TimerListener* pListener, int timerType, LONG64 param = 0,
+		ConnectionHandle connectionHandle = INVALID_CONNECTION_HANDLE);
+
+	// 아직 실행되지 않은 timer를 취소한다.
+	// 이미 실행되었거나(실행중 포함) 취소된 timer라면 false
+	bool CancelTimer(TimerHandle timerHandle);
+
+	// coroutine 안에서 co_await로 delayMsec 동안 기다린다(Coroutine.h).
+	// 기다리는 동안 thread를 잡지 않고 timer 하나만 사용한다.
+	SleepAwaiter Sleep(DWORD delayMsec);
+
+	// 현재 시각까지 지나간 tick을 처리하고 만료된 timer를 실행한다.
+	// 다른 thread가 진행시키는 중이라면 기다리지 않고 바로 반환한다.
+	// 반환값은 실행한 timer 수
+	int Advance();
+
+public:
+	int GetTimerCount();
+
+	// 실행한 timer 수와
+	// 대상 connection이 이미 끊겨서 실행하지 않고 버린 timer 수
+	LONG64 GetFiredCount();
+	LONG64 GetStaleCount();
+
+public:
+	TimingWheel(const TimingWheel& rhs) = delete;
+	TimingWheel(TimingWheel&& rhs) = delete;
+
+	TimingWheel& operator=(const TimingWheel& rhs) = delete;
+	TimingWheel& operator=(TimingWheel&& rhs) = delete;
+
+private:
+	struct TimerNode
+	{
+		// slot 목록의 이전, 다음 노드 index(-1이면 끝)
+		// 쉬고 있는 노드는 mNext로 free list를 만든다.
+		int mPrev;
+		int mNext;
+
+		// 들어있는 slot(-1이면 쉬고 있다.)
+		int mSlot;
+		unsigned int mGeneration;
+
+		unsigned long long mExpireTick;
+
+		TimerListener* mListener;
+		int mTimerType;
+		LONG64 mParam;
+		ConnectionHandle mConnectionHandle;
+	};
+
+	// lock 밖에서 실행하려고 만료된 timer에서 복사해둔 정보
+	struct ExpiredTimer
+	{
+		TimerListener* mListener;
+		int mTimerType;
+		LONG64 mParam;
+		ConnectionHandle mConnectionHandle;
+	};
+
+private:
+	// 만료 tick에 맞는 slot에 노드를 넣는다.
+	void InsertNode(int index);
+	void UnlinkNode(int index);
+	void FreeNode(int index);
+
+	// level wheel의 현재 slot에 있는 노드를 아래 wheel로 다시 나눠 넣는다.
+	// 반환값은 처리한 slot 번호(0이면 그 위 wheel도 cascade할 차례)
+	int Cascade(int level);
+
+	// Create()한 시점부터 지난 tick 수
+	unsigned long long GetElapsedTick();
+
+private:
+	TimerNode* mNodes;
+	int mMaxTimerCnt;
+	int mFreeHead;
+	int mTimerCnt;
+
+	// slot마다 첫 노드 index(-1이면 비어있다.)
+	// [0, TIMER_ROOT_SLOT_CNT)가 첫 번째 wheel이고 그 뒤로 상위 wheel이 TIMER_LEVEL_SLOT_CNT개씩
+	int mSlotHeads[TIMER_SLOT_CNT];
+
+	// 다음에 처리할 tick
+	unsigned long long mCurrentTick;
+	LONG64 mBeginMsec;
+
+	ConnectionManager* mConnectionManager;
+
+	// 노드 배열과 slot을 보호한다.
+	Monitor mSyncObject;
+
+	// Advance()를 진행중인 thread가 있으면 1
+	LONG64 mIsAdvancing;
+	std::vector<ExpiredTimer> mExpiredTimers;
+
+	LONG64 mFiredCnt;
+	LONG64 mStaleCnt;
+};
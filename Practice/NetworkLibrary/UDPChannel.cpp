@@ -0,0 +1,504 @@
+﻿#include <algorithm>
+
+#include "Log.h"
+#include "UDPChannel.h"
+
+// 보낸 datagram 기록을 보관하는 개수(ack bits가 덮는 seq 수보다 넉넉하게)
+constexpr int UDP_SENT_DATAGRAM_CNT{ 1024 };
+
+// ack 하나가 알려주는 seq 수(ack bits)
+constexpr int UDP_ACK_BITS_CNT{ 32 };
+
+// ack 처리에 사용하는 mLane의 비트
+constexpr unsigned char UDP_LANE_MASK{ 0x7F };
+constexpr unsigned char UDP_ACK_VALID_FLAG{ 0x80 };
+constexpr unsigned char UDP_ACK_ONLY_LANE{ 0x7F };
+
+// 신뢰성 lane은 eUDPLane의 앞 두 개(ORDERED, UNORDERED)
+constexpr int UDP_RELIABLE_LANE_CNT{ 2 };
+
+constexpr LONG64 UDP_INITIAL_RTT_MSEC{ 100 };
+constexpr LONG64 UDP_MIN_RTO_MSEC{ 20 };
+constexpr LONG64 UDP_MAX_RTO_MSEC{ 1000 };
+
+// 16비트 순번이 한 바퀴 돌아도 비교할 수 있도록 차이의 부호로 판단한다.
+static bool IsNewerSeq(unsigned short lhs, unsigned short rhs)
+{
+	return 0 < static_cast<short>(lhs - rhs);
+}
+
+static bool IsReliableLane(unsigned char lane)
+{
+	return static_cast<unsigned char>(eUDPLane::LANE_RELIABLE_ORDERED) == lane ||
+		static_cast<unsigned char>(eUDPLane::LANE_RELIABLE_UNORDERED) == lane;
+}
+
+UDPChannel::UDPChannel()
+	: mSessionIndex{ 0 }
+	, mToken{ 0 }
+	, mConnectionHandle{ INVALID_CONNECTION_HANDLE }
+	, mNextSeq{ 0 }
+	, mSentDatagrams(UDP_SENT_DATAGRAM_CNT)
+	, mSendLanes{ new ReliableSendLane[UDP_RELIABLE_LANE_CNT]{} }
+	, mNextSequencedId{ 0 }
+	, mHasRemoteSeq{ false }
+	, mRemoteSeq{ 0 }
+	, mRemoteAckBits{ 0 }
+	, mIsAckPending{ false }
+	, mRecvSinceAckCnt{ 0 }
+	, mRecvOrderedId{ 0 }
+	, mRecvOrderedMessages{ new ReliableMessage[UDP_RELIABLE_WINDOW]{} }
+	, mRecvUnorderedId{ 0 }
+	, mRecvUnorderedFlags(UDP_RELIABLE_WINDOW, false)
+	, mHasRecvSequencedId{ false }
+	, mRecvSequencedId{ 0 }
+	, mRTTMsec{ UDP_INITIAL_RTT_MSEC }
+	, mResendCnt{ 0 }
+	, mOutBuffer{}
+	, mOutSizes{}
+	, mOutOffsets{}
+{
+}
+
+UDPChannel::~UDPChannel()
+{
+	delete[] mSendLanes;
+	delete[] mRecvOrderedMessages;
+}
+
+void UDPChannel::Initialize(unsigned int sessionIndex, unsigned long long token, ConnectionHandle connectionHandle)
+{
+	mSessionIndex = sessionIndex;
+	mToken = token;
+	mConnectionHandle = connectionHandle;
+
+	mNextSeq = 0;
+	for (SentDatagram& sentDatagram : mSentDatagrams)
+	{
+		sentDatagram.mIsValid = false;
+	}
+
+	// 보관하던 메시지의 buffer는 다음 session에서 다시 사용한다.
+	for (int lane = 0; lane < UDP_RELIABLE_LANE_CNT; ++lane)
+	{
+		mSendLanes[lane].mNextId = 0;
+		mSendLanes[lane].mOldestId = 0;
+
+		for (ReliableMessage& message : mSendLanes[lane].mMessages)
+		{
+			message.mIsUsed = false;
+		}
+	}
+
+	mNextSequencedId = 0;
+
+	mHasRemoteSeq = false;
+	mRemoteSeq = 0;
+	mRemoteAckBits = 0;
+	mIsAckPending = false;
+	mRecvSinceAckCnt = 0;
+
+	mRecvOrderedId = 0;
+	for (int i = 0; i < UDP_RELIABLE_WINDOW; ++i)
+	{
+		mRecvOrderedMessages[i].mIsUsed = false;
+	}
+
+	mRecvUnorderedId = 0;
+	mRecvUnorderedFlags.assign(UDP_RELIABLE_WINDOW, false);
+
+	mHasRecvSequencedId = false;
+	mRecvSequencedId = 0;
+
+	mRTTMsec = UDP_INITIAL_RTT_MSEC;
+	mResendCnt = 0;
+
+	ClearDatagrams();
+}
+
+bool UDPChannel::Send(eUDPLane lane, const char* pMessage, int size, LONG64 nowMsec)
+{
+	if (0 > size || UDP_MAX_MESSAGE_SIZE < size || eUDPLane::LANE_CNT <= lane)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | UDPChannel::Send() | invalid message, lane(%d) size(%d)",
+			static_cast<int>(lane),
+			size);
+
+		return false;
+	}
+
+	if (eUDPLane::LANE_UNRELIABLE_SEQUENCED == lane)
+	{
+		WriteDatagram(static_cast<unsigned char>(lane), mNextSequencedId++, pMessage, size, nowMsec);
+		return true;
+	}
+
+	// 받는 쪽의 window를 넘지 않도록 확인받지 못한 메시지 수를 제한한다.
+	ReliableSendLane& sendLane = mSendLanes[static_cast<int>(lane)];
+	if (UDP_RELIABLE_WINDOW <= static_cast<unsigned short>(sendLane.mNextId - sendLane.mOldestId))
+	{
+		return false;
+	}
+
+	unsigned short messageId = sendLane.mNextId++;
+
+	ReliableMessage& message = sendLane.mMessages[messageId % UDP_RELIABLE_WINDOW];
+	message.mId = messageId;
+	message.mIsUsed = true;
+	message.mLastSendMsec = nowMsec;
+	message.mData.assign(pMessage, pMessage + size);
+
+	WriteDatagram(static_cast<unsigned char>(lane), messageId, pMessage, size, nowMsec);
+	return true;
+}
+
+bool UDPChannel::OnDatagram(const char* pDatagram, int size, LONG64 nowMsec, UDPListener* pListener)
+{
+	if (UDP_HEADER_SIZE > size)
+	{
+		return false;
+	}
+
+	UDPHeader header{};
+	CopyMemory(&header, pDatagram, UDP_HEADER_SIZE);
+
+	unsigned char lane = header.mLane & UDP_LANE_MASK;
+	if (UDP_ACK_ONLY_LANE != lane && static_cast<unsigned char>(eUDPLane::LANE_CNT) <= lane)
+	{
+		return false;
+	}
+
+	// 상대가 받은 datagram을 확인 처리
+	if (0 != (header.mLane & UDP_ACK_VALID_FLAG))
+	{
+		AckDatagram(header.mAck, nowMsec);
+
+		for (int i = 0; i < UDP_ACK_BITS_CNT; ++i)
+		{
+			if (0 != (header.mAckBits & (1u << i)))
+			{
+				AckDatagram(static_cast<unsigned short>(header.mAck - 1 - i), nowMsec);
+			}
+		}
+	}
+
+	// ack만 담은 datagram에 다시 ack를 보내면 서로 끝없이 주고받게 된다.
+	if (UDP_ACK_ONLY_LANE == lane)
+	{
+		return true;
+	}
+
+	RecordRemoteSeq(header.mSeq);
+	mIsAckPending = true;
+
+	if (UDP_ACK_BITS_CNT <= ++mRecvSinceAckCnt)
+	{
+		WriteDatagram(UDP_ACK_ONLY_LANE, 0, nullptr, 0, nowMsec);
+	}
+
+	const char* pMessage = pDatagram + UDP_HEADER_SIZE;
+	int messageSize = size - UDP_HEADER_SIZE;
+
+	switch (static_cast<eUDPLane>(lane))
+	{
+	case eUDPLane::LANE_RELIABLE_ORDERED:
+		DeliverOrdered(header.mMessageId, pMessage, messageSize, pListener);
+		break;
+	case eUDPLane::LANE_RELIABLE_UNORDERED:
+		DeliverUnordered(header.mMessageId, pMessage, messageSize, pListener);
+		break;
+	default:
+		DeliverSequenced(header.mMessageId, pMessage, messageSize, pListener);
+		break;
+	}
+
+	return true;
+}
+
+void UDPChannel::Update(LONG64 nowMsec)
+{
+	LONG64 rtoMsec = GetRTOMsec();
+
+	for (int lane = 0; lane < UDP_RELIABLE_LANE_CNT; ++lane)
+	{
+		ReliableSendLane& sendLane = mSendLanes[lane];
+
+		for (unsigned short messageId = sendLane.mOldestId; messageId != sendLane.mNextId; ++messageId)
+		{
+			ReliableMessage& message = sendLane.mMessages[messageId % UDP_RELIABLE_WINDOW];
+			if (false == message.mIsUsed || rtoMsec > nowMsec - message.mLastSendMsec)
+			{
+				continue;
+			}
+
+			message.mLastSendMsec = nowMsec;
+			++mResendCnt;
+
+			WriteDatagram(static_cast<unsigned char>(lane), messageId,
+				message.mData.data(), static_cast<int>(message.mData.size()), nowMsec);
+		}
+	}
+
+	// 이번 간격에 보낸 datagram이 있다면 이미 ack를 실어 보냈다.
+	if (mIsAckPending)
+	{
+		WriteDatagram(UDP_ACK_ONLY_LANE, 0, nullptr, 0, nowMsec);
+	}
+}
+
+int UDPChannel::GetDatagramCount()
+{
+	return static_cast<int>(mOutSizes.size());
+}
+
+const char* UDPChannel::GetDatagram(int index, int* pSize)
+{
+	*pSize = mOutSizes[index];
+	return mOutBuffer.data() + mOutOffsets[index];
+}
+
+void UDPChannel::ClearDatagrams()
+{
+	mOutBuffer.clear();
+	mOutSizes.clear();
+	mOutOffsets.clear();
+}
+
+unsigned int UDPChannel::GetSessionIndex()
+{
+	return mSessionIndex;
+}
+
+unsigned long long UDPChannel::GetToken()
+{
+	return mToken;
+}
+
+ConnectionHandle UDPChannel::GetConnectionHandle()
+{
+	return mConnectionHandle;
+}
+
+LONG64 UDPChannel::GetRTTMsec()
+{
+	return mRTTMsec;
+}
+
+LONG64 UDPChannel::GetRTOMsec()
+{
+	// 상대는 ack를 최대 UDP_UPDATE_MSEC까지 모았다가 보낸다.
+	return std::clamp(mRTTMsec * 2 + UDP_UPDATE_MSEC, UDP_MIN_RTO_MSEC, UDP_MAX_RTO_MSEC);
+}
+
+LONG64 UDPChannel::GetResendCount()
+{
+	return mResendCnt;
+}
+
+int UDPChannel::GetUnackedCount()
+{
+	int unackedCnt{ 0 };
+
+	for (int lane = 0; lane < UDP_RELIABLE_LANE_CNT; ++lane)
+	{
+		ReliableSendLane& sendLane = mSendLanes[lane];
+
+		for (unsigned short messageId = sendLane.mOldestId; messageId != sendLane.mNextId; ++messageId)
+		{
+			if (sendLane.mMessages[messageId % UDP_RELIABLE_WINDOW].mIsUsed)
+			{
+				++unackedCnt;
+			}
+		}
+	}
+
+	return unackedCnt;
+}
+
+void UDPChannel::WriteDatagram(unsigned char lane, unsigned short messageId, const char* pMessage, int size, LONG64 nowMsec)
+{
+	unsigned short seq = mNextSeq++;
+
+	UDPHeader header{};
+	header.mSessionIndex = mSessionIndex;
+	header.mToken = mToken;
+	header.mSeq = seq;
+	header.mAck = mRemoteSeq;
+	header.mAckBits = mRemoteAckBits;
+	header.mLane = lane | (mHasRemoteSeq ? UDP_ACK_VALID_FLAG : 0);
+	header.mMessageId = messageId;
+
+	// 모든 datagram이 ack를 싣고 간다.
+	mIsAckPending = false;
+	mRecvSinceAckCnt = 0;
+
+	SentDatagram& sentDatagram = mSentDatagrams[seq % UDP_SENT_DATAGRAM_CNT];
+	sentDatagram.mSeq = seq;
+	sentDatagram.mIsValid = UDP_ACK_ONLY_LANE != lane;
+	sentDatagram.mLane = lane;
+	sentDatagram.mMessageId = messageId;
+	sentDatagram.mSendMsec = nowMsec;
+
+	size_t offset = mOutBuffer.size();
+	mOutBuffer.resize(offset + UDP_HEADER_SIZE + size);
+
+	CopyMemory(mOutBuffer.data() + offset, &header, UDP_HEADER_SIZE);
+	if (0 < size)
+	{
+		CopyMemory(mOutBuffer.data() + offset + UDP_HEADER_SIZE, pMessage, size);
+	}
+
+	mOutOffsets.push_back(static_cast<int>(offset));
+	mOutSizes.push_back(UDP_HEADER_SIZE + size);
+}
+
+void UDPChannel::RecordRemoteSeq(unsigned short seq)
+{
+	if (false == mHasRemoteSeq)
+	{
+		mHasRemoteSeq = true;
+		mRemoteSeq = seq;
+		mRemoteAckBits = 0;
+		return;
+	}
+
+	if (IsNewerSeq(seq, mRemoteSeq))
+	{
+		// 새 seq가 ack가 되고, 이전 ack는 ack bits로 밀려난다.
+		unsigned short shift = seq - mRemoteSeq;
+		mRemoteAckBits = UDP_ACK_BITS_CNT > shift ? mRemoteAckBits << shift : 0;
+		if (UDP_ACK_BITS_CNT >= shift)
+		{
+			mRemoteAckBits |= 1u << (shift - 1);
+		}
+
+		mRemoteSeq = seq;
+		return;
+	}
+
+	unsigned short distance = mRemoteSeq - seq;
+	if (1 <= distance && UDP_ACK_BITS_CNT >= distance)
+	{
+		mRemoteAckBits |= 1u << (distance - 1);
+	}
+}
+
+void UDPChannel::AckDatagram(unsigned short seq, LONG64 nowMsec)
+{
+	SentDatagram& sentDatagram = mSentDatagrams[seq % UDP_SENT_DATAGRAM_CNT];
+	if (false == sentDatagram.mIsValid || seq != sentDatagram.mSeq)
+	{
+		return;
+	}
+
+	// 같은 datagram의 ack는 여러 번 오지만 처음 한 번만 처리한다.
+	sentDatagram.mIsValid = false;
+
+	LONG64 rttMsec = nowMsec - sentDatagram.mSendMsec;
+	mRTTMsec = (mRTTMsec * 7 + rttMsec) / 8;
+
+	if (false == IsReliableLane(sentDatagram.mLane))
+	{
+		return;
+	}
+
+	ReliableSendLane& sendLane = mSendLanes[sentDatagram.mLane];
+
+	ReliableMessage& message = sendLane.mMessages[sentDatagram.mMessageId % UDP_RELIABLE_WINDOW];
+	if (false == message.mIsUsed || sentDatagram.mMessageId != message.mId)
+	{
+		return;
+	}
+
+	message.mIsUsed = false;
+
+	// 앞에서부터 확인받은 만큼 window를 민다.
+	while (sendLane.mOldestId != sendLane.mNextId &&
+		false == sendLane.mMessages[sendLane.mOldestId % UDP_RELIABLE_WINDOW].mIsUsed)
+	{
+		++sendLane.mOldestId;
+	}
+}
+
+void UDPChannel::DeliverOrdered(unsigned short messageId, const char* pMessage, int size, UDPListener* pListener)
+{
+	// 이미 전달했거나(다시 보낸 메시지) window 밖의 메시지
+	unsigned short distance = messageId - mRecvOrderedId;
+	if (UDP_RELIABLE_WINDOW <= distance)
+	{
+		return;
+	}
+
+	// 기다리던 메시지가 아니면 앞 메시지가 올 때까지 보관한다.
+	if (0 != distance)
+	{
+		ReliableMessage& message = mRecvOrderedMessages[messageId % UDP_RELIABLE_WINDOW];
+		if (false == message.mIsUsed)
+		{
+			message.mId = messageId;
+			message.mIsUsed = true;
+			message.mData.assign(pMessage, pMessage + size);
+		}
+
+		return;
+	}
+
+	pListener->OnUDPRecv(mConnectionHandle, eUDPLane::LANE_RELIABLE_ORDERED, const_cast<char*>(pMessage), size);
+	++mRecvOrderedId;
+
+	// 보관하던 다음 메시지들을 이어서 전달
+	while (true)
+	{
+		ReliableMessage& message = mRecvOrderedMessages[mRecvOrderedId % UDP_RELIABLE_WINDOW];
+		if (false == message.mIsUsed || mRecvOrderedId != message.mId)
+		{
+			break;
+		}
+
+		message.mIsUsed = false;
+		pListener->OnUDPRecv(mConnectionHandle, eUDPLane::LANE_RELIABLE_ORDERED,
+			message.mData.data(), static_cast<DWORD>(message.mData.size()));
+
+		++mRecvOrderedId;
+	}
+}
+
+void UDPChannel::DeliverUnordered(unsigned short messageId, const char* pMessage, int size, UDPListener* pListener)
+{
+	unsigned short distance = messageId - mRecvUnorderedId;
+	if (UDP_RELIABLE_WINDOW <= distance)
+	{
+		return;
+	}
+
+	int slot = messageId % UDP_RELIABLE_WINDOW;
+	if (mRecvUnorderedFlags[slot])
+	{
+		return;
+	}
+
+	mRecvUnorderedFlags[slot] = true;
+	pListener->OnUDPRecv(mConnectionHandle, eUDPLane::LANE_RELIABLE_UNORDERED, const_cast<char*>(pMessage), size);
+
+	// 앞에서부터 빠짐없이 받은 만큼 기준을 민다.
+	while (mRecvUnorderedFlags[mRecvUnorderedId % UDP_RELIABLE_WINDOW])
+	{
+		mRecvUnorderedFlags[mRecvUnorderedId % UDP_RELIABLE_WINDOW] = false;
+		++mRecvUnorderedId;
+	}
+}
+
+void UDPChannel::DeliverSequenced(unsigned short messageId, const char* pMessage, int size, UDPListener* pListener)
+{
+	// 늦게 도착한 오래된 값은 버린다.
+	if (mHasRecvSequencedId && false == IsNewerSeq(messageId, mRecvSequencedId))
+	{
+		return;
+	}
+
+	mHasRecvSequencedId = true;
+	mRecvSequencedId = messageId;
+
+	pListener->OnUDPRecv(mConnectionHandle, eUDPLane::LANE_UNRELIABLE_SEQUENCED, const_cast<char*>(pMessage), size);
+}
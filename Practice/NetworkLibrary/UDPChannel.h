@@ -0,0 +1,223 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// TCP Connection의 session에 붙여서 사용하는 UDP 신뢰성 계층(reliable UDP)
+//
+// 모든 gameplay 패킷이 TCP로 가면 segment 하나가 손실되었을 때
+// 재전송될 때까지 뒤의 이동 갱신이 모두 막힌다(head-of-line blocking).
+// 이동, 전투 event처럼 최신 값만 중요한 패킷은 UDP로 보내고 잃어버리면 다음 값을 쓰면 된다.
+//
+// lane(전달 방식)은 세 가지다.
+// - LANE_RELIABLE_ORDERED: 잃어버리면 다시 보내고 보낸 순서대로 전달(TCP와 같지만 이 lane만 막힌다.)
+// - LANE_RELIABLE_UNORDERED: 잃어버리면 다시 보내지만 도착하는 대로 전달
+// - LANE_UNRELIABLE_SEQUENCED: 다시 보내지 않고, 이미 전달한 것보다 오래된 메시지는 버린다.
+//
+// datagram 하나에 메시지 하나를 담고 datagram마다 16비트 순번(seq)을 붙인다.
+// 받은 쪽은 보내는 모든 datagram에 마지막으로 받은 seq(ack)와
+// 그 앞 32개 seq를 받았는지 표시한 bit(ack bits)를 실어서 보낸다(selective ack).
+// 그래서 ack 하나를 잃어버려도 뒤의 datagram이 다시 알려주고
+// 중간 하나만 빠졌다면 그 datagram에 담긴 메시지만 다시 보낸다.
+// 확인받지 못한 신뢰성 메시지는 RTO(측정한 RTT로 계산)가 지나면 새 seq로 다시 보낸다.
+// 보낼 것이 없는데 ack를 알려야 하면 Update()가 ack만 담은 datagram을 만든다.
+// 보내기 전에 32개보다 많이 받으면 앞의 seq가 ack bits 밖으로 밀려나기 때문에
+// 그 전에 ack만 담은 datagram을 바로 만든다.
+//
+// datagram 앞에는 session index와 token이 붙어있어서
+// UDPEndpoint는 주소 검색 없이 session을 찾고 token으로 다른 client의 datagram을 걸러낸다.
+//
+// 이 class는 socket을 사용하지 않는다.
+// 보낼 datagram은 내부 목록에 쌓아두고 UDPEndpoint(client는 자기 socket)가 꺼내서 보낸다.
+// 동기화를 하지 않기 때문에 여러 thread가 사용한다면 사용하는 쪽에서 lock을 걸어야 한다.
+
+#include <vector>
+
+#include "Platform.h"
+#include "Connection.h"
+
+enum class eUDPLane : unsigned char
+{
+	LANE_RELIABLE_ORDERED,
+	LANE_RELIABLE_UNORDERED,
+	LANE_UNRELIABLE_SEQUENCED,
+
+	LANE_CNT,
+};
+
+// IPv6 최소 MTU(1280)에서 IP, UDP header를 빼도 조각나지 않는 크기
+constexpr int UDP_MAX_DATAGRAM_SIZE{ 1232 };
+
+// 아직 확인받지 못한 신뢰성 메시지를 lane마다 몇 개까지 보낼 수 있는지
+constexpr int UDP_RELIABLE_WINDOW{ 256 };
+
+// Update()를 호출하는 간격(ms), ack가 늦어지는 최대 시간이기도 하다.
+constexpr int UDP_UPDATE_MSEC{ 10 };
+
+#pragma pack(push, 1)
+struct UDPHeader
+{
+	unsigned int mSessionIndex;
+	unsigned long long mToken;
+
+	unsigned short mSeq;
+	unsigned short mAck;
+
+	// bit i가 1이면 mAck - 1 - i를 받았다.
+	unsigned int mAckBits;
+
+	// 하위 7비트는 eUDPLane(ack만 담았다면 UDP_ACK_ONLY_LANE), 최상위 비트는 mAck가 유효한지
+	unsigned char mLane;
+	unsigned short mMessageId;
+};
+#pragma pack(pop)
+
+constexpr int UDP_HEADER_SIZE{ sizeof(UDPHeader) };
+constexpr int UDP_MAX_MESSAGE_SIZE{ UDP_MAX_DATAGRAM_SIZE - UDP_HEADER_SIZE };
+
+// UDP로 받은 메시지를 전달받는 interface
+class NETLIB_API UDPListener
+{
+public:
+	virtual ~UDPListener() = default;
+
+	// connectionHandle: 메시지를 보낸 session의 Connection(ConnectionManager::WithConnection()으로 사용한다.)
+	// pMessage: 보낸 쪽이 Send()에 넘긴 내용(UDP header는 빠져있다.)
+	// UDPEndpoint는 session lock을 잡은 채로 호출한다.
+	// 같은 session에 Send()하는 것은 괜찮지만, 다른 lock을 잡는 처리는 Strand 같은 곳으로 넘긴다.
+	virtual void OnUDPRecv(ConnectionHandle connectionHandle, eUDPLane lane, char* pMessage, DWORD size) = 0;
+};
+
+class NETLIB_API UDPChannel
+{
+public:
+	UDPChannel();
+	~UDPChannel();
+
+public:
+	// 새 session을 시작한다. 이전 session의 상태는 모두 지운다.
+	// sessionIndex, token: 보내는 datagram에 붙일 값(받은 datagram의 검사는 UDPEndpoint가 한다.)
+	void Initialize(unsigned int sessionIndex, unsigned long long token, ConnectionHandle connectionHandle);
+
+	// 메시지를 datagram으로 만들어서 보낼 목록에 넣는다.
+	// 메시지가 UDP_MAX_MESSAGE_SIZE보다 크거나 신뢰성 lane의 window가 가득 찼다면 false
+	bool Send(eUDPLane lane, const char* pMessage, int size, LONG64 nowMsec);
+
+	// 받은 datagram을 처리하고 전달할 메시지를 pListener에게 넘긴다.
+	// 형식이 맞지 않으면 false(token 검사는 하지 않는다.)
+	bool OnDatagram(const char* pDatagram, int size, LONG64 nowMsec, UDPListener* pListener);
+
+	// RTO가 지난 신뢰성 메시지를 다시 보내고, 알려야 할 ack가 남았다면 ack만 담은 datagram을 만든다.
+	// 일정한 간격(UDP_UPDATE_MSEC)으로 호출한다.
+	void Update(LONG64 nowMsec);
+
+public:
+	// 보낼 datagram 목록
+	int GetDatagramCount();
+	const char* GetDatagram(int index, int* pSize);
+	void ClearDatagrams();
+
+public:
+	unsigned int GetSessionIndex();
+	unsigned long long GetToken();
+	ConnectionHandle GetConnectionHandle();
+
+	LONG64 GetRTTMsec();
+	LONG64 GetRTOMsec();
+	LONG64 GetResendCount();
+
+	// 확인받지 못한 신뢰성 메시지 수(모든 lane)
+	int GetUnackedCount();
+
+public:
+	UDPChannel(const UDPChannel& rhs) = delete;
+	UDPChannel(UDPChannel&& rhs) = delete;
+
+	UDPChannel& operator=(const UDPChannel& rhs) = delete;
+	UDPChannel& operator=(UDPChannel&& rhs) = delete;
+
+private:
+	// 보낸 datagram의 기록(ack가 오면 담았던 메시지를 확인 처리)
+	struct SentDatagram
+	{
+		unsigned short mSeq;
+		bool mIsValid;
+		unsigned char mLane;
+		unsigned short mMessageId;
+		LONG64 mSendMsec;
+	};
+
+	// 신뢰성 메시지 하나(보내는 쪽은 확인받을 때까지, 받는 쪽은 순서가 올 때까지 보관)
+	struct ReliableMessage
+	{
+		unsigned short mId;
+		bool mIsUsed;
+		LONG64 mLastSendMsec;
+		std::vector<char> mData;
+	};
+
+	// 신뢰성 lane 하나의 송신 상태
+	struct ReliableSendLane
+	{
+		unsigned short mNextId;
+
+		// 가장 오래된 확인받지 못한 메시지(mNextId와 같으면 모두 확인받았다.)
+		unsigned short mOldestId;
+
+		ReliableMessage mMessages[UDP_RELIABLE_WINDOW];
+	};
+
+private:
+	void WriteDatagram(unsigned char lane, unsigned short messageId, const char* pMessage, int size, LONG64 nowMsec);
+
+	// 받은 datagram의 seq를 ack, ack bits에 반영한다.
+	void RecordRemoteSeq(unsigned short seq);
+
+	// 상대가 seq를 받았다고 알려왔다.
+	void AckDatagram(unsigned short seq, LONG64 nowMsec);
+
+	void DeliverOrdered(unsigned short messageId, const char* pMessage, int size, UDPListener* pListener);
+	void DeliverUnordered(unsigned short messageId, const char* pMessage, int size, UDPListener* pListener);
+	void DeliverSequenced(unsigned short messageId, const char* pMessage, int size, UDPListener* pListener);
+
+private:
+	unsigned int mSessionIndex;
+	unsigned long long mToken;
+	ConnectionHandle mConnectionHandle;
+
+	unsigned short mNextSeq;
+	std::vector<SentDatagram> mSentDatagrams;
+
+	// 신뢰성 lane(ORDERED, UNORDERED)의 송신 상태
+	ReliableSendLane* mSendLanes;
+	unsigned short mNextSequencedId;
+
+	// 상대에게 알려줄 ack
+	bool mHasRemoteSeq;
+	unsigned short mRemoteSeq;
+	unsigned int mRemoteAckBits;
+	bool mIsAckPending;
+
+	// 마지막으로 ack를 실어 보낸 뒤에 받은 datagram 수
+	int mRecvSinceAckCnt;
+
+	// LANE_RELIABLE_ORDERED: 다음에 전달할 id와 먼저 도착해서 기다리는 메시지
+	unsigned short mRecvOrderedId;
+	ReliableMessage* mRecvOrderedMessages;
+
+	// LANE_RELIABLE_UNORDERED: 이 id 앞은 모두 전달했고, 뒤는 mRecvUnorderedFlags로 전달 여부를 기억한다.
+	unsigned short mRecvUnorderedId;
+	std::vector<bool> mRecvUnorderedFlags;
+
+	// LANE_UNRELIABLE_SEQUENCED: 마지막으로 전달한 id
+	bool mHasRecvSequencedId;
+	unsigned short mRecvSequencedId;
+
+	// RTT는 지수 이동 평균
+	LONG64 mRTTMsec;
+	LONG64 mResendCnt;
+
+	// 보낼 datagram을 이어 붙인 buffer와 각 datagram의 크기
+	std::vector<char> mOutBuffer;
+	std::vector<int> mOutSizes;
+	std::vector<int> mOutOffsets;
+};
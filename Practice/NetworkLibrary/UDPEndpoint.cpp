@@ -0,0 +1,580 @@
+﻿#include <chrono>
+#include <random>
+
+#ifdef _WIN32
+#include <process.h>
+#endif
+
+#include "Log.h"
+#include "UDPEndpoint.h"
+
+static LONG64 GetNowMsec()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// token은 다른 client가 session을 가로채지 못하게 하는 용도라 예측하기 어렵기만 하면 된다.
+static unsigned long long NextToken(unsigned long long* pSeed)
+{
+	// splitmix64
+	unsigned long long value = (*pSeed += 0x9E3779B97F4A7C15ULL);
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+#ifdef _WIN32
+unsigned int WINAPI CallUDPThread(LPVOID p)
+#else
+void* CallUDPThread(void* p)
+#endif
+{
+	UDPEndpoint* pUDPEndpoint = reinterpret_cast<UDPEndpoint*>(p);
+
+	pUDPEndpoint->UDPThread();
+
+#ifdef _WIN32
+	return 0;
+#else
+	return nullptr;
+#endif
+}
+
+UDPEndpoint::UDPEndpoint()
+	: mSocket{ INVALID_SOCKET }
+	, mListener{ nullptr }
+	, mSessions{ nullptr }
+	, mSessionCnt{ 0 }
+	, mDirtySessions{}
+	, mDirtySyncObject{}
+	, mFlushSessions{}
+	, mBatchBuffer{ nullptr }
+	, mBatchSizes{}
+	, mBatchAddresses{}
+	, mBatchCnt{ 0 }
+	, mFlushSyncObject{}
+	, mTokenSeed{ 0 }
+	, mTokenSyncObject{}
+	, mUDPThread{}
+	, mIsThreadCreated{ false }
+	, mIsQuit{ false }
+	, mSendDatagramCnt{ 0 }
+	, mRecvDatagramCnt{ 0 }
+	, mSendSyscallCnt{ 0 }
+	, mRecvSyscallCnt{ 0 }
+	, mResendCnt{ 0 }
+{
+}
+
+UDPEndpoint::~UDPEndpoint()
+{
+	Destroy();
+}
+
+bool UDPEndpoint::Create(unsigned short port, int maxSessionCnt, UDPListener* pListener)
+{
+	if (0 >= maxSessionCnt || nullptr == pListener)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | UDPEndpoint::Create() | invalid parameter, maxSessionCnt(%d)",
+			maxSessionCnt);
+
+		return false;
+	}
+
+	mSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (INVALID_SOCKET == mSocket)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | UDPEndpoint::Create() | socket() failed: %d",
+			WSAGetLastError());
+
+		return false;
+	}
+
+	// 많은 session의 datagram이 한꺼번에 몰려도 버려지지 않도록 kernel buffer를 키운다.
+	int socketBufSize{ 4 * 1024 * 1024 };
+	setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&socketBufSize), sizeof(socketBufSize));
+	setsockopt(mSocket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&socketBufSize), sizeof(socketBufSize));
+
+	// 받을 것이 없어도 UDP_UPDATE_MSEC마다 깨어나서 재전송, ack를 처리한다.
+#ifdef _WIN32
+	DWORD recvTimeout{ UDP_UPDATE_MSEC };
+#else
+	timeval recvTimeout{ 0, UDP_UPDATE_MSEC * 1000 };
+#endif
+	setsockopt(mSocket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&recvTimeout), sizeof(recvTimeout));
+
+	SOCKADDR_IN address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (SOCKET_ERROR == bind(mSocket, reinterpret_cast<SOCKADDR*>(&address), sizeof(address)))
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | UDPEndpoint::Create() | bind() failed: %d",
+			WSAGetLastError());
+
+		Destroy();
+		return false;
+	}
+
+	mListener = pListener;
+	mSessions = new UDPSession[maxSessionCnt]{};
+	mSessionCnt = maxSessionCnt;
+	mBatchBuffer = new char[UDP_BATCH_CNT * UDP_MAX_DATAGRAM_SIZE];
+	mBatchCnt = 0;
+
+	std::random_device randomDevice;
+	mTokenSeed = (static_cast<unsigned long long>(randomDevice()) << 32) ^ randomDevice() ^ GetNowMsec();
+
+	mIsQuit.store(false);
+
+#ifdef _WIN32
+	unsigned int threadID{ 0 };
+
+	mUDPThread = reinterpret_cast<HANDLE>(_beginthreadex(
+		NULL,
+		0,
+		CallUDPThread,
+		this,
+		0,
+		&threadID));
+
+	mIsThreadCreated = NULL != mUDPThread;
+#else
+	mIsThreadCreated = 0 == pthread_create(&mUDPThread, nullptr, CallUDPThread, this);
+#endif
+
+	if (false == mIsThreadCreated)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | UDPEndpoint::Create() | UDPThread 생성 실패: Error(%lu)",
+			GetLastError());
+
+		Destroy();
+		return false;
+	}
+
+	return true;
+}
+
+void UDPEndpoint::Destroy()
+{
+	// UDP thread는 UDP_UPDATE_MSEC 안에 종료 요청을 확인한다.
+	mIsQuit.store(true);
+
+	if (mIsThreadCreated)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(mUDPThread, INFINITE);
+		CloseHandle(mUDPThread);
+#else
+		pthread_join(mUDPThread, nullptr);
+#endif
+		mIsThreadCreated = false;
+	}
+
+	if (INVALID_SOCKET != mSocket)
+	{
+		closesocket(mSocket);
+		mSocket = INVALID_SOCKET;
+	}
+
+	delete[] mSessions;
+	mSessions = nullptr;
+	mSessionCnt = 0;
+
+	delete[] mBatchBuffer;
+	mBatchBuffer = nullptr;
+
+	mDirtySessions.clear();
+	mListener = nullptr;
+}
+
+unsigned long long UDPEndpoint::BindSession(Connection* pConnection)
+{
+	int sessionIndex = pConnection->GetIndex();
+	if (0 > sessionIndex || mSessionCnt <= sessionIndex)
+	{
+		LOG(eLogInfoType::LOG_ERROR_NORMAL,
+			L"SYSTEM | UDPEndpoint::BindSession() | invalid session index(%d)",
+			sessionIndex);
+
+		return 0;
+	}
+
+	unsigned long long token{ 0 };
+	{
+		Monitor::Owner lock{ mTokenSyncObject };
+
+		// 0은 session이 없다는 뜻으로 사용한다.
+		while (0 == token)
+		{
+			token = NextToken(&mTokenSeed);
+		}
+	}
+
+	UDPSession& session = mSessions[sessionIndex];
+
+	Monitor::Owner lock{ session.mSyncObject };
+	session.mChannel.Initialize(static_cast<unsigned int>(sessionIndex), token, pConnection->GetHandle());
+	session.mIsBound = true;
+	session.mHasAddress = false;
+
+	return token;
+}
+
+void UDPEndpoint::UnbindSession(Connection* pConnection)
+{
+	int sessionIndex = pConnection->GetIndex();
+	if (0 > sessionIndex || mSessionCnt <= sessionIndex)
+	{
+		return;
+	}
+
+	UDPSession& session = mSessions[sessionIndex];
+
+	// 이전 client의 token으로 온 datagram은 OnDatagram()에서 걸러진다.
+	Monitor::Owner lock{ session.mSyncObject };
+	session.mChannel.Initialize(static_cast<unsigned int>(sessionIndex), 0, INVALID_CONNECTION_HANDLE);
+	session.mIsBound = false;
+	session.mHasAddress = false;
+}
+
+bool UDPEndpoint::Send(Connection* pConnection, eUDPLane lane, const char* pMessage, int size)
+{
+	int sessionIndex = pConnection->GetIndex();
+	if (0 > sessionIndex || mSessionCnt <= sessionIndex)
+	{
+		return false;
+	}
+
+	UDPSession& session = mSessions[sessionIndex];
+
+	Monitor::Owner lock{ session.mSyncObject };
+
+	// 연결이 끊기고 다른 client가 같은 Connection을 사용중일 수 있다.
+	if (false == session.mIsBound || pConnection->GetHandle() != session.mChannel.GetConnectionHandle())
+	{
+		return false;
+	}
+
+	if (false == session.mChannel.Send(lane, pMessage, size, GetNowMsec()))
+	{
+		return false;
+	}
+
+	MarkDirty(sessionIndex);
+	return true;
+}
+
+void UDPEndpoint::Flush()
+{
+	Monitor::Owner lock{ mFlushSyncObject };
+
+	{
+		Monitor::Owner dirtyLock{ mDirtySyncObject };
+		mFlushSessions.swap(mDirtySessions);
+	}
+
+	for (int sessionIndex : mFlushSessions)
+	{
+		UDPSession& session = mSessions[sessionIndex];
+
+		Monitor::Owner sessionLock{ session.mSyncObject };
+		session.mIsDirty = false;
+
+		if (session.mIsBound && session.mHasAddress)
+		{
+			for (int i = 0; i < session.mChannel.GetDatagramCount(); ++i)
+			{
+				if (UDP_BATCH_CNT == mBatchCnt)
+				{
+					SendBatch();
+				}
+
+				int size{ 0 };
+				const char* pDatagram = session.mChannel.GetDatagram(i, &size);
+
+				CopyMemory(mBatchBuffer + mBatchCnt * UDP_MAX_DATAGRAM_SIZE, pDatagram, size);
+				mBatchSizes[mBatchCnt] = size;
+				mBatchAddresses[mBatchCnt] = session.mAddress;
+				++mBatchCnt;
+			}
+		}
+
+		session.mChannel.ClearDatagrams();
+	}
+
+	mFlushSessions.clear();
+
+	SendBatch();
+}
+
+LONG64 UDPEndpoint::GetSendDatagramCount()
+{
+	return mSendDatagramCnt;
+}
+
+LONG64 UDPEndpoint::GetRecvDatagramCount()
+{
+	return mRecvDatagramCnt;
+}
+
+LONG64 UDPEndpoint::GetSendSyscallCount()
+{
+	return mSendSyscallCnt;
+}
+
+LONG64 UDPEndpoint::GetRecvSyscallCount()
+{
+	return mRecvSyscallCnt;
+}
+
+LONG64 UDPEndpoint::GetResendCount()
+{
+	return mResendCnt;
+}
+
+LONG64 UDPEndpoint::GetRTTMsec(Connection* pConnection)
+{
+	int sessionIndex = pConnection->GetIndex();
+	if (0 > sessionIndex || mSessionCnt <= sessionIndex)
+	{
+		return -1;
+	}
+
+	UDPSession& session = mSessions[sessionIndex];
+
+	Monitor::Owner lock{ session.mSyncObject };
+	if (false == session.mIsBound || pConnection->GetHandle() != session.mChannel.GetConnectionHandle())
+	{
+		return -1;
+	}
+
+	return session.mChannel.GetRTTMsec();
+}
+
+void UDPEndpoint::UDPThread()
+{
+	char* pRecvBuffer = new char[UDP_BATCH_CNT * UDP_MAX_DATAGRAM_SIZE];
+	SOCKADDR_IN recvAddresses[UDP_BATCH_CNT]{};
+
+#ifndef _WIN32
+	mmsghdr recvMessages[UDP_BATCH_CNT]{};
+	iovec recvIovecs[UDP_BATCH_CNT]{};
+#endif
+
+	LONG64 lastUpdateMsec = GetNowMsec();
+
+	while (false == mIsQuit.load())
+	{
+#ifdef _WIN32
+		int addressLength{ sizeof(SOCKADDR_IN) };
+		int recvSize = recvfrom(mSocket, pRecvBuffer, UDP_MAX_DATAGRAM_SIZE, 0,
+			reinterpret_cast<SOCKADDR*>(&recvAddresses[0]), &addressLength);
+
+		int recvCnt{ 0 };
+		if (SOCKET_ERROR != recvSize)
+		{
+			recvCnt = 1;
+		}
+#else
+		for (int i = 0; i < UDP_BATCH_CNT; ++i)
+		{
+			recvIovecs[i].iov_base = pRecvBuffer + i * UDP_MAX_DATAGRAM_SIZE;
+			recvIovecs[i].iov_len = UDP_MAX_DATAGRAM_SIZE;
+
+			recvMessages[i].msg_hdr.msg_name = &recvAddresses[i];
+			recvMessages[i].msg_hdr.msg_namelen = sizeof(SOCKADDR_IN);
+			recvMessages[i].msg_hdr.msg_iov = &recvIovecs[i];
+			recvMessages[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		// 첫 datagram이 올 때까지만(SO_RCVTIMEO까지) 기다리고 나머지는 이미 와있는 만큼 가져온다.
+		int recvCnt = recvmmsg(mSocket, recvMessages, UDP_BATCH_CNT, MSG_WAITFORONE, nullptr);
+		if (0 > recvCnt)
+		{
+			recvCnt = 0;
+		}
+#endif
+
+		InterlockedIncrement64(&mRecvSyscallCnt);
+
+		LONG64 nowMsec = GetNowMsec();
+
+		for (int i = 0; i < recvCnt; ++i)
+		{
+#ifdef _WIN32
+			OnDatagram(pRecvBuffer, recvSize, recvAddresses[0], nowMsec);
+#else
+			OnDatagram(pRecvBuffer + i * UDP_MAX_DATAGRAM_SIZE, static_cast<int>(recvMessages[i].msg_len), recvAddresses[i], nowMsec);
+#endif
+		}
+
+		InterlockedAdd64(&mRecvDatagramCnt, recvCnt);
+
+		if (UDP_UPDATE_MSEC <= nowMsec - lastUpdateMsec)
+		{
+			lastUpdateMsec = nowMsec;
+
+			UpdateSessions(nowMsec);
+			Flush();
+		}
+	}
+
+	delete[] pRecvBuffer;
+}
+
+void UDPEndpoint::OnDatagram(const char* pDatagram, int size, const SOCKADDR_IN& address, LONG64 nowMsec)
+{
+	if (UDP_HEADER_SIZE > size)
+	{
+		return;
+	}
+
+	UDPHeader header{};
+	CopyMemory(&header, pDatagram, UDP_HEADER_SIZE);
+
+	if (static_cast<unsigned int>(mSessionCnt) <= header.mSessionIndex)
+	{
+		return;
+	}
+
+	UDPSession& session = mSessions[header.mSessionIndex];
+
+	Monitor::Owner lock{ session.mSyncObject };
+
+	// 끊긴 session이나 다른 client의 datagram
+	if (false == session.mIsBound || session.mChannel.GetToken() != header.mToken)
+	{
+		return;
+	}
+
+	if (false == session.mChannel.OnDatagram(pDatagram, size, nowMsec, mListener))
+	{
+		return;
+	}
+
+	// token이 맞으면 보낸 주소를 session 주소로 사용한다(client의 NAT 주소가 바뀌어도 따라간다).
+	session.mAddress = address;
+	session.mHasAddress = true;
+
+	// OnUDPRecv()에서 Send()했다면 이미 목록에 들어있다.
+	if (0 < session.mChannel.GetDatagramCount())
+	{
+		MarkDirty(static_cast<int>(header.mSessionIndex));
+	}
+}
+
+void UDPEndpoint::UpdateSessions(LONG64 nowMsec)
+{
+	for (int sessionIndex = 0; sessionIndex < mSessionCnt; ++sessionIndex)
+	{
+		UDPSession& session = mSessions[sessionIndex];
+
+		Monitor::Owner lock{ session.mSyncObject };
+		if (false == session.mIsBound)
+		{
+			continue;
+		}
+
+		LONG64 beginResendCnt = session.mChannel.GetResendCount();
+		session.mChannel.Update(nowMsec);
+
+		LONG64 resendCnt = session.mChannel.GetResendCount() - beginResendCnt;
+		if (0 < resendCnt)
+		{
+			InterlockedAdd64(&mResendCnt, resendCnt);
+		}
+
+		if (0 < session.mChannel.GetDatagramCount())
+		{
+			MarkDirty(sessionIndex);
+		}
+	}
+}
+
+void UDPEndpoint::MarkDirty(int sessionIndex)
+{
+	UDPSession& session = mSessions[sessionIndex];
+	if (session.mIsDirty)
+	{
+		return;
+	}
+
+	session.mIsDirty = true;
+
+	Monitor::Owner lock{ mDirtySyncObject };
+	mDirtySessions.push_back(sessionIndex);
+}
+
+void UDPEndpoint::SendBatch()
+{
+	if (0 == mBatchCnt)
+	{
+		return;
+	}
+
+	int sendCnt{ 0 };
+
+#ifdef _WIN32
+	for (int i = 0; i < mBatchCnt; ++i)
+	{
+		int ret = sendto(mSocket, mBatchBuffer + i * UDP_MAX_DATAGRAM_SIZE, mBatchSizes[i], 0,
+			reinterpret_cast<SOCKADDR*>(&mBatchAddresses[i]), sizeof(SOCKADDR_IN));
+
+		InterlockedIncrement64(&mSendSyscallCnt);
+
+		if (SOCKET_ERROR != ret)
+		{
+			++sendCnt;
+		}
+	}
+#else
+	mmsghdr sendMessages[UDP_BATCH_CNT]{};
+	iovec sendIovecs[UDP_BATCH_CNT]{};
+
+	for (int i = 0; i < mBatchCnt; ++i)
+	{
+		sendIovecs[i].iov_base = mBatchBuffer + i * UDP_MAX_DATAGRAM_SIZE;
+		sendIovecs[i].iov_len = mBatchSizes[i];
+
+		sendMessages[i].msg_hdr.msg_name = &mBatchAddresses[i];
+		sendMessages[i].msg_hdr.msg_namelen = sizeof(SOCKADDR_IN);
+		sendMessages[i].msg_hdr.msg_iov = &sendIovecs[i];
+		sendMessages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	// sendmmsg()는 일부만 보내고 반환할 수 있다.
+	while (mBatchCnt > sendCnt)
+	{
+		int ret = sendmmsg(mSocket, sendMessages + sendCnt, mBatchCnt - sendCnt, 0);
+
+		InterlockedIncrement64(&mSendSyscallCnt);
+
+		if (0 > ret)
+		{
+			if (EINTR == errno)
+			{
+				continue;
+			}
+
+			// UDP는 원래 손실될 수 있으니 남은 datagram은 버리고 신뢰성 메시지는 재전송에 맡긴다.
+			LOG(eLogInfoType::LOG_ERROR_NORMAL,
+				L"SYSTEM | UDPEndpoint::SendBatch() | sendmmsg() failed: %d",
+				errno);
+
+			break;
+		}
+
+		sendCnt += ret;
+	}
+#endif
+
+	InterlockedAdd64(&mSendDatagramCnt, sendCnt);
+	mBatchCnt = 0;
+}
@@ -0,0 +1,153 @@
+﻿#pragma once
+
+// 2026 10 18 이정모 home
+
+// server의 UDP socket 하나로 모든 session의 UDPChannel을 송수신하는 endpoint
+//
+// TCP Connection마다 UDPChannel 하나를 붙인다(Connection의 index를 session index로 사용).
+// 1. 접속을 수락하면 BindSession()으로 token을 받아서 TCP로 client에게 보낸다.
+// 2. client는 UDP datagram에 session index와 token을 붙여서 보낸다.
+//    token이 맞는 datagram이 오면 그 주소를 session의 주소로 기억한다(NAT가 port를 바꾸면 따라간다).
+// 3. 연결이 끊기면 OnClose()에서 UnbindSession()을 호출한다.
+//
+// 수신은 UDP thread 하나가 하고 받은 메시지는 그 thread에서 UDPListener::OnUDPRecv()로 넘긴다.
+// Linux에서는 recvmmsg()로 한 번에 여러 datagram을 받는다.
+// 송신은 Send()가 channel의 목록에 쌓아두고 Flush()에서 모아서 보낸다.
+// Linux에서는 sendmmsg()로 여러 session의 datagram을 한 번의 시스템 콜로 보낸다.
+// game tick이 끝날 때 Flush()를 호출하고
+// UDP thread도 UDP_UPDATE_MSEC마다 재전송, ack를 만들고 Flush()한다.
+//
+// Windows에서는 recvfrom(), sendto()를 datagram마다 호출한다.
+
+#include <atomic>
+#include <vector>
+
+#include "Platform.h"
+#include "Monitor.h"
+#include "Connection.h"
+#include "UDPChannel.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// recvmmsg(), sendmmsg() 한 번에 처리하는 최대 datagram 수
+constexpr int UDP_BATCH_CNT{ 64 };
+
+class NETLIB_API UDPEndpoint
+{
+public:
+	UDPEndpoint();
+	~UDPEndpoint();
+
+public:
+	// port에 UDP socket을 bind하고 UDP thread를 만든다.
+	// maxSessionCnt: Connection 수(session index는 Connection::GetIndex())
+	bool Create(unsigned short port, int maxSessionCnt, UDPListener* pListener);
+	void Destroy();
+
+public:
+	// pConnection의 session에 새 channel을 붙이고 client에게 알려줄 token을 반환한다(실패하면 0).
+	unsigned long long BindSession(Connection* pConnection);
+	void UnbindSession(Connection* pConnection);
+
+	// pConnection의 channel로 메시지를 보낸다. 실제 송신은 Flush()에서 한다.
+	// session이 없거나(다른 client가 사용중) 메시지를 넣지 못하면 false
+	bool Send(Connection* pConnection, eUDPLane lane, const char* pMessage, int size);
+
+	// Send()로 쌓인 datagram을 모아서 보낸다.
+	// 아직 client 주소를 모르는 session의 datagram은 버린다(신뢰성 메시지는 나중에 다시 보낸다).
+	void Flush();
+
+public:
+	LONG64 GetSendDatagramCount();
+	LONG64 GetRecvDatagramCount();
+	LONG64 GetSendSyscallCount();
+	LONG64 GetRecvSyscallCount();
+	LONG64 GetResendCount();
+
+	// session의 현재 RTT(ms), session이 없으면 -1
+	LONG64 GetRTTMsec(Connection* pConnection);
+
+public:
+	UDPEndpoint(const UDPEndpoint& rhs) = delete;
+	UDPEndpoint(UDPEndpoint&& rhs) = delete;
+
+	UDPEndpoint& operator=(const UDPEndpoint& rhs) = delete;
+	UDPEndpoint& operator=(UDPEndpoint&& rhs) = delete;
+
+private:
+	struct UDPSession
+	{
+		UDPChannel mChannel;
+
+		// BindSession()하지 않았다면 false
+		bool mIsBound;
+
+		// client 주소를 알게 되었는지
+		bool mHasAddress;
+		SOCKADDR_IN mAddress;
+
+		// 보낼 datagram이 있어서 mDirtySessions에 들어있는지
+		bool mIsDirty;
+
+		Monitor mSyncObject;
+	};
+
+private:
+#ifdef _WIN32
+	friend unsigned int WINAPI CallUDPThread(LPVOID p);
+#else
+	friend void* CallUDPThread(void* p);
+#endif
+
+	void UDPThread();
+
+	// 받은 datagram 하나를 session에 넘긴다.
+	void OnDatagram(const char* pDatagram, int size, const SOCKADDR_IN& address, LONG64 nowMsec);
+
+	// 모든 session의 재전송, ack를 처리한다.
+	void UpdateSessions(LONG64 nowMsec);
+
+	// 보낼 datagram이 생긴 session을 Flush() 목록에 넣는다(session lock을 잡고 호출).
+	void MarkDirty(int sessionIndex);
+
+	// 모아둔 datagram을 보낸다(mFlushSyncObject를 잡고 호출).
+	void SendBatch();
+
+private:
+	SOCKET mSocket;
+	UDPListener* mListener;
+
+	UDPSession* mSessions;
+	int mSessionCnt;
+
+	std::vector<int> mDirtySessions;
+	Monitor mDirtySyncObject;
+
+	// Flush()에서 보낼 datagram을 복사해두는 곳(동시에 한 thread만 Flush()한다.)
+	std::vector<int> mFlushSessions;
+	char* mBatchBuffer;
+	int mBatchSizes[UDP_BATCH_CNT];
+	SOCKADDR_IN mBatchAddresses[UDP_BATCH_CNT];
+	int mBatchCnt;
+	Monitor mFlushSyncObject;
+
+	// token을 만드는 난수 상태
+	unsigned long long mTokenSeed;
+	Monitor mTokenSyncObject;
+
+#ifdef _WIN32
+	HANDLE mUDPThread;
+#else
+	pthread_t mUDPThread;
+#endif
+	bool mIsThreadCreated;
+	std::atomic<bool> mIsQuit;
+
+	LONG64 mSendDatagramCnt;
+	LONG64 mRecvDatagramCnt;
+	LONG64 mSendSyscallCnt;
+	LONG64 mRecvSyscallCnt;
+	LONG64 mResendCnt;
+};
@@ -1,8 +1,7 @@
-﻿#define _WINSOCKAPI_
-#include <Windows.h>
-
+﻿#include "Platform.h"
 #include "VBuffer.h"
 #include "Singleton.h"
+#include "SharedPacket.h"
 
 constexpr int MAX_VBUFFER_SIZE = 1024 * 50;
 constexpr int MAX_PBUFSIZE = 4096; // PacketPool에서 버퍼 한개당 size라는데 아직은 잘 모름
@@ -175,3 +174,16 @@ bool VBuffer::CopyBuffer(char* pDstBuffer)
 
 	return true;
 }
+
+SharedPacket* VBuffer::CreateSharedPacket()
+{
+	SharedPacket* pPacket = SharedPacket::Create(mCurrentBufSize);
+	if (nullptr == pPacket)
+	{
+		return nullptr;
+	}
+
+	CopyBuffer(pPacket->GetBuffer());
+
+	return pPacket;
+}
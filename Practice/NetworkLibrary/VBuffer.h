@@ -24,14 +24,11 @@
 // 수신하는 쪽에서는 송신하는 쪽에서 입력한 데이터 순서대로 읽어야 하기 때문에
 // 처리가 조금 더 복잡하다.
 
-#ifdef NETWORKLIBRARY_EXPORTS
-#define NETLIB_API __declspec(dllexport)
-#else
-#define NETLIB_API __declspec(dllimport)
-#endif
-
+#include "Platform.h"
 #include "Singleton.h"
 
+class SharedPacket;
+
 // Singleton class를 상속해서
 // 전역 위치 어디에서든 편하게 가변 길이 패킷을 처리하도록 했다.
 // 패킷 처리가 끝날 때까지
@@ -85,6 +82,11 @@ public:
 	// 실제 송신할 버퍼에 복사하는 함수
 	bool CopyBuffer(char* pDstBuffer);
 
+	// 여러 connection에게 보낼 패킷이라면
+	// connection마다 CopyBuffer()로 복사하지 않고 공유 패킷으로 한 번만 복사한다.
+	// Connection::SendShared()로 넣은 뒤에 Release()를 호출한다. 실패하면 nullptr
+	SharedPacket* CreateSharedPacket();
+
 public:
 	int GetMaxBufSize();
 	int GetCurrentBufSize();